@@ -1,5 +1,7 @@
-#include "Cylinder.h"
+#include "cylinder.h"
 #include <iostream>
+#include <cmath>
+#include <functional>
 
 using namespace std;
 
@@ -7,9 +9,152 @@ using namespace std;
 const int MIN_SECTOR_CNT = 3; //Cannot have a cylinder with less than 3 sides
 const int MIN_STACK_CNT = 1;  //If less than 1, we have a circle (no longer 3D)
 
+//Quarter turn taking the Y axis onto the given one. The columns are where x, y and z end up, every entry is 0 or +-1
+//so turning is exact.
+static glm::mat3 UpAxisFromY(int axis) {
+	if (axis == CYLINDER_AXIS_X) {
+		return glm::mat3(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+	if (axis == CYLINDER_AXIS_Z) {
+		return glm::mat3(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	}
+	return glm::mat3(1.0f);
+}
+
+//Rotation from one up axis to another, back to the Y frame the mesh is built in and out again, so turning
+//an existing mesh gives exactly what building it at the new axis gives
+static glm::mat3 UpAxisRotation(int from, int to) {
+	return UpAxisFromY(to) * glm::transpose(UpAxisFromY(from));
+}
+
+//Turns positions (around center) and normals of vertexCount vertices, stride floats apart
+static void TurnVertices(float* vertices, size_t vertexCount, int stride, int normalOffset, const glm::mat3& rotation, const glm::vec3& center) {
+	for (size_t i = 0; i < vertexCount; i++) {
+		float* vertex = vertices + i * stride;
+		glm::vec3 position = rotation * (glm::vec3(vertex[0], vertex[1], vertex[2]) - center) + center;
+		glm::vec3 normal = rotation * glm::vec3(vertex[normalOffset], vertex[normalOffset + 1], vertex[normalOffset + 2]);
+		vertex[0] = position.x;
+		vertex[1] = position.y;
+		vertex[2] = position.z;
+		vertex[normalOffset] = normal.x;
+		vertex[normalOffset + 1] = normal.y;
+		vertex[normalOffset + 2] = normal.z;
+	}
+}
+
+//Turns a vertex buffer already on the GPU through a read/write mapping, or a read back when it can't be mapped.
+//False when the mapping lost its contents, the buffer then has to be generated again.
+static bool TurnVertexBuffer(unsigned int vbo, int vertexCount, const glm::mat3& rotation, const glm::vec3& center) {
+	GLsizeiptr size = (GLsizeiptr)vertexCount * CYLINDER_VERTEX_FLOATS * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	float* mapped = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+	if (mapped != NULL) {
+		TurnVertices(mapped, vertexCount, CYLINDER_VERTEX_FLOATS, 3, rotation, center);
+		return glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+	}
+
+	vector<float> vertices((size_t)vertexCount * CYLINDER_VERTEX_FLOATS);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data());
+	TurnVertices(vertices.data(), vertexCount, CYLINDER_VERTEX_FLOATS, 3, rotation, center);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data());
+	return true;
+}
+
+//Creates a VAO with an interleaved vertex buffer and an index buffer, filled from vertices and indices or left
+//uninitialized when they are NULL. Attributes sit at the primitive layout's locations (position 0, normal 2, uv 3)
+//so the lit shaders take either layout, location 1 (color) is unused. The VAO stays bound.
+static void CreateIndexedMesh(const float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int& vao, unsigned int& vbo, unsigned int& ebo) {
+	const int stride = CYLINDER_VERTEX_FLOATS * sizeof(float);
+	GLsizeiptr vertexBytes = vertexCount * stride;
+	GLsizeiptr indexBytes = indexCount * sizeof(unsigned int);
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+	GetResourceRegistry().TrackBuffer(vbo, RESOURCE_VERTEX_BUFFER, vertexBytes, "Cylinder");
+
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+	GetResourceRegistry().TrackBuffer(ebo, RESOURCE_INDEX_BUFFER, indexBytes, "Cylinder");
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+}
+
+//Uploads an indexed mesh kept in CPU arrays
+static void UploadIndexedMesh(const vector<float>& vertices, const vector<unsigned int>& indices, unsigned int& vao, unsigned int& vbo, unsigned int& ebo) {
+	CreateIndexedMesh(vertices.data(), vertices.size() / CYLINDER_VERTEX_FLOATS, indices.data(), indices.size(), vao, vbo, ebo);
+	glBindVertexArray(0);
+}
+
+//Allocates both buffers and lets write fill them in place through glMapBufferRange, like GeneratePrimitiveVertexBuffer,
+//so neither array exists on the CPU. If a mapping fails or loses its contents on unmap the mesh is written once more
+//into temporary arrays and copied.
+static void GenerateIndexedMesh(size_t vertexCount, size_t indexCount, unsigned int& vao, unsigned int& vbo, unsigned int& ebo, const function<void(float*, unsigned int*)>& write) {
+	GLsizeiptr vertexBytes = vertexCount * CYLINDER_VERTEX_FLOATS * sizeof(float);
+	GLsizeiptr indexBytes = indexCount * sizeof(unsigned int);
+
+	CreateIndexedMesh(NULL, vertexCount, NULL, indexCount, vao, vbo, ebo);
+	if (vertexBytes == 0 || indexBytes == 0) {
+		glBindVertexArray(0);
+		return;
+	}
+
+	float* vertices = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	unsigned int* indices = (unsigned int*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	bool written = vertices != NULL && indices != NULL;
+	if (written) {
+		write(vertices, indices);
+	}
+	if (vertices != NULL) {
+		written = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE && written;
+	}
+	if (indices != NULL) {
+		written = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE && written;
+	}
+
+	if (!written) {
+		vector<float> vertexCopy(vertexCount * CYLINDER_VERTEX_FLOATS);
+		vector<unsigned int> indexCopy(indexCount);
+		write(vertexCopy.data(), indexCopy.data());
+		glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, vertexCopy.data());
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, indexCopy.data());
+	}
+	glBindVertexArray(0);
+}
+
+static void DeleteIndexedMesh(unsigned int& vao, unsigned int& vbo, unsigned int& ebo) {
+	GetResourceRegistry().ReleaseBuffer(vbo);
+	GetResourceRegistry().ReleaseBuffer(ebo);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+	vao = vbo = ebo = 0;
+}
+
+//Radial and vertical parts of the side normal, the side leans in by (base - top) over the height
+static void SideNormalScale(float baseRadius, float topRadius, float height, float& radial, float& vertical) {
+	float slope = baseRadius - topRadius;
+	float length = sqrt(height * height + slope * slope);
+	radial = height / length;
+	vertical = slope / length;
+}
+
 //Constructor
 Cylinder::Cylinder(float baseRadius, float topRadius, float height, int sectors,
-	int stacks, bool smooth, int up) : interleavedStride(32) {
+	int stacks, bool smooth, int up, glm::vec3 position, bool drawTop, bool drawBottom) : interleavedStride(32) {
+	Position = position;
+	TopDrawn = drawTop;
+	BtmDrawn = drawBottom;
 	Set(baseRadius, topRadius, height, sectors, stacks, smooth, up);
 }
 
@@ -17,13 +162,16 @@ Cylinder::Cylinder(float baseRadius, float topRadius, float height, int sectors,
 void Cylinder::Set(float baseRadius, float topRadius, float height, int sectors,
 	int stacks, bool smooth, int up) {
 
-	//Need a radius > 0
+	//Need a base radius > 0, the top may narrow to a point (a cone) or follow the base
 	if (baseRadius > 0) {
 		this->baseRadius = baseRadius;
 	}
-	if (topRadius > 0) {
+	if (topRadius >= 0) {
 		this->topRadius = topRadius;
 	}
+	else if (topRadius == CYLINDER_SAME_RADIUS) {
+		this->topRadius = this->baseRadius;
+	}
 
 	//Need a height greater than 0 (otherwise we are 2D)
 	if (height > 0) {
@@ -47,8 +195,10 @@ void Cylinder::Set(float baseRadius, float topRadius, float height, int sectors,
 	//Determine Up Axis
 	this->upAxis = up;
 	if (up < 1 || up > 3) {
-		this->upAxis = 3;
+		this->upAxis = CYLINDER_AXIS_Y;
 	}
+
+	BuildVertices();
 }
 
 void Cylinder::SetBaseRadius(float radius) {
@@ -99,20 +249,28 @@ void Cylinder::SetSmooth(bool smooth) {
 	}
 
 	this->smooth = smooth;
-	if (smooth) {
-		BuildVerticesSmooth();
-	}
-	else {
-		BuildVerticesFlat();
-	}
+	BuildVertices();
 }
 
 void Cylinder::SetUpAxis(int up) {
 	if (this->upAxis == up || up < 1 || up > 3)
 		return;
 
-	ChangeUpAxis(this->upAxis, up);
+	bool turned = ChangeUpAxis(this->upAxis, up);
 	this->upAxis = up;
+
+	//A mapped buffer lost its contents, generate everything again at the new axis
+	if (!turned) {
+		BuildVertices();
+	}
+}
+
+size_t Cylinder::GetCPUBytes() const {
+	return InterleavedVertices.capacity() * sizeof(float) + Indices.capacity() * sizeof(unsigned int) + Vertices.capacity() * sizeof(float);
+}
+
+bool Cylinder::HasAnalyticSurface() const {
+	return baseRadius == topRadius && upAxis == CYLINDER_AXIS_Y;
 }
 
 //Debug
@@ -129,10 +287,429 @@ void Cylinder::Print() const {
 		 << "Index Cnt: " << GetIndexCount() << "\n"
 		 << "Vertex Cnt: " << GetVertexCount() << "\n"
 		 << "Normal Cnt: " << GetNormalCount() << "\n"
-		 << "TexCoord Cnt: " << GetTexCoordCount() << "\n" << endl;
+		 << "TexCoord Cnt: " << GetTexCoordCount() << "\n"
+		 << "Stride: " << GetInterleavedStride() << " bytes\n" << endl;
 }
 
 void Cylinder::Draw() const {
-	//interleaved Array
-	glEnableClientState(GL_VERTEX_ARRAY);
-}
\ No newline at end of file
+	//interleaved Array, drawn through its indices
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, IndexCount, GL_UNSIGNED_INT, 0);
+}
+
+void Cylinder::DeallocateVertexArrayBuffers() {
+	if (VAO != 0) {
+		DeleteIndexedMesh(VAO, VBO, EBO);
+	}
+
+	for (size_t i = 1; i < LODs.size(); i++) {
+		if (LODs[i].VAO != 0) {
+			DeleteIndexedMesh(LODs[i].VAO, LODs[i].VBO, LODs[i].EBO);
+		}
+	}
+	LODs.clear();
+
+	if (PatchVAO != 0) {
+		GetResourceRegistry().ReleaseBuffer(PatchVBO);
+		glDeleteVertexArrays(1, &PatchVAO);
+		glDeleteBuffers(1, &PatchVBO);
+		PatchVAO = PatchVBO = 0;
+	}
+}
+
+void Cylinder::GenerateVertexArrayAndBuffer() {
+	if (VertexCount == 0) {
+		return;
+	}
+
+	//Copy the CPU arrays when there are some, otherwise generate straight into the mapped buffers (no CPU copy at all)
+	if (!InterleavedVertices.empty()) {
+		UploadIndexedMesh(InterleavedVertices, Indices, VAO, VBO, EBO);
+	}
+	else {
+		GenerateIndexedMesh(VertexCount, IndexCount, VAO, VBO, EBO, [this](float* vertices, unsigned int* indices) {
+			BuildMesh(sectorCount, stackCount, vertices, indices);
+		});
+	}
+
+	//Level 0 of the chain is this object
+	if (!LODs.empty()) {
+		LODs[0].VAO = VAO;
+		LODs[0].VBO = VBO;
+		LODs[0].EBO = EBO;
+	}
+}
+
+void Cylinder::UploadBuffers() {
+	if (VAO == 0) {
+		GenerateVertexArrayAndBuffer();
+	}
+	for (size_t i = 1; i < LODs.size(); i++) {
+		if (LODs[i].VAO == 0) {
+			GenerateLODBuffer(LODs[i]);
+		}
+	}
+	if (PatchVAO == 0 && !PendingPatches.empty()) {
+		UploadPatchVertices(PendingPatches, PatchVAO, PatchVBO);
+		vector<float>().swap(PendingPatches);
+	}
+}
+
+void Cylinder::ReleaseVertices() {
+	if (VAO != 0) {
+		vector<float>().swap(InterleavedVertices);
+		vector<unsigned int>().swap(Indices);
+		vector<float>().swap(Vertices);
+	}
+}
+
+void Cylinder::GenerateLODs(int levelCount) {
+
+	//Replaces the chain built before, if any
+	for (size_t i = 1; i < LODs.size(); i++) {
+		if (LODs[i].VAO != 0) {
+			DeleteIndexedMesh(LODs[i].VAO, LODs[i].VBO, LODs[i].EBO);
+		}
+	}
+	LODs.clear();
+	lodLevelCount = levelCount;
+
+	LODLevel full;
+	full.VAO = VAO;
+	full.VBO = VBO;
+	full.EBO = EBO;
+	full.VertexCount = VertexCount;
+	full.IndexCount = IndexCount;
+	full.SideCount = sectorCount;
+	full.SubDivisions = stackCount;
+	LODs.push_back(full);
+
+	for (int i = 1; i < levelCount; i++) {
+		int sectors = max(LOD_MIN_SIDES, sectorCount >> i);
+		int stacks = max(1, stackCount >> i);
+		if (sectors >= LODs.back().SideCount) {
+			break;
+		}
+
+		LODLevel level;
+		level.SideCount = sectors;
+		level.SubDivisions = stacks;
+		CalculateCounts(sectors, stacks, smooth, level.VertexCount, level.IndexCount);
+		if (HasCurrentGLContext()) {
+			GenerateLODBuffer(level);
+		}
+		LODs.push_back(level);
+	}
+}
+
+int Cylinder::SelectLOD(Camera& camera, const glm::mat4& model, const glm::mat4& projection, float viewportHeight, int currentLevel) {
+	if (LODs.size() < 2) {
+		return 0;
+	}
+
+	//Middle of the axis, turned the same way as the vertices
+	glm::vec3 center = Position + UpAxisFromY(upAxis) * glm::vec3(0.0f, height * 0.5f, 0.0f);
+	float radius = max(baseRadius, topRadius);
+
+	glm::vec3 worldCenter;
+	float worldRadius;
+	TransformBoundingSphere(model, center, sqrt(radius * radius + height * height * 0.25f), worldCenter, worldRadius);
+
+	float pixelRadius = camera.GetProjectedRadius(worldCenter, worldRadius, projection, viewportHeight);
+	return SelectLODLevel(pixelRadius, currentLevel, (int)LODs.size());
+}
+
+void Cylinder::DrawLOD(int level) {
+	if (LODs.empty()) {
+		Draw();
+		GetLODCounters().TrianglesDrawn += IndexCount / 3;
+		GetLODCounters().TrianglesFullDetail += IndexCount / 3;
+		GetLODCounters().DrawsPerLevel[0]++;
+		return;
+	}
+
+	level = min(max(level, 0), (int)LODs.size() - 1);
+	glBindVertexArray(LODs[level].VAO);
+	glDrawElements(GL_TRIANGLES, LODs[level].IndexCount, GL_UNSIGNED_INT, 0);
+
+	GetLODCounters().TrianglesDrawn += LODs[level].IndexCount / 3;
+	GetLODCounters().TrianglesFullDetail += LODs[0].IndexCount / 3;
+	GetLODCounters().DrawsPerLevel[level]++;
+}
+
+void Cylinder::GeneratePatches(int columns, int rows) {
+	vector<float> patches;
+	AddPatchGrid(patches, columns, rows, TESS_CYLINDER_SIDE);
+	if (BtmDrawn) {
+		AddPatchGrid(patches, columns, 1, TESS_CYLINDER_BOTTOM);
+	}
+	if (TopDrawn) {
+		AddPatchGrid(patches, columns, 1, TESS_CYLINDER_TOP);
+	}
+	PatchVertexCount = (int)(patches.size() / TESS_PATCH_ATTRIBUTES);
+
+	if (HasCurrentGLContext()) {
+		UploadPatchVertices(patches, PatchVAO, PatchVBO);
+	}
+	else {
+		PendingPatches.swap(patches);
+	}
+}
+
+void Cylinder::SetShapeUniforms(Shader& shader) {
+	shader.setVec3("shapeOrigin", Position);
+	shader.setVec3("shapeSize", baseRadius, height, 0.0f);
+}
+
+void Cylinder::DrawPatches(Shader& shader) {
+	SetShapeUniforms(shader);
+	DrawPatchArray(PatchVAO, PatchVertexCount);
+}
+
+void Cylinder::DrawProcedural(Shader& shader) {
+	//Reads the current dimensions and counts every call, so changing them shows up on the next draw
+	SetShapeUniforms(shader);
+	DrawProceduralSurfaces(shader, TESS_CYLINDER_SIDE, 1, sectorCount, stackCount);
+
+	//Bottom then top, consecutive surfaces so one instanced draw covers both
+	if (BtmDrawn || TopDrawn) {
+		DrawProceduralSurfaces(shader, BtmDrawn ? TESS_CYLINDER_BOTTOM : TESS_CYLINDER_TOP, (BtmDrawn && TopDrawn) ? 2 : 1, sectorCount, 1);
+	}
+}
+
+void Cylinder::BuildVertices() {
+	CalculateCounts(sectorCount, stackCount, smooth, VertexCount, IndexCount);
+
+	//Headless consumers always need the arrays, with a GL context and nothing reading them back the mesh is
+	//generated straight into its buffers instead
+	bool hasContext = HasCurrentGLContext();
+	if (PrimitiveRetainsVertices() || !hasContext) {
+		BuildMesh(sectorCount, stackCount, InterleavedVertices, Indices);
+		ExpandVertices();
+	}
+	else {
+		vector<float>().swap(InterleavedVertices);
+		vector<unsigned int>().swap(Indices);
+		vector<float>().swap(Vertices);
+	}
+
+	//Replace the buffers that exist, sizes may have changed
+	if (VAO != 0) {
+		DeleteIndexedMesh(VAO, VBO, EBO);
+	}
+	if (hasContext) {
+		GenerateVertexArrayAndBuffer();
+	}
+	if (!LODs.empty()) {
+		GenerateLODs(lodLevelCount);
+	}
+}
+
+void Cylinder::CalculateCounts(int sectors, int stacks, bool smoothMesh, int& vertexCount, int& indexCount) const {
+	int caps = (BtmDrawn ? 1 : 0) + (TopDrawn ? 1 : 0);
+
+	//Smooth: one column per ring point plus the seam, flat: two columns per side face
+	int sideVertices = smoothMesh ? (sectors + 1) * (stacks + 1) : sectors * 2 * (stacks + 1);
+	vertexCount = sideVertices + caps * (sectors + 1);
+	indexCount = sectors * stacks * 6 + caps * sectors * 3;
+}
+
+void Cylinder::BuildMesh(int sectors, int stacks, vector<float>& vertices, vector<unsigned int>& indices) const {
+	int vertexCount, indexCount;
+	CalculateCounts(sectors, stacks, smooth, vertexCount, indexCount);
+	vertices.resize((size_t)vertexCount * CYLINDER_VERTEX_FLOATS);
+	indices.resize(indexCount);
+	BuildMesh(sectors, stacks, vertices.data(), indices.data());
+}
+
+void Cylinder::BuildMesh(int sectors, int stacks, float* vertices, unsigned int* indices) const {
+	if (smooth) {
+		BuildVerticesSmooth(sectors, stacks, vertices, indices);
+	}
+	else {
+		BuildVerticesFlat(sectors, stacks, vertices, indices);
+	}
+}
+
+void Cylinder::BuildVerticesSmooth(int sectors, int stacks, float* vertices, unsigned int* indices) const {
+	const AngleRing& ring = GetAngleRing(sectors);
+	float radial, vertical;
+	SideNormalScale(baseRadius, topRadius, height, radial, vertical);
+
+	float u = (1.0f / (float)sectors);
+	float v = (1.0f / (float)stacks);
+	float divHeight = height / stacks;
+	int columnVertices = stacks + 1;
+
+	//Item i writes column i bottom to top and the cells between it and column i + 1. The last column is the seam:
+	//column 0's points again with u = 0, and it carries the cap centers.
+	ParallelForPrimitive(sectors + 1, columnVertices, [&](int i) {
+		int point = i % sectors;
+		glm::vec3 normal(ring.Cos[point] * radial, vertical, ring.Sin[point] * radial);
+
+		float* out = vertices + (size_t)i * columnVertices * CYLINDER_VERTEX_FLOATS;
+		for (int j = 0; j <= stacks; j++) {
+			float radius = baseRadius + (topRadius - baseRadius) * ((float)j / stacks);
+			float y = (j == stacks) ? height : divHeight * j;
+			out = WriteVertex(out, glm::vec3(radius * ring.Cos[point], y, radius * ring.Sin[point]), normal, 1 - (u * i), v * j);
+		}
+
+		if (i < sectors) {
+			unsigned int* cell = indices + (size_t)i * stacks * 6;
+			for (int j = 0; j < stacks; j++) {
+				unsigned int bottom = i * columnVertices + j;
+				unsigned int nextBottom = bottom + columnVertices;
+
+				//Right triangle: bottom, top, next top. Left triangle: next top, next bottom, bottom
+				*cell++ = bottom;
+				*cell++ = bottom + 1;
+				*cell++ = nextBottom + 1;
+				*cell++ = nextBottom + 1;
+				*cell++ = nextBottom;
+				*cell++ = bottom;
+			}
+		}
+
+		BuildCaps(i, sectors, stacks, ring, (sectors + 1) * columnVertices, vertices, indices);
+	});
+}
+
+void Cylinder::BuildVerticesFlat(int sectors, int stacks, float* vertices, unsigned int* indices) const {
+	const AngleRing& ring = GetAngleRing(sectors);
+	float radial, vertical;
+	SideNormalScale(baseRadius, topRadius, height, radial, vertical);
+
+	float u = (1.0f / (float)sectors);
+	float v = (1.0f / (float)stacks);
+	float divHeight = height / stacks;
+	int faceVertices = 2 * (stacks + 1);
+
+	//Item i writes side face i (its two edges, every stack sharing the face normal), the last item only cap centers
+	ParallelForPrimitive(sectors + 1, faceVertices, [&](int i) {
+		if (i < sectors) {
+			int next = (i + 1) % sectors;
+
+			//The face looks out through the middle of its two edges
+			glm::vec2 middle = glm::normalize(glm::vec2(ring.Cos[i] + ring.Cos[next], ring.Sin[i] + ring.Sin[next]));
+			glm::vec3 normal(middle.x * radial, vertical, middle.y * radial);
+
+			float* out = vertices + (size_t)i * faceVertices * CYLINDER_VERTEX_FLOATS;
+			for (int j = 0; j <= stacks; j++) {
+				float radius = baseRadius + (topRadius - baseRadius) * ((float)j / stacks);
+				float y = (j == stacks) ? height : divHeight * j;
+				out = WriteVertex(out, glm::vec3(radius * ring.Cos[i], y, radius * ring.Sin[i]), normal, 1 - (u * i), v * j);
+				out = WriteVertex(out, glm::vec3(radius * ring.Cos[next], y, radius * ring.Sin[next]), normal, 1 - (u * (i + 1)), v * j);
+			}
+
+			unsigned int* cell = indices + (size_t)i * stacks * 6;
+			for (int j = 0; j < stacks; j++) {
+				unsigned int bottom = i * faceVertices + j * 2;
+				unsigned int top = bottom + 2;
+
+				//Right triangle: bottom, top, next top. Left triangle: next top, next bottom, bottom
+				*cell++ = bottom;
+				*cell++ = top;
+				*cell++ = top + 1;
+				*cell++ = top + 1;
+				*cell++ = bottom + 1;
+				*cell++ = bottom;
+			}
+		}
+
+		BuildCaps(i, sectors, stacks, ring, sectors * faceVertices, vertices, indices);
+	});
+}
+
+void Cylinder::BuildCaps(int i, int sectors, int stacks, const AngleRing& ring, int sideVertices, float* vertices, unsigned int* indices) const {
+	int cap = 0;
+	for (int top = 0; top < 2; top++) {
+		if (!(top ? TopDrawn : BtmDrawn)) {
+			continue;
+		}
+
+		//Center first, then one vertex per ring point. Texture coordinates follow the ring like before.
+		unsigned int center = sideVertices + cap * (sectors + 1);
+		unsigned int* triangle = indices + (size_t)sectors * stacks * 6 + (size_t)cap * sectors * 3 + (size_t)i * 3;
+		float y = top ? height : 0.0f;
+		float radius = top ? topRadius : baseRadius;
+		glm::vec3 normal(0.0f, top ? 1.0f : -1.0f, 0.0f);
+		cap++;
+
+		if (i == sectors) {
+			WriteVertex(vertices + (size_t)center * CYLINDER_VERTEX_FLOATS, glm::vec3(0.0f, y, 0.0f), normal, 0.0f, 0.0f);
+			continue;
+		}
+
+		WriteVertex(vertices + (size_t)(center + 1 + i) * CYLINDER_VERTEX_FLOATS, glm::vec3(radius * ring.Cos[i], y, radius * ring.Sin[i]), normal, ring.Cos[i], ring.Sin[i]);
+
+		// Triangle connecting the center, current, and next vertices
+		triangle[0] = center;
+		triangle[1] = center + 1 + i;
+		triangle[2] = center + 1 + (i + 1) % sectors;
+	}
+}
+
+float* Cylinder::WriteVertex(float* out, const glm::vec3& local, const glm::vec3& normal, float u, float v) const {
+	glm::vec3 position = local;
+	glm::vec3 turnedNormal = normal;
+	if (upAxis != CYLINDER_AXIS_Y) {
+		glm::mat3 rotation = UpAxisFromY(upAxis);
+		position = rotation * local;
+		turnedNormal = rotation * normal;
+	}
+	position += Position;
+
+	out[0] = position.x;
+	out[1] = position.y;
+	out[2] = position.z;
+	out[3] = turnedNormal.x;
+	out[4] = turnedNormal.y;
+	out[5] = turnedNormal.z;
+	out[6] = u;
+	out[7] = v;
+	return out + CYLINDER_VERTEX_FLOATS;
+}
+
+bool Cylinder::ChangeUpAxis(int from, int to) {
+	glm::mat3 rotation = UpAxisRotation(from, to);
+
+	//CPU arrays
+	TurnVertices(InterleavedVertices.data(), InterleavedVertices.size() / CYLINDER_VERTEX_FLOATS, CYLINDER_VERTEX_FLOATS, 3, rotation, Position);
+	TurnVertices(Vertices.data(), Vertices.size() / PRIMITIVE_VERTEX_FLOATS, PRIMITIVE_VERTEX_FLOATS, 6, rotation, Position);
+
+	//GPU buffers, the indices don't change. Level 0 is copied from the CPU array while there still is one.
+	bool turned = true;
+	if (VAO != 0) {
+		if (!InterleavedVertices.empty()) {
+			glBindBuffer(GL_ARRAY_BUFFER, VBO);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, InterleavedVertices.size() * sizeof(float), InterleavedVertices.data());
+		}
+		else {
+			turned = TurnVertexBuffer(VBO, VertexCount, rotation, Position) && turned;
+		}
+	}
+	for (size_t i = 1; i < LODs.size(); i++) {
+		if (LODs[i].VAO != 0) {
+			turned = TurnVertexBuffer(LODs[i].VBO, LODs[i].VertexCount, rotation, Position) && turned;
+		}
+	}
+	return turned;
+}
+
+void Cylinder::ExpandVertices() {
+	glm::vec3 vertColor = glm::vec3(1.0f);
+
+	Vertices.resize((size_t)Indices.size() * PRIMITIVE_VERTEX_FLOATS);
+	float* out = Vertices.data();
+	for (unsigned int index : Indices) {
+		const float* vertex = &InterleavedVertices[(size_t)index * CYLINDER_VERTEX_FLOATS];
+		out = WritePrimitiveVertex(out, vertex[0], vertex[1], vertex[2], vertColor, glm::vec3(vertex[3], vertex[4], vertex[5]), vertex[6], vertex[7]);
+	}
+}
+
+void Cylinder::GenerateLODBuffer(LODLevel& level) {
+	CalculateCounts(level.SideCount, level.SubDivisions, smooth, level.VertexCount, level.IndexCount);
+	GenerateIndexedMesh(level.VertexCount, level.IndexCount, level.VAO, level.VBO, level.EBO, [this, &level](float* vertices, unsigned int* indices) {
+		BuildMesh(level.SideCount, level.SubDivisions, vertices, indices);
+	});
+}
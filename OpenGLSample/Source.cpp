@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <iomanip>
 #include "shader.h"
 #include "camera.h"
 #include "plane.h"
@@ -18,6 +19,27 @@
 #include "cube.h"
 #include "texture2d.h"
 #include "sphere.h"
+#include "softwarerasterizer.h"
+#include "bvh.h"
+#include "ringbuffer.h"
+#include "uniformblocks.h"
+#include "megabuffer.h"
+#include "texturearray.h"
+#include "material.h"
+#include "scene.h"
+#include "framepacer.h"
+#include "inputlatency.h"
+#include "inputrecorder.h"
+#include "regression.h"
+#include "microbench.h"
+#include "glcalltrace.h"
+#include "boundingsphere.h"
+#include "hud.h"
+#include "resourceregistry.h"
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
 
 //define PI
 #define M_PI 3.1415926535897932384626433832795
@@ -27,8 +49,11 @@ using namespace std;
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void applyMouseMovement(double xpos, double ypos, double eventTime);
+bool inputKeyDown(GLFWwindow* window, int key);
 void scroll_callback(GLFWwindow* window, double xOffset, double yOffset);
 void key_callback(GLFWwindow* window, int key, int scanCode, int action, int mods);
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void ToggleProjectionMatrix();
 glm::mat4  ResetModelView(float angle);
 
@@ -45,10 +70,39 @@ glm::mat4 projection; //Projection matrix
 bool useDirectionalLight = true;
 bool useFlashlight = false;
 
+//Cylinders and Spheres drawn as tessellated analytic surfaces instead of their vertex buffers (T toggles, needs GL 4.0)
+bool useTessellation = false;
+
+//Cylinders and Spheres generated in the vertex shader with no vertex buffer (B toggles). Tessellation wins when both are on.
+bool useProcedural = false;
+
+//Whole static scene from one megabuffer in a single glMultiDrawElementsIndirect (M toggles, needs GL 4.3)
+bool useMultiDraw = false;
+
+//Frame pacing, lowest latency or highest throughput (V toggles)
+FramePacingMode framePacingMode = FRAME_PACING_THROUGHPUT;
+
+//Input polled and the camera latched after the frame's waits, right before its uniforms are written,
+//instead of right after the previous swap (L toggles)
+bool lateLatchInput = true;
+
+//Frame time graph and render counters over the scene (H toggles)
+bool showHud = false;
+
+//Time from a camera input event to the submission of the frame that shows it
+InputLatencyMeter inputLatency;
+
+//Input sessions saved for, or played back from, reproducible runs
+InputRecorder inputRecorder;
+InputReplayer inputReplayer;
+
 float lastX = SCR_WIDTH / 2;
 float lastY = SCR_HEIGHT / 2;
 bool firstMouse = true;
 
+//Set by a left click, handled once per frame by casting a ray through the crosshair
+bool pickRequested = false;
+
 // Define a wobble parameters
 //float wobbleSpeed = 0.5f; // Adjust the speed of the wobble
 //float wobbleAmount = 30.0f; // Adjust the amount of wobble
@@ -58,55 +112,371 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
-    // glfw: initialize and configure
+    // command line
     // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    //--software [out.ppm] renders headless on the CPU, --frames N renders N frames for timing
+    //--bvh-bench [rays] builds the scene BVH headless and measures ray throughput
+    //--primitive-bench [sides] generates very dense Cylinders/Spheres headless, one thread versus the pool
+    //--lod-report renders from several camera distances and prints the LOD triangle counts and frame times
+    //--tessellation starts with the curved objects on the tessellation path
+    //--procedural starts with the curved objects generated in the vertex shader
+    //--scene path loads another scene description (text or binary), --compile-scene out.sceneb writes it as binary and exits
+    //--pacing latency|throughput picks the frame pacing mode, --fps-cap N caps the frame rate (0 for none)
+    //--record-input out.input saves the session's input on exit, --replay-input path plays one back at a fixed frame time and exits
+    //--regression suite.regression renders the suite's camera poses, checks them against its goldens and budgets and exits 1 on a failure,
+    //  --update-golden rewrites the goldens instead
+    //--microbench [out.jsonl] times primitive construction, texture decode/upload, uniform setters and the camera on their own,
+    //  appending the results to out.jsonl tagged with --bench-label text (the commit, say)
+    //--gl-trace [out.jsonl] counts GL calls per entry point and category every frame and logs the driver's performance
+    //  messages, printed on exit and appended to out.jsonl tagged with --bench-label
+    //--hud starts with the performance HUD shown
+    //--stream-textures loads only small mips and streams larger ones in as objects come close enough to show them
+    //--pack-assets out.pak [dirs] packs the shaders, scenes and images under dirs (shaderfiles textures scenes) into one archive and exits,
+    //  --archive path.pak reads assets from such an archive, loose files fill in what it lacks
+    //--texture-quality high|medium|low makes mips on the CPU (cached in the mipcache directory) and drops 0, 1 or 2 top levels,
+    //  --bake-textures fills that cache for every texture of the scene and exits
+    //--texture-budget MB evicts the least recently used textures down to smaller mips to stay under MB and restores them once used
+    //  again with room to spare, --memory-report lists every resource
+    //--latency-bench [frames] drives the camera with a synthetic 1000Hz mouse and prints input to submit latency, early then late latched
+    bool useSoftwareRenderer = false;
+    const char* softwareOutputPath = "software_render.ppm";
+    int softwareFrameCount = 1;
+    bool runBVHBenchmark = false;
+    int bvhBenchmarkRays = 1000000;
+    bool runPrimitiveBenchmark = false;
+    int primitiveBenchmarkSides = 10000;
+    bool runLODReport = false;
+    const char* scenePath = "scenes/candles.scene";
+    const char* compiledScenePath = NULL;
+    double frameRateCap = 0.0;
+    int latencyBenchFrames = 0;
+    const char* recordInputPath = NULL;
+    const char* replayInputPath = NULL;
+    const char* regressionSuitePath = NULL;
+    bool updateGolden = false;
+    const char* microbenchPath = NULL;
+    const char* benchLabel = "";
+    const char* glTracePath = NULL;
+    bool memoryReport = false;
+    bool streamTextures = false;
+    bool bakeTextures = false;
+    const char* packArchivePath = NULL;
+    vector<string> packDirectories;
+    const char* archivePath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--software") == 0) {
+            useSoftwareRenderer = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                softwareOutputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            softwareFrameCount = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--bvh-bench") == 0) {
+            runBVHBenchmark = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                bvhBenchmarkRays = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--primitive-bench") == 0) {
+            runPrimitiveBenchmark = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                primitiveBenchmarkSides = max(8, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--lod-report") == 0) {
+            runLODReport = true;
+        }
+        else if (strcmp(argv[i], "--tessellation") == 0) {
+            useTessellation = true;
+        }
+        else if (strcmp(argv[i], "--procedural") == 0) {
+            useProcedural = true;
+        }
+        else if (strcmp(argv[i], "--multidraw") == 0) {
+            useMultiDraw = true;
+        }
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            scenePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--compile-scene") == 0 && i + 1 < argc) {
+            compiledScenePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+            framePacingMode = strcmp(argv[++i], "latency") == 0 ? FRAME_PACING_LOW_LATENCY : FRAME_PACING_THROUGHPUT;
+        }
+        else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) {
+            frameRateCap = max(0.0, atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            recordInputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) {
+            replayInputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--regression") == 0 && i + 1 < argc) {
+            regressionSuitePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--update-golden") == 0) {
+            updateGolden = true;
+        }
+        else if (strcmp(argv[i], "--microbench") == 0) {
+            microbenchPath = "microbench.jsonl";
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                microbenchPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--gl-trace") == 0) {
+            glTracePath = "gltrace.jsonl";
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                glTracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            GetResourceRegistry().TextureBudget = (size_t)(max(0.0, atof(argv[++i])) * 1024.0 * 1024.0);
+        }
+        else if (strcmp(argv[i], "--memory-report") == 0) {
+            memoryReport = true;
+        }
+        else if (strcmp(argv[i], "--pack-assets") == 0 && i + 1 < argc) {
+            packArchivePath = argv[++i];
+            while (i + 1 < argc && argv[i + 1][0] != '-')
+                packDirectories.push_back(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--archive") == 0 && i + 1 < argc) {
+            archivePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--texture-quality") == 0 && i + 1 < argc) {
+            if (!SetTextureQualityPreset(argv[++i])) {
+                cout << "ERROR::TEXTURE::UNKNOWN_QUALITY " << argv[i] << endl;
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--bake-textures") == 0) {
+            bakeTextures = true;
+        }
+        else if (strcmp(argv[i], "--stream-textures") == 0) {
+            streamTextures = true;
+        }
+        else if (strcmp(argv[i], "--hud") == 0) {
+            showHud = true;
+        }
+        else if (strcmp(argv[i], "--bench-label") == 0 && i + 1 < argc) {
+            benchLabel = argv[++i];
+        }
+        else if (strcmp(argv[i], "--latency-bench") == 0) {
+            latencyBenchFrames = 120;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                latencyBenchFrames = max(1, atoi(argv[++i]));
+        }
+    }
 
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+    if (packArchivePath != NULL) {
+        if (packDirectories.empty())
+            packDirectories = { "shaderfiles", "textures", "scenes" };
+        return PackAssets(packArchivePath, packDirectories) ? 0 : -1;
+    }
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "My 3D Scene - Christopher Roelle", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    if (archivePath != NULL && !GetAssetArchive().Open(archivePath))
         return -1;
+
+    SceneDescription sceneDescription;
+    if (!LoadSceneDescription(scenePath, sceneDescription))
+        return -1;
+
+    if (compiledScenePath != NULL) {
+        if (!SaveSceneBinary(sceneDescription, compiledScenePath))
+            return -1;
+        cout << "SCENE::COMPILED " << scenePath << " TO " << compiledScenePath << endl;
+        return 0;
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    //Lock mouse to window and add a callback for mouse movement
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouse_callback);
+    if (bakeTextures) {
+        //Only the 1x1 level is asked for: read from a fresh cache, otherwise the whole chain is generated and cached
+        GetTextureQuality().CPUMips = true;
+        atomic<int> cached(0), failed(0);
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        ThreadPool::Shared().ParallelFor(0, (int)sceneDescription.Textures.size(), [&](int i) {
+            const SceneTextureDesc& texture = sceneDescription.Textures[i];
+            MipChainRequest request;
+            request.Path = texture.Path;
+            request.Channels = texture.HasAlpha ? 4 : 3;
+            request.FlipVertical = texture.FlipVertical;
+            request.WrapU = texture.RepeatU;
+            request.WrapV = texture.RepeatV;
+            request.MaxSize = 1;
+            request.LevelCount = 1;
+            MipChain chain;
+            if (!texture.GenMipMaps)
+                return;
+            if (!LoadMipChain(request, chain))
+                failed++;
+            else if (chain.FromCache)
+                cached++;
+        });
+        double bakeMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        cout << "MIPCHAIN::BAKED " << sceneDescription.Textures.size() << " TEXTURES::" << cached << " ALREADY CACHED::" << failed << " FAILED::IN "
+            << bakeMs << "ms (" << ThreadPool::Shared().ThreadCount() + 1 << " THREADS)" << endl;
+        return failed > 0 ? -1 : 0;
+    }
 
-    //Scroll callback
-    glfwSetScrollCallback(window, scroll_callback);
+    /*
+    * =====================
+    * Primitive generation benchmark (headless)
+    * =====================
+    */
+    if (runPrimitiveBenchmark) {
+        //Times one generation on the calling thread and one split over the pool, and checks both wrote the same vertices
+        auto benchmark = [](const char* name, const function<vector<float>()>& generate) {
+            ThreadPool* pool = PrimitiveGenerationPool();
+
+            PrimitiveGenerationPool() = NULL;
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            vector<float> serial = generate();
+            double serialMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+            PrimitiveGenerationPool() = pool;
+            start = chrono::high_resolution_clock::now();
+            vector<float> parallel = generate();
+            double parallelMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+            bool same = serial.size() == parallel.size() && memcmp(serial.data(), parallel.data(), serial.size() * sizeof(float)) == 0;
+            cout << "PRIMITIVE BENCH::" << name << "::" << serial.size() / PRIMITIVE_VERTEX_FLOATS << " VERTICES::" << serialMs << "ms (1 THREAD)::"
+                << parallelMs << "ms (" << ThreadPool::Shared().ThreadCount() + 1 << " THREADS)::" << (same ? "MATCH" : "MISMATCH") << endl;
+        };
+
+        int sides = primitiveBenchmarkSides;
+        benchmark(("CYLINDER " + to_string(sides) + " SIDES x 16").c_str(), [sides]() {
+            return Cylinder(1.0f, 1.0f, 1.0f, sides, 16).Vertices;
+        });
+
+        //A sphere is sides x sides cells, a tenth of the sides keeps it in memory
+        int sphereSides = max(8, sides / 10);
+        benchmark(("SPHERE " + to_string(sphereSides) + " SIDES").c_str(), [sphereSides]() {
+            return Sphere(glm::vec3(0.0f), 1.0f, 1.0f, sphereSides, false).Vertices;
+        });
+
+        //Many objects at once, each built by its own task, against one after the other
+        const int objectCount = 64;
+        int objectSides = max(8, sides / 10);
+        benchmark((to_string(objectCount) + " CYLINDERS " + to_string(objectSides) + " SIDES x 16").c_str(), [objectCount, objectSides]() {
+            vector<unique_ptr<Cylinder>> cylinders(objectCount);
+            auto build = [&cylinders, objectSides](int i) {
+                cylinders[i].reset(new Cylinder(1.0f, 1.0f, 1.0f, objectSides, 16, true, CYLINDER_AXIS_Y, glm::vec3((float)i, 0.0f, 0.0f)));
+            };
+            if (PrimitiveGenerationPool() != NULL)
+                PrimitiveGenerationPool()->ParallelFor(0, objectCount, build);
+            else
+                for (int i = 0; i < objectCount; i++)
+                    build(i);
+
+            vector<float> vertices;
+            for (const unique_ptr<Cylinder>& cylinder : cylinders)
+                vertices.insert(vertices.end(), cylinder->Vertices.begin(), cylinder->Vertices.end());
+            return vertices;
+        });
+        return 0;
+    }
 
-    //Key callback for single action buttons
-    glfwSetKeyCallback(window, key_callback);
+    bool headless = useSoftwareRenderer || runBVHBenchmark;
+    GLFWwindow* window = NULL;
 
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+    //A replay stands in for the live input, so it has to load before the callbacks are registered
+    if (!headless && replayInputPath && !inputReplayer.Load(replayInputPath))
         return -1;
+
+    unique_ptr<RegressionRun> regression;
+    if (!headless && regressionSuitePath) {
+        RegressionSuite suite;
+        if (!LoadRegressionSuite(regressionSuitePath, suite))
+            return -1;
+        regression.reset(new RegressionRun(suite, updateGolden));
     }
 
-    //Enable depth testing (will stay on until we disable with) glDisable(GL_DEPTH_TEST);
-    glEnable(GL_DEPTH_TEST);
+    //No window, no context. Primitives and textures stay CPU side.
+    if (!headless) {
+
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+        //Drivers only promise performance messages to debug contexts
+        if (glTracePath)
+            glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+
+        // glfw window creation
+        // --------------------
+        //Newest context first (4.x has tessellation), macOS stops at 4.1, 3.3 is the minimum the scene needs
+        const int contextVersions[][2] = { { 4, 3 }, { 4, 1 }, { 3, 3 } };
+        for (size_t i = 0; i < sizeof(contextVersions) / sizeof(contextVersions[0]) && window == NULL; i++) {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, contextVersions[i][0]);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, contextVersions[i][1]);
+            window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "My 3D Scene - Christopher Roelle", NULL, NULL);
+        }
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+        //Lock mouse to window and add a callback for mouse movement
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        //A replay calls the callbacks itself, live input would only disturb it
+        if (!inputReplayer.Playing) {
+            glfwSetCursorPosCallback(window, mouse_callback);
+
+            //Scroll callback
+            glfwSetScrollCallback(window, scroll_callback);
 
-    //TODO::SOME MESHES HAVE FLIPPED FACES, ENABLE BACK-FACE CULLING TO SEE THEM. NEED TO CORRECT THESE
-    //glEnable(GL_CULL_FACE);
-    //glCullFace(GL_BACK);
+            //Key callback for single action buttons
+            glfwSetKeyCallback(window, key_callback);
+
+            //Mouse button callback for picking
+            glfwSetMouseButtonCallback(window, mouse_button_callback);
+        }
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+
+        //Hooks go in over the loaded pointers, before the first call worth counting
+        if (glTracePath) {
+            InstallGLCallTrace();
+            InstallGLPerformanceMessages();
+        }
+
+        //Enable depth testing (will stay on until we disable with) glDisable(GL_DEPTH_TEST);
+        glEnable(GL_DEPTH_TEST);
+
+        //TODO::SOME MESHES HAVE FLIPPED FACES, ENABLE BACK-FACE CULLING TO SEE THEM. NEED TO CORRECT THESE
+        //glEnable(GL_CULL_FACE);
+        //glCullFace(GL_BACK);
+    }
+
+    /*
+    * =====================
+    * Microbenchmarks
+    * =====================
+    */
+    if (microbenchPath && !headless) {
+        Microbench bench;
+        RunMicrobenchSuite(bench, sceneDescription);
+        bench.Write(microbenchPath, benchLabel);
+        glfwTerminate();
+        return 0;
+    }
 
     // build and compile our shader program
     // ------------------------------------
@@ -117,147 +487,389 @@ int main()
     Shader lightCubeSampleShader("shaderfiles/lightCubeVertex.glsl", "shaderfiles/lightCubeFragm.glsl");
     Shader multiLightShader("shaderfiles/sampleMultiLightVertex.glsl", "shaderfiles/sampleMultiLightFragm.glsl");
 
-    //Models
-    // 
-    // TODO:: Implement Indices to cut down on extra verts
-    // 
-    //                       Position                       len    wid
-    Plane floorPlane = Plane(glm::vec3(0.0f, -0.01f, -0.3f), 3.0f,  8.0f);
+    //Analytic Cylinders/Spheres, same lighting as multiLightShader (ID stays 0 without GL 4.0)
+    Shader tessShader("shaderfiles/tessPrimitiveVertex.glsl", "shaderfiles/tessPrimitiveControl.glsl", "shaderfiles/tessPrimitiveEval.glsl", "shaderfiles/sampleMultiLightFragm.glsl");
+    bool tessellationSupported = IsTessellationSupported() && tessShader.ID != 0;
+    float maxTessLevel = tessellationSupported ? GetMaxTessellationLevel() : 1.0f;
+
+    //Buffer-less Cylinders/Spheres, same lighting as multiLightShader
+    Shader proceduralShader("shaderfiles/proceduralPrimitiveVertex.glsl", "shaderfiles/sampleMultiLightFragm.glsl");
+
+    //Static scene from the megabuffer, same lighting as multiLightShader (ID stays 0 without GL 4.3)
+    bool multiDrawSupported = IsMultiDrawSupported();
+    Shader multiDrawShader(multiDrawSupported ? "shaderfiles/multiDrawVertex.glsl" : NULL, multiDrawSupported ? "shaderfiles/multiDrawFragm.glsl" : NULL);
+    multiDrawSupported = multiDrawSupported && multiDrawShader.ID != 0;
+
+    //Camera, transforms and lights come from uniform blocks streamed through one ring buffer
+    BindSceneUniformBlocks(multiLightShader);
+    BindSceneUniformBlocks(multiDrawShader);
+    BindSceneUniformBlocks(tessShader);
+    BindSceneUniformBlocks(proceduralShader);
+    BindSceneUniformBlocks(lightCubeSampleShader);
+
+    //Material maps always sit on the same texture units
+    MaterialTable::SetSamplerUnits(multiLightShader);
+    MaterialTable::SetSamplerUnits(tessShader);
+    MaterialTable::SetSamplerUnits(proceduralShader);
+
+    RingBuffer uniformRing(GL_UNIFORM_BUFFER);
+    if (!headless)
+        std::cout << "RINGBUFFER::" << (uniformRing.Persistent ? "PERSISTENT" : "UNSYNCHRONIZED MAP") << "::" << uniformRing.RegionCount << " x " << uniformRing.RegionSize << " BYTES" << std::endl;
+
+    //Scene: textures decoded and meshes generated in parallel, uploaded here
+    Scene scene;
+    TextureStreamer textureStreamer;
+    scene.Build(sceneDescription, tessellationSupported, streamTextures ? &textureStreamer : NULL);
+    cout << "SCENE::" << scenePath << "::" << scene.Objects.size() << " OBJECTS::" << scene.Primitives.size() << " PRIMITIVES::" << scene.Textures.size() << " TEXTURES::"
+        << scene.GetTriangleCount() << " TRIANGLES::GENERATED IN " << scene.Stats.GenerateMs << "ms (" << scene.Stats.Threads << " THREADS)::UPLOADED IN " << scene.Stats.UploadMs << "ms" << endl;
 
-    //Candle Jar, Wax and Wicks
-    Cylinder candleJar = Cylinder(glm::vec3(0.0f,  0.0f, 0.0f), 0.5f, 0.75f, 40,   3,           false,   true); //No top, because its a candle holder
-    Cylinder candle = Cylinder(glm::vec3(0.0f, 0.01f, 0.0f), 0.49f, 0.3f, 40, 1, true, false);
+    //Initial Set Camera Projection Matrix
+    ToggleProjectionMatrix();
 
-    Cylinder wick1 = Cylinder(glm::vec3( 0.20f, 0.3f,  0.15f), 0.05f, 0.1f, 8, 1, true, false);
-    Cylinder wick2 = Cylinder(glm::vec3(-0.20f, 0.3f,  0.15f), 0.05f, 0.1f, 8, 1, true, false);
-    Cylinder wick3 = Cylinder(glm::vec3(  0.0f, 0.3f, -0.20f), 0.05f, 0.1f, 8, 1, true, false);
+    //Flashlight cone
+    float spotLightCutOff = glm::cos(glm::radians(scene.SpotLight.CutOffDegrees));
+    float spotLightOuterCutOff = glm::cos(glm::radians(scene.SpotLight.OuterCutOffDegrees));
 
-    //Pumpkin Holder
-    Sphere pumpkinHolderBase = Sphere(glm::vec3(1.5f, 0.0f, 0.5f), 0.4f, 0.2f, 30, true);//position, radLong, radLat, sides, semi
-    Cylinder pumpkinHolderStem = Cylinder(glm::vec3(1.5f, 0.17f, 0.5f), 0.2f, 0.2f, 30, 3, false, false); //position, rad, height, sides, subdivs, draw top, draw btm
-    Cylinder pumpkinHolderBody = Cylinder(glm::vec3(1.5f, 0.37f, 0.5f), 0.6f, 1.5f, 40, 3, false, true); //position, rad, height, sides, subdivs, draw top, draw btm
+    //Light cubes of the point lights past the shader's array are still drawn, they just don't light anything
+    int shadedPointLights = min((int)scene.PointLights.size(), NR_POINT_LIGHTS);
 
-    //Pumpkin
-    Sphere pumpkinBody = Sphere(glm::vec3(0.0f, 0.0f, 0.0f), 0.4f, 0.3f, 15, false);
-    Cylinder pumpkinStem = Cylinder(glm::vec3(0.0f, 0.28f, 0.0f), 0.045f, 0.08f, 15, 3, true, false); //position, rad, height, sides, subdivs, draw top, draw btm
+    /*
+    * =====================
+    * Scene BVH (picking and ray queries)
+    * =====================
+    */
+    BVH sceneBVH;
+    vector<string> sceneObjectNames;
 
-    //Black Candle Jar, similar in height as the pumpkin holder.
-    Cylinder blackJar = Cylinder(glm::vec3(-1.1f, 0.0f, 0.85f), 0.6f, 1.9f, 40, 3, false, true);
+    //Bounds for texture streaming, taken while the vertices are still on the CPU
+    vector<BoundingSphere> objectBounds;
 
+    for (const SceneObjectDesc& object : scene.Objects) {
+        sceneBVH.AddObject(scene.Primitives[object.Primitive].GetVertices(), object.Model);
+        sceneObjectNames.push_back(object.Name);
+        objectBounds.push_back(ComputeBoundingSphere(scene.Primitives[object.Primitive].GetVertices(), object.Model));
+    }
 
-    //Build the wick array
-    vector<float> candleWicks;
-    candleWicks.insert(candleWicks.end(), wick1.Vertices.begin(), wick1.Vertices.end());
-    candleWicks.insert(candleWicks.end(), wick2.Vertices.begin(), wick2.Vertices.end());
-    candleWicks.insert(candleWicks.end(), wick3.Vertices.begin(), wick3.Vertices.end());
+    sceneBVH.Build();
+    cout << "BVH::" << sceneBVH.GetTriangleCount() << " TRIANGLES::" << sceneBVH.GetNodeCount() << " NODES::BUILT IN " << sceneBVH.BuildMs << "ms" << endl;
+
+    /*
+    * =====================
+    * BVH Benchmark (headless)
+    * =====================
+    */
+    if (runBVHBenchmark) {
+        mt19937 rng(1234);
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        //Primary rays through random pixels of the default camera, and rays from random points above the floor in random directions
+        vector<BVHRay> primaryRays(bvhBenchmarkRays);
+        vector<BVHRay> randomRays(bvhBenchmarkRays);
+        glm::mat4 inverseViewProjection = glm::inverse(projection * camera.GetViewMatrix());
+
+        for (int i = 0; i < bvhBenchmarkRays; i++) {
+            glm::vec4 farPoint = inverseViewProjection * glm::vec4(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f, 1.0f, 1.0f);
+            primaryRays[i] = BVHRay(camera.Position, glm::normalize(glm::vec3(farPoint) / farPoint.w - camera.Position));
+
+            glm::vec3 origin(unit(rng) * 4.0f - 2.0f, unit(rng) * 2.0f, unit(rng) * 4.0f - 2.0f);
+            glm::vec3 direction;
+            do {
+                direction = glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.0f - 1.0f;
+            } while (glm::dot(direction, direction) > 1.0f || glm::dot(direction, direction) < 1e-4f);
+            randomRays[i] = BVHRay(origin, glm::normalize(direction));
+        }
 
-    Cube lightCube = Cube(glm::vec3(0.0f), 0.05f, 0.05f, 0.05f);
+        struct BenchmarkCase { const char* name; const vector<BVHRay>* rays; bool anyHit; };
+        BenchmarkCase cases[] = {
+            { "PRIMARY CLOSEST", &primaryRays, false },
+            { "PRIMARY ANY", &primaryRays, true },
+            { "RANDOM CLOSEST", &randomRays, false },
+            { "RANDOM ANY", &randomRays, true }
+        };
+
+        for (const BenchmarkCase& benchmark : cases) {
+            int hits = 0;
+            double singleThread = sceneBVH.Benchmark(*benchmark.rays, benchmark.anyHit, NULL, &hits);
+            double multiThread = sceneBVH.Benchmark(*benchmark.rays, benchmark.anyHit, &ThreadPool::Shared());
+            cout << "BVH BENCH::" << benchmark.name << "::" << hits << "/" << bvhBenchmarkRays << " HIT::"
+                << singleThread / 1e6 << " MRAYS/S (1 THREAD)::" << multiThread / 1e6 << " MRAYS/S (" << ThreadPool::Shared().ThreadCount() + 1 << " THREADS)" << endl;
+        }
 
+        //Refit after moving the pumpkins, versus a full rebuild
+        for (int object = 0; object < sceneBVH.GetObjectCount(); object++) {
+            if (sceneObjectNames[object] == "Pumpkin" || sceneObjectNames[object] == "Pumpkin Stem")
+                sceneBVH.SetObjectTransform(object, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f)) * ResetModelView(180.0f));
+        }
+        sceneBVH.Refit();
+        double refitMs = sceneBVH.RefitMs;
+        sceneBVH.Build();
+        cout << "BVH BENCH::REFIT " << refitMs << "ms::REBUILD " << sceneBVH.BuildMs << "ms" << endl;
+        return 0;
+    }
 
-    //Texture stuff
-    //Generate and store textures (Default constructor: FilePath, hasAlphaChannel), Texture2D.Texture to return the texture data
-    Texture2D groundPlaneDiffuseTexture = Texture2D("textures/blackWood-diffuse.jpg", false);
-    Texture2D groundPlaneSpecularTexture = Texture2D("textures/blackWood-specular.jpg", false);
-    
-    Texture2D ceramicDiffuseTexture = Texture2D("textures/ceramicJar-diffuse.jpg", false);
-    Texture2D ceramicBlackDiffuseTexture = Texture2D("textures/ceramicJarBlack-diffuse.jpg", false);
-    Texture2D ceramicSpecularTexture = Texture2D("textures/ceramicJar-specular.png", true);
+    /*
+    * =====================
+    * Software Renderer (headless)
+    * =====================
+    */
+    if (useSoftwareRenderer) {
+        SoftwareRasterizer rasterizer(SCR_WIDTH, SCR_HEIGHT);
+        cout << "SOFTWARE RENDERER::" << SCR_WIDTH << "x" << SCR_HEIGHT << "::THREADS " << ThreadPool::Shared().ThreadCount() + 1 << endl;
+
+        //Materials, the same table the GL path binds
+        vector<SoftwareMaterial> softwareMaterials;
+        for (const Material& sceneMaterial : scene.Materials.Materials) {
+            SoftwareMaterial material;
+            material.Diffuse = rasterizer.GetTexture(*sceneMaterial.Diffuse);
+            material.Specular = rasterizer.GetTexture(*sceneMaterial.Specular);
+            material.Shininess = sceneMaterial.Shininess;
+            if (sceneMaterial.HasOverlay()) {
+                material.UseOverlayTexture = true;
+                material.OverlayDiffuse = rasterizer.GetTexture(*sceneMaterial.OverlayDiffuse);
+                material.OverlaySpecular = rasterizer.GetTexture(*sceneMaterial.OverlaySpecular);
+            }
+            softwareMaterials.push_back(material);
+        }
 
-    Texture2D waxDiffuseTexture = Texture2D("textures/wax-diffuse.jpg", false);
-    Texture2D waxSpecularTexture = Texture2D("textures/wax-specular.jpg", false);
+        //Lights
+        rasterizer.DirLight.Enabled = useDirectionalLight && scene.DirLight.Enabled;
+        rasterizer.DirLight.Direction = scene.DirLight.Direction;
+        rasterizer.DirLight.Ambient = scene.DirLight.Ambient;
+        rasterizer.DirLight.Diffuse = scene.DirLight.Diffuse;
+        rasterizer.DirLight.Specular = scene.DirLight.Specular;
+
+        for (int i = 0; i < shadedPointLights; i++) {
+            const ScenePointLightDesc& light = scene.PointLights[i];
+            rasterizer.PointLights[i].Position = light.Position;
+            rasterizer.PointLights[i].Ambient = light.Color / 0.5f;
+            rasterizer.PointLights[i].Diffuse = light.Color / 0.5f;
+            rasterizer.PointLights[i].Specular = light.Color / 0.5f;
+            rasterizer.PointLights[i].Constant = light.Attenuation.x;
+            rasterizer.PointLights[i].Linear = light.Attenuation.y;
+            rasterizer.PointLights[i].Quadratic = light.Attenuation.z;
+        }
 
-    Texture2D wickDiffuseTexture = Texture2D("textures/wick-diffuse.jpg", false);
-    Texture2D wickSpecularTexture = Texture2D("textures/wick-specular.jpg", false);
-    
-    Texture2D candleLabelDiffuseTexture = Texture2D("textures/label-diffuse.png", true, false, true, true, true); //Using Overload to turn off repeat of texture
-    Texture2D candleLabelSpecularTexture = Texture2D("textures/label-specular.png", true, false, true, true, true); //Using Overload to turn off repeat of texture
+        rasterizer.SpotLight.Enabled = useFlashlight;
+        rasterizer.SpotLight.Position = camera.Position;
+        rasterizer.SpotLight.Direction = camera.Front;
+        rasterizer.SpotLight.Diffuse = glm::vec3(1.0f);
+        rasterizer.SpotLight.Specular = glm::vec3(1.0f);
+        rasterizer.SpotLight.Constant = scene.SpotLight.Attenuation.x;
+        rasterizer.SpotLight.Linear = scene.SpotLight.Attenuation.y;
+        rasterizer.SpotLight.Quadratic = scene.SpotLight.Attenuation.z;
+        rasterizer.SpotLight.CutOff = spotLightCutOff;
+        rasterizer.SpotLight.OuterCutOff = spotLightOuterCutOff;
+
+        double setupMs = 0.0;
+        double rasterMs = 0.0;
+
+        for (int frame = 0; frame < softwareFrameCount; frame++) {
+            rasterizer.BeginFrame(camera.GetViewMatrix(), projection, camera.Position, glm::vec3(0.1f));
+
+            for (const SceneObjectDesc& object : scene.Objects) {
+                rasterizer.Draw(scene.Primitives[object.Primitive].GetVertices(), object.Model, softwareMaterials[object.Material]);
+            }
+
+            //Light cubes
+            if (scene.LightMesh >= 0) {
+                SoftwareMaterial lightMaterial;
+                lightMaterial.Unlit = true;
+                for (const ScenePointLightDesc& light : scene.PointLights) {
+                    lightMaterial.UnlitColor = light.Color;
+                    rasterizer.Draw(scene.Primitives[scene.LightMesh].GetVertices(), glm::scale(glm::translate(glm::mat4(1.0f), light.Position), glm::vec3(light.CubeScale)), lightMaterial);
+                }
+            }
+
+            rasterizer.EndFrame();
+
+            setupMs += rasterizer.Stats.SetupMs;
+            rasterMs += rasterizer.Stats.RasterMs;
+        }
 
-    Texture2D backWallDiffuseTexture = Texture2D("textures/backWall-diffuse.jpg", false);
-    Texture2D backWallSpecularTexture = Texture2D("textures/backWall-specular.jpg", false);
+        double frameMs = (setupMs + rasterMs) / softwareFrameCount;
+        cout << "SOFTWARE RENDERER::TRIANGLES " << rasterizer.Stats.TrianglesSubmitted << " (" << rasterizer.Stats.TrianglesSetUp << " after clipping)" << endl;
+        cout << "SOFTWARE RENDERER::BIN ENTRIES " << rasterizer.Stats.BinEntries << "::FRAGMENTS " << rasterizer.Stats.FragmentsShaded << endl;
+        cout << "SOFTWARE RENDERER::SETUP " << setupMs / softwareFrameCount << "ms::RASTER " << rasterMs / softwareFrameCount << "ms::FRAME " << frameMs << "ms" << endl;
+        cout << "SOFTWARE RENDERER::" << (frameMs > 0.0 ? 1000.0 / frameMs : 0.0) << " FPS::"
+            << (frameMs > 0.0 ? rasterizer.Stats.TrianglesSubmitted / (frameMs * 1000.0) : 0.0) << " MTRIS/S" << endl;
 
-    Texture2D silverDiffuseTexture = Texture2D("textures/silver-diffuse.jpg", false);
-    Texture2D silverSpecularTexture = Texture2D("textures/silver-specular.jpg", false);
+        rasterizer.WritePPM(softwareOutputPath);
+        return 0;
+    }
 
-    Texture2D pumpkinDiffuseTexture = Texture2D("textures/pumpkin-diffuse.jpg", false);
-    Texture2D pumpkinSpecularTexture = Texture2D("textures/pumpkin-specular.jpg", false);
+    /*
+    * =====================
+    * Multi draw scene (megabuffer + indirect commands)
+    * =====================
+    */
+    //Everything the lit pass draws, at full detail, in one indirect call. Objects sharing a primitive share one copy of its geometry.
+    //Material textures are packed into layer arrays so nothing is bound between draws.
+    SceneMultiDraw sceneMultiDraw;
+    TextureArrayBuilder materialTextureArrays;
+    if (multiDrawSupported) {
+        //Surface textures repeat, the label overlay is clamped, so they land in two arrays
+        vector<int> diffuseHandles, specularHandles, overlayDiffuseHandles, overlaySpecularHandles;
+        for (const Material& material : scene.Materials.Materials) {
+            diffuseHandles.push_back(materialTextureArrays.Add(*material.Diffuse));
+            specularHandles.push_back(materialTextureArrays.Add(*material.Specular));
+            overlayDiffuseHandles.push_back(material.HasOverlay() ? materialTextureArrays.Add(*material.OverlayDiffuse) : -1);
+            overlaySpecularHandles.push_back(material.HasOverlay() ? materialTextureArrays.Add(*material.OverlaySpecular) : -1);
+        }
+        materialTextureArrays.Build();
+
+        //Same indices as the material table
+        for (size_t i = 0; i < scene.Materials.Materials.size(); i++) {
+            MultiDrawMaterial material;
+            material.DiffuseLayer = materialTextureArrays.GetLayer(diffuseHandles[i]).Layer;
+            material.SpecularLayer = materialTextureArrays.GetLayer(specularHandles[i]).Layer;
+            if (overlayDiffuseHandles[i] >= 0) {
+                material.OverlayDiffuseLayer = materialTextureArrays.GetLayer(overlayDiffuseHandles[i]).Layer;
+                material.OverlaySpecularLayer = materialTextureArrays.GetLayer(overlaySpecularHandles[i]).Layer;
+                sceneMultiDraw.OverlayTextures = materialTextureArrays.GetArrayTexture(overlayDiffuseHandles[i]);
+            }
+            material.Shininess = scene.Materials.Materials[i].Shininess;
+            sceneMultiDraw.AddMaterial(material);
+        }
+        sceneMultiDraw.SurfaceTextures = materialTextureArrays.GetArrayTexture(diffuseHandles[0]);
 
-    //Initial Set Camera Projection Matrix
-    ToggleProjectionMatrix();
+        //Same draw order as the per object path
+        for (const SceneObjectDesc& object : scene.Objects) {
+            sceneMultiDraw.AddDraw(scene.Primitives[object.Primitive].GetVertices(), object.Model, object.Material);
+        }
 
-    //Adjust the intensity of the values
-    float keyIntensity = 1.0f;
-    float candleIntensity = 0.5f;
+        sceneMultiDraw.Upload();
+        cout << "MULTIDRAW::" << sceneMultiDraw.Commands.size() << " DRAWS::" << sceneMultiDraw.Materials.size() << " MATERIALS::"
+            << sceneMultiDraw.Geometry.UploadedVertexCount << " UNIQUE VERTICES::" << sceneMultiDraw.Geometry.UploadedIndexCount << " INDICES" << endl;
+    }
 
-    glm::vec3 keyLightPosition = glm::vec3(0.0f, 3.0f, 3.0);
-    glm::vec3 keyLightColor = glm::vec3(0.3f);
-    glm::vec3 keyLightAttenuation = glm::vec3(1.0f, 0.09f, 0.032f);
+    //The BVH and the megabuffer have their own copies now, the meshes only need their GPU buffers from here on
+    size_t cpuVertexBytes = scene.GetCPUVertexBytes();
+    scene.ReleaseVertices();
+    cout << "SCENE::CPU VERTICES " << cpuVertexBytes / 1024 << "KB::RELEASED TO " << scene.GetCPUVertexBytes() / 1024 << "KB" << endl;
 
-    //Point Lights
-    glm::vec3 candleLightPositions[] = {
-        glm::vec3(wick1.Position.x, wick1.Position.y + wick1.Dimensions.y, wick1.Position.z), //candle light 1
-        glm::vec3(wick2.Position.x, wick2.Position.y + wick2.Dimensions.y, wick2.Position.z), //candle light 2
-        glm::vec3(wick3.Position.x, wick3.Position.y + wick3.Dimensions.y, wick3.Position.z)  //candle light 3
-    };
+    GetResourceRegistry().SetCPUBytes("scene vertices", RESOURCE_CPU_VERTICES, scene.GetCPUVertexBytes());
+    GetResourceRegistry().SetCPUBytes("BVH", RESOURCE_CPU_OTHER, sceneBVH.GetMemoryBytes());
+    GetResourceRegistry().Report(memoryReport);
 
-    glm::vec3 candleLightColors[] = {
-        //glm::vec3(1.0f, 1.0f, 1.0f) * keyIntensity,    //Key Light
-        glm::vec3(1.0f, 0.0f, 0.0f) * candleIntensity, //candle light 1
-        glm::vec3(0.5f, 0.5f, 0.0f) * candleIntensity, //candle light 1
-        glm::vec3(1.0f, 0.5f, 0.0f) * candleIntensity  //candle light 1
-    };
+    //Current LOD of every object, kept between frames for the hysteresis
+    vector<int> objectLODs(scene.Objects.size(), 0);
 
-    //CONSTANT, LINEAR, QUADRATIC
-    glm::vec3 candleLightAttenuations[]{
-        glm::vec3(1.0f, 0.1f, 7.8f),
-        glm::vec3(1.0f, 0.1f, 7.8f),
-        glm::vec3(1.0f, 0.1f, 7.8f)
+    //Streams a model matrix and its normal matrix into the ring buffer and binds them for the next draw
+    auto setModel = [&](const glm::mat4& objectModel) {
+        ObjectBlock* objectData = uniformRing.MapUniformBlock<ObjectBlock>(OBJECT_BLOCK_BINDING);
+        objectData->Model = objectModel;
+        objectData->NormalMatrix = NormalMatrix(objectModel);
+        uniformRing.Unmap();
     };
 
+    //Program the curved objects are drawn with this frame, multiLightShader, tessShader or proceduralShader
+    Shader* litShader = &multiLightShader;
 
-    //Positions of the individual pumpkins in the container.
-    glm::vec3 pumpkinPositions[]{
-        glm::vec3(1.5f, 0.7f, 0.5f),
-        glm::vec3(1.4f, 1.3f, 0.4f),
-        glm::vec3(1.7f, 1.7f, 0.7f),
-        glm::vec3(1.25f, 1.9f, 0.4f),
-        glm::vec3(1.7f, 1.83f, 0.3f),
-        glm::vec3(1.3f, 1.83f, 0.8f),
+    //Selects and draws the LOD for the current model matrix (generic so it takes Cylinders and Spheres).
+    //On the tessellation path the shaders pick the detail instead, the procedural path draws the full object.
+    auto drawWithLOD = [&](auto& object, const glm::mat4& objectModel, int& currentLOD) {
+        if (litShader == &tessShader) {
+            object.DrawPatches(tessShader);
+            return;
+        }
+        if (litShader == &proceduralShader) {
+            object.DrawProcedural(proceduralShader);
+            return;
+        }
+        currentLOD = object.SelectLOD(camera, objectModel, projection, (float)SCR_HEIGHT, currentLOD);
+        object.DrawLOD(currentLOD);
     };
 
-    //Ratations of the individual pumpkins in the container.
-    float pumpkinRotationAngles[]{
-    0.0f,
-    15.0f,
-    -20.0f,
-    25.0f,
-    -15.0f,
-    19.0f
-    };
+    //LOD report: fixed camera distances, a number of frames each
+    const float lodReportDistances[] = { 2.0f, 5.0f, 10.0f, 20.0f, 40.0f };
+    const int lodReportDistanceCount = sizeof(lodReportDistances) / sizeof(lodReportDistances[0]);
+    const int lodReportFrames = 60;
+    int lodReportDistance = 0;
+    int lodReportFrame = 0;
+    double lodReportFrameTime = 0.0;
+    long long lodReportTriangles = 0;
+    long long lodReportDraws[LOD_THRESHOLD_COUNT + 1] = {};
 
-    //Scales of the individual pumpkins in the container.
-    float pumpkinScales[]{
-        1.0f,
-        1.0f,
-        0.75f,
-        0.75f,
-        0.80f,
-        0.5f
-    };
+    //Frames in flight, swap interval and the frame rate cap
+    FramePacer framePacer(framePacingMode, frameRateCap);
 
-    //TODO::ADD ATTENUATION ARRAY FOR THE POINT LIGHTS
+    PerfHud hud(uniformRing);
+
+    if (runLODReport) {
+        glfwSwapInterval(0); //Don't time vsync
+        cout << "LOD REPORT::" << lodReportFrames << " FRAMES PER DISTANCE" << endl;
+    }
+
+    if (regression) {
+        glfwSwapInterval(0); //Don't time vsync
+        cout << "REGRESSION::" << regression->Suite.Poses.size() << " POSES::" << regression->Suite.Frames << " FRAMES EACH" << endl;
+    }
+
+    //Latency bench: the same frames early latched, then late latched, under whatever pacing was picked
+    unique_ptr<SyntheticMouseInput> syntheticMouse;
+    int latencyBenchFrame = 0;
+    if (latencyBenchFrames > 0) {
+        lateLatchInput = false;
+        syntheticMouse.reset(new SyntheticMouseInput(SCR_WIDTH / 2.0f, SCR_HEIGHT / 2.0f, glfwGetTime()));
+        cout << "LATENCY BENCH::" << latencyBenchFrames << " FRAMES PER MODE::SYNTHETIC MOUSE " << syntheticMouse->RateHz << "HZ" << endl;
+    }
+
+    if (recordInputPath)
+        inputRecorder.Start(glfwGetTime());
+
+    //Calls so far were loading
+    if (glTracePath)
+        GetGLCallTrace().BeginFrames();
+
+    //OS events, plus the synthetic mouse's events generated since the last poll
+    auto pollInput = [&]() {
+        glfwPollEvents();
+        if (syntheticMouse) {
+            syntheticMouse->Poll(glfwGetTime(), [](double eventTime, float x, float y) {
+                applyMouseMovement(x, y, eventTime);
+            });
+        }
+    };
 
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
     {
+        //Pacing first, whatever it waits for happens before this frame's timing and input
+        if (framePacer.Mode != framePacingMode) {
+            framePacer.Report();
+            framePacer.SetMode(framePacingMode);
+        }
+        framePacer.BeginFrame();
+
+        if (runLODReport) {
+            camera.Position = glm::vec3(0.0f, 1.0f, lodReportDistances[lodReportDistance]);
+        }
+        GetLODCounters() = LODCounters();
+        GetRenderCounters() = RenderCounters();
+        GetResourceRegistry().BeginFrame(); //Over the texture budget, evicts before anything is bound
+        textureStreamer.Update();
+        if (regression)
+            glFinish(); //The last frame's GPU work would otherwise land in this frame's CPU time on a software GL
+        double frameStart = glfwGetTime();
+
+        //Decided once, a toggle mid frame would leave the HUD's queries open. Never over a regression capture.
+        bool hudFrame = showHud && !regression;
+        if (hudFrame)
+            hud.BeginFrame();
+
         //Delta Time stuff
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        if (inputReplayer.Playing)
+            deltaTime = inputReplayer.DeltaTime; //Simulated, so the camera moves the same however long frames take
 
         // input
         // -----
-        processInput(window);
+        //Early latch: events were polled right after the last swap, everything the frame waited for since has aged them
+        if (!lateLatchInput)
+            processInput(window);
 
         // render
         // ------
@@ -275,195 +887,143 @@ int main()
         * =====================
         */
 
+        //Late latch: poll now that the waiting is done, the camera is as new as it can be when the uniforms are written
+        if (lateLatchInput) {
+            pollInput();
+            processInput(window);
+        }
+
+        //Picking, ray from the camera through the center of the screen
+        if (pickRequested) {
+            pickRequested = false;
+            BVHHit hit;
+            if (sceneBVH.Intersect(BVHRay(camera.Position, camera.Front), hit))
+                std::cout << "PICKED::" << sceneObjectNames[hit.Object] << "::DISTANCE " << hit.T << std::endl;
+            else
+                std::cout << "PICKED::NOTHING" << std::endl;
+        }
+
+        if (regression)
+            regression->ApplyPose(camera);
+
         glm::mat4 view = camera.GetViewMatrix();
-        multiLightShader.use(); //Primary Shader
 
-        //Set the viewer's position (the camera)
-        multiLightShader.setVec3("viewPos", camera.Position);
+        //Per frame data is written straight into this frame's region of the ring buffer, shared by every shader
+        uniformRing.BeginFrame();
 
-        //Set the material
-        multiLightShader.setInt("material.diffuse", 0);
-        multiLightShader.setInt("material.specular", 1);
-        multiLightShader.setInt("material.overlayDiffuse", 2);
-        multiLightShader.setInt("material.overlaySpecular", 3);
-        multiLightShader.setFloat("material.shininess", 32.0f);
+        FrameBlock* frameData = uniformRing.MapUniformBlock<FrameBlock>(FRAME_BLOCK_BINDING);
+        frameData->View = view;
+        frameData->Projection = projection;
+        frameData->ViewPos = camera.Position; //Set the viewer's position (the camera)
+        uniformRing.Unmap();
 
-        //Turn off the overlay textures, only enable when in use
-        multiLightShader.setBool("material.useOverlayTexture", 0);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        LightBlock* lightData = uniformRing.MapUniformBlock<LightBlock>(LIGHT_BLOCK_BINDING);
 
         //Set the Directional Light
-        multiLightShader.setBool("dirLight.useDirectionalLight", useDirectionalLight);     //Toggles the calculations for directional lights
-        multiLightShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f); //Direction of the light
-        multiLightShader.setVec3("dirLight.ambient", 0.2f, 0.2f, 0.2f);   //Set low to not overbear
-        multiLightShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);      //Light color
-        multiLightShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);     //Color of the specular highlight
-
-        //Candle Lights
-        for (int i = 0; i < sizeof(candleLightPositions) / sizeof(candleLightPositions[0]); i++) {
-            multiLightShader.setVec3("pointLights[" + std::to_string(i) + "].position", candleLightPositions[i]); //Light Position
-            multiLightShader.setVec3("pointLights[" + std::to_string(i) + "].ambient", candleLightColors[i] / 0.5f); //Set low to not overbear
-            multiLightShader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", candleLightColors[i] / 0.5f); //Light color
-            multiLightShader.setVec3("pointLights[" + std::to_string(i) + "].specular", candleLightColors[i] / 0.5f); //Color of the specular highlight
-            multiLightShader.setFloat("pointLights[" + std::to_string(i) + "].constant", candleLightAttenuations[i].x); //Attenuation Variables
-            multiLightShader.setFloat("pointLights[" + std::to_string(i) + "].linear", candleLightAttenuations[i].y); //Attenuation Variables
-            multiLightShader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", candleLightAttenuations[i].z); //Attenuation Variables
-        }
-
-        //Key light
-        multiLightShader.setVec3("pointLights[" +  std::to_string(3) + "].position", keyLightPosition); //Light Position
-        multiLightShader.setVec3("pointLights[" +  std::to_string(3) + "].ambient", keyLightColor / 0.5f); //Set low to not overbear
-        multiLightShader.setVec3("pointLights[" +  std::to_string(3) + "].diffuse", keyLightColor / 0.5f); //Light color
-        multiLightShader.setVec3("pointLights[" +  std::to_string(3) + "].specular", keyLightColor / 0.5f); //Color of the specular highlight
-        multiLightShader.setFloat("pointLights[" + std::to_string(3) + "].constant", keyLightAttenuation.x); //Attenuation Variables
-        multiLightShader.setFloat("pointLights[" + std::to_string(3) + "].linear", keyLightAttenuation.y); //Attenuation Variables
-        multiLightShader.setFloat("pointLights[" + std::to_string(3) + "].quadratic", keyLightAttenuation.z); //Attenuation Variables
+        lightData->DirLight.UseDirectionalLight = useDirectionalLight && scene.DirLight.Enabled; //Toggles the calculations for directional lights
+        lightData->DirLight.Direction = scene.DirLight.Direction; //Direction of the light
+        lightData->DirLight.Ambient = scene.DirLight.Ambient;     //Set low to not overbear
+        lightData->DirLight.Diffuse = scene.DirLight.Diffuse;     //Light color
+        lightData->DirLight.Specular = scene.DirLight.Specular;   //Color of the specular highlight
+
+        //Point Lights, slots the scene doesn't fill contribute nothing
+        for (int i = 0; i < NR_POINT_LIGHTS; i++) {
+            PointLightBlock& pointLight = lightData->PointLights[i];
+            if (i < shadedPointLights) {
+                const ScenePointLightDesc& light = scene.PointLights[i];
+                pointLight.Position = light.Position; //Light Position
+                pointLight.Ambient = light.Color / 0.5f; //Set low to not overbear
+                pointLight.Diffuse = light.Color / 0.5f; //Light color
+                pointLight.Specular = light.Color / 0.5f; //Color of the specular highlight
+                pointLight.Constant = light.Attenuation.x; //Attenuation Variables
+                pointLight.Linear = light.Attenuation.y; //Attenuation Variables
+                pointLight.Quadratic = light.Attenuation.z; //Attenuation Variables
+            }
+            else {
+                pointLight = PointLightBlock();
+                pointLight.Constant = 1.0f;
+            }
+        }
 
         // SpotLight (Flashlight)
-        multiLightShader.setBool("spotLight.useSpotLight", useFlashlight);
-        multiLightShader.setVec3("spotLight.position", camera.Position); //Where the light is coming from, Flashlight, so camera
-        multiLightShader.setVec3("spotLight.direction", camera.Front); //Direction, since flashlight, itll be the front of the camera
-        multiLightShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f); //Set low to not overbear
-        multiLightShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f); //Light color
-        multiLightShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f); //Color of the specular highlight
-        multiLightShader.setFloat("spotLight.constant", 1.0f); //Attenuation Variables
-        multiLightShader.setFloat("spotLight.linear", 0.09f); //Attenuation Variables
-        multiLightShader.setFloat("spotLight.quadratic", 0.032f); //Attenuation Variables
-        multiLightShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(15.5f))); //Cutoff of the brightest part of the light
-        multiLightShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(20.0f))); //Fades from the brightest to this angle to soften the light
+        lightData->SpotLight.UseSpotLight = useFlashlight;
+        lightData->SpotLight.Position = camera.Position; //Where the light is coming from, Flashlight, so camera
+        lightData->SpotLight.Direction = camera.Front; //Direction, since flashlight, itll be the front of the camera
+        lightData->SpotLight.Ambient = glm::vec3(0.0f); //Set low to not overbear
+        lightData->SpotLight.Diffuse = glm::vec3(1.0f); //Light color
+        lightData->SpotLight.Specular = glm::vec3(1.0f); //Color of the specular highlight
+        lightData->SpotLight.Constant = scene.SpotLight.Attenuation.x; //Attenuation Variables
+        lightData->SpotLight.Linear = scene.SpotLight.Attenuation.y; //Attenuation Variables
+        lightData->SpotLight.Quadratic = scene.SpotLight.Attenuation.z; //Attenuation Variables
+        lightData->SpotLight.CutOff = spotLightCutOff; //Cutoff of the brightest part of the light
+        lightData->SpotLight.OuterCutOff = spotLightOuterCutOff; //Fades from the brightest to this angle to soften the light
+
+        uniformRing.Unmap();
+
+        //View, projection and the flashlight are fixed for this frame, later input goes to the next one
+        inputLatency.Latch();
+
+        //Curved objects go through the tessellation or procedural program when one is on
+        bool tessellateFrame = useTessellation && tessellationSupported;
+        Shader* curvedShader = tessellateFrame ? &tessShader : (useProcedural ? &proceduralShader : &multiLightShader);
 
         model = glm::mat4(1.0f); //Resetting the model view
-        multiLightShader.setMat4("model", model);
-        multiLightShader.setMat4("view", view);
-        multiLightShader.setMat4("projection", projection);
-
-        /*
-        * =====================
-        * Ground Plane
-        * =====================
-        */
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, groundPlaneDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, groundPlaneSpecularTexture.Texture);
-        floorPlane.Draw();
-        
-        /*
-        * =====================
-        * Candle Jar
-        * =====================
-        */
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ceramicDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, ceramicSpecularTexture.Texture);
-        glActiveTexture(GL_TEXTURE2);
-        multiLightShader.setBool("material.useOverlayTexture", 1);
-        glBindTexture(GL_TEXTURE_2D, candleLabelDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, candleLabelSpecularTexture.Texture);
-
-        //Rotate the model 90d
-        model = ResetModelView(180.0f); //Necessity for a bug... Too late to correct at the moment
-        multiLightShader.setMat4("model", model);
-        
-        candleJar.Draw();
-
-        //Set the texture then draw the candle in the jar
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, waxDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, waxSpecularTexture.Texture);
-
-        //Turn off the overlay textures
-        multiLightShader.setBool("material.useOverlayTexture", 0);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        
-        candle.Draw();
-
-        /*
-        * =====================
-        * PUMPKIN HOLDER
-        * =====================
-        */
-        //Turn up the shininess, since this is metal
-        multiLightShader.setFloat("material.shininess", 64.0f);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, silverDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, silverSpecularTexture.Texture);
-        pumpkinHolderBase.Draw();
-        pumpkinHolderStem.Draw();
-        pumpkinHolderBody.Draw();
-
-        multiLightShader.setFloat("material.shininess", 32.0f);
-
-        /*
-        * =====================
-        * Pumpkins
-        * =====================
-        */
-        for (int i = 0; i < sizeof(pumpkinPositions) / sizeof(pumpkinPositions[0]); i++)
-        {
-            //Reset then rotate the pumpkins so that they are haphazardly placed in the jar
-            model = ResetModelView(180.0f);
-            model = glm::translate(model, pumpkinPositions[i]);
-            model = glm::scale(model, glm::vec3(pumpkinScales[i]));
-            model = glm::rotate(model, glm::radians(pumpkinRotationAngles[i]), glm::vec3(1.0f, 0.0f, 1.0f));
-            multiLightShader.setMat4("model", model);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, pumpkinDiffuseTexture.Texture);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, pumpkinSpecularTexture.Texture);
-            pumpkinBody.Draw();
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, wickDiffuseTexture.Texture);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, wickSpecularTexture.Texture);
-            pumpkinStem.Draw();
+        setModel(model);
+
+        //Tessellation factors come from edge lengths in pixels
+        if (tessellateFrame) {
+            tessShader.use();
+            tessShader.setVec2("viewportSize", (float)SCR_WIDTH, (float)SCR_HEIGHT);
+            tessShader.setFloat("pixelsPerEdge", TESS_DEFAULT_PIXELS_PER_EDGE);
+            tessShader.setFloat("maxTessLevel", maxTessLevel);
         }
 
-        /*
-        * =====================
-        * Black Jar
-        * =====================
-        */
-        model = ResetModelView(180.0f);
-        multiLightShader.setMat4("model", model);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ceramicBlackDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, ceramicSpecularTexture.Texture);
-        glActiveTexture(GL_TEXTURE2);
-        blackJar.Draw();
-
-        /*
-        * =====================
-        * Wicks
-        * =====================
-        */
-
-        //Set the texture and draw the wicks
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, wickDiffuseTexture.Texture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, wickSpecularTexture.Texture);
-
-        model = glm::mat4(1.0f); //Reset the model
-        multiLightShader.setMat4("model", model);
+        //Texture detail every object needs on screen, asked for ahead of both draw paths. Multi draw frames would otherwise
+        //ask for nothing and the streamed levels would go while it is on.
+        for (size_t i = 0; i < scene.Objects.size(); i++) {
+            textureStreamer.Request(scene.Materials.Materials[scene.Objects[i].Material], objectBounds[i], camera.Position, projection, SCR_HEIGHT);
+        }
 
-        wick1.Draw();
-        wick2.Draw();
-        wick3.Draw();
+        //Static scene through the megabuffer: the floor and every object at full detail, no per object state changes
+        bool multiDrawFrame = useMultiDraw && multiDrawSupported;
+        if (multiDrawFrame) {
+            multiDrawShader.use();
+            sceneMultiDraw.Draw(multiDrawShader);
+            GetRenderCounters().DrawCalls++;
+        }
+        else {
+            //Cylinders and Spheres go through curvedShader, everything else through the primary shader.
+            //Programs and materials are only switched when they change between neighbouring objects.
+            litShader = curvedShader;
+            Shader* currentShader = NULL;
+            int currentMaterial = -1;
+
+            for (size_t i = 0; i < scene.Objects.size(); i++) {
+                const SceneObjectDesc& object = scene.Objects[i];
+                ScenePrimitive& primitive = scene.Primitives[object.Primitive];
+
+                GetRenderCounters().Objects++;
+
+                Shader* objectShader = primitive.IsCurved() ? curvedShader : &multiLightShader;
+                if (objectShader != currentShader) {
+                    currentShader = objectShader;
+                    currentShader->use();
+                }
+                if (object.Material != currentMaterial) {
+                    currentMaterial = object.Material;
+                    scene.Materials.Bind(currentMaterial);
+                }
+                setModel(object.Model);
+
+                if (!primitive.IsCurved())
+                    primitive.Draw();
+                else if (primitive.Type == SCENE_CYLINDER)
+                    drawWithLOD(*primitive.CylinderMesh, object.Model, objectLODs[i]);
+                else
+                    drawWithLOD(*primitive.SphereMesh, object.Model, objectLODs[i]);
+                GetRenderCounters().DrawCalls++;
+            }
+        }
 
         /*
         * =====================
@@ -471,59 +1031,130 @@ int main()
         * =====================
         */
 
-        //Draw the light cube
-        lightCubeSampleShader.use();
-        lightCubeSampleShader.setMat4("projection", projection);
-        lightCubeSampleShader.setMat4("view", view);
+        //Draw a light cube at every point light
+        if (scene.LightMesh >= 0) {
+            lightCubeSampleShader.use();
+
+            for (const ScenePointLightDesc& light : scene.PointLights) {
+                model = glm::mat4(1.0f); //Reset the model
+                model = glm::translate(model, light.Position);
+                model = glm::scale(model, glm::vec3(light.CubeScale));
+                setModel(model);
+                lightCubeSampleShader.setVec3("lightColor", light.Color);
 
-        for (int i = 0; i < sizeof(candleLightPositions) / sizeof(candleLightPositions[0]); i++) {
-            model = glm::mat4(1.0f); //Reset the model
-            model = glm::translate(model, candleLightPositions[i]);
-            lightCubeSampleShader.setMat4("model", model);
-            lightCubeSampleShader.setVec3("lightColor", candleLightColors[i]);
+                scene.Primitives[scene.LightMesh].Draw();
+                GetRenderCounters().DrawCalls++;
+            }
+        }
 
-            lightCube.Draw();
+        //HUD last, its own work stays out of what it shows
+        if (hudFrame) {
+            hud.EndScene((glfwGetTime() - frameStart) * 1000.0);
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            hud.Draw(width, height);
         }
 
-        //Draw the key light
-        model = glm::mat4(1.0f); //Reset the model
-        model = glm::translate(model, keyLightPosition);
-        model = glm::scale(model, glm::vec3(3.0f));
-        lightCubeSampleShader.setMat4("model", model);
-        lightCubeSampleShader.setVec3("lightColor", keyLightColor);
-        lightCube.Draw();
+        //Fence this frame's region, it is rewritten once the GPU has passed this point
+        uniformRing.EndFrame();
+
+        if (runLODReport) {
+            glFinish(); //Wait for the GPU so the time covers the whole frame
+            lodReportFrameTime += glfwGetTime() - frameStart;
+            lodReportTriangles += GetLODCounters().TrianglesDrawn;
+            for (int i = 0; i <= LOD_THRESHOLD_COUNT; i++)
+                lodReportDraws[i] += GetLODCounters().DrawsPerLevel[i];
+
+            if (++lodReportFrame == lodReportFrames) {
+                cout << "LOD REPORT::DISTANCE " << lodReportDistances[lodReportDistance]
+                    << "::TRIANGLES " << lodReportTriangles / lodReportFrames
+                    << " (FULL DETAIL " << GetLODCounters().TrianglesFullDetail << ")::DRAWS PER LEVEL";
+                for (int i = 0; i <= LOD_THRESHOLD_COUNT; i++)
+                    cout << " " << lodReportDraws[i] / lodReportFrames;
+                cout << "::FRAME " << lodReportFrameTime * 1000.0 / lodReportFrames << "ms" << endl;
+
+                lodReportFrame = 0;
+                lodReportFrameTime = 0.0;
+                lodReportTriangles = 0;
+                fill(begin(lodReportDraws), end(lodReportDraws), 0);
+
+                if (++lodReportDistance == lodReportDistanceCount)
+                    glfwSetWindowShouldClose(window, true);
+            }
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
+        //Regression: CPU time up to here, the image straight from the back buffer
+        if (regression) {
+            double cpuMs = (glfwGetTime() - frameStart) * 1000.0;
+            RegressionImage capture;
+            if (regression->IsCaptureFrame()) {
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                capture = ReadFramebufferImage(width, height);
+            }
+            if (regression->EndFrame(cpuMs, GetRenderCounters().DrawCalls, regression->IsCaptureFrame() ? &capture : NULL))
+                glfwSetWindowShouldClose(window, true);
+        }
+
+        inputLatency.Submit(glfwGetTime());
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        framePacer.EndFrame();
+        if (glTracePath)
+            GetGLCallTrace().EndFrame();
+        if (!lateLatchInput)
+            pollInput();
+
+        if (latencyBenchFrames > 0 && ++latencyBenchFrame == latencyBenchFrames) {
+            inputLatency.Report(lateLatchInput ? "LATE LATCH" : "EARLY LATCH");
+            latencyBenchFrame = 0;
+            if (lateLatchInput)
+                glfwSetWindowShouldClose(window, true);
+            lateLatchInput = true;
+        }
     }
 
-    // optional: de-allocate all resources once they've outlived their purpose:
-    // ------------------------------------------------------------------------
+    framePacer.Report();
+    hud.Report();
+    GetResourceRegistry().Report();
+    GetAssetArchive().Report();
+    if (streamTextures) {
+        textureStreamer.Report();
+    }
+    inputLatency.Report(lateLatchInput ? "LATE LATCH" : "EARLY LATCH");
 
-    floorPlane.DeallocateVertexArrayBuffers();
+    if (recordInputPath)
+        inputRecorder.Save(recordInputPath);
 
-    candleJar.DeallocateVertexArrayBuffers();
-    candle.DeallocateVertexArrayBuffers();
+    if (glTracePath) {
+        GetGLCallTrace().Report();
+        GetGLCallTrace().Write(glTracePath, benchLabel);
+    }
+    framePacer.Deallocate();
+    hud.Deallocate();
 
-    wick1.DeallocateVertexArrayBuffers();
-    wick2.DeallocateVertexArrayBuffers();
-    wick3.DeallocateVertexArrayBuffers();
+    // optional: de-allocate all resources once they've outlived their purpose:
+    // ------------------------------------------------------------------------
 
-    pumpkinBody.DeallocateVertexArrayBuffers();
-    pumpkinStem.DeallocateVertexArrayBuffers();
+    textureStreamer.Finish();
+    scene.Deallocate();
 
-    pumpkinHolderBase.DeallocateVertexArrayBuffers();
-    pumpkinHolderStem.DeallocateVertexArrayBuffers();
-    pumpkinHolderBody.DeallocateVertexArrayBuffers();
+    if (multiDrawSupported) {
+        sceneMultiDraw.DeallocateVertexArrayBuffers();
+        materialTextureArrays.Deallocate();
+    }
 
-    lightCube.DeallocateVertexArrayBuffers();
+    uniformRing.Deallocate();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
-    return 0;
+
+    //A suite closed before its last pose didn't pass
+    if (regression && !regression->Finished())
+        cout << "REGRESSION::INTERRUPTED" << endl;
+    return regression && (regression->Failures > 0 || !regression->Finished()) ? 1 : 0;
 }
 
 //Sets the model back to 1.0 and rotates it 180 to deal with a bug I have.... Bandaid due to time constraints
@@ -540,37 +1171,61 @@ glm::mat4 ResetModelView(float angle) {
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    //A replay delivers the recorded frame's events now, where the live ones would already have arrived
+    if (inputReplayer.Playing) {
+        const InputCallbacks callbacks = { key_callback, mouse_callback, scroll_callback, mouse_button_callback };
+        if (!inputReplayer.NextFrame(window, callbacks)) {
+            std::cout << std::setprecision(9) << "INPUT REPLAY::FINISHED::" << inputReplayer.GetFramesPlayed() << " FRAMES::CAMERA "
+                << camera.Position.x << " " << camera.Position.y << " " << camera.Position.z
+                << "::YAW " << camera.Yaw << "::PITCH " << camera.Pitch << std::setprecision(6) << std::endl;
+            glfwSetWindowShouldClose(window, true);
+            return;
+        }
+    }
+
+    if (inputKeyDown(window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_1))
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_2))
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
     //Movement
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_W))
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_S))
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_A))
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_D))
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
     //For now, move up and down with Left Control and space (World relative, not screen)
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_SPACE) || inputKeyDown(window, GLFW_KEY_E))
         camera.ProcessKeyboard(UP, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_LEFT_CONTROL) || inputKeyDown(window, GLFW_KEY_Q))
         camera.ProcessKeyboard(DOWN, deltaTime);
 
     //Reset Speed
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_3) == GLFW_PRESS)
+    if (inputReplayer.Playing ? inputReplayer.MouseButton3Down() : glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_3) == GLFW_PRESS)
         camera.ResetMoveSpeed();
 
+    //The frame's events are in, close it with the state just acted on
+    if (inputRecorder.Recording)
+        inputRecorder.EndFrame(SampleInputPolledState(window));
+}
+
+//Polled key state, from the recording while a replay plays
+bool inputKeyDown(GLFWwindow* window, int key)
+{
+    if (inputReplayer.Playing)
+        return inputReplayer.KeyDown(key);
+    return glfwGetKey(window, key) == GLFW_PRESS;
 }
 
 //Key callback for single input keys (things that should only be done once and not every frame)
 void key_callback(GLFWwindow* window, int key, int scanCode, int action, int mods) {
+    inputRecorder.RecordKey(glfwGetTime(), key, scanCode, action, mods);
 
     //Toggle Camera Projection Matrix
     if (key == GLFW_KEY_P && action == GLFW_PRESS) {
@@ -578,6 +1233,43 @@ void key_callback(GLFWwindow* window, int key, int scanCode, int action, int mod
         ToggleProjectionMatrix();
     }
 
+    //Toggle tessellated Cylinders/Spheres
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        useTessellation = !useTessellation;
+        std::cout << "TESSELLATION::" << (useTessellation ? "ON" : "OFF") << std::endl;
+    }
+
+    //Toggle drawing the static scene from the megabuffer with multi-draw-indirect
+    if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        useMultiDraw = !useMultiDraw;
+        std::cout << "MULTIDRAW::" << (useMultiDraw ? "ON" : "OFF") << std::endl;
+    }
+
+    //Toggle buffer-less Cylinders/Spheres
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        useProcedural = !useProcedural;
+        std::cout << "PROCEDURAL::" << (useProcedural ? "ON" : "OFF") << std::endl;
+    }
+
+    //Toggle frame pacing between lowest latency and highest throughput
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        framePacingMode = framePacingMode == FRAME_PACING_LOW_LATENCY ? FRAME_PACING_THROUGHPUT : FRAME_PACING_LOW_LATENCY;
+        std::cout << "FRAME PACING::" << (framePacingMode == FRAME_PACING_LOW_LATENCY ? "LOW LATENCY" : "THROUGHPUT") << std::endl;
+    }
+
+    //Toggle late latched camera input, the latency so far is reported first
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        inputLatency.Report(lateLatchInput ? "LATE LATCH" : "EARLY LATCH");
+        lateLatchInput = !lateLatchInput;
+        std::cout << "LATE LATCH::" << (lateLatchInput ? "ON" : "OFF") << std::endl;
+    }
+
+    //Toggle the performance HUD
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        showHud = !showHud;
+        std::cout << "HUD::" << (showHud ? "ON" : "OFF") << std::endl;
+    }
+
     //Light controls
     //Toggle Directional Light
     if (key == GLFW_KEY_J && action == GLFW_PRESS)
@@ -587,8 +1279,22 @@ void key_callback(GLFWwindow* window, int key, int scanCode, int action, int mod
         useFlashlight = !useFlashlight;
 }
 
-//Callback for the mouse
+//Callback for the mouse buttons, left click picks whatever is under the crosshair
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    inputRecorder.RecordMouseButton(glfwGetTime(), button, action, mods);
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+        pickRequested = true;
+}
+
+//Callback for the mouse, GLFW doesn't say when the OS saw the event so it counts from now
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    inputRecorder.RecordCursor(glfwGetTime(), xpos, ypos);
+    applyMouseMovement(xpos, ypos, glfwGetTime());
+}
+
+//Turns the camera by a cursor position, eventTime is when the movement happened
+void applyMouseMovement(double xpos, double ypos, double eventTime)
 {
     //Should initially be true, then set the mouse last values to current position
     if (firstMouse) {
@@ -603,14 +1309,16 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     lastY = ypos;
 
     camera.ProcessMouseMovement(xOffset, yOffset, usePerspective);
+    inputLatency.EventApplied(eventTime);
 }
 
 //Callback for the scroll wheel
 void scroll_callback(GLFWwindow* window, double xOffset, double yOffset) {
+    inputRecorder.RecordScroll(glfwGetTime(), xOffset, yOffset);
 
     bool scrollMod = false;
 
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (inputKeyDown(window, GLFW_KEY_LEFT_SHIFT))
         scrollMod = true;
 
     camera.ProcessMouseScroll(yOffset, scrollMod);
@@ -0,0 +1,149 @@
+#ifndef ANGLETABLE_H
+#define ANGLETABLE_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+//define PI
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+/*
+* Unit circle rings shared by the primitive generators. Each ring is computed once per side count and then only read,
+* instead of calling sin/cos for every subdivision, cap and quad corner. Every entry comes from the same double precision
+* routine below (compile time for the common counts, run time for the rest), so a mesh is the same whichever path its
+* count takes and on every compiler's math library.
+*/
+
+//sin/cos on [-pi/4, pi/4], the series has converged far below double precision by the last term
+constexpr double UnitCircleSinSeries(double x) {
+	double x2 = x * x, term = x, sum = x;
+	for (int n = 1; n < 12; n++) {
+		term *= -x2 / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double UnitCircleCosSeries(double x) {
+	double x2 = x * x, term = 1.0, sum = 1.0;
+	for (int n = 1; n < 12; n++) {
+		term *= -x2 / ((2 * n - 1) * (2 * n));
+		sum += term;
+	}
+	return sum;
+}
+
+//Reduces x by a multiple of pi/2 (three part split of pi/2 so the remainder keeps its precision), quadrant in [0, 3]
+constexpr double UnitCircleReduce(double x, int& quadrant) {
+	const double halfPi = 1.5707963267948966192313216916398;
+	const double halfPi1 = 1.5707963267341256141662597656250;
+	const double halfPi2 = 6.0771005065061922320e-11;
+	const double halfPi3 = 2.0222662487959507324e-21;
+
+	double k = x / halfPi;
+	long long n = (long long)(k + (k >= 0.0 ? 0.5 : -0.5));
+	quadrant = (int)(((n % 4) + 4) % 4);
+	return ((x - n * halfPi1) - n * halfPi2) - n * halfPi3;
+}
+
+constexpr float UnitCircleSin(float angle) {
+	int quadrant = 0;
+	double r = UnitCircleReduce(angle, quadrant);
+	double value = quadrant == 0 ? UnitCircleSinSeries(r) : quadrant == 1 ? UnitCircleCosSeries(r) : quadrant == 2 ? -UnitCircleSinSeries(r) : -UnitCircleCosSeries(r);
+	return (float)value;
+}
+
+constexpr float UnitCircleCos(float angle) {
+	int quadrant = 0;
+	double r = UnitCircleReduce(angle, quadrant);
+	double value = quadrant == 0 ? UnitCircleCosSeries(r) : quadrant == 1 ? -UnitCircleSinSeries(r) : quadrant == 2 ? -UnitCircleCosSeries(r) : UnitCircleSinSeries(r);
+	return (float)value;
+}
+
+//Angle of step i, exactly as the generators always computed it: full rings step 2pi / count, half rings pi / count
+constexpr float UnitCircleAngle(int i, int count, bool half) {
+	return half ? (float)(M_PI * i) / count : (float)(2.0f * M_PI * i) / count;
+}
+
+//Ring evaluated at compile time. Count + 2 entries: caps step one past the end for their closing triangle.
+template <int Count, bool Half>
+struct ConstexprAngleRing {
+	float Cos[Count + 2];
+	float Sin[Count + 2];
+
+	constexpr ConstexprAngleRing() : Cos{}, Sin{} {
+		for (int i = 0; i < Count + 2; i++) {
+			Cos[i] = UnitCircleCos(UnitCircleAngle(i, Count, Half));
+			Sin[i] = UnitCircleSin(UnitCircleAngle(i, Count, Half));
+		}
+	}
+};
+
+//Ring handed to the generators, Cos[i]/Sin[i] for i in [0, Count + 1]
+struct AngleRing {
+	int Count = 0;
+	bool Half = false;
+	vector<float> Cos;
+	vector<float> Sin;
+};
+
+//Copies the compile time table when the ring's count is Count
+template <int Count>
+bool CopyConstexprAngleRing(AngleRing& ring) {
+	static constexpr ConstexprAngleRing<Count, false> full{};
+	static constexpr ConstexprAngleRing<Count, true> half{};
+	if (ring.Count != Count) {
+		return false;
+	}
+	const float* cosines = ring.Half ? half.Cos : full.Cos;
+	const float* sines = ring.Half ? half.Sin : full.Sin;
+	ring.Cos.assign(cosines, cosines + Count + 2);
+	ring.Sin.assign(sines, sines + Count + 2);
+	return true;
+}
+
+//Side counts the scene and its LOD chains use, plus the usual round numbers
+inline bool CopyCommonAngleRing(AngleRing& ring) {
+	return CopyConstexprAngleRing<6>(ring) || CopyConstexprAngleRing<7>(ring) || CopyConstexprAngleRing<8>(ring)
+		|| CopyConstexprAngleRing<10>(ring) || CopyConstexprAngleRing<12>(ring) || CopyConstexprAngleRing<14>(ring)
+		|| CopyConstexprAngleRing<15>(ring) || CopyConstexprAngleRing<16>(ring) || CopyConstexprAngleRing<20>(ring)
+		|| CopyConstexprAngleRing<24>(ring) || CopyConstexprAngleRing<29>(ring) || CopyConstexprAngleRing<30>(ring)
+		|| CopyConstexprAngleRing<32>(ring) || CopyConstexprAngleRing<40>(ring) || CopyConstexprAngleRing<48>(ring)
+		|| CopyConstexprAngleRing<64>(ring);
+}
+
+//Returns the ring for a count, building it on first use. Safe from any thread, the reference stays valid for the program.
+inline const AngleRing& GetAngleRing(int count, bool half = false) {
+	static map<pair<int, bool>, unique_ptr<AngleRing>> rings;
+	static mutex ringsMutex;
+
+	//A ring needs at least one step
+	count = max(count, 1);
+
+	lock_guard<mutex> lock(ringsMutex);
+	unique_ptr<AngleRing>& ring = rings[make_pair(count, half)];
+	if (!ring) {
+		ring.reset(new AngleRing());
+		ring->Count = count;
+		ring->Half = half;
+		if (!CopyCommonAngleRing(*ring)) {
+			ring->Cos.resize(count + 2);
+			ring->Sin.resize(count + 2);
+			for (int i = 0; i < count + 2; i++) {
+				ring->Cos[i] = UnitCircleCos(UnitCircleAngle(i, count, half));
+				ring->Sin[i] = UnitCircleSin(UnitCircleAngle(i, count, half));
+			}
+		}
+	}
+	return *ring;
+}
+
+#endif
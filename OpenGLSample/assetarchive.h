@@ -0,0 +1,516 @@
+#ifndef ASSETARCHIVE_H
+#define ASSETARCHIVE_H
+
+#include "lz4block.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/*
+* Asset archive. Shaders, scenes and images packed into one file: a header, every entry's bytes starting on an
+* ASSET_ARCHIVE_ALIGNMENT boundary, then the index (name, offset, sizes, flags, checksum of the unpacked bytes).
+* The archive is mapped once; an entry stored as is comes back as a span into the mapping with nothing copied, an
+* LZ4 entry is unpacked into a buffer of its own. Every entry's checksum is checked the first time it is read.
+* ReadAsset falls back to the loose file when no archive is open or it lacks the entry.
+*/
+
+const uint32_t ASSET_ARCHIVE_MAGIC = 0x4B415041; //"APAK"
+const uint32_t ASSET_ARCHIVE_VERSION = 1;
+const uint32_t ASSET_ARCHIVE_ALIGNMENT = 64;
+const uint32_t ASSET_ENTRY_LZ4 = 1;
+
+//LZ4 never unpacks a block to more than this many times its size, a larger Size in the index is corrupt
+const uint64_t ASSET_ARCHIVE_MAX_LZ4_RATIO = 255;
+
+//Files PackAssets takes from the directories it is given, by extension
+const char* const ASSET_ARCHIVE_EXTENSIONS[] = { ".glsl", ".scene", ".sceneb", ".jpg", ".jpeg", ".png" };
+
+//Stored with the LZ4 flag only when packing saves at least this fraction
+const float ASSET_ARCHIVE_MIN_SAVING = 0.125f;
+
+struct AssetArchiveHeader {
+	uint32_t Magic = ASSET_ARCHIVE_MAGIC;
+	uint32_t Version = ASSET_ARCHIVE_VERSION;
+	uint32_t EntryCount = 0;
+	uint32_t Alignment = ASSET_ARCHIVE_ALIGNMENT;
+	uint64_t IndexOffset = 0;
+	uint64_t IndexSize = 0;
+};
+
+struct AssetArchiveEntry {
+	string Name;
+	uint64_t Offset = 0;
+	uint64_t StoredSize = 0;	//Bytes in the archive
+	uint64_t Size = 0;			//Bytes once unpacked
+	uint32_t Flags = 0;
+	uint64_t Checksum = 0;		//Of the unpacked bytes
+};
+
+//FNV-1a over a block of bytes
+inline uint64_t AssetChecksum(const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+//Archive names use forward slashes and no leading ./
+inline string NormalizeAssetPath(string path) {
+	replace(path.begin(), path.end(), '\\', '/');
+	while (path.compare(0, 2, "./") == 0) {
+		path.erase(0, 2);
+	}
+	return path;
+}
+
+//Bytes of one asset: a span into the archive's mapping (valid while it stays open), or bytes of its own when the entry
+//was compressed or came from a loose file
+struct AssetData {
+	const char* Mapped = NULL;
+	size_t MappedSize = 0;
+	vector<char> Owned;
+
+	const char* GetData() const { return Mapped != NULL ? Mapped : Owned.data(); }
+	size_t GetSize() const { return Mapped != NULL ? MappedSize : Owned.size(); }
+};
+
+class AssetArchive
+{
+public:
+	//Reads served since the start
+	atomic<int> MappedReads;
+	atomic<int> UnpackedReads;
+	atomic<int> LooseReads;
+
+	AssetArchive() : MappedReads(0), UnpackedReads(0), LooseReads(0) {}
+	~AssetArchive() { Close(); }
+
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	//Maps the archive and reads its index, false (and nothing open) when it is missing or malformed
+	bool Open(const string& path) {
+		Close();
+		if (!Map(path)) {
+			cout << "ERROR::ASSETS::ARCHIVE_NOT_OPENED " << path << endl;
+			return false;
+		}
+
+		string error;
+		if (!ReadIndex(error)) {
+			cout << "ERROR::ASSETS::ARCHIVE_INVALID " << path << " " << error << endl;
+			Close();
+			return false;
+		}
+		verified.reset(new atomic<uint8_t>[entries.size()]);
+		for (size_t i = 0; i < entries.size(); i++) {
+			verified[i] = 0;
+		}
+		archivePath = path;
+		cout << "ASSETS::" << path << "::" << entries.size() << " ENTRIES::" << mappedSize / 1024 << "KB MAPPED" << endl;
+		return true;
+	}
+
+	void Close() {
+		entries.clear();
+		lookup.clear();
+		verified.reset();
+		archivePath.clear();
+		Unmap();
+	}
+
+	bool IsOpen() const { return mapped != NULL; }
+
+	const AssetArchiveEntry* Find(const string& name) const {
+		unordered_map<string, size_t>::const_iterator found = lookup.find(NormalizeAssetPath(name));
+		return found != lookup.end() ? &entries[found->second] : NULL;
+	}
+
+	//An entry's bytes, false when it is not in the archive or fails its checksum. Safe on any thread.
+	bool Read(const string& name, AssetData& data) {
+		const AssetArchiveEntry* entry = Find(name);
+		if (entry == NULL) {
+			return false;
+		}
+		const char* stored = mapped + entry->Offset;
+		data = AssetData();
+		if (entry->Flags & ASSET_ENTRY_LZ4) {
+			try {
+				data.Owned.resize((size_t)entry->Size);
+			}
+			catch (const bad_alloc&) {
+				cout << "ERROR::ASSETS::OUT_OF_MEMORY " << entry->Name << endl;
+				data = AssetData();
+				return false;
+			}
+			if (!LZ4DecompressBlock((const unsigned char*)stored, (size_t)entry->StoredSize, (unsigned char*)data.Owned.data(), data.Owned.size())) {
+				cout << "ERROR::ASSETS::CORRUPT_ENTRY " << entry->Name << endl;
+				return false;
+			}
+			UnpackedReads++;
+		}
+		else {
+			data.Mapped = stored;
+			data.MappedSize = (size_t)entry->Size;
+			MappedReads++;
+		}
+
+		atomic<uint8_t>& state = verified[entry - &entries[0]];
+		if (state == 0) {
+			state = AssetChecksum(data.GetData(), data.GetSize()) == entry->Checksum ? 1 : 2;
+		}
+		if (state == 2) {
+			cout << "ERROR::ASSETS::CHECKSUM_MISMATCH " << entry->Name << endl;
+			data = AssetData();
+			return false;
+		}
+		return true;
+	}
+
+	void Report() const {
+		if (IsOpen()) {
+			cout << "ASSETS::" << archivePath << "::" << MappedReads << " MAPPED READS::" << UnpackedReads << " UNPACKED READS::" << LooseReads << " LOOSE FILE READS" << endl;
+		}
+	}
+
+private:
+	const char* mapped = NULL;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	HANDLE fileHandle = INVALID_HANDLE_VALUE;
+	HANDLE mappingHandle = NULL;
+#endif
+	string archivePath;
+	vector<AssetArchiveEntry> entries;
+	unordered_map<string, size_t> lookup;
+	unique_ptr<atomic<uint8_t>[]> verified; //0 not checked yet, 1 good, 2 corrupt
+
+	bool Map(const string& path) {
+#ifdef _WIN32
+		fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		LARGE_INTEGER size;
+		if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+			Unmap();
+			return false;
+		}
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		void* view = mappingHandle != NULL ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (view == NULL) {
+			Unmap();
+			return false;
+		}
+		mapped = (const char*)view;
+		mappedSize = (size_t)size.QuadPart;
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		struct stat info;
+		if (file < 0 || fstat(file, &info) != 0 || info.st_size == 0) {
+			if (file >= 0) {
+				close(file);
+			}
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file); //The mapping keeps the file
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		mapped = (const char*)view;
+		mappedSize = (size_t)info.st_size;
+#endif
+		return true;
+	}
+
+	void Unmap() {
+#ifdef _WIN32
+		if (mapped != NULL) {
+			UnmapViewOfFile(mapped);
+		}
+		if (mappingHandle != NULL) {
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle != INVALID_HANDLE_VALUE) {
+			CloseHandle(fileHandle);
+		}
+		mappingHandle = NULL;
+		fileHandle = INVALID_HANDLE_VALUE;
+#else
+		if (mapped != NULL) {
+			munmap((void*)mapped, mappedSize);
+		}
+#endif
+		mapped = NULL;
+		mappedSize = 0;
+	}
+
+	//Every offset and size is checked against the mapping, and no LZ4 entry unpacks larger than its stored bytes allow
+	bool ReadIndex(string& error) {
+		AssetArchiveHeader header;
+		if (mappedSize < sizeof(header)) {
+			error = "shorter than its header";
+			return false;
+		}
+		memcpy(&header, mapped, sizeof(header));
+		if (header.Magic != ASSET_ARCHIVE_MAGIC || header.Version != ASSET_ARCHIVE_VERSION) {
+			error = "not an asset archive of version " + to_string(ASSET_ARCHIVE_VERSION);
+			return false;
+		}
+		if (header.IndexOffset > mappedSize || header.IndexSize > mappedSize - header.IndexOffset) {
+			error = "index outside the file";
+			return false;
+		}
+
+		const char* index = mapped + header.IndexOffset;
+		size_t left = (size_t)header.IndexSize;
+		auto take = [&](void* value, size_t size) {
+			if (left < size) {
+				return false;
+			}
+			memcpy(value, index, size);
+			index += size;
+			left -= size;
+			return true;
+		};
+
+		for (uint32_t i = 0; i < header.EntryCount; i++) {
+			AssetArchiveEntry entry;
+			uint32_t nameLength;
+			if (!take(&nameLength, sizeof(nameLength)) || nameLength > left) {
+				error = "index cut short";
+				return false;
+			}
+			entry.Name.assign(index, nameLength);
+			index += nameLength;
+			left -= nameLength;
+			if (!take(&entry.Offset, sizeof(entry.Offset)) || !take(&entry.StoredSize, sizeof(entry.StoredSize)) || !take(&entry.Size, sizeof(entry.Size))
+				|| !take(&entry.Flags, sizeof(entry.Flags)) || !take(&entry.Checksum, sizeof(entry.Checksum))) {
+				error = "index cut short";
+				return false;
+			}
+			if (entry.Offset > mappedSize || entry.StoredSize > mappedSize - entry.Offset || (!(entry.Flags & ASSET_ENTRY_LZ4) && entry.StoredSize != entry.Size)) {
+				error = "entry " + entry.Name + " outside the file";
+				return false;
+			}
+			if ((entry.Flags & ASSET_ENTRY_LZ4) && entry.Size > entry.StoredSize * ASSET_ARCHIVE_MAX_LZ4_RATIO) {
+				//Left out of the lookup, so it comes from the loose file
+				cout << "ERROR::ASSETS::CORRUPT_ENTRY " << entry.Name << " unpacks larger than LZ4 can" << endl;
+				continue;
+			}
+			lookup[entry.Name] = entries.size();
+			entries.push_back(entry);
+		}
+		return true;
+	}
+};
+
+inline AssetArchive& GetAssetArchive() {
+	static AssetArchive archive;
+	return archive;
+}
+
+//An asset from the open archive, or else from the loose file of that path. False when neither has it.
+inline bool ReadAsset(const string& path, AssetData& data) {
+	AssetArchive& archive = GetAssetArchive();
+	if (archive.IsOpen() && archive.Read(path, data)) {
+		return true;
+	}
+
+	data = AssetData();
+	ifstream file(path.c_str(), ios::binary | ios::ate);
+	if (!file) {
+		return false;
+	}
+	data.Owned.resize((size_t)file.tellg());
+	file.seekg(0);
+	if (!data.Owned.empty() && !file.read(data.Owned.data(), data.Owned.size())) {
+		return false;
+	}
+	archive.LooseReads++;
+	return true;
+}
+
+//Size and checksum of an asset's bytes: the archive entry's, or one worked out over the loose file
+inline bool GetAssetChecksum(const string& path, uint64_t& size, uint64_t& checksum) {
+	const AssetArchiveEntry* entry = GetAssetArchive().IsOpen() ? GetAssetArchive().Find(path) : NULL;
+	if (entry != NULL) {
+		size = entry->Size;
+		checksum = entry->Checksum;
+		return true;
+	}
+	AssetData data;
+	if (!ReadAsset(path, data)) {
+		return false;
+	}
+	size = data.GetSize();
+	checksum = AssetChecksum(data.GetData(), data.GetSize());
+	return true;
+}
+
+//Creates a directory, true when it exists afterwards
+inline bool MakeDirectory(const string& path) {
+#ifdef _WIN32
+	return CreateDirectoryA(path.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+	return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+//Every file under a directory, recursively, as directory/relative/path
+inline void ListAssetFiles(const string& directory, vector<string>& files) {
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	do {
+		string name = found.cFileName;
+		if (name == "." || name == "..") {
+			continue;
+		}
+		if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			ListAssetFiles(directory + "/" + name, files);
+		}
+		else {
+			files.push_back(directory + "/" + name);
+		}
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL) {
+		return;
+	}
+	while (dirent* found = readdir(dir)) {
+		string name = found->d_name;
+		if (name == "." || name == "..") {
+			continue;
+		}
+		string path = directory + "/" + name;
+		struct stat info;
+		if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+			ListAssetFiles(path, files);
+		}
+		else {
+			files.push_back(path);
+		}
+	}
+	closedir(dir);
+#endif
+}
+
+//The packer: every file with an archive extension under the directories, compressed where LZ4 pays off
+inline bool PackAssets(const string& archivePath, const vector<string>& directories) {
+	vector<string> files;
+	for (const string& directory : directories) {
+		ListAssetFiles(NormalizeAssetPath(directory), files);
+	}
+	files.erase(remove_if(files.begin(), files.end(), [](const string& file) {
+		for (const char* extension : ASSET_ARCHIVE_EXTENSIONS) {
+			size_t length = strlen(extension);
+			if (file.size() >= length && file.compare(file.size() - length, length, extension) == 0) {
+				return false;
+			}
+		}
+		return true;
+	}), files.end());
+	sort(files.begin(), files.end());
+
+	ofstream archive(archivePath.c_str(), ios::binary);
+	AssetArchiveHeader header;
+	archive.write((const char*)&header, sizeof(header));
+	uint64_t offset = sizeof(header);
+
+	vector<AssetArchiveEntry> entries;
+	uint64_t totalSize = 0;
+	int compressed = 0;
+	for (const string& file : files) {
+		AssetData data;
+		if (!ReadAsset(file, data)) {
+			cout << "ERROR::ASSETS::FILE_NOT_SUCCESSFULLY_READ " << file << endl;
+			return false;
+		}
+
+		AssetArchiveEntry entry;
+		entry.Name = NormalizeAssetPath(file);
+		entry.Size = data.GetSize();
+		entry.Checksum = AssetChecksum(data.GetData(), data.GetSize());
+		vector<unsigned char> packed = LZ4CompressBlock((const unsigned char*)data.GetData(), data.GetSize());
+		bool usePacked = data.GetSize() > 0 && packed.size() <= data.GetSize() * (1.0f - ASSET_ARCHIVE_MIN_SAVING);
+		entry.Flags = usePacked ? ASSET_ENTRY_LZ4 : 0;
+		entry.StoredSize = usePacked ? packed.size() : data.GetSize();
+
+		uint64_t aligned = (offset + ASSET_ARCHIVE_ALIGNMENT - 1) / ASSET_ARCHIVE_ALIGNMENT * ASSET_ARCHIVE_ALIGNMENT;
+		archive.write(string((size_t)(aligned - offset), '\0').c_str(), aligned - offset);
+		entry.Offset = aligned;
+		if (usePacked) {
+			archive.write((const char*)packed.data(), packed.size());
+			compressed++;
+		}
+		else {
+			archive.write(data.GetData(), data.GetSize());
+		}
+		offset = aligned + entry.StoredSize;
+		totalSize += entry.Size;
+		entries.push_back(entry);
+	}
+
+	string index;
+	for (const AssetArchiveEntry& entry : entries) {
+		uint32_t nameLength = (uint32_t)entry.Name.size();
+		index.append((const char*)&nameLength, sizeof(nameLength));
+		index.append(entry.Name);
+		index.append((const char*)&entry.Offset, sizeof(entry.Offset));
+		index.append((const char*)&entry.StoredSize, sizeof(entry.StoredSize));
+		index.append((const char*)&entry.Size, sizeof(entry.Size));
+		index.append((const char*)&entry.Flags, sizeof(entry.Flags));
+		index.append((const char*)&entry.Checksum, sizeof(entry.Checksum));
+	}
+	archive.write(index.data(), index.size());
+
+	header.EntryCount = (uint32_t)entries.size();
+	header.IndexOffset = offset;
+	header.IndexSize = index.size();
+	archive.seekp(0);
+	archive.write((const char*)&header, sizeof(header));
+	if (!archive) {
+		cout << "ERROR::ASSETS::WRITE_FAILED " << archivePath << endl;
+		return false;
+	}
+	cout << "ASSETS::PACKED " << entries.size() << " FILES::" << totalSize / 1024 << "KB IN " << (offset + index.size()) / 1024 << "KB::"
+		<< compressed << " COMPRESSED::TO " << archivePath << endl;
+	return true;
+}
+
+#endif
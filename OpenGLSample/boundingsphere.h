@@ -0,0 +1,37 @@
+#ifndef BOUNDINGSPHERE_H
+#define BOUNDINGSPHERE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+
+//World space bounds of one object, a sphere so its size on screen is one distance away
+struct BoundingSphere {
+	glm::vec3 Center = glm::vec3(0.0f);
+	float Radius = -1.0f; //Negative when the object had no vertices
+};
+
+//Sphere around the object's local AABB, moved by its model matrix and grown by its largest scale.
+//Vertices are a triangle list with the position in the first 3 floats of every vertex.
+inline BoundingSphere ComputeBoundingSphere(const vector<float>& vertices, const glm::mat4& model, int floatsPerVertex = 11) {
+	BoundingSphere sphere;
+	if (vertices.size() < (size_t)floatsPerVertex) {
+		return sphere;
+	}
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for (size_t i = 0; i + 2 < vertices.size(); i += floatsPerVertex) {
+		glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+	float scale = max(glm::length(glm::vec3(model[0])), max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	sphere.Center = glm::vec3(model * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+	sphere.Radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+	return sphere;
+}
+
+#endif
@@ -0,0 +1,647 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cstdint>
+
+#include "threadpool.h"
+
+using namespace std;
+
+//Number of centroid bins tried per axis when looking for the best SAH split
+const int BVH_SAH_BINS = 16;
+
+//Leaves never get bigger than this, even when SAH says not to split or finds no split (an object median split is
+//made instead). Only a leaf at BVH_MAX_DEPTH can hold more.
+const int BVH_MAX_LEAF_SIZE = 8;
+
+//Deepest a tree is allowed to get, keeps the fixed traversal stack safe
+const int BVH_MAX_DEPTH = 48;
+
+//Ranges smaller than this are built on whatever thread reaches them instead of being handed to the pool
+const int BVH_PARALLEL_SUBTREE_MIN = 4096;
+
+//Relative cost of one AABB test versus one triangle test, used by the SAH
+const float BVH_TRAVERSAL_COST = 1.0f;
+const float BVH_TRIANGLE_COST = 1.0f;
+
+struct BVHRay {
+	glm::vec3 Origin;
+	glm::vec3 Direction;
+	float TMin = 0.0f;
+	float TMax = FLT_MAX;
+
+	BVHRay() {}
+	BVHRay(const glm::vec3& origin, const glm::vec3& direction, float tMax = FLT_MAX) : Origin(origin), Direction(direction), TMax(tMax) {}
+};
+
+struct BVHHit {
+	float T = FLT_MAX;
+	int Object = -1;     //Id returned by AddObject
+	int Triangle = -1;   //Triangle index within that object's vertex array
+	float U = 0.0f;      //Barycentrics of the hit
+	float V = 0.0f;
+};
+
+//32 bytes. Interior nodes store the index of their left child, the right child is always the next node.
+//Leaves store the first triangle and a non-zero count.
+struct BVHNode {
+	glm::vec3 BoundsMin;
+	uint32_t LeftFirst;
+	glm::vec3 BoundsMax;
+	uint32_t Count;
+
+	bool IsLeaf() const { return Count > 0; }
+};
+
+//Bounding volume hierarchy over the world space triangles of every added object.
+//Built top down with binned SAH splits, large subtrees are built in parallel. Supports refitting after a transform change.
+class BVH
+{
+public:
+
+	//Adds an object's triangles, non-indexed vertex array with the position in the first 3 floats of every vertex. Returns the object id.
+	int AddObject(const vector<float>& vertices, const glm::mat4& transform, int floatsPerVertex = 11) {
+		Object object;
+		object.Transform = transform;
+		object.FirstTriangle = (int)localTriangles.size();
+		object.TriangleCount = (int)(vertices.size() / (floatsPerVertex * 3));
+
+		for (int t = 0; t < object.TriangleCount; t++) {
+			LocalTriangle tri;
+			for (int i = 0; i < 3; i++) {
+				const float* vertex = &vertices[((size_t)t * 3 + i) * floatsPerVertex];
+				tri.V[i] = glm::vec3(vertex[0], vertex[1], vertex[2]);
+			}
+			tri.Object = (int)objects.size();
+			localTriangles.push_back(tri);
+		}
+
+		objects.push_back(object);
+		return (int)objects.size() - 1;
+	}
+
+	//(Re)builds the whole hierarchy
+	void Build(ThreadPool* pool = NULL) {
+		ThreadPool& threads = (pool != NULL) ? *pool : ThreadPool::Shared();
+		auto start = chrono::high_resolution_clock::now();
+
+		int triangleCount = (int)localTriangles.size();
+		nodes.clear();
+		triangles.clear();
+		triangleSource.clear();
+		dirtyObjects = false;
+
+		if (triangleCount == 0) {
+			BuildMs = 0.0;
+			return;
+		}
+
+		//World space triangles, bounds and centroids for the build
+		vector<glm::vec3> world((size_t)triangleCount * 3);
+		buildRefs.resize(triangleCount);
+		threads.ParallelFor(0, triangleCount, [&](int t) {
+			const LocalTriangle& local = localTriangles[t];
+			const glm::mat4& transform = objects[local.Object].Transform;
+
+			BuildRef& ref = buildRefs[t];
+			ref.Triangle = t;
+			ref.BoundsMin = glm::vec3(FLT_MAX);
+			ref.BoundsMax = glm::vec3(-FLT_MAX);
+			for (int i = 0; i < 3; i++) {
+				glm::vec3 v = glm::vec3(transform * glm::vec4(local.V[i], 1.0f));
+				world[(size_t)t * 3 + i] = v;
+				ref.BoundsMin = glm::min(ref.BoundsMin, v);
+				ref.BoundsMax = glm::max(ref.BoundsMax, v);
+			}
+			ref.Centroid = (ref.BoundsMin + ref.BoundsMax) * 0.5f;
+		}, 1024);
+
+		//A binary tree with N leaves at most has 2N - 1 nodes, plus the unused slot after the root to keep pairs aligned
+		nodes.resize((size_t)triangleCount * 2);
+		nodesUsed = 2;
+
+		BVHNode& root = nodes[0];
+		root.LeftFirst = 0;
+		root.Count = (uint32_t)triangleCount;
+		UpdateNodeBounds(root);
+
+		//Split serially until there are enough big subtrees to keep every thread busy, then build those in parallel
+		vector<pair<uint32_t, int>> pending; //node, depth
+		vector<pair<uint32_t, int>> parallelSubtrees;
+		pending.push_back(make_pair(0u, 0));
+		size_t targetSubtrees = (size_t)(threads.ThreadCount() + 1) * 4;
+
+		while (!pending.empty()) {
+			pair<uint32_t, int> item = pending.back();
+			pending.pop_back();
+
+			if (nodes[item.first].Count < BVH_PARALLEL_SUBTREE_MIN || parallelSubtrees.size() + pending.size() >= targetSubtrees) {
+				parallelSubtrees.push_back(item);
+				continue;
+			}
+
+			if (Split(item.first)) {
+				pending.push_back(make_pair(nodes[item.first].LeftFirst, item.second + 1));
+				pending.push_back(make_pair(nodes[item.first].LeftFirst + 1, item.second + 1));
+			}
+		}
+
+		threads.ParallelFor(0, (int)parallelSubtrees.size(), [&](int i) {
+			Subdivide(parallelSubtrees[i].first, parallelSubtrees[i].second);
+		});
+
+		nodes.resize(nodesUsed.load());
+
+		//Leaf order triangle data: vertex 0 and two edges, ready for the intersection test
+		triangles.resize(triangleCount);
+		triangleSource.resize(triangleCount);
+		threads.ParallelFor(0, triangleCount, [&](int slot) {
+			int t = buildRefs[slot].Triangle;
+			triangleSource[slot] = t;
+			SetTriangle(slot, world[(size_t)t * 3], world[(size_t)t * 3 + 1], world[(size_t)t * 3 + 2]);
+		}, 1024);
+
+		buildRefs.clear();
+		buildRefs.shrink_to_fit();
+
+		BuildMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Moves an object. Call Refit() (or Build() after big changes) before the next query.
+	void SetObjectTransform(int object, const glm::mat4& transform) {
+		objects[object].Transform = transform;
+		objects[object].Dirty = true;
+		dirtyObjects = true;
+	}
+
+	//Re-transforms the triangles of moved objects and recomputes every node's bounds bottom up. Tree topology is kept.
+	void Refit(ThreadPool* pool = NULL) {
+		if (!dirtyObjects || nodes.empty()) {
+			return;
+		}
+		ThreadPool& threads = (pool != NULL) ? *pool : ThreadPool::Shared();
+		auto start = chrono::high_resolution_clock::now();
+
+		threads.ParallelFor(0, (int)triangles.size(), [&](int slot) {
+			const LocalTriangle& local = localTriangles[triangleSource[slot]];
+			const Object& object = objects[local.Object];
+			if (!object.Dirty) {
+				return;
+			}
+			glm::vec3 v0 = glm::vec3(object.Transform * glm::vec4(local.V[0], 1.0f));
+			glm::vec3 v1 = glm::vec3(object.Transform * glm::vec4(local.V[1], 1.0f));
+			glm::vec3 v2 = glm::vec3(object.Transform * glm::vec4(local.V[2], 1.0f));
+			SetTriangle(slot, v0, v1, v2);
+		}, 1024);
+
+		//Children are always allocated after their parent, so walking backwards sees children first
+		for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+			if (i == 1) {
+				continue; //Unused padding slot
+			}
+			BVHNode& node = nodes[i];
+			if (node.IsLeaf()) {
+				UpdateNodeBounds(node);
+			}
+			else {
+				const BVHNode& left = nodes[node.LeftFirst];
+				const BVHNode& right = nodes[node.LeftFirst + 1];
+				node.BoundsMin = glm::min(left.BoundsMin, right.BoundsMin);
+				node.BoundsMax = glm::max(left.BoundsMax, right.BoundsMax);
+			}
+		}
+
+		for (Object& object : objects) {
+			object.Dirty = false;
+		}
+		dirtyObjects = false;
+
+		RefitMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Closest hit along the ray. Returns false if nothing was hit.
+	bool Intersect(const BVHRay& ray, BVHHit& hit) const {
+		hit = BVHHit();
+		hit.T = ray.TMax;
+		return Traverse(ray, hit, false);
+	}
+
+	//True if anything is hit between TMin and TMax, stops at the first hit found
+	bool Occluded(const BVHRay& ray) const {
+		BVHHit hit;
+		hit.T = ray.TMax;
+		return Traverse(ray, hit, true);
+	}
+
+	int GetNodeCount() const { return (int)nodes.size(); }
+	int GetTriangleCount() const { return (int)localTriangles.size(); }
+	int GetObjectCount() const { return (int)objects.size(); }
+
+	//Bytes held by the tree and its triangle copies
+	size_t GetMemoryBytes() const {
+		return objects.capacity() * sizeof(Object) + localTriangles.capacity() * sizeof(LocalTriangle) + nodes.capacity() * sizeof(BVHNode)
+			+ triangles.capacity() * sizeof(Triangle) + triangleSource.capacity() * sizeof(int) + buildRefs.capacity() * sizeof(BuildRef);
+	}
+
+	//Timings of the last Build()/Refit()
+	double BuildMs = 0.0;
+	double RefitMs = 0.0;
+
+	//Casts every ray and returns rays per second. Rays are split across the pool when one is given.
+	double Benchmark(const vector<BVHRay>& rays, bool anyHit, ThreadPool* pool = NULL, int* hitCount = NULL) const {
+		atomic<int> hits(0);
+		const int raysPerChunk = 256;
+		int chunkCount = (int)((rays.size() + raysPerChunk - 1) / raysPerChunk);
+
+		auto castChunk = [&](int chunk) {
+			int chunkHits = 0;
+			size_t end = min(rays.size(), (size_t)(chunk + 1) * raysPerChunk);
+			for (size_t i = (size_t)chunk * raysPerChunk; i < end; i++) {
+				BVHHit hit;
+				if (anyHit ? Occluded(rays[i]) : Intersect(rays[i], hit)) {
+					chunkHits++;
+				}
+			}
+			hits += chunkHits;
+		};
+
+		auto start = chrono::high_resolution_clock::now();
+		if (pool != NULL) {
+			pool->ParallelFor(0, chunkCount, castChunk);
+		}
+		else {
+			for (int chunk = 0; chunk < chunkCount; chunk++) {
+				castChunk(chunk);
+			}
+		}
+		double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+		if (hitCount != NULL) {
+			*hitCount = hits.load();
+		}
+		return (seconds > 0.0) ? rays.size() / seconds : 0.0;
+	}
+
+private:
+
+	struct Object {
+		glm::mat4 Transform;
+		int FirstTriangle;
+		int TriangleCount;
+		bool Dirty = false;
+	};
+
+	//Object space triangle, as added
+	struct LocalTriangle {
+		glm::vec3 V[3];
+		int Object;
+	};
+
+	//Leaf order world space triangle, 36 bytes
+	struct Triangle {
+		glm::vec3 V0;
+		glm::vec3 Edge1;
+		glm::vec3 Edge2;
+	};
+
+	//Per triangle data only needed while building
+	struct BuildRef {
+		glm::vec3 BoundsMin;
+		glm::vec3 BoundsMax;
+		glm::vec3 Centroid;
+		int Triangle;
+	};
+
+	struct Bin {
+		glm::vec3 BoundsMin = glm::vec3(FLT_MAX);
+		glm::vec3 BoundsMax = glm::vec3(-FLT_MAX);
+		int Count = 0;
+	};
+
+	vector<Object> objects;
+	vector<LocalTriangle> localTriangles;
+
+	vector<BVHNode> nodes;
+	atomic<uint32_t> nodesUsed{ 0 };
+
+	vector<Triangle> triangles;
+	vector<int> triangleSource; //Leaf slot -> index into localTriangles
+	vector<BuildRef> buildRefs;
+
+	bool dirtyObjects = false;
+
+	static float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+		glm::vec3 extent = boundsMax - boundsMin;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+
+	void SetTriangle(int slot, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+		Triangle& tri = triangles[slot];
+		tri.V0 = v0;
+		tri.Edge1 = v1 - v0;
+		tri.Edge2 = v2 - v0;
+	}
+
+	//Fits a leaf (during the build from buildRefs, afterwards from the leaf triangles)
+	void UpdateNodeBounds(BVHNode& node) const {
+		node.BoundsMin = glm::vec3(FLT_MAX);
+		node.BoundsMax = glm::vec3(-FLT_MAX);
+
+		for (uint32_t i = 0; i < node.Count; i++) {
+			if (!buildRefs.empty()) {
+				const BuildRef& ref = buildRefs[node.LeftFirst + i];
+				node.BoundsMin = glm::min(node.BoundsMin, ref.BoundsMin);
+				node.BoundsMax = glm::max(node.BoundsMax, ref.BoundsMax);
+			}
+			else {
+				const Triangle& tri = triangles[node.LeftFirst + i];
+				glm::vec3 v1 = tri.V0 + tri.Edge1;
+				glm::vec3 v2 = tri.V0 + tri.Edge2;
+				node.BoundsMin = glm::min(node.BoundsMin, glm::min(tri.V0, glm::min(v1, v2)));
+				node.BoundsMax = glm::max(node.BoundsMax, glm::max(tri.V0, glm::max(v1, v2)));
+			}
+		}
+	}
+
+	//Finds the cheapest binned SAH split of a node. Returns its cost, FLT_MAX if the centroids can't be separated.
+	float FindBestSplit(const BVHNode& node, int& bestAxis, float& bestPosition) const {
+		float bestCost = FLT_MAX;
+
+		glm::vec3 centroidMin(FLT_MAX);
+		glm::vec3 centroidMax(-FLT_MAX);
+		for (uint32_t i = 0; i < node.Count; i++) {
+			const glm::vec3& centroid = buildRefs[node.LeftFirst + i].Centroid;
+			centroidMin = glm::min(centroidMin, centroid);
+			centroidMax = glm::max(centroidMax, centroid);
+		}
+
+		for (int axis = 0; axis < 3; axis++) {
+			float axisMin = centroidMin[axis];
+			float axisMax = centroidMax[axis];
+			if (axisMax <= axisMin) {
+				continue;
+			}
+
+			Bin bins[BVH_SAH_BINS];
+			float scale = BVH_SAH_BINS / (axisMax - axisMin);
+			for (uint32_t i = 0; i < node.Count; i++) {
+				const BuildRef& ref = buildRefs[node.LeftFirst + i];
+				int bin = min(BVH_SAH_BINS - 1, (int)((ref.Centroid[axis] - axisMin) * scale));
+				bins[bin].Count++;
+				bins[bin].BoundsMin = glm::min(bins[bin].BoundsMin, ref.BoundsMin);
+				bins[bin].BoundsMax = glm::max(bins[bin].BoundsMax, ref.BoundsMax);
+			}
+
+			//Sweep from both sides to get the area/count left and right of every bin boundary
+			float leftArea[BVH_SAH_BINS - 1], rightArea[BVH_SAH_BINS - 1];
+			int leftCount[BVH_SAH_BINS - 1], rightCount[BVH_SAH_BINS - 1];
+			glm::vec3 leftMin(FLT_MAX), leftMax(-FLT_MAX), rightMin(FLT_MAX), rightMax(-FLT_MAX);
+			int leftSum = 0, rightSum = 0;
+
+			for (int i = 0; i < BVH_SAH_BINS - 1; i++) {
+				leftSum += bins[i].Count;
+				leftCount[i] = leftSum;
+				leftMin = glm::min(leftMin, bins[i].BoundsMin);
+				leftMax = glm::max(leftMax, bins[i].BoundsMax);
+				leftArea[i] = (leftSum > 0) ? SurfaceArea(leftMin, leftMax) : 0.0f;
+
+				int r = BVH_SAH_BINS - 1 - i;
+				rightSum += bins[r].Count;
+				rightCount[r - 1] = rightSum;
+				rightMin = glm::min(rightMin, bins[r].BoundsMin);
+				rightMax = glm::max(rightMax, bins[r].BoundsMax);
+				rightArea[r - 1] = (rightSum > 0) ? SurfaceArea(rightMin, rightMax) : 0.0f;
+			}
+
+			for (int i = 0; i < BVH_SAH_BINS - 1; i++) {
+				if (leftCount[i] == 0 || rightCount[i] == 0) {
+					continue;
+				}
+				float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestPosition = axisMin + (i + 1) / scale;
+				}
+			}
+		}
+
+		return bestCost;
+	}
+
+	//Splits one node into two children. Returns false when it should stay a leaf.
+	bool Split(uint32_t nodeIndex) {
+		BVHNode& node = nodes[nodeIndex];
+		if (node.Count <= 2) {
+			return false;
+		}
+
+		int axis = 0;
+		float position = 0.0f;
+		float splitCost = FindBestSplit(node, axis, position);
+
+		//SAH cost relative to the parent's area
+		float parentArea = SurfaceArea(node.BoundsMin, node.BoundsMax);
+		float leafCost = node.Count * BVH_TRIANGLE_COST;
+		if (splitCost == FLT_MAX) {
+			//Every centroid in one spot, no plane separates them
+			return node.Count > (uint32_t)BVH_MAX_LEAF_SIZE && SplitMedian(nodeIndex);
+		}
+		splitCost = BVH_TRAVERSAL_COST + BVH_TRIANGLE_COST * splitCost / max(parentArea, FLT_MIN);
+		if (splitCost >= leafCost && node.Count <= (uint32_t)BVH_MAX_LEAF_SIZE) {
+			return false;
+		}
+
+		//Partition the refs in place
+		BuildRef* first = &buildRefs[node.LeftFirst];
+		BuildRef* last = first + node.Count;
+		BuildRef* middle = partition(first, last, [axis, position](const BuildRef& ref) {
+			return ref.Centroid[axis] < position;
+		});
+
+		uint32_t leftCount = (uint32_t)(middle - first);
+		if (leftCount == 0 || leftCount == node.Count) {
+			return node.Count > (uint32_t)BVH_MAX_LEAF_SIZE && SplitMedian(nodeIndex);
+		}
+		MakeChildren(nodeIndex, leftCount);
+		return true;
+	}
+
+	//Halves a node's refs by centroid along the longest axis of their centroids, for nodes too big for a leaf that SAH
+	//can not split. Refs with equal centroids still go half each side.
+	bool SplitMedian(uint32_t nodeIndex) {
+		BVHNode& node = nodes[nodeIndex];
+		BuildRef* first = &buildRefs[node.LeftFirst];
+		BuildRef* last = first + node.Count;
+		glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+		for (BuildRef* ref = first; ref != last; ref++) {
+			centroidMin = glm::min(centroidMin, ref->Centroid);
+			centroidMax = glm::max(centroidMax, ref->Centroid);
+		}
+		glm::vec3 extent = centroidMax - centroidMin;
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+		uint32_t leftCount = node.Count / 2;
+		nth_element(first, first + leftCount, last, [axis](const BuildRef& a, const BuildRef& b) {
+			return a.Centroid[axis] < b.Centroid[axis];
+		});
+		MakeChildren(nodeIndex, leftCount);
+		return true;
+	}
+
+	//The node's first leftCount refs become its left child and the rest its right
+	void MakeChildren(uint32_t nodeIndex, uint32_t leftCount) {
+		BVHNode& node = nodes[nodeIndex];
+		uint32_t leftIndex = nodesUsed.fetch_add(2);
+		BVHNode& left = nodes[leftIndex];
+		BVHNode& right = nodes[leftIndex + 1];
+		left.LeftFirst = node.LeftFirst;
+		left.Count = leftCount;
+		right.LeftFirst = node.LeftFirst + leftCount;
+		right.Count = node.Count - leftCount;
+		UpdateNodeBounds(left);
+		UpdateNodeBounds(right);
+
+		node.LeftFirst = leftIndex;
+		node.Count = 0;
+	}
+
+	//Builds the whole subtree under a node on the calling thread
+	void Subdivide(uint32_t nodeIndex, int depth) {
+		vector<pair<uint32_t, int>> stack;
+		stack.push_back(make_pair(nodeIndex, depth));
+
+		while (!stack.empty()) {
+			pair<uint32_t, int> item = stack.back();
+			stack.pop_back();
+
+			if (item.second < BVH_MAX_DEPTH && Split(item.first)) {
+				stack.push_back(make_pair(nodes[item.first].LeftFirst, item.second + 1));
+				stack.push_back(make_pair(nodes[item.first].LeftFirst + 1, item.second + 1));
+			}
+		}
+	}
+
+	//Slab test, returns the entry distance or FLT_MAX on a miss
+	static float IntersectAABB(const glm::vec3& origin, const glm::vec3& invDirection, float tMin, float tMax, const BVHNode& node) {
+		glm::vec3 t0 = (node.BoundsMin - origin) * invDirection;
+		glm::vec3 t1 = (node.BoundsMax - origin) * invDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+
+		float enter = max(max(tNear.x, tNear.y), max(tNear.z, tMin));
+		float exit = min(min(tFar.x, tFar.y), min(tFar.z, tMax));
+		return (enter <= exit) ? enter : FLT_MAX;
+	}
+
+	//Moller-Trumbore, updates hit when closer
+	bool IntersectTriangle(const BVHRay& ray, int slot, BVHHit& hit) const {
+		const Triangle& tri = triangles[slot];
+		glm::vec3 p = glm::cross(ray.Direction, tri.Edge2);
+		float det = glm::dot(tri.Edge1, p);
+		if (fabs(det) < 1e-12f) {
+			return false;
+		}
+
+		float invDet = 1.0f / det;
+		glm::vec3 s = ray.Origin - tri.V0;
+		float u = glm::dot(s, p) * invDet;
+		if (u < 0.0f || u > 1.0f) {
+			return false;
+		}
+
+		glm::vec3 q = glm::cross(s, tri.Edge1);
+		float v = glm::dot(ray.Direction, q) * invDet;
+		if (v < 0.0f || u + v > 1.0f) {
+			return false;
+		}
+
+		float t = glm::dot(tri.Edge2, q) * invDet;
+		if (t < ray.TMin || t >= hit.T) {
+			return false;
+		}
+
+		const LocalTriangle& local = localTriangles[triangleSource[slot]];
+		hit.T = t;
+		hit.U = u;
+		hit.V = v;
+		hit.Object = local.Object;
+		hit.Triangle = triangleSource[slot] - objects[local.Object].FirstTriangle;
+		return true;
+	}
+
+	//Stack based traversal, nearer child first. anyHit stops at the first hit.
+	bool Traverse(const BVHRay& ray, BVHHit& hit, bool anyHit) const {
+		if (nodes.empty()) {
+			return false;
+		}
+
+		glm::vec3 invDirection = 1.0f / ray.Direction;
+		bool found = false;
+
+		if (IntersectAABB(ray.Origin, invDirection, ray.TMin, hit.T, nodes[0]) == FLT_MAX) {
+			return false;
+		}
+
+		uint32_t stack[64];
+		int stackSize = 0;
+		uint32_t nodeIndex = 0;
+
+		while (true) {
+			const BVHNode& node = nodes[nodeIndex];
+
+			if (node.IsLeaf()) {
+				for (uint32_t i = 0; i < node.Count; i++) {
+					if (IntersectTriangle(ray, node.LeftFirst + i, hit)) {
+						found = true;
+						if (anyHit) {
+							return true;
+						}
+					}
+				}
+			}
+			else {
+				uint32_t nearChild = node.LeftFirst;
+				uint32_t farChild = node.LeftFirst + 1;
+				float tNear = IntersectAABB(ray.Origin, invDirection, ray.TMin, hit.T, nodes[nearChild]);
+				float tFar = IntersectAABB(ray.Origin, invDirection, ray.TMin, hit.T, nodes[farChild]);
+				if (tNear > tFar) {
+					swap(nearChild, farChild);
+					swap(tNear, tFar);
+				}
+
+				if (tNear != FLT_MAX) {
+					if (tFar != FLT_MAX) {
+						stack[stackSize++] = farChild;
+					}
+					nodeIndex = nearChild;
+					continue;
+				}
+			}
+
+			//Pop until we find a node that is still in front of the closest hit
+			bool next = false;
+			while (stackSize > 0) {
+				nodeIndex = stack[--stackSize];
+				if (IntersectAABB(ray.Origin, invDirection, ray.TMin, hit.T, nodes[nodeIndex]) != FLT_MAX) {
+					next = true;
+					break;
+				}
+			}
+			if (!next) {
+				break;
+			}
+		}
+
+		return found;
+	}
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <vector>
+#include <iostream>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
@@ -80,6 +81,23 @@ public:
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// returns the on screen radius in pixels of a world space sphere, used to pick a level of detail
+	float GetProjectedRadius(const glm::vec3& center, float radius, const glm::mat4& projection, float viewportHeight)
+	{
+		glm::vec3 viewCenter = glm::vec3(GetViewMatrix() * glm::vec4(center, 1.0f));
+
+		// orthographic projections have no divide by depth
+		bool perspective = projection[3][3] == 0.0f;
+		float depth = perspective ? -viewCenter.z : 1.0f;
+
+		if (perspective && depth <= -radius)
+			return 0.0f;            // entirely behind the camera
+		if (perspective && depth <= radius)
+			return viewportHeight;  // camera is inside or touching the sphere
+
+		return radius * projection[1][1] / depth * viewportHeight * 0.5f;
+	}
+
 	// processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
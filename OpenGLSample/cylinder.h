@@ -3,265 +3,190 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "glcontext.h"
+#include "camera.h"
+#include "lod.h"
+#include "shader.h"
+#include "tessellation.h"
+#include "procedural.h"
+#include "primitivegen.h"
+#include "angletable.h"
 
 #include <vector>
-#include <random>
-
-//define PI
-#define M_PI 3.1415926535897932384626433832795
 
 using namespace std;
 
+//Up axis values
+const int CYLINDER_AXIS_X = 1;
+const int CYLINDER_AXIS_Y = 2;
+const int CYLINDER_AXIS_Z = 3;
+
+//Top radius meaning "the same as the base radius", 0 is a real top radius (a cone)
+const float CYLINDER_SAME_RADIUS = -1.0f;
+
+//Floats per interleaved vertex: position(3), normal(3), uv(2), 32 bytes
+const int CYLINDER_VERTEX_FLOATS = 8;
+
+/*
+* Indexed cylinder, a truncated cone when the base and top radii differ. Sectors go around, stacks go up.
+* Smooth cylinders share every ring vertex between the two sides next to it, flat ones only share along a side face.
+* The mesh is built around the Y axis and then turned to the up axis, later axis changes turn the existing vertices
+* (CPU arrays and GPU buffers) in place instead of rebuilding. Definitions are in Cylinder.cpp.
+*/
 class Cylinder
 {
 public:
-	//originOffset point will be middle of the plane
+	//Center of the base, the cylinder grows from here along the up axis
 	glm::vec3 Position;
 
-	//Dimensions (r, h)
-	glm::vec2 Dimensions;
-
-	int SideCount;
-	int SubDivisions;
 	bool TopDrawn;
 	bool BtmDrawn;
 
-	//Vector of vertices
-	vector<float> Vertices;
-
-	//VAO and VBO
-	unsigned int VAO, VBO;
-
-	//Constructor
-	Cylinder(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), float radius = 2.0f, float height = 2.0f, int sides = 8, int subdivisions = 1, bool drawTop = true, bool drawBottom = true)
-	{
-		Position = position;
+	//Interleaved vertices and the triangles indexing them, empty once ReleaseVertices was called or when the mesh
+	//was generated straight into its buffers (PrimitiveRetainsVertices() off with a GL context)
+	vector<float> InterleavedVertices;
+	vector<unsigned int> Indices;
 
-		//X-axis = raidus, Y-axis = height
-		Dimensions.x = radius;
-		Dimensions.y = height;
-
-		TopDrawn = drawTop;
-		BtmDrawn = drawBottom;
-
-		SideCount = sides;
-
-		//Need at least one subdivision
-		if (subdivisions <= 0) { subdivisions = 1; }
-		SubDivisions = subdivisions;
-
-		//Calculate the vertices
-		CalculateVertices();
+	//The same triangles expanded to the primitive layout (pos, color, normal, uv) for the CPU consumers that read
+	//triangle lists (BVH, software renderer, megabuffer). Only kept while PrimitiveRetainsVertices() is set.
+	vector<float> Vertices;
 
-		//Generate the VAO/VBO
-		GenerateVertexArrayAndBuffer();
-	}
+	//Counts of the full detail mesh, valid whether or not the arrays are kept
+	int VertexCount = 0;
+	int IndexCount = 0;
 
-	//Binds the VAO associated with this object
-	void BindVAO() {
-		glBindVertexArray(VAO);
-	}
+	//VAO, VBO and index buffer
+	unsigned int VAO = 0, VBO = 0, EBO = 0;
 
-	//Draws the object
-	void Draw() {
-		BindVAO();
-		glDrawArrays(GL_TRIANGLES, 0, (Vertices.size() / numVertexAttributes));
-	}
+	//Level of detail chain, empty until GenerateLODs is called. Level 0 shares the buffers above.
+	vector<LODLevel> LODs;
 
-	//De-allocates the resources associated with the VAO/VBO
-	void DeallocateVertexArrayBuffers() {
-		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &VBO);
-	}
+	//Coarse patch mesh for the tessellated path, empty until GeneratePatches is called
+	unsigned int PatchVAO = 0, PatchVBO = 0;
+	int PatchVertexCount = 0;
+	vector<float> PendingPatches; //Kept until UploadBuffers when built without a GL context
 
-private:
+	//Constructor: radii (top CYLINDER_SAME_RADIUS for a straight cylinder, 0 for a cone), height, sectors around,
+	//stacks up, smooth or flat normals, up axis (1 = X, 2 = Y, 3 = Z), base center and caps. Uploads straight away
+	//when there is a current GL context.
+	Cylinder(float baseRadius = 1.0f, float topRadius = CYLINDER_SAME_RADIUS, float height = 1.0f, int sectors = 36, int stacks = 1, bool smooth = true,
+		int up = CYLINDER_AXIS_Y, glm::vec3 position = glm::vec3(0.0f), bool drawTop = true, bool drawBottom = true);
 
-	const int numVertexAttributes = 11;
+	//Setters, everything but the up axis rebuilds the mesh (and its buffers and LOD chain when there are some)
+	void Set(float baseRadius, float topRadius, float height, int sectors, int stacks, bool smooth = true, int up = CYLINDER_AXIS_Y);
+	void SetBaseRadius(float radius);
+	void SetTopRadius(float radius);
+	void SetHeight(float height);
+	void SetSectorCount(int sectors);
+	void SetStackCount(int stacks);
+	void SetSmooth(bool smooth);
+	void SetUpAxis(int up);
 
-	//Calculates the vertices that make up the plane
-	void CalculateVertices() {
+	//Getters
+	float GetBaseRadius() const { return baseRadius; }
+	float GetTopRadius() const { return topRadius; }
+	float GetHeight() const { return height; }
+	int GetSectorCount() const { return sectorCount; }
+	int GetStackCount() const { return stackCount; }
+	bool IsSmooth() const { return smooth; }
+	int GetUpAxis() const { return upAxis; }
+	int GetTrisCount() const { return IndexCount / 3; }
+	int GetIndexCount() const { return IndexCount; }
+	int GetVertexCount() const { return VertexCount; }
+	int GetNormalCount() const { return VertexCount; }
+	int GetTexCoordCount() const { return VertexCount; }
+	int GetInterleavedStride() const { return interleavedStride; }
 
-		// Generate vertices for a Cylinder (ground plane)
-		glm::vec3 vertColor;
-		//vertColor = GenerateRandomVertColor();
-		vertColor = glm::vec3(1.0f);
-		float radius = Dimensions.x;
-		float height = Dimensions.y;
+	//Bytes still held in CPU arrays
+	size_t GetCPUBytes() const;
 
-		float u = (1.0f / (float)SideCount);
-		float v = (1.0f / (float)SubDivisions);
+	//Straight Y-up cylinders only, the tessellated and procedural paths evaluate exactly that surface
+	bool HasAnalyticSurface() const;
 
-		glm::vec3 normals;
+	//Debug
+	void Print() const;
 
-		// Connect the vertices to form triangles for the sides
-		for (int i = 0; i < SideCount; i++) {
-			// Calculate our points along the circumference
-			float theta1 = (float)(2.0f * M_PI * i) / SideCount;
-			float theta2 = (float)(2.0f * M_PI * (i + 1)) / SideCount;
+	//Draws the full detail mesh
+	void Draw() const;
 
-			float x1 = Position.x + radius * cos(theta1);
-			float z1 = Position.z + radius * sin(theta1);
+	//De-allocates the VAO/VBO/index buffer, the LOD levels and the patches
+	void DeallocateVertexArrayBuffers();
 
-			float x2 = Position.x + radius * cos(theta2);
-			float z2 = Position.z + radius * sin(theta2);
+	//Creates the buffers from the CPU arrays, or generates the mesh into them when there are none. Needs a current GL context, the constructor skips it when there is none (headless).
+	void GenerateVertexArrayAndBuffer();
 
-			float divHeight = height / SubDivisions;
+	//Uploads whatever was built on a thread without a GL context: the object itself, its LOD levels and its patches
+	void UploadBuffers();
 
-			//Subdivide, starting from the bottom, then stack up
-			for (int j = 0; j < SubDivisions; j++) {
+	//Frees the CPU arrays once the buffers hold them. Drawing keeps working, CPU consumers must have taken what they need first.
+	void ReleaseVertices();
 
-				float btmY = Position.y + (divHeight * j);
-				float topY = Position.y + (divHeight * (j+1));
+	//Builds reduced versions of this object, each level halves the sector and stack counts. Stops early once the
+	//sector count can't drop any further. Without a current GL context levels are only described until UploadBuffers.
+	void GenerateLODs(int levelCount = LOD_DEFAULT_LEVELS);
 
-				//Generate the normals
-				glm::vec3 vert1 = glm::vec3(x1, btmY, z1);
-				glm::vec3 vert2 = glm::vec3(x1, topY, z1);
-				glm::vec3 vert3 = glm::vec3(x2, topY, z2);
+	//Picks the level to draw from how large the bounding sphere is on screen
+	int SelectLOD(Camera& camera, const glm::mat4& model, const glm::mat4& projection, float viewportHeight, int currentLevel);
 
-				glm::vec3 edge1 = vert3 - vert1;
-				glm::vec3 edge2 = vert2 - vert1;
+	//Draws one level of the chain, falls back to the full object when there is no chain
+	void DrawLOD(int level);
 
-				normals = glm::normalize(glm::cross(edge1, edge2));
+	//Builds the coarse patch mesh the tessellation shaders refine. Columns go around, rows go up.
+	void GeneratePatches(int columns = TESS_DEFAULT_PATCH_COLUMNS, int rows = TESS_DEFAULT_PATCH_ROWS);
 
-				//Right triangle
-				AddVertex(x1, btmY, z1, vertColor, normals, 1 - (u * i), v * j); //Downward Tip (Bottom Right)
-				AddVertex(x1, topY, z1, vertColor, normals, 1 - (u * i), v * (j + 1)); //Top Right
-				AddVertex(x2, topY, z2, vertColor, normals, 1 - (u * (i + 1)), v * (j + 1)); //Top Left
+	//Sets the uniforms the tessellation and procedural shaders evaluate the surface from
+	void SetShapeUniforms(Shader& shader);
 
-				vert1 = glm::vec3(x2, topY, z2);
-				vert2 = glm::vec3(x2, btmY, z2);
-				vert3 = glm::vec3(x1, btmY, z1);
+	//Draws the analytic surface through the tessellation program, which must be in use with model/view/projection set
+	void DrawPatches(Shader& shader);
 
-				edge1 = vert3 - vert1;
-				edge2 = vert2 - vert1;
+	//Draws without any vertex buffer, positions/normals/UVs come from the vertex ID in proceduralPrimitiveVertex.glsl
+	void DrawProcedural(Shader& shader);
 
-				normals = glm::normalize(glm::cross(edge1, edge2));
-												   
-				//Left triangle					   
-				AddVertex(x2, topY, z2, vertColor, normals, 1 - (u * (i + 1)), v * (j + 1)); //Upward Tip (Top Left)
-				AddVertex(x2, btmY, z2, vertColor, normals, 1 - (u * (i + 1)), v * j); //Bottom Left
-				AddVertex(x1, btmY, z1, vertColor, normals, 1 - (u * i), v * j); //Bottom Right
-			}
-		}
+private:
+	float baseRadius = 1.0f;
+	float topRadius = 1.0f;
+	float height = 1.0f;
+	int sectorCount = 36;
+	int stackCount = 1;
+	bool smooth = true;
+	int upAxis = CYLINDER_AXIS_Y;
+	int interleavedStride;
 
-		// Create the vertices for the bottom, I will probably use the bottom everytime.
-		if (BtmDrawn) {
+	//Levels GenerateLODs was last asked for, so a rebuild makes the same chain
+	int lodLevelCount = 0;
 
-			normals = glm::vec3(0.0f, -1.0f, 0.0);
+	//Builds the full detail mesh with the current settings, then refreshes the buffers and LOD chain that exist
+	void BuildVertices();
 
-			for (int i = 0; i <= SideCount; ++i) {
+	//Writes a mesh for the given counts at the current up axis, smooth or flat, into arrays sized for it or into
+	//destinations (mapped buffers) holding the vertices and indices CalculateCounts gives
+	void BuildMesh(int sectors, int stacks, vector<float>& vertices, vector<unsigned int>& indices) const;
+	void BuildMesh(int sectors, int stacks, float* vertices, unsigned int* indices) const;
 
-				float curTheta = (float)(2.0f * M_PI * i) / SideCount;
-				float nxtTheta = (float)(2.0f * M_PI * (i + 1)) / SideCount;
+	//The two generators behind BuildMesh
+	void BuildVerticesSmooth(int sectors, int stacks, float* vertices, unsigned int* indices) const;
+	void BuildVerticesFlat(int sectors, int stacks, float* vertices, unsigned int* indices) const;
 
-				float curX = Position.x + radius * cos(curTheta);
-				float curZ = Position.z + radius * sin(curTheta);
+	//Vertices and indices a mesh with these counts has: the sides, then the bottom and top caps
+	void CalculateCounts(int sectors, int stacks, bool smoothMesh, int& vertexCount, int& indexCount) const;
 
-				float nxtX = Position.x + radius * cos(nxtTheta);
-				float nxtZ = Position.z + radius * sin(nxtTheta);
+	//Writes cap item i of both caps (ring vertex and triangle i, the centers for i == sectors). Shared by both generators,
+	//the caps start after sideVertices vertices and the side indices.
+	void BuildCaps(int i, int sectors, int stacks, const AngleRing& ring, int sideVertices, float* vertices, unsigned int* indices) const;
 
-				float textureCurThetaU = 1.0f * cos(curTheta);
-				float textureCurThetaV = 1.0f * sin(curTheta);
+	//Writes one interleaved vertex from a point in the Y-up frame, turned to the up axis and moved to Position
+	float* WriteVertex(float* out, const glm::vec3& local, const glm::vec3& normal, float u, float v) const;
 
-				float textureNxtThetaU = 1.0f * cos(nxtTheta);
-				float textureNxtThetaV = 1.0f * sin(nxtTheta);
+	//Turns every position and normal from one up axis to another, in place. False when a buffer lost its contents
+	//while mapped and has to be rebuilt.
+	bool ChangeUpAxis(int from, int to);
 
-				// Triangle connecting the center, current, and next vertices
-				AddVertex(Position.x, Position.y, Position.z, vertColor, normals, 0.0f, 0.0f); //Center
-				AddVertex(curX, Position.y, curZ, vertColor, normals, textureCurThetaU, textureCurThetaV);
-				AddVertex(nxtX, Position.y, nxtZ, vertColor, normals, textureNxtThetaU, textureNxtThetaV);
-				
-			}
-		}
+	//Expands the indexed mesh into Vertices
+	void ExpandVertices();
 
-		// Create the vertices for the bottom, I will probably use the bottom everytime.
-		if (TopDrawn) {
-
-			normals = glm::vec3(0.0f, 1.0f, 0.0f);
-
-			for (int i = 0; i <= SideCount; ++i) {
-
-				float curTheta = (float)(2.0f * M_PI * i) / SideCount;
-				float nxtTheta = (float)(2.0f * M_PI * (i + 1)) / SideCount;
-
-				float curX = Position.x + radius * cos(curTheta);
-				float curZ = Position.z + radius * sin(curTheta);
-
-				float nxtX = Position.x + radius * cos(nxtTheta);
-				float nxtZ = Position.z + radius * sin(nxtTheta);
-
-				float textureCurThetaU = 1.0f * cos(curTheta);
-				float textureCurThetaV = 1.0f * sin(curTheta);
-
-				float textureNxtThetaU = 1.0f * cos(nxtTheta);
-				float textureNxtThetaV = 1.0f * sin(nxtTheta);
-
-				// Triangle connecting the center, current, and next vertices
-				AddVertex(Position.x, Position.y + height, Position.z, vertColor, normals, 0.0f, 0.0f); //Center
-				AddVertex(curX, Position.y + height, curZ, vertColor, normals, textureCurThetaU, textureCurThetaV);
-				AddVertex(nxtX, Position.y + height, nxtZ, vertColor, normals, textureNxtThetaU, textureNxtThetaV);
-
-			}
-		}
-	}
-
-	//Helper function to add the vertices
-	void AddVertex(float x, float y, float z, const glm::vec3& color, const glm::vec3& normals, float u, float v) {
-		Vertices.push_back(x);
-		Vertices.push_back(y);
-		Vertices.push_back(z);
-		Vertices.push_back(color.r);
-		Vertices.push_back(color.g);
-		Vertices.push_back(color.b);
-		Vertices.push_back(normals.x);
-		Vertices.push_back(normals.y);
-		Vertices.push_back(normals.z);
-		Vertices.push_back(u);
-		Vertices.push_back(v);
-	}
-
-	//Generates the VAO and VBO for the object
-	void GenerateVertexArrayAndBuffer() {
-
-		//Gen the vertex array
-		glGenVertexArrays(1, &VAO);
-		glBindVertexArray(VAO);
-
-		//Gen and bind the buffer
-		glGenBuffers(1, &VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), &Vertices[0], GL_STATIC_DRAW);
-
-		//Configure the Buffer Attributes
-
-		//Position (x, y, z)
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		// color attribute (r, g, b)
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-		// normals attribute (x, y, z)
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		// texture attribute (U, V)
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
-		glEnableVertexAttribArray(3);
-
-	}
-
-	//Generates a random color for the object's vertices
-	glm::vec3 GenerateRandomVertColor() {
-		//default colors for now, going to randomize since no shading.
-		random_device rd;
-		mt19937 gen(rd());
-		uniform_real_distribution<float> dis(0.0f, 1.0f);
-		glm::vec3 vertColor;
-		vertColor.r = dis(gen);
-		vertColor.g = dis(gen);
-		vertColor.b = dis(gen);
-
-		return vertColor;
-	}
+	//Generates one reduced level straight into its own buffers
+	void GenerateLODBuffer(LODLevel& level);
 };
 
-#endif
\ No newline at end of file
+#endif
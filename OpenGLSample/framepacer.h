@@ -0,0 +1,201 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "glcontext.h"
+#include "ringbuffer.h"
+
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+enum FramePacingMode {
+	FRAME_PACING_LOW_LATENCY,	//One frame in flight, no vsync: input is sampled as late as possible, the GPU may idle between frames
+	FRAME_PACING_THROUGHPUT		//As many frames in flight as the ring buffers hold, vsync on: the GPU never waits for the CPU
+};
+
+//Frames the CPU may run ahead of the GPU in each mode. Throughput stays within the uniform ring so its fences never block.
+const int FRAME_PACER_LOW_LATENCY_FRAMES = 1;
+const int FRAME_PACER_THROUGHPUT_FRAMES = RING_BUFFER_FRAMES_IN_FLIGHT;
+
+//The limiter sleeps until this long before the deadline and spins the rest, OS sleeps overshoot by about a scheduler tick
+const double FRAME_PACER_DEFAULT_SPIN_MS = 2.0;
+
+//Frame to frame timings since the last report
+struct FramePacingStats {
+	int Frames = 0;
+	double MeanMs = 0.0;	//Start to start interval
+	double StdDevMs = 0.0;	//Spread of the interval
+	double JitterMs = 0.0;	//Mean change of the interval from one frame to the next
+	double WorstMs = 0.0;
+	int FenceWaits = 0;		//Frames that had to wait for the GPU
+	double FenceWaitMs = 0.0;
+	double LimiterMs = 0.0;	//Time the cap spent sleeping/spinning
+};
+
+//Paces the render loop: BeginFrame at the top of the loop (before input is read), EndFrame right after the swap.
+//Frames in flight are limited with a fence per frame, and an optional frame rate cap waits out the rest of the frame
+//before the frame starts rather than after it is presented, so the wait never ages the input the frame is built from.
+class FramePacer
+{
+public:
+	FramePacingMode Mode = FRAME_PACING_THROUGHPUT;
+	int MaxFramesInFlight = FRAME_PACER_THROUGHPUT_FRAMES;
+
+	//Frame rate cap, 0 for none
+	double TargetFps = 0.0;
+	double SpinMs = FRAME_PACER_DEFAULT_SPIN_MS;
+
+	FramePacer(FramePacingMode mode = FRAME_PACING_THROUGHPUT, double targetFps = 0.0) {
+		TargetFps = targetFps;
+		SetMode(mode);
+	}
+
+	//Switches mode: frames in flight and swap interval. Stats restart, the two modes aren't comparable.
+	void SetMode(FramePacingMode mode) {
+		Mode = mode;
+		MaxFramesInFlight = (mode == FRAME_PACING_LOW_LATENCY) ? FRAME_PACER_LOW_LATENCY_FRAMES : FRAME_PACER_THROUGHPUT_FRAMES;
+		if (HasCurrentGLContext()) {
+			glfwSwapInterval(mode == FRAME_PACING_LOW_LATENCY ? 0 : 1);
+		}
+		ResetStats();
+	}
+
+	//Waits until the frame may start: for the GPU if too many frames are in flight, then for the cap's deadline
+	void BeginFrame() {
+		while ((int)fences.size() >= MaxFramesInFlight) {
+			WaitForOldestFence();
+		}
+
+		if (TargetFps > 0.0) {
+			WaitForDeadline();
+		}
+
+		//Frame start to frame start, measured after every wait so it is what the display sees
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (hasLastStart) {
+			AddInterval(chrono::duration<double, milli>(now - lastStart).count());
+		}
+		lastStart = now;
+		hasLastStart = true;
+	}
+
+	//Fences the frame just submitted, call right after the swap
+	void EndFrame() {
+		if (HasCurrentGLContext()) {
+			fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		}
+	}
+
+	FramePacingStats GetStats() const {
+		FramePacingStats result = stats;
+		result.Frames = intervals;
+		result.MeanMs = mean;
+		result.StdDevMs = intervals > 1 ? sqrt(sumSquares / (intervals - 1)) : 0.0;
+		result.JitterMs = intervals > 1 ? sumDeltas / (intervals - 1) : 0.0;
+		return result;
+	}
+
+	//Prints the stats since the last report and starts over
+	void Report() {
+		FramePacingStats result = GetStats();
+		if (result.Frames > 0) {
+			cout << "FRAME PACING::" << (Mode == FRAME_PACING_LOW_LATENCY ? "LOW LATENCY" : "THROUGHPUT")
+				<< "::IN FLIGHT " << MaxFramesInFlight << "::CAP " << (TargetFps > 0.0 ? to_string((int)TargetFps) : string("OFF"))
+				<< "::FRAMES " << result.Frames << "::MEAN " << result.MeanMs << "ms::STDDEV " << result.StdDevMs
+				<< "ms::JITTER " << result.JitterMs << "ms::WORST " << result.WorstMs << "ms::FENCE WAITS " << result.FenceWaits
+				<< " (" << result.FenceWaitMs << "ms)::LIMITER " << result.LimiterMs << "ms" << endl;
+		}
+		ResetStats();
+	}
+
+	//Deletes the outstanding fences
+	void Deallocate() {
+		for (GLsync fence : fences) {
+			glDeleteSync(fence);
+		}
+		fences.clear();
+	}
+
+private:
+	deque<GLsync> fences;
+
+	chrono::steady_clock::time_point lastStart;
+	chrono::steady_clock::time_point deadline;
+	bool hasLastStart = false;
+	bool hasDeadline = false;
+
+	//Running mean/variance (Welford) of the interval and the frame to frame change
+	FramePacingStats stats;
+	int intervals = 0;
+	double mean = 0.0;
+	double sumSquares = 0.0;
+	double sumDeltas = 0.0;
+	double lastInterval = 0.0;
+
+	void WaitForOldestFence() {
+		GLsync fence = fences.front();
+		fences.pop_front();
+
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms steps
+			} while (result == GL_TIMEOUT_EXPIRED);
+			stats.FenceWaits++;
+			stats.FenceWaitMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(fence);
+	}
+
+	//Sleeps until SpinMs before the deadline, then spins. Deadlines advance by whole frames so a late frame doesn't
+	//shift every frame after it, but more than a frame late starts over instead of rushing to catch up.
+	void WaitForDeadline() {
+		chrono::steady_clock::duration frame = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / TargetFps));
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (!hasDeadline || now - deadline > frame) {
+			deadline = now;
+			hasDeadline = true;
+		}
+
+		chrono::steady_clock::time_point start = now;
+		chrono::steady_clock::duration spin = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(SpinMs));
+		if (deadline - now > spin) {
+			this_thread::sleep_for(deadline - now - spin);
+		}
+		while (chrono::steady_clock::now() < deadline) {
+			this_thread::yield();
+		}
+		stats.LimiterMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		deadline += frame;
+	}
+
+	void AddInterval(double intervalMs) {
+		intervals++;
+		double delta = intervalMs - mean;
+		mean += delta / intervals;
+		sumSquares += delta * (intervalMs - mean);
+		if (intervals > 1) {
+			sumDeltas += fabs(intervalMs - lastInterval);
+		}
+		lastInterval = intervalMs;
+		stats.WorstMs = max(stats.WorstMs, intervalMs);
+	}
+
+	void ResetStats() {
+		stats = FramePacingStats();
+		intervals = 0;
+		mean = sumSquares = sumDeltas = lastInterval = 0.0;
+		hasLastStart = false;
+		hasDeadline = false;
+	}
+};
+
+#endif
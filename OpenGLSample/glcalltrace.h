@@ -0,0 +1,328 @@
+#ifndef GLCALLTRACE_H
+#define GLCALLTRACE_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+/*
+* GL call tracing. InstallGLCallTrace swaps the glad function pointers of every entry point the program uses for a
+* hook that counts the call and forwards it, so nothing else changes and untraced runs pay nothing. Counts are kept
+* per entry point and per category and closed out once a frame. InstallGLPerformanceMessages subscribes to the
+* KHR_debug performance messages (GL 4.3 debug output) and logs each kind the first time the driver sends it.
+*/
+
+enum GLCallCategory {
+	GL_CALL_STATE,		//Fixed function and vertex format state
+	GL_CALL_UNIFORM,	//Uniform values and location lookups
+	GL_CALL_BIND,		//Binding objects and programs
+	GL_CALL_DRAW,		//Draws and clears
+	GL_CALL_BUFFER,		//Buffer and texture data updates
+	GL_CALL_OTHER,		//Creation, deletion, queries and sync
+	GL_CALL_CATEGORY_COUNT
+};
+
+const char* const GL_CALL_CATEGORY_NAMES[GL_CALL_CATEGORY_COUNT] = { "state", "uniform", "bind", "draw", "buffer", "other" };
+
+//Entry points listed by Report
+const int GL_CALL_TRACE_TOP_ENTRIES = 10;
+
+struct GLCallEntry {
+	string Name;
+	GLCallCategory Category = GL_CALL_OTHER;
+	long long FrameCalls = 0;	//Since the last EndFrame
+	long long TotalCalls = 0;	//In closed frames
+	long long MaxFrameCalls = 0;
+};
+
+struct GLPerformanceMessage {
+	string Text;
+	long long Count = 0;
+};
+
+class GLCallTrace
+{
+public:
+	bool Enabled = false;
+	vector<GLCallEntry> Entries;
+
+	//Frames closed, and the calls made before the first frame (loading)
+	long long Frames = 0;
+	long long LoadCalls = 0;
+
+	//KHR_debug performance messages by id
+	map<GLuint, GLPerformanceMessage> PerformanceMessages;
+
+	int Register(const char* name, GLCallCategory category) {
+		GLCallEntry entry;
+		entry.Name = name;
+		entry.Category = category;
+		Entries.push_back(entry);
+		return (int)Entries.size() - 1;
+	}
+
+	void Count(int entry) {
+		Entries[entry].FrameCalls++;
+	}
+
+	//Everything counted so far was loading, frames start now
+	void BeginFrames() {
+		for (GLCallEntry& entry : Entries) {
+			LoadCalls += entry.FrameCalls;
+			entry.FrameCalls = 0;
+		}
+	}
+
+	//Closes the frame, call right after the swap
+	void EndFrame() {
+		for (GLCallEntry& entry : Entries) {
+			entry.TotalCalls += entry.FrameCalls;
+			entry.MaxFrameCalls = max(entry.MaxFrameCalls, entry.FrameCalls);
+			entry.FrameCalls = 0;
+		}
+		Frames++;
+	}
+
+	double CallsPerFrame(const GLCallEntry& entry) const {
+		return Frames > 0 ? (double)entry.TotalCalls / Frames : 0.0;
+	}
+
+	double CategoryCallsPerFrame(GLCallCategory category) const {
+		long long calls = 0;
+		for (const GLCallEntry& entry : Entries) {
+			if (entry.Category == category) {
+				calls += entry.TotalCalls;
+			}
+		}
+		return Frames > 0 ? (double)calls / Frames : 0.0;
+	}
+
+	//Per frame averages by category and the busiest entry points
+	void Report() const {
+		if (!Enabled || Frames == 0) {
+			return;
+		}
+		double total = 0.0;
+		cout << "GL CALLS::" << Frames << " FRAMES::LOADING " << LoadCalls << "::PER FRAME";
+		for (int i = 0; i < GL_CALL_CATEGORY_COUNT; i++) {
+			double calls = CategoryCallsPerFrame((GLCallCategory)i);
+			total += calls;
+			cout << " " << GL_CALL_CATEGORY_NAMES[i] << " " << calls;
+		}
+		cout << "::TOTAL " << total << endl;
+
+		vector<const GLCallEntry*> busiest;
+		for (const GLCallEntry& entry : Entries) {
+			if (entry.TotalCalls > 0) {
+				busiest.push_back(&entry);
+			}
+		}
+		sort(busiest.begin(), busiest.end(), [](const GLCallEntry* a, const GLCallEntry* b) { return a->TotalCalls > b->TotalCalls; });
+		for (size_t i = 0; i < busiest.size() && i < GL_CALL_TRACE_TOP_ENTRIES; i++) {
+			cout << "GL CALLS::" << busiest[i]->Name << "::" << GL_CALL_CATEGORY_NAMES[busiest[i]->Category] << "::" << CallsPerFrame(*busiest[i])
+				<< " PER FRAME::MAX " << busiest[i]->MaxFrameCalls << endl;
+		}
+
+		for (const auto& message : PerformanceMessages) {
+			cout << "GL PERFORMANCE::" << message.first << "::" << message.second.Count << " TIMES::" << message.second.Text << endl;
+		}
+	}
+
+	//Appends the per frame counts and the performance messages as JSON lines, the same layout as the microbenchmarks
+	bool Write(const string& path, const string& label) const {
+		FILE* file = fopen(path.c_str(), "a");
+		if (!file) {
+			cout << "ERROR::GL_CALL_TRACE::COULD_NOT_WRITE::" << path << endl;
+			return false;
+		}
+		for (int i = 0; i < GL_CALL_CATEGORY_COUNT; i++) {
+			fprintf(file, "{\"label\":\"%s\",\"group\":\"glcalls\",\"name\":\"%s\",\"param\":\"category\",\"calls_per_frame\":%.2f,\"frames\":%lld}\n",
+				Escape(label).c_str(), GL_CALL_CATEGORY_NAMES[i], CategoryCallsPerFrame((GLCallCategory)i), Frames);
+		}
+		for (const GLCallEntry& entry : Entries) {
+			if (entry.TotalCalls > 0) {
+				fprintf(file, "{\"label\":\"%s\",\"group\":\"glcalls\",\"name\":\"%s\",\"param\":\"%s\",\"calls_per_frame\":%.2f,\"max_per_frame\":%lld,\"frames\":%lld}\n",
+					Escape(label).c_str(), entry.Name.c_str(), GL_CALL_CATEGORY_NAMES[entry.Category], CallsPerFrame(entry), entry.MaxFrameCalls, Frames);
+			}
+		}
+		for (const auto& message : PerformanceMessages) {
+			fprintf(file, "{\"label\":\"%s\",\"group\":\"glperformance\",\"name\":\"%u\",\"param\":\"%s\",\"count\":%lld}\n",
+				Escape(label).c_str(), message.first, Escape(message.second.Text).c_str(), message.second.Count);
+		}
+		fclose(file);
+		return true;
+	}
+
+private:
+	static string Escape(const string& text) {
+		string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') escaped += '\\';
+			if (c == '\n' || c == '\r') c = ' ';
+			escaped += c;
+		}
+		return escaped;
+	}
+};
+
+inline GLCallTrace& GetGLCallTrace() {
+	static GLCallTrace trace;
+	return trace;
+}
+
+//One hook per entry point: Id keeps the statics apart, the signature comes from the glad pointer type
+template <int Id, typename Function>
+struct GLCallHook;
+
+template <int Id, typename Result, typename... Args>
+struct GLCallHook<Id, Result (APIENTRYP)(Args...)> {
+	static Result (APIENTRYP original)(Args...);
+	static int entry;
+
+	static Result APIENTRY Call(Args... args) {
+		GetGLCallTrace().Count(entry);
+		return original(args...);
+	}
+};
+
+template <int Id, typename Result, typename... Args>
+Result (APIENTRYP GLCallHook<Id, Result (APIENTRYP)(Args...)>::original)(Args...) = NULL;
+
+template <int Id, typename Result, typename... Args>
+int GLCallHook<Id, Result (APIENTRYP)(Args...)>::entry = 0;
+
+template <int Id, typename Function>
+void InstallGLCallHook(Function& pointer, const char* name, GLCallCategory category) {
+	if (pointer == NULL) {
+		return;
+	}
+	GLCallHook<Id, Function>::original = pointer;
+	GLCallHook<Id, Function>::entry = GetGLCallTrace().Register(name, category);
+	pointer = &GLCallHook<Id, Function>::Call;
+}
+
+#define GL_CALL_HOOK(name, category) InstallGLCallHook<__COUNTER__>(glad_##name, #name, category)
+
+//Hooks the entry points the program calls, after gladLoadGLLoader. Anything not listed goes straight to the driver uncounted.
+inline void InstallGLCallTrace() {
+	GetGLCallTrace().Enabled = true;
+
+	GL_CALL_HOOK(glEnable, GL_CALL_STATE);
+	GL_CALL_HOOK(glDisable, GL_CALL_STATE);
+	GL_CALL_HOOK(glPolygonMode, GL_CALL_STATE);
+	GL_CALL_HOOK(glCullFace, GL_CALL_STATE);
+	GL_CALL_HOOK(glBlendFunc, GL_CALL_STATE);
+	GL_CALL_HOOK(glViewport, GL_CALL_STATE);
+	GL_CALL_HOOK(glClearColor, GL_CALL_STATE);
+	GL_CALL_HOOK(glPixelStorei, GL_CALL_STATE);
+	GL_CALL_HOOK(glTexParameteri, GL_CALL_STATE);
+	GL_CALL_HOOK(glPatchParameteri, GL_CALL_STATE);
+	GL_CALL_HOOK(glVertexAttribPointer, GL_CALL_STATE);
+	GL_CALL_HOOK(glVertexAttribIPointer, GL_CALL_STATE);
+	GL_CALL_HOOK(glEnableVertexAttribArray, GL_CALL_STATE);
+	GL_CALL_HOOK(glVertexAttribDivisor, GL_CALL_STATE);
+	GL_CALL_HOOK(glUniformBlockBinding, GL_CALL_STATE);
+
+	GL_CALL_HOOK(glGetUniformLocation, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniform1i, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniform1f, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniform2f, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniform3f, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniform3fv, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniform4fv, GL_CALL_UNIFORM);
+	GL_CALL_HOOK(glUniformMatrix4fv, GL_CALL_UNIFORM);
+
+	GL_CALL_HOOK(glBindBuffer, GL_CALL_BIND);
+	GL_CALL_HOOK(glBindBufferBase, GL_CALL_BIND);
+	GL_CALL_HOOK(glBindBufferRange, GL_CALL_BIND);
+	GL_CALL_HOOK(glBindVertexArray, GL_CALL_BIND);
+	GL_CALL_HOOK(glBindTexture, GL_CALL_BIND);
+	GL_CALL_HOOK(glActiveTexture, GL_CALL_BIND);
+	GL_CALL_HOOK(glUseProgram, GL_CALL_BIND);
+	GL_CALL_HOOK(glBindFramebuffer, GL_CALL_BIND);
+
+	GL_CALL_HOOK(glClear, GL_CALL_DRAW);
+	GL_CALL_HOOK(glDrawArrays, GL_CALL_DRAW);
+	GL_CALL_HOOK(glDrawArraysInstanced, GL_CALL_DRAW);
+	GL_CALL_HOOK(glDrawElements, GL_CALL_DRAW);
+	GL_CALL_HOOK(glDrawElementsInstanced, GL_CALL_DRAW);
+	GL_CALL_HOOK(glDrawElementsBaseVertex, GL_CALL_DRAW);
+	GL_CALL_HOOK(glMultiDrawElementsIndirect, GL_CALL_DRAW);
+
+	GL_CALL_HOOK(glBufferData, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glBufferSubData, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glMapBufferRange, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glUnmapBuffer, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glTexImage2D, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glTexSubImage2D, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glTexImage3D, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glTexSubImage3D, GL_CALL_BUFFER);
+	GL_CALL_HOOK(glGenerateMipmap, GL_CALL_BUFFER);
+
+	GL_CALL_HOOK(glGenBuffers, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGenVertexArrays, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGenTextures, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGenQueries, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteBuffers, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteVertexArrays, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteTextures, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteQueries, GL_CALL_OTHER);
+	GL_CALL_HOOK(glCreateShader, GL_CALL_OTHER);
+	GL_CALL_HOOK(glShaderSource, GL_CALL_OTHER);
+	GL_CALL_HOOK(glCompileShader, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteShader, GL_CALL_OTHER);
+	GL_CALL_HOOK(glCreateProgram, GL_CALL_OTHER);
+	GL_CALL_HOOK(glAttachShader, GL_CALL_OTHER);
+	GL_CALL_HOOK(glLinkProgram, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteProgram, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetIntegerv, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetShaderiv, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetProgramiv, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetUniformBlockIndex, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetBufferSubData, GL_CALL_OTHER);
+	GL_CALL_HOOK(glReadPixels, GL_CALL_OTHER);
+	GL_CALL_HOOK(glBeginQuery, GL_CALL_OTHER);
+	GL_CALL_HOOK(glEndQuery, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetQueryObjectiv, GL_CALL_OTHER);
+	GL_CALL_HOOK(glGetQueryObjectui64v, GL_CALL_OTHER);
+	GL_CALL_HOOK(glFenceSync, GL_CALL_OTHER);
+	GL_CALL_HOOK(glClientWaitSync, GL_CALL_OTHER);
+	GL_CALL_HOOK(glDeleteSync, GL_CALL_OTHER);
+	GL_CALL_HOOK(glFlush, GL_CALL_OTHER);
+	GL_CALL_HOOK(glFinish, GL_CALL_OTHER);
+}
+
+//Logs a performance message kind the first time, afterwards only counts it. Runs on the thread that made the GL call,
+//as debug output is synchronous.
+inline void APIENTRY GLPerformanceMessageCallback(GLenum /*source*/, GLenum /*type*/, GLuint id, GLenum /*severity*/, GLsizei length, const GLchar* message, const void* /*userParam*/) {
+	GLPerformanceMessage& entry = GetGLCallTrace().PerformanceMessages[id];
+	if (entry.Count++ == 0) {
+		entry.Text = string(message, length >= 0 ? (size_t)length : strlen(message));
+		cout << "GL PERFORMANCE::" << id << "::" << entry.Text << endl;
+	}
+}
+
+//Subscribes to the driver's performance messages. Needs GL 4.3 debug output, best with a debug context (GLFW_OPENGL_DEBUG_CONTEXT).
+inline bool InstallGLPerformanceMessages() {
+	if (!GLAD_GL_VERSION_4_3 || glad_glDebugMessageCallback == NULL) {
+		cout << "GL PERFORMANCE::NO DEBUG OUTPUT (NEEDS GL 4.3)" << endl;
+		return false;
+	}
+	glEnable(GL_DEBUG_OUTPUT);
+	//Otherwise the driver may call back from its own threads, racing Report and Write over the message counts
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+	glDebugMessageCallback(GLPerformanceMessageCallback, NULL);
+	return true;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef GLCONTEXT_H
+#define GLCONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+//True when the calling thread has a current OpenGL context.
+//GLFW tracks the current context per thread, so this is false on worker threads and when running headless.
+inline bool HasCurrentGLContext() {
+	return glfwGetCurrentContext() != NULL;
+}
+
+#endif
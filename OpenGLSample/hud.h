@@ -0,0 +1,509 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "glcontext.h"
+#include "shader.h"
+#include "ringbuffer.h"
+#include "rendercounters.h"
+#include "resourceregistry.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Performance HUD. A rolling CPU/GPU frame time graph and the frame's render counters, drawn over the scene in one
+* glDrawElementsBaseVertex of five quads streamed through the frame's ring buffer region (fenced with the scene's data,
+* a fence of its own would flush the frame early): the panel, two graph guides, the text and the graph. Text and graph
+* are each one quad the fragment shader fills from a uniform block in the same region, the text as a grid of character
+* codes looked up in a 5x7 font atlas built at startup and the graph from the frame history, so the draw costs the
+* same however much they show. Solid quads sample the atlas' filled cell, so nothing is switched between them.
+* GPU time and triangles come from GL_TIME_ELAPSED and GL_PRIMITIVES_GENERATED queries read a few frames late,
+* so the HUD never waits on the GPU.
+*/
+
+//Glyph cell in the atlas (5x7 glyph plus a gap), and the atlas grid covering ASCII 32 to 127
+const int HUD_GLYPH_WIDTH = 5;
+const int HUD_GLYPH_HEIGHT = 7;
+const int HUD_CELL_WIDTH = 6;
+const int HUD_CELL_HEIGHT = 8;
+const int HUD_ATLAS_COLUMNS = 16;
+const int HUD_ATLAS_ROWS = 6;
+const int HUD_ATLAS_WIDTH = HUD_ATLAS_COLUMNS * HUD_CELL_WIDTH;
+const int HUD_ATLAS_HEIGHT = HUD_ATLAS_ROWS * HUD_CELL_HEIGHT;
+
+//Cell filled solid, for the panel and graph guides (DEL has no glyph of its own)
+const char HUD_SOLID_CELL = 127;
+
+//Screen pixels per atlas pixel
+const int HUD_TEXT_SCALE = 2;
+
+//Frames in the graph, each is one CPU and one GPU pixel column
+const int HUD_HISTORY = 160;
+
+//Character grid of the text, lines of HUD_TEXT_COLUMNS cells. The sizes of HudData in hudFragm.glsl follow from these.
+const int HUD_TEXT_LINES = 6;
+const int HUD_TEXT_COLUMNS = 32;
+
+//Frame time at the top of the graph, and its height in pixels
+const float HUD_GRAPH_MS = 40.0f;
+const float HUD_GRAPH_HEIGHT = 64.0f;
+
+//Text colors, a character cell's color index picks one. CPU and GPU also color the graph.
+enum HudColor { HUD_COLOR_TEXT, HUD_COLOR_CPU, HUD_COLOR_GPU };
+const glm::vec3 HUD_COLORS[] = { glm::vec3(235, 235, 235) / 255.0f, glm::vec3(255, 170, 40) / 255.0f, glm::vec3(60, 200, 255) / 255.0f };
+
+//Most quads one frame of the HUD can write
+const int HUD_MAX_QUADS = 8;
+
+//Query sets in flight, results are read back this many frames later
+const int HUD_QUERY_FRAMES = 4;
+
+//Text is rewritten at most this often, numbers changing every frame can't be read anyway
+const double HUD_TEXT_REFRESH_MS = 250.0;
+
+//Uniform block binding of HudData, the graph history and text grid
+const unsigned int HUD_BLOCK_BINDING = 4;
+
+//Rows of a glyph top to bottom, bit 4 is the leftmost pixel. Lower case is drawn as upper case, anything else is blank.
+struct HudGlyph {
+	char Character;
+	uint8_t Rows[HUD_GLYPH_HEIGHT];
+};
+
+const HudGlyph HUD_FONT[] = {
+	{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+	{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+	{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+	{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+	{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+	{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+	{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+	{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+	{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+	{ 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+	{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+	{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+	{ 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+	{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+	{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+	{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+	{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+	{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+	{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+	{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+	{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+	{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+	{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+	{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+	{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+	{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+	{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+	{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+	{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+	{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+	{ ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+	{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+	{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+	{ '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+	{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+	{ '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+	{ '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+	{ '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+	{ '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+	{ ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+	{ '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+	{ '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } }
+};
+
+//16 bytes, attribute pointers are set once and each frame's vertices are reached through the base vertex
+struct HudVertex {
+	float X, Y;
+	uint16_t U, V;
+	uint8_t Color[4];
+};
+
+//HudData: the graph's frame history oldest first, CPU and GPU time of two frames to a vec4 with 1.0 at the top of the
+//graph, then the text grid line by line, a 16 bit cell (character, color index << 8) in each half of a uint
+struct HudBlock {
+	glm::vec4 Samples[HUD_HISTORY / 2];
+	glm::uvec4 Text[HUD_TEXT_LINES * HUD_TEXT_COLUMNS / 8];
+};
+
+static_assert(HUD_HISTORY % 2 == 0 && HUD_TEXT_COLUMNS % 8 == 0, "HudData packs two frames and eight text cells to a vec4");
+static_assert(sizeof(HudBlock) == HUD_HISTORY * 2 * sizeof(float) + HUD_TEXT_LINES * HUD_TEXT_COLUMNS * 2, "HudBlock must match the std140 HudData block");
+
+class PerfHud
+{
+public:
+	//What the last finished frame did, shown until the next one finishes
+	RenderCounters Counters;
+	long long Triangles = 0;
+	double CpuMs = 0.0;
+	double GpuMs = 0.0;
+	double FrameMs = 0.0;
+
+	//CPU time of building and drawing the HUD itself. The first frame is kept apart, the driver compiles the
+	//shader on its first draw and that is not what the HUD costs a frame.
+	double HudMs = 0.0;
+	double HudFirstMs = 0.0;
+	double HudTotalMs = 0.0;
+	long long HudFrames = 0;
+
+	//Constructor: the ring the vertices are streamed through. Needs a current GL context, without one Draw does nothing.
+	PerfHud(RingBuffer& ring) : shader("shaderfiles/hudVertex.glsl", "shaderfiles/hudFragm.glsl"), vertexRing(ring)
+	{
+		cpuHistory.assign(HUD_HISTORY, 0.0f);
+		gpuHistory.assign(HUD_HISTORY, 0.0f);
+		if (!HasCurrentGLContext() || shader.ID == 0 || vertexRing.Buffer == 0) {
+			return;
+		}
+
+		BuildFontAtlas();
+
+		shader.use();
+		shader.setInt("fontAtlas", 0);
+		for (int i = 0; i < 3; i++) {
+			shader.setVec3("colors[" + to_string(i) + "]", HUD_COLORS[i]);
+		}
+		shader.setBlockBinding("HudData", HUD_BLOCK_BINDING);
+		screenSizeLocation = glGetUniformLocation(shader.ID, "screenSize");
+
+		//Quads are always 0 1 2, 0 2 3
+		vector<uint16_t> indices;
+		indices.reserve(HUD_MAX_QUADS * 6);
+		for (int quad = 0; quad < HUD_MAX_QUADS; quad++) {
+			uint16_t first = (uint16_t)(quad * 4);
+			uint16_t quadIndices[] = { first, (uint16_t)(first + 1), (uint16_t)(first + 2), first, (uint16_t)(first + 2), (uint16_t)(first + 3) };
+			indices.insert(indices.end(), quadIndices, quadIndices + 6);
+		}
+
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glGenBuffers(1, &EBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(EBO, RESOURCE_INDEX_BUFFER, indices.size() * sizeof(uint16_t), "HUD quads");
+
+		//Every ring offset is a multiple of the 16 byte vertex, so a frame's vertices start at a whole base vertex
+		glBindBuffer(GL_ARRAY_BUFFER, vertexRing.Buffer);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, X));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(HudVertex), (void*)offsetof(HudVertex, U));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)offsetof(HudVertex, Color));
+		glEnableVertexAttribArray(2);
+		glBindVertexArray(0);
+
+		glGenQueries(HUD_QUERY_FRAMES, timeQueries);
+		glGenQueries(HUD_QUERY_FRAMES, primitiveQueries);
+	}
+
+	//Start of the frame's GL work. Picks up the results of the query set about to be reused, then starts it again.
+	void BeginFrame() {
+		if (VAO == 0) {
+			return;
+		}
+		querySlot = (querySlot + 1) % HUD_QUERY_FRAMES;
+		if (queryPending[querySlot]) {
+			queryPending[querySlot] = false;
+			GLint available = 0;
+			glGetQueryObjectiv(timeQueries[querySlot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 elapsed = 0, primitives = 0;
+				glGetQueryObjectui64v(timeQueries[querySlot], GL_QUERY_RESULT, &elapsed);
+				glGetQueryObjectui64v(primitiveQueries[querySlot], GL_QUERY_RESULT, &primitives);
+				GpuMs = elapsed / 1000000.0;
+				Triangles = (long long)primitives;
+			}
+			//Still running a full ring later, this sample is dropped rather than waited for
+		}
+		gpuHistory[historyIndex] = (float)GpuMs;
+
+		glBeginQuery(GL_TIME_ELAPSED, timeQueries[querySlot]);
+		glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[querySlot]);
+		queryActive = true;
+	}
+
+	//End of the scene's GL work, before the HUD draws itself. cpuMs is the frame's CPU time so far.
+	void EndScene(double cpuMs) {
+		if (queryActive) {
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			glEndQuery(GL_TIME_ELAPSED);
+			queryPending[querySlot] = true;
+			queryActive = false;
+		}
+
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (lastSceneEnd != chrono::steady_clock::time_point()) {
+			FrameMs = chrono::duration<double, milli>(now - lastSceneEnd).count();
+		}
+		lastSceneEnd = now;
+
+		Counters = GetRenderCounters();
+		CpuMs = cpuMs;
+		cpuHistory[historyIndex] = (float)cpuMs;
+		historyIndex = (historyIndex + 1) % HUD_HISTORY;
+	}
+
+	//Draws the HUD over whatever is in the framebuffer, top left of a width x height window.
+	//Call between the ring's BeginFrame and EndFrame.
+	void Draw(int width, int height) {
+		if (VAO == 0) {
+			return;
+		}
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		if (vertices.empty()) {
+			BuildQuads();
+		}
+		if (chrono::duration<double, milli>(start - lastTextRefresh).count() >= HUD_TEXT_REFRESH_MS) {
+			WriteText();
+			lastTextRefresh = start;
+		}
+
+		//History, text and quads all go into this frame's region, the last frame's may still be in use
+		GLintptr blockOffset = -1, offset = -1;
+		HudBlock* block = (HudBlock*)vertexRing.Map(sizeof(HudBlock), blockOffset);
+		float* samples = &block->Samples[0][0];
+		for (int i = 0; i < HUD_HISTORY; i++) {
+			int sample = (historyIndex + i) % HUD_HISTORY;
+			samples[i * 2] = cpuHistory[sample] / HUD_GRAPH_MS;
+			samples[i * 2 + 1] = gpuHistory[sample] / HUD_GRAPH_MS;
+		}
+		memcpy(block->Text, textCells, sizeof(textCells));
+		vertexRing.Unmap();
+		void* mapped = vertexRing.Map(vertices.size() * sizeof(HudVertex), offset);
+		memcpy(mapped, vertices.data(), vertices.size() * sizeof(HudVertex));
+		vertexRing.Unmap();
+
+		if (blockOffset >= 0 && offset >= 0 && offset % sizeof(HudVertex) == 0) {
+			//Wireframe mode must not reach the HUD
+			GLint polygonMode[2] = { GL_FILL, GL_FILL };
+			glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			glDisable(GL_DEPTH_TEST);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+			shader.use();
+			glUniform2f(screenSizeLocation, (float)width, (float)height);
+			glBindBufferRange(GL_UNIFORM_BUFFER, HUD_BLOCK_BINDING, vertexRing.Buffer, blockOffset, sizeof(HudBlock));
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, FontAtlas);
+			glBindVertexArray(VAO);
+			glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)vertices.size() / 4 * 6, GL_UNSIGNED_SHORT, (void*)0, (GLint)(offset / sizeof(HudVertex)));
+			glBindVertexArray(0);
+
+			glDisable(GL_BLEND);
+			glEnable(GL_DEPTH_TEST);
+			glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+		}
+
+		HudMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		if (HudFrames == 0) {
+			HudFirstMs = HudMs;
+		}
+		else {
+			HudTotalMs += HudMs;
+		}
+		HudFrames++;
+	}
+
+	//Average cost of the HUD over every frame it was drawn after the first
+	void Report() const {
+		if (HudFrames > 1) {
+			cout << "HUD::" << HudFrames << " FRAMES::CPU " << HudTotalMs / (HudFrames - 1) << "ms PER FRAME::FIRST FRAME " << HudFirstMs << "ms" << endl;
+		}
+	}
+
+	//De-allocates the atlas, buffers and queries
+	void Deallocate() {
+		if (VAO == 0) {
+			return;
+		}
+		if (queryActive) {
+			glEndQuery(GL_PRIMITIVES_GENERATED);
+			glEndQuery(GL_TIME_ELAPSED);
+			queryActive = false;
+		}
+		glDeleteQueries(HUD_QUERY_FRAMES, timeQueries);
+		glDeleteQueries(HUD_QUERY_FRAMES, primitiveQueries);
+		GetResourceRegistry().ReleaseTexture(FontAtlas);
+		GetResourceRegistry().ReleaseBuffer(EBO);
+		glDeleteTextures(1, &FontAtlas);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &EBO);
+		glDeleteProgram(shader.ID);
+		VAO = 0;
+	}
+
+private:
+	Shader shader;
+	RingBuffer& vertexRing;
+	unsigned int FontAtlas = 0;
+	unsigned int VAO = 0;
+	unsigned int EBO = 0;
+	GLint screenSizeLocation = -1;
+
+	GLuint timeQueries[HUD_QUERY_FRAMES] = {};
+	GLuint primitiveQueries[HUD_QUERY_FRAMES] = {};
+	bool queryPending[HUD_QUERY_FRAMES] = {};
+	int querySlot = 0;
+	bool queryActive = false;
+
+	vector<float> cpuHistory;
+	vector<float> gpuHistory;
+	int historyIndex = 0;
+	chrono::steady_clock::time_point lastSceneEnd;
+
+	//Panel, guides, text grid and graph quads, the same every frame
+	vector<HudVertex> vertices;
+
+	//Text grid as of the last refresh, copied into every frame's block
+	uint16_t textCells[HUD_TEXT_LINES * HUD_TEXT_COLUMNS] = {};
+	chrono::steady_clock::time_point lastTextRefresh;
+
+	void BuildQuads() {
+		vertices.clear();
+
+		const float left = 8.0f, top = 8.0f, padding = 6.0f;
+		const float lineHeight = (HUD_CELL_HEIGHT + 1) * HUD_TEXT_SCALE;
+		const float panelWidth = HUD_HISTORY * 2 + padding * 2;
+		const float graphTop = top + padding + HUD_TEXT_LINES * lineHeight + padding;
+		const float panelHeight = graphTop + HUD_GRAPH_HEIGHT + padding - top;
+		const uint8_t panel[] = { 0, 0, 0, 160 };
+		const uint8_t guide[] = { 120, 120, 120, 200 };
+		float x = left + padding;
+
+		AddQuad(left, top, panelWidth, panelHeight, panel);
+
+		//Guides at 60 and 30 frames per second, under the bars
+		float graphBottom = graphTop + HUD_GRAPH_HEIGHT;
+		float pixelsPerMs = HUD_GRAPH_HEIGHT / HUD_GRAPH_MS;
+		AddQuad(x, graphBottom - 1000.0f / 60.0f * pixelsPerMs, HUD_HISTORY * 2.0f, 1.0f, guide);
+		AddQuad(x, graphBottom - 1000.0f / 30.0f * pixelsPerMs, HUD_HISTORY * 2.0f, 1.0f, guide);
+
+		AddFilledQuad(x, top + padding, HUD_TEXT_COLUMNS * HUD_CELL_WIDTH * HUD_TEXT_SCALE, HUD_TEXT_LINES * lineHeight, 255);
+		AddFilledQuad(x, graphTop, HUD_HISTORY * 2.0f, HUD_GRAPH_HEIGHT, 0);
+	}
+
+	//Rewrites the text grid from the values of the last finished frame
+	void WriteText() {
+		fill_n(textCells, HUD_TEXT_LINES * HUD_TEXT_COLUMNS, (uint16_t)0);
+		char line[64];
+		snprintf(line, sizeof(line), "FPS %.1f  FRAME %.2f MS", FrameMs > 0.0 ? 1000.0 / FrameMs : 0.0, FrameMs);
+		SetText(0, 0, line, HUD_COLOR_TEXT);
+		SetText(1, 0, "CPU", HUD_COLOR_CPU);
+		snprintf(line, sizeof(line), "%.2f MS", CpuMs);
+		SetText(1, 4, line, HUD_COLOR_TEXT);
+		SetText(1, 14, "GPU", HUD_COLOR_GPU);
+		snprintf(line, sizeof(line), "%.2f MS", GpuMs);
+		SetText(1, 18, line, HUD_COLOR_TEXT);
+		snprintf(line, sizeof(line), "DRAWS %d  TRIS %lld", Counters.DrawCalls, Triangles);
+		SetText(2, 0, line, HUD_COLOR_TEXT);
+		snprintf(line, sizeof(line), "TEX BINDS %d  UNIFORMS %d", Counters.TextureBinds, Counters.UniformUploads);
+		SetText(3, 0, line, HUD_COLOR_TEXT);
+		snprintf(line, sizeof(line), "OBJECTS %d  HUD %.3f MS", Counters.Objects, HudMs);
+		SetText(4, 0, line, HUD_COLOR_TEXT);
+		snprintf(line, sizeof(line), "GPU MEM %.1f MB  TEX %.1f MB", GetResourceRegistry().GetGPUBytes() / 1048576.0, GetResourceRegistry().GetBytes(RESOURCE_TEXTURE) / 1048576.0);
+		SetText(5, 0, line, HUD_COLOR_TEXT);
+	}
+
+	//Text into the grid from a cell on, cut at the end of the line. Lower case is shown as upper case, characters
+	//without a glyph as blanks.
+	void SetText(int line, int column, const char* text, HudColor color) {
+		for (const char* c = text; *c != '\0' && column < HUD_TEXT_COLUMNS; c++, column++) {
+			char character = (*c >= 'a' && *c <= 'z') ? (char)(*c - 'a' + 'A') : *c;
+			if (character <= ' ' || character >= HUD_SOLID_CELL) {
+				continue;
+			}
+			textCells[line * HUD_TEXT_COLUMNS + column] = (uint16_t)((uint8_t)character | (color << 8));
+		}
+	}
+
+	//Atlas as single channel coverage, glyphs in ASCII order and the last cell filled solid
+	void BuildFontAtlas() {
+		vector<uint8_t> pixels(HUD_ATLAS_WIDTH * HUD_ATLAS_HEIGHT, 0);
+		auto cellOrigin = [](char c) {
+			int cell = c - ' ';
+			return (cell / HUD_ATLAS_COLUMNS) * HUD_CELL_HEIGHT * HUD_ATLAS_WIDTH + (cell % HUD_ATLAS_COLUMNS) * HUD_CELL_WIDTH;
+		};
+
+		for (const HudGlyph& glyph : HUD_FONT) {
+			int origin = cellOrigin(glyph.Character);
+			for (int row = 0; row < HUD_GLYPH_HEIGHT; row++) {
+				for (int column = 0; column < HUD_GLYPH_WIDTH; column++) {
+					if (glyph.Rows[row] & (0x10 >> column)) {
+						pixels[origin + row * HUD_ATLAS_WIDTH + column] = 255;
+					}
+				}
+			}
+		}
+		int solid = cellOrigin(HUD_SOLID_CELL);
+		for (int row = 0; row < HUD_CELL_HEIGHT; row++) {
+			fill_n(pixels.begin() + solid + row * HUD_ATLAS_WIDTH, HUD_CELL_WIDTH, (uint8_t)255);
+		}
+
+		glGenTextures(1, &FontAtlas);
+		glBindTexture(GL_TEXTURE_2D, FontAtlas);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GetResourceRegistry().TrackTexture(FontAtlas, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, 1, 1, false, "HUD font atlas");
+	}
+
+	//Quad sampling atlas pixels (u, v) to (u + uSize, v + vSize)
+	void AddQuad(float x, float y, float width, float height, const uint8_t color[4], int u, int v, int uSize, int vSize) {
+		if ((int)vertices.size() >= HUD_MAX_QUADS * 4 || width <= 0.0f || height <= 0.0f) {
+			return;
+		}
+		uint16_t u0 = (uint16_t)(u * 65535 / HUD_ATLAS_WIDTH), u1 = (uint16_t)((u + uSize) * 65535 / HUD_ATLAS_WIDTH);
+		uint16_t v0 = (uint16_t)(v * 65535 / HUD_ATLAS_HEIGHT), v1 = (uint16_t)((v + vSize) * 65535 / HUD_ATLAS_HEIGHT);
+		vertices.push_back({ x, y, u0, v0, { color[0], color[1], color[2], color[3] } });
+		vertices.push_back({ x, y + height, u0, v1, { color[0], color[1], color[2], color[3] } });
+		vertices.push_back({ x + width, y + height, u1, v1, { color[0], color[1], color[2], color[3] } });
+		vertices.push_back({ x + width, y, u1, v0, { color[0], color[1], color[2], color[3] } });
+	}
+
+	//Quad the shader fills from HudData, marked by a zero alpha with red picking the graph (0) or the text grid (255).
+	//U runs left to right and V from the bottom up.
+	void AddFilledQuad(float x, float y, float width, float height, uint8_t kind) {
+		if ((int)vertices.size() >= HUD_MAX_QUADS * 4) {
+			return;
+		}
+		vertices.push_back({ x, y, 0, 65535, { kind, 0, 0, 0 } });
+		vertices.push_back({ x, y + height, 0, 0, { kind, 0, 0, 0 } });
+		vertices.push_back({ x + width, y + height, 65535, 0, { kind, 0, 0, 0 } });
+		vertices.push_back({ x + width, y, 65535, 65535, { kind, 0, 0, 0 } });
+	}
+
+	//Solid quad, samples the middle of the filled cell
+	void AddQuad(float x, float y, float width, float height, const uint8_t color[4]) {
+		int cell = HUD_SOLID_CELL - ' ';
+		AddQuad(x, y, width, height, color, (cell % HUD_ATLAS_COLUMNS) * HUD_CELL_WIDTH + 2, (cell / HUD_ATLAS_COLUMNS) * HUD_CELL_HEIGHT + 2, 1, 1);
+	}
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef INPUTLATENCY_H
+#define INPUTLATENCY_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+//Default rate of the synthetic mouse, a common gaming mouse polls at 1000Hz
+const double SYNTHETIC_MOUSE_DEFAULT_RATE_HZ = 1000.0;
+
+//Input event to submit times since the last report
+struct InputLatencyStats {
+	int Events = 0;			//Events that made it into a submitted frame
+	int Frames = 0;			//Submitted frames that carried at least one new event
+	double MeanMs = 0.0;
+	double WorstMs = 0.0;
+};
+
+//Measures how long input waits before a frame built from it is submitted. Every event applied to the camera is stamped
+//with when it happened, the frame's camera latch takes every event applied so far, and the submit closes them all out.
+//Events applied after the latch are counted against the next frame, which is the one that actually shows them.
+class InputLatencyMeter
+{
+public:
+	//An event was applied to the camera, eventTime on the glfwGetTime clock
+	void EventApplied(double eventTime) {
+		applied.push_back(eventTime);
+	}
+
+	//The frame's view and projection were just written, everything applied so far is in this frame
+	void Latch() {
+		latched.insert(latched.end(), applied.begin(), applied.end());
+		applied.clear();
+	}
+
+	//The frame was handed to the driver
+	void Submit(double submitTime) {
+		if (latched.empty()) {
+			return;
+		}
+		for (double eventTime : latched) {
+			double latencyMs = (submitTime - eventTime) * 1000.0;
+			stats.Events++;
+			sumMs += latencyMs;
+			stats.WorstMs = max(stats.WorstMs, latencyMs);
+		}
+		stats.Frames++;
+		latched.clear();
+	}
+
+	InputLatencyStats GetStats() const {
+		InputLatencyStats result = stats;
+		result.MeanMs = stats.Events > 0 ? sumMs / stats.Events : 0.0;
+		return result;
+	}
+
+	//Prints the stats since the last report under a label and starts over. Events still waiting for a frame are kept.
+	void Report(const char* label) {
+		InputLatencyStats result = GetStats();
+		if (result.Events > 0) {
+			cout << "INPUT LATENCY::" << label << "::EVENTS " << result.Events << "::FRAMES " << result.Frames
+				<< "::MEAN " << result.MeanMs << "ms::WORST " << result.WorstMs << "ms" << endl;
+		}
+		stats = InputLatencyStats();
+		sumMs = 0.0;
+	}
+
+private:
+	vector<double> applied;
+	vector<double> latched;
+
+	InputLatencyStats stats;
+	double sumMs = 0.0;
+};
+
+//Mouse motion generated on a fixed timeline like a real mouse, but only handed over when the loop polls, the same way
+//GLFW queues OS events until glfwPollEvents. Each event keeps the time it was generated, so the meter sees its true age.
+class SyntheticMouseInput
+{
+public:
+	double RateHz = SYNTHETIC_MOUSE_DEFAULT_RATE_HZ;
+
+	//Center and radius of the circle the cursor sweeps, in window pixels
+	float CenterX, CenterY;
+	float Radius = 100.0f;
+
+	//Constructor: center of the sweep and the time the first event is generated
+	SyntheticMouseInput(float centerX, float centerY, double startTime) {
+		CenterX = centerX;
+		CenterY = centerY;
+		nextEvent = startTime;
+	}
+
+	//Delivers every event generated up to now, oldest first, as deliver(eventTime, x, y)
+	template <typename Deliver>
+	int Poll(double now, Deliver deliver) {
+		int delivered = 0;
+		double step = 1.0 / RateHz;
+		while (nextEvent <= now) {
+			float angle = (float)(eventIndex * 0.01);
+			deliver(nextEvent, CenterX + Radius * cos(angle), CenterY + Radius * sin(angle));
+			nextEvent += step;
+			eventIndex++;
+			delivered++;
+		}
+		return delivered;
+	}
+
+private:
+	double nextEvent;
+	long long eventIndex = 0;
+};
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+#include <GLFW/glfw3.h>
+#include "scene.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Input recording (.input). A session is stored frame by frame: the keys processInput polls, packed into one mask,
+* then the callback events (keys, cursor, scroll, mouse buttons) that arrived since the frame before, each stamped
+* with microseconds since the recording started. A replay hands each frame back through the same callbacks and
+* answers the polls from the mask, with the fixed deltaTime from the header, so every replay of a file moves the
+* camera the same way on any machine no matter how fast the frames come.
+*/
+
+const uint32_t INPUT_RECORDING_MAGIC = 0x54504E49;
+const uint32_t INPUT_RECORDING_VERSION = 1;
+
+//Simulated frame time of a replay
+const float INPUT_REPLAY_DELTA_TIME = 1.0f / 60.0f;
+
+//Keys processInput and scroll_callback poll, bit i of a frame's mask is key i. Mouse button 3 takes the bit after them.
+const int INPUT_POLLED_KEYS[] = {
+	GLFW_KEY_ESCAPE, GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D,
+	GLFW_KEY_SPACE, GLFW_KEY_E, GLFW_KEY_LEFT_CONTROL, GLFW_KEY_Q, GLFW_KEY_LEFT_SHIFT
+};
+const int INPUT_POLLED_KEY_COUNT = sizeof(INPUT_POLLED_KEYS) / sizeof(INPUT_POLLED_KEYS[0]);
+const uint32_t INPUT_POLLED_MOUSE_BUTTON_3 = 1u << INPUT_POLLED_KEY_COUNT;
+
+//Event types in the file
+enum InputEventType {
+	INPUT_EVENT_KEY,
+	INPUT_EVENT_CURSOR,
+	INPUT_EVENT_SCROLL,
+	INPUT_EVENT_MOUSE_BUTTON
+};
+
+//One callback event, only the fields its type uses are stored
+struct InputEvent {
+	uint8_t Type = INPUT_EVENT_KEY;
+	uint32_t TimeMicros = 0;
+	int32_t Key = 0;		//Key or mouse button
+	int32_t ScanCode = 0;
+	int32_t Action = 0;
+	int32_t Mods = 0;
+	double X = 0.0;			//Cursor position or scroll offset
+	double Y = 0.0;
+};
+
+struct InputFrame {
+	uint32_t PolledState = 0;
+	vector<InputEvent> Events;
+};
+
+//The callbacks a replay feeds
+struct InputCallbacks {
+	GLFWkeyfun Key;
+	GLFWcursorposfun Cursor;
+	GLFWscrollfun Scroll;
+	GLFWmousebuttonfun MouseButton;
+};
+
+//Bit of a polled key, -1 when it isn't one
+inline int InputPolledKeyBit(int key) {
+	for (int i = 0; i < INPUT_POLLED_KEY_COUNT; i++) {
+		if (INPUT_POLLED_KEYS[i] == key) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Reads the live state of every polled key and mouse button 3
+inline uint32_t SampleInputPolledState(GLFWwindow* window) {
+	uint32_t state = 0;
+	for (int i = 0; i < INPUT_POLLED_KEY_COUNT; i++) {
+		if (glfwGetKey(window, INPUT_POLLED_KEYS[i]) == GLFW_PRESS) {
+			state |= 1u << i;
+		}
+	}
+	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_3) == GLFW_PRESS) {
+		state |= INPUT_POLLED_MOUSE_BUTTON_3;
+	}
+	return state;
+}
+
+//Records a session. The callbacks report their events as they come (ignored until Start), processInput closes the frame.
+class InputRecorder
+{
+public:
+	bool Recording = false;
+	vector<InputFrame> Frames;
+
+	void Start(double now) {
+		Recording = true;
+		startTime = now;
+		Frames.clear();
+		pending = InputFrame();
+	}
+
+	void RecordKey(double now, int key, int scanCode, int action, int mods) {
+		if (!Recording) {
+			return;
+		}
+		InputEvent event = Stamp(INPUT_EVENT_KEY, now);
+		event.Key = key;
+		event.ScanCode = scanCode;
+		event.Action = action;
+		event.Mods = mods;
+		pending.Events.push_back(event);
+	}
+
+	void RecordCursor(double now, double x, double y) {
+		if (!Recording) {
+			return;
+		}
+		InputEvent event = Stamp(INPUT_EVENT_CURSOR, now);
+		event.X = x;
+		event.Y = y;
+		pending.Events.push_back(event);
+	}
+
+	void RecordScroll(double now, double x, double y) {
+		if (!Recording) {
+			return;
+		}
+		InputEvent event = Stamp(INPUT_EVENT_SCROLL, now);
+		event.X = x;
+		event.Y = y;
+		pending.Events.push_back(event);
+	}
+
+	void RecordMouseButton(double now, int button, int action, int mods) {
+		if (!Recording) {
+			return;
+		}
+		InputEvent event = Stamp(INPUT_EVENT_MOUSE_BUTTON, now);
+		event.Key = button;
+		event.Action = action;
+		event.Mods = mods;
+		pending.Events.push_back(event);
+	}
+
+	//Closes the frame with the polled state processInput is about to act on
+	void EndFrame(uint32_t polledState) {
+		if (!Recording) {
+			return;
+		}
+		pending.PolledState = polledState;
+		Frames.push_back(move(pending));
+		pending = InputFrame();
+	}
+
+	//Writes the frames recorded so far. Keys take 11 bytes, cursor and scroll events 21, buttons 8, plus 8 per frame.
+	bool Save(const string& path) const {
+		SceneBinaryWriter writer;
+		writer.Write(INPUT_RECORDING_MAGIC);
+		writer.Write(INPUT_RECORDING_VERSION);
+		writer.Write(INPUT_REPLAY_DELTA_TIME);
+		writer.Write((uint32_t)Frames.size());
+
+		for (const InputFrame& frame : Frames) {
+			writer.Write(frame.PolledState);
+			writer.Write((uint32_t)frame.Events.size());
+			for (const InputEvent& event : frame.Events) {
+				writer.Write(event.Type);
+				writer.Write(event.TimeMicros);
+				if (event.Type == INPUT_EVENT_KEY) {
+					writer.Write((int16_t)event.Key);
+					writer.Write((int16_t)event.ScanCode);
+					writer.Write((uint8_t)event.Action);
+					writer.Write((uint8_t)event.Mods);
+				}
+				else if (event.Type == INPUT_EVENT_MOUSE_BUTTON) {
+					writer.Write((uint8_t)event.Key);
+					writer.Write((uint8_t)event.Action);
+					writer.Write((uint8_t)event.Mods);
+				}
+				else {
+					writer.Write(event.X);
+					writer.Write(event.Y);
+				}
+			}
+		}
+
+		ofstream file(path.c_str(), ios::binary);
+		file.write(writer.Data.data(), writer.Data.size());
+		if (!file) {
+			cout << "ERROR::INPUT::WRITE_FAILED " << path << endl;
+			return false;
+		}
+		cout << "INPUT RECORDING::" << Frames.size() << " FRAMES::" << writer.Data.size() << " BYTES::" << path << endl;
+		return true;
+	}
+
+private:
+	double startTime = 0.0;
+	InputFrame pending;
+
+	InputEvent Stamp(InputEventType type, double now) const {
+		InputEvent event;
+		event.Type = (uint8_t)type;
+		event.TimeMicros = (uint32_t)max(0.0, (now - startTime) * 1000000.0); //Wraps after about 71 minutes
+		return event;
+	}
+};
+
+//Plays a recording back. The live input callbacks must not be registered while it plays.
+class InputReplayer
+{
+public:
+	bool Playing = false;
+	float DeltaTime = INPUT_REPLAY_DELTA_TIME;
+	vector<InputFrame> Frames;
+
+	bool Load(const string& path) {
+		ifstream file(path.c_str(), ios::binary);
+		if (!file) {
+			cout << "ERROR::INPUT::FILE_NOT_SUCCESSFULLY_READ " << path << endl;
+			return false;
+		}
+		vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+		SceneBinaryReader reader(data);
+		if (reader.Read<uint32_t>() != INPUT_RECORDING_MAGIC || reader.Read<uint32_t>() != INPUT_RECORDING_VERSION) {
+			cout << "ERROR::INPUT::PARSE " << path << " not an input recording of version " << INPUT_RECORDING_VERSION << endl;
+			return false;
+		}
+		DeltaTime = reader.Read<float>();
+
+		Frames.clear();
+		uint32_t frameCount = reader.ReadCount(8);
+		for (uint32_t i = 0; i < frameCount && reader.Ok; i++) {
+			InputFrame frame;
+			frame.PolledState = reader.Read<uint32_t>();
+			uint32_t eventCount = reader.ReadCount(8);
+			for (uint32_t j = 0; j < eventCount && reader.Ok; j++) {
+				InputEvent event;
+				event.Type = reader.Read<uint8_t>();
+				event.TimeMicros = reader.Read<uint32_t>();
+				if (event.Type == INPUT_EVENT_KEY) {
+					event.Key = reader.Read<int16_t>();
+					event.ScanCode = reader.Read<int16_t>();
+					event.Action = reader.Read<uint8_t>();
+					event.Mods = reader.Read<uint8_t>();
+				}
+				else if (event.Type == INPUT_EVENT_MOUSE_BUTTON) {
+					event.Key = reader.Read<uint8_t>();
+					event.Action = reader.Read<uint8_t>();
+					event.Mods = reader.Read<uint8_t>();
+				}
+				else if (event.Type == INPUT_EVENT_CURSOR || event.Type == INPUT_EVENT_SCROLL) {
+					event.X = reader.Read<double>();
+					event.Y = reader.Read<double>();
+				}
+				else {
+					reader.Ok = false;
+				}
+				frame.Events.push_back(event);
+			}
+			Frames.push_back(move(frame));
+		}
+
+		if (!reader.Ok || !(DeltaTime > 0.0f)) {
+			cout << "ERROR::INPUT::PARSE " << path << " truncated or corrupt" << endl;
+			Frames.clear();
+			return false;
+		}
+
+		Playing = true;
+		nextFrame = 0;
+		polledState = 0;
+		return true;
+	}
+
+	//Feeds the next frame's events through the callbacks and switches the polled state to it. False once every frame was played.
+	bool NextFrame(GLFWwindow* window, const InputCallbacks& callbacks) {
+		if (nextFrame >= Frames.size()) {
+			Playing = false;
+			return false;
+		}
+
+		//State first, a scroll checks shift while it is handled
+		const InputFrame& frame = Frames[nextFrame++];
+		polledState = frame.PolledState;
+		for (const InputEvent& event : frame.Events) {
+			switch (event.Type) {
+			case INPUT_EVENT_KEY:
+				callbacks.Key(window, event.Key, event.ScanCode, event.Action, event.Mods);
+				break;
+			case INPUT_EVENT_CURSOR:
+				callbacks.Cursor(window, event.X, event.Y);
+				break;
+			case INPUT_EVENT_SCROLL:
+				callbacks.Scroll(window, event.X, event.Y);
+				break;
+			case INPUT_EVENT_MOUSE_BUTTON:
+				callbacks.MouseButton(window, event.Key, event.Action, event.Mods);
+				break;
+			}
+		}
+		return true;
+	}
+
+	//Polled state of the frame being played
+	bool KeyDown(int key) const {
+		int bit = InputPolledKeyBit(key);
+		return bit >= 0 && (polledState & (1u << bit)) != 0;
+	}
+
+	bool MouseButton3Down() const {
+		return (polledState & INPUT_POLLED_MOUSE_BUTTON_3) != 0;
+	}
+
+	size_t GetFramesPlayed() const { return nextFrame; }
+
+private:
+	size_t nextFrame = 0;
+	uint32_t polledState = 0;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "resourceregistry.h"
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+//Default number of levels in a chain: full, half and quarter side counts
+const int LOD_DEFAULT_LEVELS = 3;
+
+//Fewest sides a reduced level may have, below this curved objects stop reading as round
+const int LOD_MIN_SIDES = 6;
+
+//Projected radius in pixels above which level i is used instead of level i + 1
+const float LOD_PIXEL_THRESHOLDS[] = { 120.0f, 45.0f, 15.0f };
+const int LOD_THRESHOLD_COUNT = sizeof(LOD_PIXEL_THRESHOLDS) / sizeof(LOD_PIXEL_THRESHOLDS[0]);
+
+//Fraction a threshold is widened by in the direction away from the current level, stops popping back and forth on the boundary
+const float LOD_HYSTERESIS = 0.15f;
+
+//One level of a chain, GPU side only (level 0 is the object's own VAO/VBO). A VAO of 0 means not generated yet,
+//levels described without a GL context are written straight into their buffers by the object's UploadBuffers.
+struct LODLevel {
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
+	unsigned int EBO = 0; //Indexed objects (Cylinder) only
+	int VertexCount = 0;
+	int IndexCount = 0;
+	int SideCount = 0;
+	int SubDivisions = 0;
+};
+
+//Triangles actually submitted through LOD draws, reset by the caller every frame
+struct LODCounters {
+	long long TrianglesDrawn = 0;
+	long long TrianglesFullDetail = 0; //What the same draws would have cost at level 0
+	long long DrawsPerLevel[LOD_THRESHOLD_COUNT + 1] = {};
+};
+
+inline LODCounters& GetLODCounters() {
+	static LODCounters counters;
+	return counters;
+}
+
+//Picks a level from the projected radius, with hysteresis around every threshold
+inline int SelectLODLevel(float pixelRadius, int currentLevel, int levelCount) {
+	int level = 0;
+	for (int i = 0; i < levelCount - 1 && i < LOD_THRESHOLD_COUNT; i++) {
+		//Already at this level or finer: only go coarser once clearly below. Coarser: only come back once clearly above.
+		float threshold = LOD_PIXEL_THRESHOLDS[i] * ((currentLevel <= i) ? (1.0f - LOD_HYSTERESIS) : (1.0f + LOD_HYSTERESIS));
+		if (pixelRadius >= threshold) {
+			break;
+		}
+		level = i + 1;
+	}
+	return level;
+}
+
+//Transforms an object space bounding sphere, radius is scaled by the largest axis scale of the model matrix
+inline void TransformBoundingSphere(const glm::mat4& model, const glm::vec3& center, float radius, glm::vec3& worldCenter, float& worldRadius) {
+	worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+	float scale = max(glm::length(glm::vec3(model[0])), max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	worldRadius = radius * scale;
+}
+
+//Creates a VAO/VBO pair in the primitive layout: pos(3), color(3), normal(3), uv(2). data may be NULL to only allocate.
+inline void CreatePrimitiveVertexBuffer(const float* data, size_t vertexCount, unsigned int& vao, unsigned int& vbo) {
+	const int numVertexAttributes = 11;
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * numVertexAttributes * sizeof(float), data, GL_STATIC_DRAW);
+	GetResourceRegistry().TrackBuffer(vbo, RESOURCE_VERTEX_BUFFER, vertexCount * numVertexAttributes * sizeof(float), "primitive vertices");
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+}
+
+//Uploads a vertex array in the primitive layout
+inline void UploadPrimitiveVertices(const vector<float>& vertices, unsigned int& vao, unsigned int& vbo) {
+	CreatePrimitiveVertexBuffer(vertices.data(), vertices.size() / 11, vao, vbo);
+}
+
+//Allocates the buffer and lets write fill it in place through glMapBufferRange, so the vertices never exist in a CPU array.
+//write may split the work over threads, it only touches memory. If the mapping fails or its contents are lost on unmap
+//(display mode change and the like) the vertices are generated once more into a temporary array and copied.
+inline void GeneratePrimitiveVertexBuffer(size_t vertexCount, unsigned int& vao, unsigned int& vbo, const function<void(float*)>& write) {
+	const int numVertexAttributes = 11;
+	GLsizeiptr size = vertexCount * numVertexAttributes * sizeof(float);
+
+	CreatePrimitiveVertexBuffer(NULL, vertexCount, vao, vbo);
+	if (size == 0) {
+		return;
+	}
+
+	float* mapped = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != NULL) {
+		write(mapped);
+		if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE) {
+			return;
+		}
+	}
+
+	vector<float> vertices(vertexCount * numVertexAttributes);
+	write(vertices.data());
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data());
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef LZ4BLOCK_H
+#define LZ4BLOCK_H
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+/*
+* The LZ4 block format, enough for the asset archive: a greedy compressor with one hash table and a bounds checked
+* decompressor. Blocks are plain LZ4, any LZ4 block decoder reads them.
+*/
+
+const int LZ4_MIN_MATCH = 4;
+const int LZ4_LAST_LITERALS = 5;	//The format ends every block with at least this many literals
+const int LZ4_MATCH_LIMIT = 12;		//and starts no match closer to the end than this
+const int LZ4_HASH_BITS = 12;
+
+inline uint32_t LZ4Read32(const unsigned char* p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+//A length of 15 or more goes on in extra bytes of 255 until one is less
+inline void LZ4WriteLength(vector<unsigned char>& out, size_t length) {
+	for (length -= 15; length >= 255; length -= 255) {
+		out.push_back(255);
+	}
+	out.push_back((unsigned char)length);
+}
+
+//Literals from anchor up to source + literals, then a match (matchLength 0 for the final literals only)
+inline void LZ4WriteSequence(vector<unsigned char>& out, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+	size_t matchCode = matchLength > 0 ? matchLength - LZ4_MIN_MATCH : 0;
+	out.push_back((unsigned char)((min(literalLength, (size_t)15) << 4) | min(matchCode, (size_t)15)));
+	if (literalLength >= 15) {
+		LZ4WriteLength(out, literalLength);
+	}
+	out.insert(out.end(), literals, literals + literalLength);
+	if (matchLength == 0) {
+		return;
+	}
+	out.push_back((unsigned char)(offset & 0xFF));
+	out.push_back((unsigned char)(offset >> 8));
+	if (matchCode >= 15) {
+		LZ4WriteLength(out, matchCode);
+	}
+}
+
+inline vector<unsigned char> LZ4CompressBlock(const unsigned char* source, size_t size) {
+	vector<unsigned char> out;
+	out.reserve(size / 2 + 16);
+	size_t anchor = 0;
+
+	if (size > (size_t)LZ4_MATCH_LIMIT) {
+		vector<int64_t> table((size_t)1 << LZ4_HASH_BITS, -1);
+		size_t limit = size - LZ4_MATCH_LIMIT;
+		size_t position = 0;
+		while (position < limit) {
+			uint32_t sequence = LZ4Read32(source + position);
+			uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+			int64_t candidate = table[hash];
+			table[hash] = (int64_t)position;
+			if (candidate < 0 || position - (size_t)candidate > 65535 || LZ4Read32(source + candidate) != sequence) {
+				position++;
+				continue;
+			}
+
+			size_t length = LZ4_MIN_MATCH;
+			while (position + length < size - LZ4_LAST_LITERALS && source[candidate + length] == source[position + length]) {
+				length++;
+			}
+			LZ4WriteSequence(out, source + anchor, position - anchor, position - (size_t)candidate, length);
+			position += length;
+			anchor = position;
+		}
+	}
+
+	LZ4WriteSequence(out, source + anchor, size - anchor, 0, 0);
+	return out;
+}
+
+//Decompresses into exactly size bytes, false when the block is corrupt or does not come out at that size
+inline bool LZ4DecompressBlock(const unsigned char* block, size_t blockSize, unsigned char* out, size_t size) {
+	const unsigned char* in = block;
+	const unsigned char* inEnd = block + blockSize;
+	size_t written = 0;
+
+	while (in < inEnd) {
+		unsigned char token = *in++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15) {
+			unsigned char extra;
+			do {
+				if (in >= inEnd) {
+					return false;
+				}
+				extra = *in++;
+				literalLength += extra;
+			} while (extra == 255);
+		}
+		if ((size_t)(inEnd - in) < literalLength || size - written < literalLength) {
+			return false;
+		}
+		memcpy(out + written, in, literalLength);
+		in += literalLength;
+		written += literalLength;
+
+		//The last sequence has literals only
+		if (in == inEnd) {
+			break;
+		}
+
+		if (inEnd - in < 2) {
+			return false;
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15) {
+			unsigned char extra;
+			do {
+				if (in >= inEnd) {
+					return false;
+				}
+				extra = *in++;
+				matchLength += extra;
+			} while (extra == 255);
+		}
+		matchLength += LZ4_MIN_MATCH;
+		if (offset == 0 || offset > written || size - written < matchLength) {
+			return false;
+		}
+		//Byte by byte, a match may overlap what it is copying
+		for (size_t i = 0; i < matchLength; i++) {
+			out[written + i] = out[written + i - offset];
+		}
+		written += matchLength;
+	}
+	return written == size;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+#include "glcontext.h"
+#include "shader.h"
+#include "rendercounters.h"
+#include "resourceregistry.h"
+#include "texture2d.h"
+#include "uniformblocks.h"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+//Texture units of the material maps, the samplers are pointed at these once per program
+const int MATERIAL_DIFFUSE_UNIT = 0;
+const int MATERIAL_SPECULAR_UNIT = 1;
+const int MATERIAL_OVERLAY_DIFFUSE_UNIT = 2;
+const int MATERIAL_OVERLAY_SPECULAR_UNIT = 3;
+
+//Surface description: the maps it samples and its lighting parameters. Overlays are optional (NULL).
+struct Material {
+	const Texture2D* Diffuse = NULL;
+	const Texture2D* Specular = NULL;
+	const Texture2D* OverlayDiffuse = NULL;
+	const Texture2D* OverlaySpecular = NULL;
+	float Shininess = 32.0f;
+
+	Material() {}
+
+	//Constructor: diffuse map, specular map, shininess
+	Material(const Texture2D& diffuse, const Texture2D& specular, float shininess = 32.0f) {
+		Diffuse = &diffuse;
+		Specular = &specular;
+		Shininess = shininess;
+	}
+
+	//Adds a label style overlay blended over the base maps by its alpha
+	Material& WithOverlay(const Texture2D& overlayDiffuse, const Texture2D& overlaySpecular) {
+		OverlayDiffuse = &overlayDiffuse;
+		OverlaySpecular = &overlaySpecular;
+		return *this;
+	}
+
+	bool HasOverlay() const {
+		return OverlayDiffuse != NULL;
+	}
+};
+
+//Every material of the scene, compiled once into one uniform buffer. Each material owns an aligned range holding its
+//MaterialData block, so binding a material is one glBindBufferRange plus its textures and no uniform is set per draw.
+class MaterialTable
+{
+public:
+	vector<Material> Materials;
+
+	unsigned int Buffer = 0;
+
+	//Distance between two materials in the buffer, MaterialBlock rounded up to the offset alignment
+	GLsizeiptr Stride = sizeof(MaterialBlock);
+
+	//Adds a material and returns its index for Bind
+	int Add(const Material& material) {
+		Materials.push_back(material);
+		return (int)Materials.size() - 1;
+	}
+
+	//Bakes every material into its block and uploads the table, call once after the last Add
+	void Upload() {
+		if (!HasCurrentGLContext() || Materials.empty()) {
+			return;
+		}
+
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		Stride = (sizeof(MaterialBlock) + alignment - 1) / alignment * alignment;
+
+		vector<char> data(Stride * Materials.size(), 0);
+		for (size_t i = 0; i < Materials.size(); i++) {
+			MaterialBlock* block = (MaterialBlock*)&data[i * Stride];
+			block->UseOverlayTexture = Materials[i].HasOverlay();
+			block->Shininess = Materials[i].Shininess;
+		}
+
+		glGenBuffers(1, &Buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+		glBufferData(GL_UNIFORM_BUFFER, data.size(), &data[0], GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(Buffer, RESOURCE_UNIFORM_BUFFER, data.size(), "material table");
+	}
+
+	//Makes a material current for the following draws of any program using the MaterialData block
+	void Bind(int index) const {
+		const Material& material = Materials[index];
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, Buffer, index * Stride, sizeof(MaterialBlock));
+
+		BindTexture(MATERIAL_DIFFUSE_UNIT, material.Diffuse);
+		BindTexture(MATERIAL_SPECULAR_UNIT, material.Specular);
+		BindTexture(MATERIAL_OVERLAY_DIFFUSE_UNIT, material.OverlayDiffuse);
+		BindTexture(MATERIAL_OVERLAY_SPECULAR_UNIT, material.OverlaySpecular);
+	}
+
+	//Points a program's material samplers at the material units, once after it is compiled
+	static void SetSamplerUnits(Shader& shader) {
+		if (shader.ID == 0) {
+			return;
+		}
+		shader.use();
+		shader.setInt("material.diffuse", MATERIAL_DIFFUSE_UNIT);
+		shader.setInt("material.specular", MATERIAL_SPECULAR_UNIT);
+		shader.setInt("material.overlayDiffuse", MATERIAL_OVERLAY_DIFFUSE_UNIT);
+		shader.setInt("material.overlaySpecular", MATERIAL_OVERLAY_SPECULAR_UNIT);
+	}
+
+	//De-allocates the uniform buffer
+	void Deallocate() {
+		GetResourceRegistry().ReleaseBuffer(Buffer);
+		glDeleteBuffers(1, &Buffer);
+		Buffer = 0;
+	}
+
+private:
+	static void BindTexture(int unit, const Texture2D* texture) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, texture != NULL ? texture->Texture : 0);
+		GetRenderCounters().TextureBinds++;
+		if (texture != NULL) {
+			GetResourceRegistry().TouchTexture(texture->Texture);
+		}
+	}
+};
+
+#endif
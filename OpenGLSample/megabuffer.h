@@ -0,0 +1,296 @@
+#ifndef MEGABUFFER_H
+#define MEGABUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "glcontext.h"
+#include "shader.h"
+#include "uniformblocks.h"
+#include "rendercounters.h"
+#include "resourceregistry.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+//Vertex layout of every primitive: pos(3), color(3), normal(3), uv(2)
+const int MEGA_BUFFER_VERTEX_FLOATS = 11;
+
+//Attribute the draw index arrives on, instanced so baseInstance of each indirect command selects it
+const int MEGA_BUFFER_DRAW_ID_ATTRIBUTE = 4;
+
+//Shader storage bindings of the per-draw array (multiDrawVertex.glsl) and the material table (multiDrawFragm.glsl)
+const unsigned int MULTI_DRAW_DATA_BINDING = 0;
+const unsigned int MULTI_DRAW_MATERIAL_BINDING = 1;
+
+//Texture units of the two layer arrays the multi draw shader samples
+const int MULTI_DRAW_SURFACE_TEXTURE_UNIT = 0;
+const int MULTI_DRAW_OVERLAY_TEXTURE_UNIT = 1;
+
+//Indirect multi draws and shader storage buffers are core in GL 4.3
+inline bool IsMultiDrawSupported() {
+	return HasCurrentGLContext() && GLAD_GL_VERSION_4_3;
+}
+
+//Where a primitive's geometry sits in the megabuffer
+struct MegaBufferRange {
+	unsigned int FirstIndex = 0;
+	unsigned int IndexCount = 0;
+	int BaseVertex = 0;
+};
+
+//Same layout as the command glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+	unsigned int Count;
+	unsigned int InstanceCount;
+	unsigned int FirstIndex;
+	int BaseVertex;
+	unsigned int BaseInstance;
+};
+
+//Per-draw data, std430 DrawData in multiDrawVertex.glsl
+struct MultiDrawData {
+	glm::mat4 Model;
+	glm::mat3x4 NormalMatrix;
+	int MaterialIndex;
+	int pad0[3];
+};
+
+static_assert(sizeof(MultiDrawData) == 128, "MultiDrawData must match the std430 DrawData struct");
+
+//All primitive vertices and indices in one vertex buffer and one index buffer behind a single VAO.
+//Vertex arrays are turned into indexed geometry on the way in, identical vertices are stored once.
+class GeometryMegaBuffer
+{
+public:
+	unsigned int VAO = 0, VertexBuffer = 0, IndexBuffer = 0, DrawIDBuffer = 0;
+
+	//CPU copies until Upload
+	vector<float> Vertices;
+	vector<unsigned int> Indices;
+
+	//Sizes of what Upload sent, the CPU copies are gone by then
+	int UploadedVertexCount = 0;
+	int UploadedIndexCount = 0;
+
+	//Adds a non-indexed triangle list and returns its range. Adding the same vector twice returns the first range.
+	MegaBufferRange Add(const vector<float>& vertices) {
+		unordered_map<const vector<float>*, MegaBufferRange>::iterator existing = ranges.find(&vertices);
+		if (existing != ranges.end()) {
+			return existing->second;
+		}
+
+		MegaBufferRange range;
+		range.FirstIndex = (unsigned int)Indices.size();
+		range.BaseVertex = (int)(Vertices.size() / MEGA_BUFFER_VERTEX_FLOATS);
+
+		//Indices are relative to BaseVertex, dedupe only within this primitive
+		unordered_map<VertexKey, unsigned int, VertexKeyHash> unique;
+		unsigned int nextIndex = 0;
+		size_t vertexCount = vertices.size() / MEGA_BUFFER_VERTEX_FLOATS;
+		for (size_t i = 0; i < vertexCount; i++) {
+			VertexKey key;
+			memcpy(key.Values, &vertices[i * MEGA_BUFFER_VERTEX_FLOATS], sizeof(key.Values));
+
+			pair<unordered_map<VertexKey, unsigned int, VertexKeyHash>::iterator, bool> inserted = unique.insert(make_pair(key, nextIndex));
+			if (inserted.second) {
+				Vertices.insert(Vertices.end(), key.Values, key.Values + MEGA_BUFFER_VERTEX_FLOATS);
+				nextIndex++;
+			}
+			Indices.push_back(inserted.first->second);
+		}
+
+		range.IndexCount = (unsigned int)(Indices.size() - range.FirstIndex);
+		ranges[&vertices] = range;
+		return range;
+	}
+
+	//Creates the buffers and the shared VAO. drawCount sizes the draw index buffer (0, 1, 2, ...).
+	void Upload(int drawCount) {
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+
+		glGenBuffers(1, &VertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(VertexBuffer, RESOURCE_VERTEX_BUFFER, Vertices.size() * sizeof(float), "megabuffer vertices");
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MEGA_BUFFER_VERTEX_FLOATS * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, MEGA_BUFFER_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MEGA_BUFFER_VERTEX_FLOATS * sizeof(float), (void*)(6 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, MEGA_BUFFER_VERTEX_FLOATS * sizeof(float), (void*)(9 * sizeof(float)));
+		glEnableVertexAttribArray(3);
+
+		//Base instance trick: one instance per command, the instanced attribute then reads DrawIDBuffer[baseInstance]
+		vector<unsigned int> drawIDs(max(drawCount, 1));
+		for (size_t i = 0; i < drawIDs.size(); i++) {
+			drawIDs[i] = (unsigned int)i;
+		}
+		glGenBuffers(1, &DrawIDBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, DrawIDBuffer);
+		glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(unsigned int), drawIDs.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(DrawIDBuffer, RESOURCE_VERTEX_BUFFER, drawIDs.size() * sizeof(unsigned int), "megabuffer draw ids");
+		glVertexAttribIPointer(MEGA_BUFFER_DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+		glVertexAttribDivisor(MEGA_BUFFER_DRAW_ID_ATTRIBUTE, 1);
+		glEnableVertexAttribArray(MEGA_BUFFER_DRAW_ID_ATTRIBUTE);
+
+		glGenBuffers(1, &IndexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), Indices.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(IndexBuffer, RESOURCE_INDEX_BUFFER, Indices.size() * sizeof(unsigned int), "megabuffer indices");
+
+		glBindVertexArray(0);
+
+		UploadedVertexCount = (int)(Vertices.size() / MEGA_BUFFER_VERTEX_FLOATS);
+		UploadedIndexCount = (int)Indices.size();
+		vector<float>().swap(Vertices);
+		vector<unsigned int>().swap(Indices);
+		ranges.clear();
+	}
+
+	//De-allocates the resources associated with the VAO and buffers
+	void DeallocateVertexArrayBuffers() {
+		GetResourceRegistry().ReleaseBuffer(VertexBuffer);
+		GetResourceRegistry().ReleaseBuffer(IndexBuffer);
+		GetResourceRegistry().ReleaseBuffer(DrawIDBuffer);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VertexBuffer);
+		glDeleteBuffers(1, &IndexBuffer);
+		glDeleteBuffers(1, &DrawIDBuffer);
+	}
+
+private:
+	struct VertexKey {
+		float Values[MEGA_BUFFER_VERTEX_FLOATS];
+		bool operator==(const VertexKey& other) const {
+			return memcmp(Values, other.Values, sizeof(Values)) == 0;
+		}
+	};
+
+	struct VertexKeyHash {
+		size_t operator()(const VertexKey& key) const {
+			//FNV-1a over the raw bytes
+			const unsigned char* bytes = (const unsigned char*)key.Values;
+			size_t hash = 2166136261u;
+			for (size_t i = 0; i < sizeof(key.Values); i++) {
+				hash = (hash ^ bytes[i]) * 16777619u;
+			}
+			return hash;
+		}
+	};
+
+	unordered_map<const vector<float>*, MegaBufferRange> ranges;
+};
+
+//Material of a multi draw, std430 MaterialData in multiDrawFragm.glsl.
+//Textures are layers: diffuse/specular in the surface array, the overlays in the overlay array (-1 for no overlay).
+struct MultiDrawMaterial {
+	int DiffuseLayer = 0;
+	int SpecularLayer = 0;
+	int OverlayDiffuseLayer = -1;
+	int OverlaySpecularLayer = -1;
+	float Shininess = 32.0f;
+	int pad0[3];
+};
+
+static_assert(sizeof(MultiDrawMaterial) == 32, "MultiDrawMaterial must match the std430 MaterialData struct");
+
+//Static scene submitted with one glMultiDrawElementsIndirect. Textures come from two layer arrays bound once,
+//so draws with different materials follow each other with no state change. Model matrices come from a storage buffer
+//indexed by draw, material parameters from a second one indexed by the draw's material.
+class SceneMultiDraw
+{
+public:
+	GeometryMegaBuffer Geometry;
+
+	vector<DrawElementsIndirectCommand> Commands;
+	vector<MultiDrawData> DrawData;
+	vector<MultiDrawMaterial> Materials;
+
+	unsigned int IndirectBuffer = 0, DrawDataBuffer = 0, MaterialBuffer = 0;
+
+	//GL_TEXTURE_2D_ARRAYs the material layers index into
+	unsigned int SurfaceTextures = 0, OverlayTextures = 0;
+
+	//Adds a material and returns its index for AddDraw
+	int AddMaterial(const MultiDrawMaterial& material) {
+		Materials.push_back(material);
+		return (int)Materials.size() - 1;
+	}
+
+	//Adds one draw of a primitive's vertices
+	void AddDraw(const vector<float>& vertices, const glm::mat4& model, int materialIndex) {
+		MegaBufferRange range = Geometry.Add(vertices);
+
+		DrawElementsIndirectCommand command;
+		command.Count = range.IndexCount;
+		command.InstanceCount = 1;
+		command.FirstIndex = range.FirstIndex;
+		command.BaseVertex = range.BaseVertex;
+		command.BaseInstance = (unsigned int)Commands.size(); //Draw index, see GeometryMegaBuffer::Upload
+		Commands.push_back(command);
+
+		MultiDrawData data;
+		data.Model = model;
+		data.NormalMatrix = NormalMatrix(model);
+		data.MaterialIndex = materialIndex;
+		DrawData.push_back(data);
+	}
+
+	//Uploads the geometry, the indirect commands, the per-draw data and the materials
+	void Upload() {
+		Geometry.Upload((int)Commands.size());
+
+		glGenBuffers(1, &IndirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, Commands.size() * sizeof(DrawElementsIndirectCommand), Commands.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(IndirectBuffer, RESOURCE_DRAW_BUFFER, Commands.size() * sizeof(DrawElementsIndirectCommand), "indirect commands");
+
+		glGenBuffers(1, &DrawDataBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, DrawDataBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, DrawData.size() * sizeof(MultiDrawData), DrawData.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(DrawDataBuffer, RESOURCE_DRAW_BUFFER, DrawData.size() * sizeof(MultiDrawData), "multi draw data");
+
+		glGenBuffers(1, &MaterialBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, MaterialBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, Materials.size() * sizeof(MultiDrawMaterial), Materials.data(), GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(MaterialBuffer, RESOURCE_DRAW_BUFFER, Materials.size() * sizeof(MultiDrawMaterial), "multi draw materials");
+	}
+
+	//Draws the whole scene in one call, the multi draw shader must be in use with the frame/light blocks bound
+	void Draw(Shader& shader) {
+		glBindVertexArray(Geometry.VAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MULTI_DRAW_DATA_BINDING, DrawDataBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MULTI_DRAW_MATERIAL_BINDING, MaterialBuffer);
+
+		glActiveTexture(GL_TEXTURE0 + MULTI_DRAW_SURFACE_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, SurfaceTextures);
+		glActiveTexture(GL_TEXTURE0 + MULTI_DRAW_OVERLAY_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, OverlayTextures);
+		GetRenderCounters().TextureBinds += 2;
+		shader.setInt("surfaceTextures", MULTI_DRAW_SURFACE_TEXTURE_UNIT);
+		shader.setInt("overlayTextures", MULTI_DRAW_OVERLAY_TEXTURE_UNIT);
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, (GLsizei)Commands.size(), 0);
+	}
+
+	//De-allocates every buffer (the texture arrays belong to whoever built them)
+	void DeallocateVertexArrayBuffers() {
+		Geometry.DeallocateVertexArrayBuffers();
+		GetResourceRegistry().ReleaseBuffer(IndirectBuffer);
+		GetResourceRegistry().ReleaseBuffer(DrawDataBuffer);
+		GetResourceRegistry().ReleaseBuffer(MaterialBuffer);
+		glDeleteBuffers(1, &IndirectBuffer);
+		glDeleteBuffers(1, &DrawDataBuffer);
+		glDeleteBuffers(1, &MaterialBuffer);
+	}
+};
+
+#endif
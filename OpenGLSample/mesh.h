@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
+#include "resourceregistry.h"
 
 #include <string>
 #include <vector>
@@ -107,9 +108,11 @@ private:
 		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		// again translates to 3/2 floats which translates to a byte array.
 		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(VBO, RESOURCE_VERTEX_BUFFER, vertices.size() * sizeof(Vertex), "Mesh");
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(EBO, RESOURCE_INDEX_BUFFER, indices.size() * sizeof(unsigned int), "Mesh");
 
 		// set the vertex attribute pointers
 		// vertex Positions
@@ -0,0 +1,247 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "camera.h"
+#include "cylinder.h"
+#include "sphere.h"
+#include "cube.h"
+#include "plane.h"
+#include "pyramid.h"
+#include "texture2d.h"
+#include "scene.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Microbenchmarks of the hot pieces on their own: primitive construction (with its upload), texture decode and upload,
+* uniform setters and the camera. Results are appended to a JSON lines file, one object per benchmark tagged with a
+* label (the commit, say), so the same file collects a trend run after run.
+*/
+
+//Samples per benchmark, the median is reported so one preempted sample doesn't move it
+const int MICROBENCH_SAMPLES = 9;
+
+//Fast bodies run in batches sized so one sample takes about this long
+const double MICROBENCH_SAMPLE_MS = 5.0;
+
+//Bodies with a setup are timed one call at a time, up to this many calls or this much time
+const int MICROBENCH_MAX_SINGLE_CALLS = 200;
+const double MICROBENCH_SINGLE_BUDGET_MS = 300.0;
+
+struct MicrobenchResult {
+	string Group;
+	string Name;
+	string Parameter;
+	long long Iterations = 0;
+	double MedianNs = 0.0;
+	double MinNs = 0.0;
+	double MaxNs = 0.0;
+};
+
+class Microbench
+{
+public:
+	vector<MicrobenchResult> Results;
+
+	//Runs body until the timing settles and records the nanoseconds per call. With a setup the calls are timed one
+	//by one and setup runs untimed before each, for bodies that need fresh state (or have to throw the last one away).
+	void Run(const string& group, const string& name, const string& parameter, const function<void()>& body, const function<void()>& setup = nullptr) {
+		vector<double> samples;
+		long long iterations = 0;
+
+		if (setup) {
+			double totalMs = 0.0;
+			while ((int)samples.size() < MICROBENCH_MAX_SINGLE_CALLS && (samples.size() < MICROBENCH_SAMPLES || totalMs < MICROBENCH_SINGLE_BUDGET_MS)) {
+				setup();
+				auto start = chrono::steady_clock::now();
+				body();
+				double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+				samples.push_back(ns);
+				totalMs += ns / 1000000.0;
+			}
+			setup();
+			iterations = (long long)samples.size();
+		}
+		else {
+			//Doubles the batch until it fills a sample, that run doubles as the warm up
+			long long batch = 1;
+			while (true) {
+				double ms = TimeBatch(body, batch) / 1000000.0;
+				if (ms >= MICROBENCH_SAMPLE_MS || batch >= (1LL << 30)) {
+					break;
+				}
+				batch *= 2;
+			}
+			for (int i = 0; i < MICROBENCH_SAMPLES; i++) {
+				samples.push_back(TimeBatch(body, batch) / batch);
+			}
+			iterations = batch * MICROBENCH_SAMPLES;
+		}
+
+		sort(samples.begin(), samples.end());
+		MicrobenchResult result;
+		result.Group = group;
+		result.Name = name;
+		result.Parameter = parameter;
+		result.Iterations = iterations;
+		result.MedianNs = samples[samples.size() / 2];
+		result.MinNs = samples.front();
+		result.MaxNs = samples.back();
+		Results.push_back(result);
+
+		cout << "MICROBENCH::" << group << "::" << name << (parameter.empty() ? "" : " " + parameter) << "::" << FormatTime(result.MedianNs)
+			<< " (MIN " << FormatTime(result.MinNs) << ")::" << iterations << " CALLS" << endl;
+	}
+
+	//Appends every result as one JSON object per line
+	bool Write(const string& path, const string& label) const {
+		FILE* file = fopen(path.c_str(), "a");
+		if (!file) {
+			cout << "ERROR::MICROBENCH::COULD_NOT_WRITE::" << path << endl;
+			return false;
+		}
+		for (const MicrobenchResult& result : Results) {
+			fprintf(file, "{\"label\":\"%s\",\"group\":\"%s\",\"name\":\"%s\",\"param\":\"%s\",\"median_ns\":%.1f,\"min_ns\":%.1f,\"max_ns\":%.1f,\"iterations\":%lld}\n",
+				Escape(label).c_str(), Escape(result.Group).c_str(), Escape(result.Name).c_str(), Escape(result.Parameter).c_str(),
+				result.MedianNs, result.MinNs, result.MaxNs, result.Iterations);
+		}
+		fclose(file);
+		cout << "MICROBENCH::" << Results.size() << " RESULTS::" << path << endl;
+		return true;
+	}
+
+private:
+	static double TimeBatch(const function<void()>& body, long long batch) {
+		auto start = chrono::steady_clock::now();
+		for (long long i = 0; i < batch; i++) {
+			body();
+		}
+		return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+	}
+
+	static string FormatTime(double ns) {
+		char text[32];
+		if (ns >= 1000000.0) snprintf(text, sizeof(text), "%.3fms", ns / 1000000.0);
+		else if (ns >= 1000.0) snprintf(text, sizeof(text), "%.3fus", ns / 1000.0);
+		else snprintf(text, sizeof(text), "%.1fns", ns);
+		return text;
+	}
+
+	static string Escape(const string& text) {
+		string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+};
+
+//Construction of one primitive, the one from the call before is deallocated outside the timing
+template <typename T>
+void MicrobenchPrimitive(Microbench& bench, const string& name, const string& parameter, const function<T*()>& create) {
+	unique_ptr<T> primitive;
+	bench.Run("geometry", name, parameter, [&]() {
+		primitive.reset(create());
+	}, [&]() {
+		if (primitive) {
+			primitive->DeallocateVertexArrayBuffers();
+		}
+		primitive.reset();
+	});
+}
+
+//The whole suite. Needs a current GL context, textures are the ones the scene description lists.
+inline void RunMicrobenchSuite(Microbench& bench, const SceneDescription& scene) {
+
+	//Primitive construction across side counts
+	const int cylinderSides[] = { 8, 36, 128, 1024 };
+	for (int sides : cylinderSides) {
+		MicrobenchPrimitive<Cylinder>(bench, "Cylinder", to_string(sides), [sides]() {
+			return new Cylinder(0.5f, 0.5f, 1.0f, sides, 3);
+		});
+	}
+	const int sphereSides[] = { 8, 36, 128 };
+	for (int sides : sphereSides) {
+		MicrobenchPrimitive<Sphere>(bench, "Sphere", to_string(sides), [sides]() {
+			return new Sphere(glm::vec3(0.0f), 0.5f, sides);
+		});
+	}
+	MicrobenchPrimitive<Cube>(bench, "Cube", "", []() { return new Cube(); });
+	MicrobenchPrimitive<Plane>(bench, "Plane", "", []() { return new Plane(); });
+	MicrobenchPrimitive<Pyramid>(bench, "Pyramid", "", []() { return new Pyramid(); });
+
+	//Texture decode, then upload (with mipmaps, finished before the clock stops) from the decoded pixels
+	stbi_set_flip_vertically_on_load(false);
+	for (const SceneTextureDesc& desc : scene.Textures) {
+		Texture2D texture = Texture2D::CreateDeferred(desc.Path.c_str(), desc.HasAlpha, desc.RepeatU, desc.RepeatV, desc.GenMipMaps, desc.FlipVertical);
+		bench.Run("texture", "Decode", desc.Path, [&]() {
+			texture.DecodePixels();
+		});
+		if (texture.Pixels.empty()) {
+			continue;
+		}
+
+		vector<unsigned char> pixels = texture.Pixels;
+		bench.Run("texture", "Upload", desc.Path, [&]() {
+			texture.UploadPixels();
+			glFinish();
+		}, [&]() {
+			if (texture.Texture != 0) {
+				GetResourceRegistry().ReleaseTexture(texture.Texture);
+				glDeleteTextures(1, &texture.Texture);
+				texture.Texture = 0;
+			}
+			texture.Pixels = pixels;
+		});
+	}
+
+	//Uniform setters: the name lookup every call against a location looked up once
+	Shader shader("shaderfiles/vertex.glsl", "shaderfiles/fragment.glsl");
+	Shader colorShader("shaderfiles/lightCubeVertex.glsl", "shaderfiles/lightCubeFragm.glsl");
+	glm::mat4 matrix(1.0f);
+	glm::vec3 color(1.0f, 0.5f, 0.25f);
+
+	shader.use();
+	GLint modelLocation = glGetUniformLocation(shader.ID, "model");
+	GLint textureLocation = glGetUniformLocation(shader.ID, "baseTexture");
+	bench.Run("uniform", "Shader::setMat4", "", [&]() { shader.setMat4("model", matrix); });
+	bench.Run("uniform", "glUniformMatrix4fv", "cached location", [&]() { glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &matrix[0][0]); });
+	bench.Run("uniform", "Shader::setInt", "", [&]() { shader.setInt("baseTexture", 0); });
+	bench.Run("uniform", "glUniform1i", "cached location", [&]() { glUniform1i(textureLocation, 0); });
+
+	colorShader.use();
+	GLint colorLocation = glGetUniformLocation(colorShader.ID, "lightColor");
+	bench.Run("uniform", "Shader::setVec3", "", [&]() { colorShader.setVec3("lightColor", color); });
+	bench.Run("uniform", "glUniform3fv", "cached location", [&]() { glUniform3fv(colorLocation, 1, &color[0]); });
+	glUseProgram(0);
+	glDeleteProgram(shader.ID);
+	glDeleteProgram(colorShader.ID);
+
+	//Camera, the sink keeps the results alive
+	Camera camera(glm::vec3(0.0f, 1.0f, 3.0f));
+	volatile float sink = 0.0f;
+	bench.Run("camera", "Camera::GetViewMatrix", "", [&]() {
+		sink = sink + camera.GetViewMatrix()[3][0];
+	});
+	float offset = 0.5f;
+	bench.Run("camera", "Camera::ProcessMouseMovement", "updateCameraVectors", [&]() {
+		offset = -offset; //Back and forth so the angles stay put
+		camera.ProcessMouseMovement(offset, offset);
+		sink = sink + camera.Front.x;
+	});
+}
+
+#endif
@@ -0,0 +1,452 @@
+#ifndef MIPCHAIN_H
+#define MIPCHAIN_H
+
+#include "stb_image.h"
+#include "assetarchive.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPCHAIN_SSE2
+#endif
+
+using namespace std;
+
+/*
+* Mip levels made on the CPU. GenerateMipChain filters every level from the one above it with a Lanczos-3 kernel in
+* linear light (colour converted from sRGB, alpha left linear), one texel's four channels to an SSE register. Colour is
+* premultiplied by alpha while it is filtered, so transparent texels lend nothing to their opaque neighbours. The chain
+* is saved in MIPCHAIN_CACHE_DIRECTORY under a name made from the image's checksum and load settings, so later loads
+* read the levels they need straight from it without decoding the image, and skip the top levels a low quality preset
+* drops by seeking past them. Images in the asset archive cache the same way as loose ones, nothing is written beside them.
+*/
+
+const uint32_t MIPCHAIN_MAGIC = 0x5350494D; //"MIPS"
+const uint32_t MIPCHAIN_VERSION = 2;
+
+//Where cached chains go, relative to the working directory
+const char* const MIPCHAIN_CACHE_DIRECTORY = "mipcache";
+
+//How textures get their mip levels, set once from the command line before anything loads
+struct TextureQuality {
+	bool CPUMips = false;	//GenerateMipChain and the cache, instead of glGenerateMipmap
+	int DropLevels = 0;		//Top levels never loaded, for machines short on memory
+};
+
+inline TextureQuality& GetTextureQuality() {
+	static TextureQuality quality;
+	return quality;
+}
+
+//high, medium and low: CPU mips with 0, 1 and 2 top levels dropped. False for an unknown name.
+inline bool SetTextureQualityPreset(const string& name) {
+	const char* const presets[] = { "high", "medium", "low" };
+	for (int i = 0; i < 3; i++) {
+		if (name == presets[i]) {
+			GetTextureQuality().CPUMips = true;
+			GetTextureQuality().DropLevels = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Levels FirstLevel onwards of an image, tightly packed rows of Channels bytes
+struct MipChain {
+	int Width = 0, Height = 0;	//Of level 0, whether or not it was loaded
+	int Channels = 4;
+	int FirstLevel = 0;			//Levels[0] is this level
+	vector<vector<unsigned char>> Levels;
+	bool FromCache = false;
+
+	int LevelWidth(int level) const { return max(1, Width >> level); }
+	int LevelHeight(int level) const { return max(1, Height >> level); }
+
+	//Levels in the whole chain, down to 1x1
+	int GetLevelCount() const {
+		int count = 1;
+		while ((Width >> count) > 0 || (Height >> count) > 0) {
+			count++;
+		}
+		return count;
+	}
+};
+
+//What LoadMipChain brings back
+struct MipChainRequest {
+	string Path;
+	int Channels = 4;
+	bool FlipVertical = true;
+	bool WrapU = true, WrapV = true;	//Repeating edges filter across to the other side
+	int FirstLevel = 0;					//Levels above are skipped
+	int MaxSize = 0;					//Skips on until the longer side fits, 0 for no limit
+	int LevelCount = 0;					//Levels from the first one, 0 for the rest of the chain
+};
+
+//Decodes a file (from the asset archive when it has it) to tightly packed rows, flipped here rather than through stb's
+//global flag, so it is safe on any thread. Empty on failure.
+inline vector<unsigned char> DecodeImageFile(const string& path, int channels, bool flipVertical, int& width, int& height) {
+	AssetData file;
+	if (!ReadAsset(path, file)) {
+		return vector<unsigned char>();
+	}
+	int fileChannels;
+	unsigned char* decoded = stbi_load_from_memory((const stbi_uc*)file.GetData(), (int)file.GetSize(), &width, &height, &fileChannels, channels);
+	if (!decoded) {
+		return vector<unsigned char>();
+	}
+
+	size_t rowBytes = (size_t)width * channels;
+	vector<unsigned char> pixels(rowBytes * height);
+	for (int y = 0; y < height; y++) {
+		int sourceRow = flipVertical ? height - 1 - y : y;
+		memcpy(&pixels[y * rowBytes], decoded + sourceRow * rowBytes, rowBytes);
+	}
+	stbi_image_free(decoded);
+	return pixels;
+}
+
+//The next mip level down, a 2x2 box on the bytes. Sizes round down like GL's, an odd last row or column is left out.
+inline vector<unsigned char> HalveImage(const vector<unsigned char>& pixels, int& width, int& height, int channels) {
+	int halfWidth = max(1, width / 2);
+	int halfHeight = max(1, height / 2);
+	vector<unsigned char> half((size_t)halfWidth * halfHeight * channels);
+	for (int y = 0; y < halfHeight; y++) {
+		const unsigned char* row0 = &pixels[(size_t)min(y * 2, height - 1) * width * channels];
+		const unsigned char* row1 = &pixels[(size_t)min(y * 2 + 1, height - 1) * width * channels];
+		unsigned char* out = &half[(size_t)y * halfWidth * channels];
+		for (int x = 0; x < halfWidth; x++) {
+			int x0 = min(x * 2, width - 1) * channels;
+			int x1 = min(x * 2 + 1, width - 1) * channels;
+			for (int c = 0; c < channels; c++) {
+				out[x * channels + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+			}
+		}
+	}
+	width = halfWidth;
+	height = halfHeight;
+	return half;
+}
+
+//sRGB byte to linear, and linear (quantized to 1/16383) back to the nearest sRGB byte
+struct MipGammaTables {
+	float ToLinear[256];
+	unsigned char ToSRGB[16384];
+
+	MipGammaTables() {
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			ToLinear[i] = c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 16384; i++) {
+			float l = i / 16383.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * pow(l, 1.0f / 2.4f) - 0.055f;
+			ToSRGB[i] = (unsigned char)min(255.0f, c * 255.0f + 0.5f);
+		}
+	}
+};
+
+inline const MipGammaTables& GetMipGammaTables() {
+	static MipGammaTables tables;
+	return tables;
+}
+
+//Lanczos window with 3 lobes
+inline float LanczosWeight(float x) {
+	const float PI = 3.14159265358979f;
+	x = fabs(x);
+	if (x < 1e-5f) {
+		return 1.0f;
+	}
+	if (x >= 3.0f) {
+		return 0.0f;
+	}
+	float px = PI * x;
+	return 3.0f * sin(px) * sin(px / 3.0f) / (px * px);
+}
+
+//Source texels and weights of every output texel along one axis, widened by the reduction so each output covers its source
+struct MipFilterTaps {
+	int Count = 0; //Per output texel
+	vector<int> Index;
+	vector<float> Weight;
+};
+
+inline MipFilterTaps BuildMipFilterTaps(int sourceLength, int destinationLength, bool wrap) {
+	MipFilterTaps taps;
+	float scale = (float)sourceLength / destinationLength;
+	float radius = 3.0f * scale;
+	taps.Count = (int)ceil(radius * 2.0f) + 1;
+	taps.Index.resize((size_t)destinationLength * taps.Count);
+	taps.Weight.resize((size_t)destinationLength * taps.Count);
+
+	for (int d = 0; d < destinationLength; d++) {
+		float center = (d + 0.5f) * scale;
+		int first = (int)floor(center - radius);
+		float weightSum = 0.0f;
+		for (int t = 0; t < taps.Count; t++) {
+			int s = first + t;
+			float weight = LanczosWeight((s + 0.5f - center) / scale);
+			int index = wrap ? ((s % sourceLength) + sourceLength) % sourceLength : min(max(s, 0), sourceLength - 1);
+			taps.Index[(size_t)d * taps.Count + t] = index;
+			taps.Weight[(size_t)d * taps.Count + t] = weight;
+			weightSum += weight;
+		}
+		for (int t = 0; t < taps.Count; t++) {
+			taps.Weight[(size_t)d * taps.Count + t] /= weightSum;
+		}
+	}
+	return taps;
+}
+
+//destination += source * weight for one RGBA float texel
+inline void MipAccumulate(float* destination, const float* source, float weight) {
+#ifdef MIPCHAIN_SSE2
+	_mm_storeu_ps(destination, _mm_add_ps(_mm_loadu_ps(destination), _mm_mul_ps(_mm_loadu_ps(source), _mm_set1_ps(weight))));
+#else
+	for (int c = 0; c < 4; c++) {
+		destination[c] += source[c] * weight;
+	}
+#endif
+}
+
+//Halves a linear RGBA float image, rows then columns. Columns are done a whole output row at a time to stay in cache.
+inline vector<float> ReduceLinearImage(const vector<float>& source, int width, int height, bool wrapU, bool wrapV, int& newWidth, int& newHeight) {
+	newWidth = max(1, width / 2);
+	newHeight = max(1, height / 2);
+
+	vector<float> rows((size_t)newWidth * height * 4, 0.0f);
+	MipFilterTaps horizontal = BuildMipFilterTaps(width, newWidth, wrapU);
+	for (int y = 0; y < height; y++) {
+		const float* sourceRow = &source[(size_t)y * width * 4];
+		float* out = &rows[(size_t)y * newWidth * 4];
+		for (int x = 0; x < newWidth; x++) {
+			for (int t = 0; t < horizontal.Count; t++) {
+				size_t tap = (size_t)x * horizontal.Count + t;
+				MipAccumulate(&out[x * 4], &sourceRow[horizontal.Index[tap] * 4], horizontal.Weight[tap]);
+			}
+		}
+	}
+
+	vector<float> reduced((size_t)newWidth * newHeight * 4, 0.0f);
+	MipFilterTaps vertical = BuildMipFilterTaps(height, newHeight, wrapV);
+	for (int y = 0; y < newHeight; y++) {
+		float* out = &reduced[(size_t)y * newWidth * 4];
+		for (int t = 0; t < vertical.Count; t++) {
+			size_t tap = (size_t)y * vertical.Count + t;
+			const float* sourceRow = &rows[(size_t)vertical.Index[tap] * newWidth * 4];
+			float weight = vertical.Weight[tap];
+			for (int x = 0; x < newWidth; x++) {
+				MipAccumulate(&out[x * 4], &sourceRow[x * 4], weight);
+			}
+		}
+	}
+	return reduced;
+}
+
+//Bytes to linear RGBA floats with the colour premultiplied by alpha, a missing alpha becomes 1
+inline vector<float> ToLinearImage(const vector<unsigned char>& pixels, int texels, int channels) {
+	const MipGammaTables& tables = GetMipGammaTables();
+	vector<float> linear((size_t)texels * 4);
+	for (int i = 0; i < texels; i++) {
+		const unsigned char* texel = &pixels[(size_t)i * channels];
+		float alpha = channels == 4 ? texel[3] / 255.0f : 1.0f;
+		linear[i * 4 + 0] = tables.ToLinear[texel[0]] * alpha;
+		linear[i * 4 + 1] = tables.ToLinear[texel[1]] * alpha;
+		linear[i * 4 + 2] = tables.ToLinear[texel[2]] * alpha;
+		linear[i * 4 + 3] = alpha;
+	}
+	return linear;
+}
+
+//Premultiplied linear RGBA floats back to straight alpha bytes. Lanczos rings past 0 and 1, so alpha is clamped before
+//the colour is divided by it and the colour after. A texel that came out fully transparent keeps no colour.
+inline vector<unsigned char> FromLinearImage(const vector<float>& linear, int texels, int channels) {
+	const MipGammaTables& tables = GetMipGammaTables();
+	vector<unsigned char> pixels((size_t)texels * channels);
+	for (int i = 0; i < texels; i++) {
+		unsigned char* texel = &pixels[(size_t)i * channels];
+		float alpha = min(max(linear[i * 4 + 3], 0.0f), 1.0f);
+		float unpremultiply = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+		for (int c = 0; c < 3; c++) {
+			float value = min(max(linear[i * 4 + c] * unpremultiply, 0.0f), 1.0f);
+			texel[c] = tables.ToSRGB[(int)(value * 16383.0f + 0.5f)];
+		}
+		if (channels == 4) {
+			texel[3] = (unsigned char)(alpha * 255.0f + 0.5f);
+		}
+	}
+	return pixels;
+}
+
+//Every level of an image, level 0 being the image itself
+inline MipChain GenerateMipChain(const vector<unsigned char>& pixels, int width, int height, int channels, bool wrapU, bool wrapV) {
+	MipChain chain;
+	chain.Width = width;
+	chain.Height = height;
+	chain.Channels = channels;
+	chain.Levels.push_back(pixels);
+
+	vector<float> linear = ToLinearImage(pixels, width * height, channels);
+	int levelCount = chain.GetLevelCount();
+	for (int level = 1; level < levelCount; level++) {
+		int newWidth, newHeight;
+		linear = ReduceLinearImage(linear, width, height, wrapU, wrapV, newWidth, newHeight);
+		width = newWidth;
+		height = newHeight;
+		chain.Levels.push_back(FromLinearImage(linear, width * height, channels));
+	}
+	return chain;
+}
+
+//Start of a cache file, followed by every level largest first
+struct MipCacheHeader {
+	uint32_t Magic = MIPCHAIN_MAGIC;
+	uint32_t Version = MIPCHAIN_VERSION;
+	uint64_t SourceSize = 0;	//The image the chain was made from
+	uint64_t SourceChecksum = 0;
+	int32_t Width = 0, Height = 0, Channels = 0, LevelCount = 0;
+	uint8_t FlipVertical = 0, WrapU = 0, WrapV = 0, Reserved = 0;
+};
+
+//Header a cache made from the image as it is now would have, false when the image is missing
+inline bool GetMipCacheStamp(const MipChainRequest& request, MipCacheHeader& header) {
+	if (!GetAssetChecksum(request.Path, header.SourceSize, header.SourceChecksum)) {
+		return false;
+	}
+	header.Channels = request.Channels;
+	header.FlipVertical = request.FlipVertical;
+	header.WrapU = request.WrapU;
+	header.WrapV = request.WrapV;
+	return true;
+}
+
+//The cache file of a stamp, named by the image's checksum and the load settings. A changed image gets a new name.
+inline string GetMipCachePath(const MipCacheHeader& stamp) {
+	uint64_t key[] = { stamp.SourceSize, stamp.SourceChecksum, (uint64_t)stamp.Channels, stamp.FlipVertical, stamp.WrapU, stamp.WrapV };
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mips", (unsigned long long)AssetChecksum(key, sizeof(key)));
+	return string(MIPCHAIN_CACHE_DIRECTORY) + "/" + name;
+}
+
+//First level by the request, moved down while too large, and the level past the last one loaded
+inline void GetRequestedLevels(const MipChainRequest& request, const MipChain& chain, int& first, int& end) {
+	int levelCount = chain.GetLevelCount();
+	first = min(request.FirstLevel, levelCount - 1);
+	while (request.MaxSize > 0 && first < levelCount - 1 && max(chain.LevelWidth(first), chain.LevelHeight(first)) > request.MaxSize) {
+		first++;
+	}
+	end = request.LevelCount > 0 ? min(first + request.LevelCount, levelCount) : levelCount;
+}
+
+//Reads the requested levels from a cache made from the image as it is now, seeking past the ones not wanted
+inline bool ReadMipCache(const MipChainRequest& request, MipChain& chain) {
+	MipCacheHeader expected, header;
+	if (!GetMipCacheStamp(request, expected)) {
+		return false;
+	}
+	ifstream file(GetMipCachePath(expected).c_str(), ios::binary);
+	if (!file.read((char*)&header, sizeof(header)) || header.Magic != MIPCHAIN_MAGIC || header.Version != MIPCHAIN_VERSION
+		|| header.SourceSize != expected.SourceSize || header.SourceChecksum != expected.SourceChecksum || header.Channels != expected.Channels
+		|| header.FlipVertical != expected.FlipVertical || header.WrapU != expected.WrapU || header.WrapV != expected.WrapV) {
+		return false;
+	}
+
+	chain.Width = header.Width;
+	chain.Height = header.Height;
+	chain.Channels = header.Channels;
+	if (chain.Width <= 0 || chain.Height <= 0 || header.LevelCount != chain.GetLevelCount()) {
+		return false;
+	}
+	int first, end;
+	GetRequestedLevels(request, chain, first, end);
+
+	streamoff offset = sizeof(header);
+	for (int level = 0; level < first; level++) {
+		offset += (streamoff)chain.LevelWidth(level) * chain.LevelHeight(level) * chain.Channels;
+	}
+	file.seekg(offset);
+	chain.FirstLevel = first;
+	chain.Levels.resize(end - first);
+	for (int level = first; level < end; level++) {
+		vector<unsigned char>& pixels = chain.Levels[level - first];
+		pixels.resize((size_t)chain.LevelWidth(level) * chain.LevelHeight(level) * chain.Channels);
+		if (!file.read((char*)&pixels[0], pixels.size())) {
+			chain.Levels.clear();
+			return false;
+		}
+	}
+	chain.FromCache = true;
+	return true;
+}
+
+inline bool WriteMipCache(const MipChainRequest& request, const MipChain& chain) {
+	MipCacheHeader header;
+	if (!GetMipCacheStamp(request, header)) {
+		return false;
+	}
+	header.Width = chain.Width;
+	header.Height = chain.Height;
+	header.LevelCount = (int32_t)chain.Levels.size();
+
+	string path = GetMipCachePath(header);
+	MakeDirectory(MIPCHAIN_CACHE_DIRECTORY);
+	ofstream file(path.c_str(), ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	for (const vector<unsigned char>& level : chain.Levels) {
+		file.write((const char*)&level[0], level.size());
+	}
+	if (!file) {
+		cout << "ERROR::MIPCHAIN::WRITE_FAILED " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+//The requested levels of an image. With CPU mips they come from the cache, or the image is decoded once, its whole
+//chain generated and cached. Without, the image is decoded and box filtered only as far down as asked (the GL generates
+//the rest). Safe on worker threads. False when the image can not be read.
+inline bool LoadMipChain(const MipChainRequest& request, MipChain& chain) {
+	bool cpuMips = GetTextureQuality().CPUMips;
+	if (cpuMips && ReadMipCache(request, chain)) {
+		return true;
+	}
+
+	vector<unsigned char> pixels = DecodeImageFile(request.Path, request.Channels, request.FlipVertical, chain.Width, chain.Height);
+	if (pixels.empty()) {
+		return false;
+	}
+	chain.Channels = request.Channels;
+	int first, end;
+	GetRequestedLevels(request, chain, first, end);
+	chain.FirstLevel = first;
+
+	if (cpuMips) {
+		MipChain whole = GenerateMipChain(pixels, chain.Width, chain.Height, chain.Channels, request.WrapU, request.WrapV);
+		WriteMipCache(request, whole);
+		chain.Levels.assign(make_move_iterator(whole.Levels.begin() + first), make_move_iterator(whole.Levels.begin() + end));
+		return true;
+	}
+
+	int width = chain.Width, height = chain.Height;
+	for (int level = 0; level < end; level++) {
+		if (level >= first) {
+			chain.Levels.push_back(level + 1 < end ? pixels : move(pixels));
+		}
+		if (level + 1 < end) {
+			pixels = HalveImage(pixels, width, height, chain.Channels);
+		}
+	}
+	return true;
+}
+
+#endif
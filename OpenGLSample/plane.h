@@ -3,6 +3,8 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "glcontext.h"
+#include "resourceregistry.h"
 
 #include <vector>
 #include <random>
@@ -19,11 +21,14 @@ public:
 	//Dimensions (w, h, l)
 	glm::vec3 Dimensions;
 
-	//Vector of vertices
+	//Vector of vertices, empty after ReleaseVertices
 	vector<float> Vertices;
 
+	//Vertices in the buffer, valid whether or not Vertices is kept
+	int VertexCount = 0;
+
 	//VAO and VBO
-	unsigned int VAO, VBO;
+	unsigned int VAO = 0, VBO = 0;
 
 	//Constructor
 	Plane(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), float length = 2.0f, float width = 2.0f) 
@@ -36,9 +41,12 @@ public:
 
 		//Calculate the vertices
 		CalculateVertices();
+		VertexCount = (int)(Vertices.size() / numVertexAttributes);
 
 		//Generate the VAO/VBO
-		GenerateVertexArrayAndBuffer();
+		if (HasCurrentGLContext()) {
+			GenerateVertexArrayAndBuffer();
+		}
 	}
 
 	//Binds the VAO associated with this object
@@ -49,15 +57,53 @@ public:
 	//Draws the object
 	void Draw() {
 		BindVAO();
-		glDrawArrays(GL_TRIANGLES, 0, (Vertices.size() / numVertexAttributes));
+		glDrawArrays(GL_TRIANGLES, 0, VertexCount);
 	}
 
 	//De-allocates the resources associated with the VAO/VBO
 	void DeallocateVertexArrayBuffers() {
+		GetResourceRegistry().ReleaseBuffer(VBO);
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
 	}
 
+	//Frees the CPU copy of the vertices once the buffer holds them
+	void ReleaseVertices() {
+		if (VAO != 0) {
+			vector<float>().swap(Vertices);
+		}
+	}
+
+	//Generates the VAO and VBO for the object. Needs a current GL context, the constructor skips it when there is none (headless).
+	void GenerateVertexArrayAndBuffer() {
+
+		//Gen the vertex array
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+
+		//Gen and bind the buffer
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), &Vertices[0], GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(VBO, RESOURCE_VERTEX_BUFFER, Vertices.size() * sizeof(float), "Plane");
+
+		//Configure the Buffer Attributes
+
+		//Position (x, y, z)
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		// color attribute (r, g, b)
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		// normals attribute (x, y, z)
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		// texture attribute (U, V)
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
+		glEnableVertexAttribArray(3);
+
+	}
+
 private:
 
 	const int numVertexAttributes = 11;
@@ -102,35 +148,6 @@ private:
 		Vertices.push_back(v);
 	}
 
-	//Generates the VAO and VBO for the object
-	void GenerateVertexArrayAndBuffer() {
-
-		//Gen the vertex array
-		glGenVertexArrays(1, &VAO);
-		glBindVertexArray(VAO);
-
-		//Gen and bind the buffer
-		glGenBuffers(1, &VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), &Vertices[0], GL_STATIC_DRAW);
-
-		//Configure the Buffer Attributes
-
-		//Position (x, y, z)
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		// color attribute (r, g, b)
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-		// normals attribute (x, y, z)
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		// texture attribute (U, V)
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
-		glEnableVertexAttribArray(3);
-
-	}
-
 	//Generates a random color for the object's vertices
 	glm::vec3 GenerateRandomVertColor() {
 		//default colors for now, going to randomize since no shading.
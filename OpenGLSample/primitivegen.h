@@ -0,0 +1,61 @@
+#ifndef PRIMITIVEGEN_H
+#define PRIMITIVEGEN_H
+
+#include <glm/glm.hpp>
+#include "threadpool.h"
+
+#include <functional>
+
+using namespace std;
+
+//Floats per vertex of the primitive layout: position, color, normal, uv
+const int PRIMITIVE_VERTEX_FLOATS = 11;
+
+//Fewest vertices a generator hands to one thread, smaller meshes are written on the calling thread
+const int PRIMITIVE_PARALLEL_MIN_VERTICES = 16384;
+
+//Pool the generators split large meshes over, NULL generates everything on the calling thread (benchmarks)
+inline ThreadPool*& PrimitiveGenerationPool() {
+	static ThreadPool* pool = &ThreadPool::Shared();
+	return pool;
+}
+
+//Whether new Cylinders/Spheres keep their vertices in a CPU array. Without it (and with a GL context) both are generated
+//straight into their mapped buffers (vertex and index buffer for Cylinders) and keep no CPU arrays, for objects
+//nothing reads back on the CPU.
+inline bool& PrimitiveRetainsVertices() {
+	static bool retain = true;
+	return retain;
+}
+
+//Runs body(i) for i in [0, count). Every item writes verticesPerItem vertices into its own part of a preallocated buffer,
+//so items are independent and are split over the pool once there is enough work for more than one thread.
+inline void ParallelForPrimitive(int count, int verticesPerItem, const function<void(int)>& body) {
+	ThreadPool* pool = PrimitiveGenerationPool();
+	if (pool == NULL) {
+		for (int i = 0; i < count; i++) {
+			body(i);
+		}
+		return;
+	}
+	int grainSize = max(1, PRIMITIVE_PARALLEL_MIN_VERTICES / max(1, verticesPerItem));
+	pool->ParallelFor(0, count, body, grainSize);
+}
+
+//Writes one vertex at out and returns where the next one goes
+inline float* WritePrimitiveVertex(float* out, float x, float y, float z, const glm::vec3& color, const glm::vec3& normals, float u, float v) {
+	out[0] = x;
+	out[1] = y;
+	out[2] = z;
+	out[3] = color.r;
+	out[4] = color.g;
+	out[5] = color.b;
+	out[6] = normals.x;
+	out[7] = normals.y;
+	out[8] = normals.z;
+	out[9] = u;
+	out[10] = v;
+	return out + PRIMITIVE_VERTEX_FLOATS;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PROCEDURAL_H
+#define PROCEDURAL_H
+
+#include <glad/glad.h>
+#include "shader.h"
+#include "tessellation.h"
+
+//Vertices per grid cell, two triangles with no index buffer
+const int PROCEDURAL_VERTICES_PER_CELL = 6;
+
+//Core profile won't draw without a VAO bound, even when no attributes are read. One empty VAO serves every procedural draw.
+inline unsigned int GetEmptyVertexArray() {
+	static unsigned int emptyVAO = 0;
+	if (emptyVAO == 0) {
+		glGenVertexArrays(1, &emptyVAO);
+	}
+	return emptyVAO;
+}
+
+//Draws columns x rows cells of surfaceCount consecutive surfaces (TessSurface ids, shared with the tessellation path).
+//proceduralPrimitiveVertex.glsl builds every vertex from gl_VertexID, gl_InstanceID picks the surface.
+//The shader must be in use with the shape uniforms already set.
+inline void DrawProceduralSurfaces(Shader& shader, TessSurface firstSurface, int surfaceCount, int columns, int rows) {
+	shader.setInt("firstSurface", (int)firstSurface);
+	shader.setInt("gridColumns", columns);
+	shader.setInt("gridRows", rows);
+
+	glBindVertexArray(GetEmptyVertexArray());
+	glDrawArraysInstanced(GL_TRIANGLES, 0, PROCEDURAL_VERTICES_PER_CELL * columns * rows, surfaceCount);
+}
+
+#endif
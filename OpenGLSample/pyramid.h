@@ -3,6 +3,8 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "glcontext.h"
+#include "resourceregistry.h"
 
 #include <vector>
 #include <random>
@@ -41,7 +43,9 @@ public:
 		CalculateVertices();
 
 		//Generate the VAO/VBO
-		GenerateVertexArrayAndBuffer();
+		if (HasCurrentGLContext()) {
+			GenerateVertexArrayAndBuffer();
+		}
 	}
 
 	//Binds the VAO associated with this object
@@ -57,10 +61,41 @@ public:
 
 	//De-allocates the resources associated with the VAO/VBO
 	void DeallocateVertexArrayBuffers() {
+		GetResourceRegistry().ReleaseBuffer(VBO);
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
 	}
 
+	//Generates the VAO and VBO for the object. Needs a current GL context, the constructor skips it when there is none (headless).
+	void GenerateVertexArrayAndBuffer() {
+
+		//Gen the vertex array
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+
+		//Gen and bind the buffer
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), &Vertices[0], GL_STATIC_DRAW);
+		GetResourceRegistry().TrackBuffer(VBO, RESOURCE_VERTEX_BUFFER, Vertices.size() * sizeof(float), "Pyramid");
+
+		//Configure the Buffer Attributes
+
+		//Position (x, y, z)
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		// color attribute (r, g, b)
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		// normals attribute (x, y, z)
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		// texture attribute (U, V)
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
+		glEnableVertexAttribArray(3);
+
+	}
+
 private:
 
 	const int numVertexAttributes = 11;
@@ -181,35 +216,6 @@ private:
 		Vertices.push_back(v);
 	}
 
-	//Generates the VAO and VBO for the object
-	void GenerateVertexArrayAndBuffer() {
-
-		//Gen the vertex array
-		glGenVertexArrays(1, &VAO);
-		glBindVertexArray(VAO);
-
-		//Gen and bind the buffer
-		glGenBuffers(1, &VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), &Vertices[0], GL_STATIC_DRAW);
-
-		//Configure the Buffer Attributes
-
-		//Position (x, y, z)
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		// color attribute (r, g, b)
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-		// normals attribute (x, y, z)
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		// texture attribute (U, V)
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
-		glEnableVertexAttribArray(3);
-
-	}
-
 	//Generates a random color for the object's vertices
 	glm::vec3 GenerateRandomVertColor() {
 		//default colors for now, going to randomize since no shading.
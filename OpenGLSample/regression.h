@@ -0,0 +1,353 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "camera.h"
+#include "scene.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Regression suites (.regression), one statement per line like a scene file, # starts a comment:
+*   golden    <directory>               golden images, relative to the suite file, one <pose>.ppm each
+*   tolerance <difference> <percent>    pixels may differ perceptually by up to <difference> (0-255), <percent> of them by more
+*   budget    <cpu ms> <draw calls>     per frame, the CPU time averaged over a pose's timed frames
+*   frames    <count>                   frames rendered per pose, the first one settles LOD hysteresis and isn't timed
+*   pose      <name> <x y z> <yaw> <pitch> [<cpu ms> <draw calls>]
+*
+* A pose with budgets of its own is held to those instead of the suite's, views differ too much in cost for one
+* number to catch a slowdown in the cheap ones.
+*
+* Frames are compared after a box filter shrinks them by REGRESSION_DOWNSAMPLE, which keeps the goldens small and lets
+* an edge land a pixel over without failing. The difference is the weighted "redmean" RGB distance, which follows
+* what the eye notices far better than a plain per channel difference for the cost of a square root.
+*/
+
+const int REGRESSION_DOWNSAMPLE = 4;
+const int REGRESSION_DEFAULT_FRAMES = 10;
+
+struct RegressionPose {
+	string Name;
+	glm::vec3 Position = glm::vec3(0.0f);
+	float Yaw = -90.0f;
+	float Pitch = 0.0f;
+	float BudgetMs = -1.0f;		//Below 0 for the suite's budget
+	int BudgetDrawCalls = -1;	//Below 0 for the suite's budget
+};
+
+struct RegressionSuite {
+	string GoldenDirectory;
+	float Tolerance = 8.0f;
+	float MaxPercentOver = 0.5f;
+	float BudgetMs = 0.0f;		//0 for no budget
+	int BudgetDrawCalls = 0;	//0 for no budget
+	int Frames = REGRESSION_DEFAULT_FRAMES;
+	vector<RegressionPose> Poses;
+};
+
+//8 bit RGB, top row first
+struct RegressionImage {
+	int Width = 0;
+	int Height = 0;
+	vector<unsigned char> Pixels;
+};
+
+struct RegressionDiff {
+	float MaxDifference = 0.0f;
+	float MeanDifference = 0.0f;
+	float PercentOver = 0.0f;
+};
+
+//Loads a suite, golden paths are made relative to the suite file
+inline bool LoadRegressionSuite(const string& path, RegressionSuite& suite) {
+	ifstream file(path.c_str());
+	if (!file) {
+		cout << "ERROR::REGRESSION::FILE_NOT_SUCCESSFULLY_READ " << path << endl;
+		return false;
+	}
+
+	size_t slash = path.find_last_of("/\\");
+	string directory = slash == string::npos ? string() : path.substr(0, slash + 1);
+
+	suite = RegressionSuite();
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+		vector<string> tokens = TokenizeSceneLine(line);
+		if (tokens.empty()) {
+			continue;
+		}
+
+		//Every statement has a fixed number of values, the pose name is the only word among them. A pose may add its budgets.
+		const string& keyword = tokens[0];
+		size_t expected = keyword == "golden" ? 2 : keyword == "tolerance" || keyword == "budget" ? 3 : keyword == "frames" ? 2 : keyword == "pose" ? 7 : 0;
+		if (keyword == "pose" && tokens.size() == 9) {
+			expected = 9;
+		}
+		if (expected == 0 || tokens.size() != expected) {
+			cout << "ERROR::REGRESSION::PARSE " << path << " LINE " << lineNumber << ": "
+				<< (expected == 0 ? "unknown statement " + keyword : keyword == "pose" ? string("expected 6 or 8 values") : "expected " + to_string(expected - 1) + " values") << endl;
+			return false;
+		}
+		vector<float> numbers;
+		for (size_t i = (keyword == "pose" ? 2 : 1); i < tokens.size() && keyword != "golden"; i++) {
+			char* end = NULL;
+			numbers.push_back((float)strtod(tokens[i].c_str(), &end));
+			if (end == tokens[i].c_str() || *end != '\0') {
+				cout << "ERROR::REGRESSION::PARSE " << path << " LINE " << lineNumber << ": expected a number, got " << tokens[i] << endl;
+				return false;
+			}
+		}
+
+		if (keyword == "golden") {
+			suite.GoldenDirectory = directory + tokens[1];
+			if (!suite.GoldenDirectory.empty() && suite.GoldenDirectory.back() != '/' && suite.GoldenDirectory.back() != '\\') {
+				suite.GoldenDirectory += '/';
+			}
+		}
+		else if (keyword == "tolerance") {
+			suite.Tolerance = numbers[0];
+			suite.MaxPercentOver = numbers[1];
+		}
+		else if (keyword == "budget") {
+			suite.BudgetMs = numbers[0];
+			suite.BudgetDrawCalls = (int)numbers[1];
+		}
+		else if (keyword == "frames") {
+			suite.Frames = max(2, (int)numbers[0]);
+		}
+		else {
+			RegressionPose pose;
+			pose.Name = tokens[1];
+			pose.Position = glm::vec3(numbers[0], numbers[1], numbers[2]);
+			pose.Yaw = numbers[3];
+			pose.Pitch = numbers[4];
+			if (numbers.size() == 7) {
+				pose.BudgetMs = numbers[5];
+				pose.BudgetDrawCalls = (int)numbers[6];
+			}
+			suite.Poses.push_back(pose);
+		}
+	}
+
+	if (suite.Poses.empty()) {
+		cout << "ERROR::REGRESSION::PARSE " << path << " has no poses" << endl;
+		return false;
+	}
+	return true;
+}
+
+//Binary PPM, the same format the software renderer writes
+inline bool ReadRegressionImage(const string& path, RegressionImage& image) {
+	ifstream file(path.c_str(), ios::binary);
+	string magic;
+	int maxValue = 0;
+	file >> magic >> image.Width >> image.Height >> maxValue;
+	if (!file || magic != "P6" || maxValue != 255 || image.Width <= 0 || image.Height <= 0) {
+		return false;
+	}
+	file.get();
+	image.Pixels.resize((size_t)image.Width * image.Height * 3);
+	file.read((char*)image.Pixels.data(), image.Pixels.size());
+	return (bool)file;
+}
+
+inline bool WriteRegressionImage(const string& path, const RegressionImage& image) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file) {
+		cout << "ERROR::REGRESSION::COULD_NOT_WRITE::" << path << endl;
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", image.Width, image.Height);
+	fwrite(image.Pixels.data(), 1, image.Pixels.size(), file);
+	fclose(file);
+	return true;
+}
+
+//Reads the back buffer of the current context, call before the swap
+inline RegressionImage ReadFramebufferImage(int width, int height) {
+	RegressionImage image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 3);
+
+	vector<unsigned char> rows(image.Pixels.size());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rows.data());
+
+	//GL reads bottom row first
+	size_t rowBytes = (size_t)width * 3;
+	for (int y = 0; y < height; y++) {
+		memcpy(&image.Pixels[y * rowBytes], &rows[(height - 1 - y) * rowBytes], rowBytes);
+	}
+	return image;
+}
+
+//Box filter, the edges that don't fill a whole box are dropped
+inline RegressionImage DownsampleRegressionImage(const RegressionImage& image, int factor) {
+	RegressionImage result;
+	result.Width = image.Width / factor;
+	result.Height = image.Height / factor;
+	result.Pixels.resize((size_t)result.Width * result.Height * 3);
+
+	for (int y = 0; y < result.Height; y++) {
+		for (int x = 0; x < result.Width; x++) {
+			for (int c = 0; c < 3; c++) {
+				int sum = 0;
+				for (int sy = 0; sy < factor; sy++) {
+					for (int sx = 0; sx < factor; sx++) {
+						sum += image.Pixels[((size_t)(y * factor + sy) * image.Width + x * factor + sx) * 3 + c];
+					}
+				}
+				result.Pixels[((size_t)y * result.Width + x) * 3 + c] = (unsigned char)((sum + factor * factor / 2) / (factor * factor));
+			}
+		}
+	}
+	return result;
+}
+
+//Redmean distance scaled so that black against white is 255
+inline float RegressionPixelDifference(const unsigned char* a, const unsigned char* b) {
+	float meanRed = (a[0] + b[0]) * 0.5f;
+	float red = (float)a[0] - b[0];
+	float green = (float)a[1] - b[1];
+	float blue = (float)a[2] - b[2];
+	float distance = sqrt((2.0f + meanRed / 256.0f) * red * red + 4.0f * green * green + (2.0f + (255.0f - meanRed) / 256.0f) * blue * blue);
+	return distance / 3.0f;
+}
+
+inline RegressionDiff CompareRegressionImages(const RegressionImage& golden, const RegressionImage& frame, float tolerance) {
+	RegressionDiff diff;
+	size_t pixels = (size_t)golden.Width * golden.Height;
+	size_t over = 0;
+	double sum = 0.0;
+	for (size_t i = 0; i < pixels; i++) {
+		float difference = RegressionPixelDifference(&golden.Pixels[i * 3], &frame.Pixels[i * 3]);
+		diff.MaxDifference = max(diff.MaxDifference, difference);
+		sum += difference;
+		if (difference > tolerance) {
+			over++;
+		}
+	}
+	diff.MeanDifference = pixels > 0 ? (float)(sum / pixels) : 0.0f;
+	diff.PercentOver = pixels > 0 ? 100.0f * over / pixels : 0.0f;
+	return diff;
+}
+
+//Walks the render loop through a suite: the pose for every frame, then the checks once a pose's last frame is drawn
+class RegressionRun
+{
+public:
+	RegressionSuite Suite;
+
+	//Writes the goldens instead of comparing against them, the budgets are still checked
+	bool UpdateGolden = false;
+
+	int Failures = 0;
+
+	RegressionRun(const RegressionSuite& suite, bool updateGolden) : Suite(suite), UpdateGolden(updateGolden) {}
+
+	bool Finished() const {
+		return pose >= Suite.Poses.size();
+	}
+
+	//Puts the camera on the current pose, every frame so input can't move it
+	void ApplyPose(Camera& camera) const {
+		const RegressionPose& current = Suite.Poses[pose];
+		camera = Camera(current.Position, glm::vec3(0.0f, 1.0f, 0.0f), current.Yaw, current.Pitch);
+	}
+
+	//True on the frame whose image is checked
+	bool IsCaptureFrame() const {
+		return frame == Suite.Frames - 1;
+	}
+
+	//Adds the frame's CPU time and draw calls, capture is the back buffer on the capture frame. True once the suite is done.
+	bool EndFrame(double cpuMs, int drawCalls, const RegressionImage* capture) {
+		if (frame > 0) {
+			frameMs += cpuMs;
+			maxDrawCalls = max(maxDrawCalls, drawCalls);
+		}
+		if (IsCaptureFrame() && capture) {
+			CheckPose(*capture);
+			pose++;
+			frame = 0;
+			frameMs = 0.0;
+			maxDrawCalls = 0;
+		}
+		else {
+			frame++;
+		}
+
+		if (Finished()) {
+			cout << "REGRESSION::" << (Failures == 0 ? "PASSED" : "FAILED") << "::" << Suite.Poses.size() - Failures << " OF " << Suite.Poses.size() << " POSES" << endl;
+		}
+		return Finished();
+	}
+
+private:
+	size_t pose = 0;
+	int frame = 0;
+	double frameMs = 0.0;
+	int maxDrawCalls = 0;
+
+	void CheckPose(const RegressionImage& capture) {
+		const RegressionPose& current = Suite.Poses[pose];
+		string goldenPath = Suite.GoldenDirectory + current.Name + ".ppm";
+		RegressionImage image = DownsampleRegressionImage(capture, REGRESSION_DOWNSAMPLE);
+		double meanMs = frameMs / (Suite.Frames - 1);
+
+		bool passed = true;
+		ostringstream result;
+		result << "REGRESSION::" << current.Name;
+
+		if (UpdateGolden) {
+			passed = WriteRegressionImage(goldenPath, image);
+			result << "::GOLDEN WRITTEN";
+		}
+		else {
+			RegressionImage golden;
+			if (!ReadRegressionImage(goldenPath, golden)) {
+				passed = false;
+				result << "::GOLDEN MISSING " << goldenPath;
+			}
+			else if (golden.Width != image.Width || golden.Height != image.Height) {
+				passed = false;
+				result << "::GOLDEN SIZE " << golden.Width << "x" << golden.Height << " FRAME " << image.Width << "x" << image.Height;
+			}
+			else {
+				RegressionDiff diff = CompareRegressionImages(golden, image, Suite.Tolerance);
+				bool imagePassed = diff.PercentOver <= Suite.MaxPercentOver;
+				passed = passed && imagePassed;
+				result << "::IMAGE " << (imagePassed ? "OK" : "DIFFERS") << " (MAX " << diff.MaxDifference << " MEAN " << diff.MeanDifference
+					<< " " << diff.PercentOver << "% OVER " << Suite.Tolerance << ")";
+			}
+		}
+
+		float budgetMs = current.BudgetMs >= 0.0f ? current.BudgetMs : Suite.BudgetMs;
+		int budgetDrawCalls = current.BudgetDrawCalls >= 0 ? current.BudgetDrawCalls : Suite.BudgetDrawCalls;
+		bool timePassed = budgetMs <= 0.0f || meanMs <= budgetMs;
+		bool drawsPassed = budgetDrawCalls <= 0 || maxDrawCalls <= budgetDrawCalls;
+		passed = passed && timePassed && drawsPassed;
+		result << "::CPU " << meanMs << "ms" << (timePassed ? "" : " OVER BUDGET") << "::DRAWS " << maxDrawCalls << (drawsPassed ? "" : " OVER BUDGET");
+
+		if (!passed) {
+			Failures++;
+		}
+		cout << result.str() << "::" << (passed ? "PASS" : "FAIL") << endl;
+	}
+};
+
+#endif
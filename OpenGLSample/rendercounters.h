@@ -0,0 +1,18 @@
+#ifndef RENDERCOUNTERS_H
+#define RENDERCOUNTERS_H
+
+//Work the CPU handed to GL during a frame, reset by the caller every frame. Triangles are counted by the GPU instead
+//(see hud.h), the tessellation and procedural paths make them where the CPU can't see.
+struct RenderCounters {
+	int DrawCalls = 0;
+	int TextureBinds = 0;
+	int UniformUploads = 0;		//Shader setters and uniform block ranges
+	int Objects = 0;			//Objects submitted on the per-object path
+};
+
+inline RenderCounters& GetRenderCounters() {
+	static RenderCounters counters;
+	return counters;
+}
+
+#endif
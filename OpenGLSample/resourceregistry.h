@@ -0,0 +1,452 @@
+#ifndef RESOURCEREGISTRY_H
+#define RESOURCEREGISTRY_H
+
+#include <glad/glad.h>
+#include "mipchain.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Memory accounting. Whoever creates a GL buffer or texture records its size here (textures with their whole mip
+* chain) and releases it when deleting it, CPU side copies are recorded as named totals. Textures that can be rebuilt
+* from a smaller mip are evictable: once their total goes over the budget the least recently bound ones are cut down
+* a level at a time, every level moving up one so the chain keeps the filter that made it, until the total fits. The
+* levels are moved by copies on the GPU, so evicting never waits on the GL; contexts older than 4.3 rebuild the
+* smaller chain from the source image instead. An evicted texture with a source image gets its top level back from
+* the image once it is bound again and the budget has room for it.
+*/
+
+//Kinds of memory, GPU ones first
+enum ResourceCategory {
+	RESOURCE_VERTEX_BUFFER,
+	RESOURCE_INDEX_BUFFER,
+	RESOURCE_UNIFORM_BUFFER,	//Material table and the streaming ring
+	RESOURCE_DRAW_BUFFER,		//Indirect commands and per draw storage
+	RESOURCE_TEXTURE,
+	RESOURCE_CPU_VERTICES,		//Vertex and index copies kept in memory
+	RESOURCE_CPU_OTHER,
+	RESOURCE_CATEGORY_COUNT
+};
+
+const char* const RESOURCE_CATEGORY_NAMES[RESOURCE_CATEGORY_COUNT] = { "VERTEX BUFFERS", "INDEX BUFFERS", "UNIFORM BUFFERS", "DRAW BUFFERS", "TEXTURES", "CPU VERTICES", "CPU OTHER" };
+
+inline bool IsGPUResourceCategory(ResourceCategory category) {
+	return category < RESOURCE_CPU_VERTICES;
+}
+
+//Evictions a single frame may do, each copies the levels below the top up one (or reloads them from the image)
+const int RESOURCE_MAX_EVICTIONS_PER_FRAME = 8;
+
+//Evicted textures stop shrinking at this size on their longer side
+const int RESOURCE_MIN_EVICTED_SIZE = 16;
+
+//Levels a single frame may bring back, each reloads the image's level (from the mip cache with CPU mips)
+const int RESOURCE_MAX_RESTORES_PER_FRAME = 1;
+
+struct TrackedBuffer {
+	ResourceCategory Category = RESOURCE_VERTEX_BUFFER;
+	size_t Bytes = 0;
+	string Label;
+};
+
+struct TrackedTexture {
+	size_t Bytes = 0;
+	string Label;
+	int Width = 0, Height = 0;	//Of the current level 0
+	int Layers = 1;
+	int BytesPerTexel = 4;
+	bool Mipmapped = true;
+	bool Evictable = false;		//GL_TEXTURE_2D with RGB/RGBA bytes and a full mip chain
+	int Channels = 4;
+	int DroppedLevels = 0;		//Levels evicted so far
+	long long LastUsedFrame = 0;
+	bool HasSource = false;		//Source set, evicted levels can be restored
+	MipChainRequest Source;		//FirstLevel is the image level of level 0 before any eviction
+	int ImageWidth = 0, ImageHeight = 0;
+};
+
+//Bytes of a width x height texture and, when mipmapped, every level below it
+inline size_t TextureBytesWithMips(int width, int height, int layers, int bytesPerTexel, bool mipmapped) {
+	size_t bytes = 0;
+	do {
+		bytes += (size_t)width * height * layers * bytesPerTexel;
+		if (width == 1 && height == 1) {
+			break;
+		}
+		width = max(1, width / 2);
+		height = max(1, height / 2);
+	} while (mipmapped);
+	return bytes;
+}
+
+class ResourceRegistry
+{
+public:
+	//Evictable texture bytes allowed, 0 for no limit
+	size_t TextureBudget = 0;
+
+	//Levels dropped and brought back since the start
+	int Evictions = 0;
+	int Restores = 0;
+
+	void TrackBuffer(GLuint buffer, ResourceCategory category, size_t bytes, const string& label) {
+		if (buffer == 0) {
+			return;
+		}
+		TrackedBuffer& tracked = buffers[buffer]; //A name given new storage replaces its old size
+		tracked.Category = category;
+		tracked.Bytes = bytes;
+		tracked.Label = label;
+	}
+
+	void ReleaseBuffer(GLuint buffer) {
+		buffers.erase(buffer);
+	}
+
+	//A texture's storage. Uploads of unsized RGB are counted as 4 bytes a texel, the padding drivers store them with.
+	void TrackTexture(GLuint texture, int width, int height, int layers, int bytesPerTexel, bool mipmapped, const string& label, bool evictable = false, int channels = 4) {
+		if (texture == 0) {
+			return;
+		}
+		TrackedTexture& tracked = textures[texture];
+		tracked = TrackedTexture();
+		tracked.Label = label;
+		tracked.Width = width;
+		tracked.Height = height;
+		tracked.Layers = layers;
+		tracked.BytesPerTexel = bytesPerTexel;
+		tracked.Mipmapped = mipmapped;
+		tracked.Evictable = evictable && mipmapped && layers == 1;
+		tracked.Channels = channels;
+		tracked.Bytes = TextureBytesWithMips(width, height, layers, bytesPerTexel, mipmapped);
+		tracked.LastUsedFrame = frame;
+	}
+
+	//The image an evictable texture was loaded from, so evicted levels can be reloaded. Its level request.FirstLevel
+	//is the texture's level 0.
+	void SetTextureSource(GLuint texture, const MipChainRequest& request, int imageWidth, int imageHeight) {
+		unordered_map<GLuint, TrackedTexture>::iterator found = textures.find(texture);
+		if (found == textures.end() || !found->second.Evictable) {
+			return;
+		}
+		found->second.HasSource = true;
+		found->second.Source = request;
+		found->second.ImageWidth = imageWidth;
+		found->second.ImageHeight = imageHeight;
+	}
+
+	void ReleaseTexture(GLuint texture) {
+		textures.erase(texture);
+	}
+
+	//A texture was bound for drawing this frame
+	void TouchTexture(GLuint texture) {
+		unordered_map<GLuint, TrackedTexture>::iterator found = textures.find(texture);
+		if (found != textures.end()) {
+			found->second.LastUsedFrame = frame;
+		}
+	}
+
+	//A named CPU total, replaces whatever was recorded under the label before
+	void SetCPUBytes(const string& label, ResourceCategory category, size_t bytes) {
+		CPUEntry& entry = cpuEntries[label];
+		entry.Category = category;
+		entry.Bytes = bytes;
+	}
+
+	size_t GetBytes(ResourceCategory category) const {
+		size_t bytes = 0;
+		for (const auto& buffer : buffers) {
+			if (buffer.second.Category == category) {
+				bytes += buffer.second.Bytes;
+			}
+		}
+		if (category == RESOURCE_TEXTURE) {
+			for (const auto& texture : textures) {
+				bytes += texture.second.Bytes;
+			}
+		}
+		for (const auto& entry : cpuEntries) {
+			if (entry.second.Category == category) {
+				bytes += entry.second.Bytes;
+			}
+		}
+		return bytes;
+	}
+
+	size_t GetGPUBytes() const {
+		size_t bytes = 0;
+		for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) {
+			if (IsGPUResourceCategory((ResourceCategory)i)) {
+				bytes += GetBytes((ResourceCategory)i);
+			}
+		}
+		return bytes;
+	}
+
+	size_t GetEvictableTextureBytes() const {
+		size_t bytes = 0;
+		for (const auto& texture : textures) {
+			if (texture.second.Evictable) {
+				bytes += texture.second.Bytes;
+			}
+		}
+		return bytes;
+	}
+
+	const unordered_map<GLuint, TrackedTexture>& GetTextures() const { return textures; }
+
+	//Call once per frame before drawing, starts the frame for the LRU and evicts down to the budget, or when nothing had
+	//to go restores levels of textures bound last frame that fit again
+	void BeginFrame() {
+		frame++;
+		if (EnforceTextureBudget(RESOURCE_MAX_EVICTIONS_PER_FRAME) == 0) {
+			RestoreEvictedTextures(RESOURCE_MAX_RESTORES_PER_FRAME);
+		}
+	}
+
+	//Drops top levels of the least recently used evictable textures until the budget holds or maxEvictions ran
+	int EnforceTextureBudget(int maxEvictions) {
+		int evicted = 0;
+		if (TextureBudget == 0) {
+			return evicted;
+		}
+		size_t bytes = GetEvictableTextureBytes();
+		while (bytes > TextureBudget && evicted < maxEvictions) {
+			GLuint victim = 0;
+			const TrackedTexture* oldest = NULL;
+			for (const auto& texture : textures) {
+				const TrackedTexture& candidate = texture.second;
+				if (!candidate.Evictable || max(candidate.Width, candidate.Height) / 2 < RESOURCE_MIN_EVICTED_SIZE || (!GLAD_GL_VERSION_4_3 && !candidate.HasSource)) {
+					continue;
+				}
+				if (oldest == NULL || candidate.LastUsedFrame < oldest->LastUsedFrame || (candidate.LastUsedFrame == oldest->LastUsedFrame && candidate.Bytes > oldest->Bytes)) {
+					oldest = &candidate;
+					victim = texture.first;
+				}
+			}
+			if (oldest == NULL) {
+				if (!budgetUnreachableReported) {
+					cout << "ERROR::RESOURCES::TEXTURE_BUDGET_UNREACHABLE " << bytes / 1024 << "KB OVER " << TextureBudget / 1024 << "KB" << endl;
+					budgetUnreachableReported = true;
+				}
+				break;
+			}
+			size_t before = oldest->Bytes;
+			DropTopLevel(victim);
+			bytes = bytes - before + textures[victim].Bytes;
+			evicted++;
+		}
+		return evicted;
+	}
+
+	//Brings back the top level of textures bound last frame, most evicted first, while the budget has room for them
+	int RestoreEvictedTextures(int maxRestores) {
+		int restored = 0;
+		if (TextureBudget == 0) {
+			return restored;
+		}
+		size_t bytes = GetEvictableTextureBytes();
+		while (restored < maxRestores) {
+			GLuint chosen = 0;
+			const TrackedTexture* best = NULL;
+			for (const auto& texture : textures) {
+				const TrackedTexture& candidate = texture.second;
+				if (!candidate.HasSource || candidate.DroppedLevels == 0 || candidate.LastUsedFrame < frame - 1) {
+					continue;
+				}
+				if (best == NULL || candidate.DroppedLevels > best->DroppedLevels) {
+					best = &candidate;
+					chosen = texture.first;
+				}
+			}
+			if (best == NULL) {
+				break;
+			}
+			int level = best->Source.FirstLevel + best->DroppedLevels - 1;
+			size_t grown = TextureBytesWithMips(max(1, best->ImageWidth >> level), max(1, best->ImageHeight >> level), 1, best->BytesPerTexel, true);
+			if (bytes - best->Bytes + grown > TextureBudget) {
+				break;
+			}
+			size_t before = best->Bytes;
+			if (!RestoreTopLevel(chosen)) {
+				break;
+			}
+			bytes = bytes - before + textures[chosen].Bytes;
+			restored++;
+		}
+		return restored;
+	}
+
+	//Totals per category, and with detailed every resource largest first
+	void Report(bool detailed = false) const {
+		cout << "MEMORY::GPU " << GetGPUBytes() / 1024 << "KB";
+		for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) {
+			if (IsGPUResourceCategory((ResourceCategory)i)) {
+				cout << "::" << RESOURCE_CATEGORY_NAMES[i] << " " << GetBytes((ResourceCategory)i) / 1024 << "KB";
+			}
+		}
+		cout << endl;
+		cout << "MEMORY::CPU";
+		for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) {
+			if (!IsGPUResourceCategory((ResourceCategory)i)) {
+				cout << "::" << RESOURCE_CATEGORY_NAMES[i] << " " << GetBytes((ResourceCategory)i) / 1024 << "KB";
+			}
+		}
+		cout << endl;
+		if (TextureBudget > 0) {
+			cout << "MEMORY::TEXTURE BUDGET " << TextureBudget / 1024 << "KB::EVICTABLE " << GetEvictableTextureBytes() / 1024 << "KB::" << Evictions << " LEVELS EVICTED::" << Restores << " RESTORED" << endl;
+		}
+
+		if (!detailed) {
+			return;
+		}
+		//Buffers grouped by label, a scene has many of each primitive's
+		struct Line { size_t Bytes; string Text; };
+		vector<Line> lines;
+		unordered_map<string, pair<size_t, int>> bufferGroups;
+		for (const auto& buffer : buffers) {
+			pair<size_t, int>& group = bufferGroups[string(RESOURCE_CATEGORY_NAMES[buffer.second.Category]) + "::" + buffer.second.Label];
+			group.first += buffer.second.Bytes;
+			group.second++;
+		}
+		for (const auto& group : bufferGroups) {
+			lines.push_back({ group.second.first, group.first + " x" + to_string(group.second.second) });
+		}
+		for (const auto& texture : textures) {
+			const TrackedTexture& tracked = texture.second;
+			string size = to_string(tracked.Width) + "x" + to_string(tracked.Height) + (tracked.Layers > 1 ? "x" + to_string(tracked.Layers) : "");
+			string dropped = tracked.DroppedLevels > 0 ? " (" + to_string(tracked.DroppedLevels) + " LEVELS EVICTED)" : "";
+			lines.push_back({ tracked.Bytes, string(RESOURCE_CATEGORY_NAMES[RESOURCE_TEXTURE]) + "::" + tracked.Label + " " + size + dropped });
+		}
+		for (const auto& entry : cpuEntries) {
+			lines.push_back({ entry.second.Bytes, string(RESOURCE_CATEGORY_NAMES[entry.second.Category]) + "::" + entry.first });
+		}
+		sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.Bytes > b.Bytes; });
+		for (const Line& line : lines) {
+			cout << "MEMORY::" << line.Text << "::" << line.Bytes / 1024 << "KB" << endl;
+		}
+	}
+
+private:
+	struct CPUEntry {
+		ResourceCategory Category = RESOURCE_CPU_OTHER;
+		size_t Bytes = 0;
+	};
+
+	unordered_map<GLuint, TrackedBuffer> buffers;
+	unordered_map<GLuint, TrackedTexture> textures;
+	unordered_map<string, CPUEntry> cpuEntries;
+	long long frame = 0;
+	bool budgetUnreachableReported = false;
+
+	//Every level moved up one, so the chain keeps the filter that made it (GenerateMipChain's with CPU mips). Levels 1
+	//and down are copied on the GPU into a scratch chain, the texture is given the smaller sizes and they are copied
+	//back (a copy needs both textures complete, so the levels can't move in place). Nothing comes back to the CPU, so
+	//the GL is never waited on. The old smallest level is left past the end of the chain, unused. The name stays, so
+	//materials need no update. Without glCopyImageSubData (before 4.3) the chain is reloaded from the image instead.
+	bool DropTopLevel(GLuint texture) {
+		TrackedTexture& tracked = textures[texture];
+		if (!GLAD_GL_VERSION_4_3) {
+			if (!LoadLevelsFromSource(texture, tracked.DroppedLevels + 1)) {
+				return false;
+			}
+			Evictions++;
+			return true;
+		}
+
+		GLenum format = tracked.Channels == 4 ? GL_RGBA : GL_RGB;
+		vector<int> widths, heights;
+		int width = tracked.Width, height = tracked.Height;
+		while (width > 1 || height > 1) {
+			width = max(1, width / 2);
+			height = max(1, height / 2);
+			widths.push_back(width);
+			heights.push_back(height);
+		}
+
+		GLuint scratch = 0;
+		glGenTextures(1, &scratch);
+		glBindTexture(GL_TEXTURE_2D, scratch);
+		for (size_t i = 0; i < widths.size(); i++) {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, widths[i], heights[i], 0, format, GL_UNSIGNED_BYTE, NULL);
+		}
+		for (size_t i = 0; i < widths.size(); i++) {
+			glCopyImageSubData(texture, GL_TEXTURE_2D, (GLint)i + 1, 0, 0, 0, scratch, GL_TEXTURE_2D, (GLint)i, 0, 0, 0, widths[i], heights[i], 1);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		for (size_t i = 0; i < widths.size(); i++) {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, widths[i], heights[i], 0, format, GL_UNSIGNED_BYTE, NULL);
+		}
+		for (size_t i = 0; i < widths.size(); i++) {
+			glCopyImageSubData(scratch, GL_TEXTURE_2D, (GLint)i, 0, 0, 0, texture, GL_TEXTURE_2D, (GLint)i, 0, 0, 0, widths[i], heights[i], 1);
+		}
+		glDeleteTextures(1, &scratch);
+
+		SetTopLevel(tracked, max(1, tracked.Width / 2), max(1, tracked.Height / 2), tracked.DroppedLevels + 1);
+		Evictions++;
+		return true;
+	}
+
+	//The image's level above the current level 0 reloaded through LoadMipChain
+	bool RestoreTopLevel(GLuint texture) {
+		if (!LoadLevelsFromSource(texture, textures[texture].DroppedLevels - 1)) {
+			return false;
+		}
+		Restores++;
+		return true;
+	}
+
+	//Rebuilds the texture as its image with droppedLevels levels left out, the levels below the top from the mip cache
+	//(CPU mips) or the GL, the same way Texture2D made them. False, and no more tries, when the image is gone.
+	bool LoadLevelsFromSource(GLuint texture, int droppedLevels) {
+		TrackedTexture& tracked = textures[texture];
+		MipChainRequest request = tracked.Source;
+		request.FirstLevel = tracked.Source.FirstLevel + droppedLevels;
+		request.MaxSize = 0;
+		request.LevelCount = GetTextureQuality().CPUMips ? 0 : 1;
+		MipChain chain;
+		if (!LoadMipChain(request, chain) || chain.FirstLevel != request.FirstLevel || chain.Levels.empty()) {
+			cout << "ERROR::RESOURCES::TEXTURE_NOT_RELOADED " << tracked.Label << endl;
+			tracked.HasSource = false;
+			return false;
+		}
+
+		GLenum format = tracked.Channels == 4 ? GL_RGBA : GL_RGB;
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t i = 0; i < chain.Levels.size(); i++) {
+			int level = chain.FirstLevel + (int)i;
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, chain.LevelWidth(level), chain.LevelHeight(level), 0, format, GL_UNSIGNED_BYTE, chain.Levels[i].data());
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		if (chain.Levels.size() == 1) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+
+		SetTopLevel(tracked, chain.LevelWidth(chain.FirstLevel), chain.LevelHeight(chain.FirstLevel), droppedLevels);
+		return true;
+	}
+
+	//A new level 0, the bytes of its whole chain
+	static void SetTopLevel(TrackedTexture& tracked, int width, int height, int droppedLevels) {
+		tracked.Width = width;
+		tracked.Height = height;
+		tracked.DroppedLevels = droppedLevels;
+		tracked.Bytes = TextureBytesWithMips(tracked.Width, tracked.Height, 1, tracked.BytesPerTexel, true);
+	}
+};
+
+inline ResourceRegistry& GetResourceRegistry() {
+	static ResourceRegistry registry;
+	return registry;
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "glcontext.h"
+#include "rendercounters.h"
+#include "resourceregistry.h"
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+//glBufferStorage is GL 4.4 / ARB_buffer_storage, newer than the loader, so it is fetched by hand
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFN_RING_BUFFER_STORAGE)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+//Regions in the ring, the CPU writes one while the GPU may still read the other two
+const int RING_BUFFER_FRAMES_IN_FLIGHT = 3;
+
+//Default bytes per region, a frame of the scene uses a few KB
+const GLsizeiptr RING_BUFFER_DEFAULT_REGION_SIZE = 256 * 1024;
+
+//Streaming buffer for data rewritten every frame (transforms, lights, instance arrays).
+//One buffer split into N regions. A region is fenced at the end of its frame and only reused once that fence has passed,
+//so writes never touch memory the GPU could still be reading and the driver never has to stall or copy.
+//With buffer storage the whole buffer stays persistently mapped and coherent. Without it every allocation is mapped
+//unsynchronized and unmapped again, the fences still make that safe.
+class RingBuffer
+{
+public:
+	unsigned int Buffer = 0;
+	GLenum Target;
+
+	GLsizeiptr RegionSize;
+	int RegionCount;
+
+	//True when running on glBufferStorage with a persistent mapping
+	bool Persistent = false;
+
+	//Times BeginFrame had to wait for the GPU, and for how long in total
+	int FenceWaits = 0;
+	double FenceWaitMs = 0.0;
+
+	//Constructor: target the ranges will usually be bound to, size of one frame's region, number of frames in flight
+	RingBuffer(GLenum target = GL_UNIFORM_BUFFER, GLsizeiptr regionSize = RING_BUFFER_DEFAULT_REGION_SIZE, int regionCount = RING_BUFFER_FRAMES_IN_FLIGHT)
+	{
+		Target = target;
+		RegionSize = regionSize;
+		RegionCount = regionCount;
+		fences.assign(regionCount, (GLsync)0);
+
+		if (!HasCurrentGLContext()) {
+			return;
+		}
+
+		//Offsets handed out must suit glBindBufferRange on uniform/storage targets
+		GLint uniformAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		alignment = max((GLintptr)uniformAlignment, (GLintptr)16);
+		RegionSize = (RegionSize + alignment - 1) / alignment * alignment;
+
+		GLsizeiptr totalSize = RegionSize * RegionCount;
+
+		glGenBuffers(1, &Buffer);
+		glBindBuffer(Target, Buffer);
+
+		PFN_RING_BUFFER_STORAGE bufferStorage = NULL;
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		if (major * 10 + minor >= 44 || glfwExtensionSupported("GL_ARB_buffer_storage")) {
+			bufferStorage = (PFN_RING_BUFFER_STORAGE)glfwGetProcAddress("glBufferStorage");
+		}
+
+		if (bufferStorage != NULL) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			bufferStorage(Target, totalSize, NULL, flags);
+			mapped = (char*)glMapBufferRange(Target, 0, totalSize, flags);
+			Persistent = mapped != NULL;
+		}
+
+		if (!Persistent) {
+			//Fresh name, storage made with glBufferStorage is immutable
+			if (bufferStorage != NULL) {
+				glDeleteBuffers(1, &Buffer);
+				glGenBuffers(1, &Buffer);
+				glBindBuffer(Target, Buffer);
+			}
+			glBufferData(Target, totalSize, NULL, GL_STREAM_DRAW);
+		}
+		GetResourceRegistry().TrackBuffer(Buffer, Target == GL_UNIFORM_BUFFER ? RESOURCE_UNIFORM_BUFFER : RESOURCE_VERTEX_BUFFER, totalSize, "ring buffer");
+	}
+
+	//Call once per frame before any Map. Waits (only if the GPU is a full ring behind) for the region about to be reused.
+	void BeginFrame() {
+		region = (region + 1) % RegionCount;
+		offset = 0;
+		overflowReported = false;
+
+		GLsync& fence = fences[region];
+		if (fence == 0) {
+			return;
+		}
+
+		//Quick check first, most frames the fence has long passed
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms steps
+			} while (result == GL_TIMEOUT_EXPIRED);
+			FenceWaits++;
+			FenceWaitMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		}
+
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	//Call once per frame after the last draw that reads this frame's data
+	void EndFrame() {
+		if (Buffer == 0) {
+			return;
+		}
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	//Reserves size bytes in this frame's region and returns where to write them. outOffset is the offset in Buffer.
+	//Call Unmap once written (free when persistent). Running out of room is reported and the writes go to a scratch block.
+	void* Map(GLsizeiptr size, GLintptr& outOffset) {
+		GLintptr alignedOffset = (offset + alignment - 1) / alignment * alignment;
+		if (Buffer == 0 || alignedOffset + size > RegionSize) {
+			if (Buffer != 0 && !overflowReported) {
+				cout << "ERROR::RINGBUFFER::REGION_FULL " << RegionSize << " BYTES" << endl;
+				overflowReported = true;
+			}
+			scratch.resize((size_t)size);
+			outOffset = -1;
+			return &scratch[0];
+		}
+
+		offset = alignedOffset + size;
+		outOffset = region * RegionSize + alignedOffset;
+
+		if (Persistent) {
+			return mapped + outOffset;
+		}
+
+		//Unsynchronized is safe, the fence in BeginFrame already guarantees the GPU is done with this region
+		glBindBuffer(Target, Buffer);
+		return glMapBufferRange(Target, outOffset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	}
+
+	//Finishes the last Map, needed before drawing only when not persistent
+	void Unmap() {
+		if (!Persistent && Buffer != 0) {
+			glBindBuffer(Target, Buffer);
+			glUnmapBuffer(Target);
+		}
+	}
+
+	//Maps space for one T, and binds it as a uniform block range on bindingPoint
+	template <typename T>
+	T* MapUniformBlock(GLuint bindingPoint) {
+		GLintptr blockOffset;
+		T* block = (T*)Map(sizeof(T), blockOffset);
+		if (blockOffset >= 0) {
+			glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, Buffer, blockOffset, sizeof(T));
+		}
+		GetRenderCounters().UniformUploads++;
+		return block;
+	}
+
+	//Bytes used so far in this frame's region
+	GLsizeiptr GetFrameBytesUsed() const {
+		return offset;
+	}
+
+	//De-allocates the buffer and any fences still pending
+	void Deallocate() {
+		for (GLsync& fence : fences) {
+			if (fence != 0) {
+				glDeleteSync(fence);
+				fence = 0;
+			}
+		}
+		if (Buffer != 0) {
+			if (Persistent) {
+				glBindBuffer(Target, Buffer);
+				glUnmapBuffer(Target);
+			}
+			GetResourceRegistry().ReleaseBuffer(Buffer);
+			glDeleteBuffers(1, &Buffer);
+			Buffer = 0;
+		}
+	}
+
+private:
+	char* mapped = NULL;
+	GLintptr alignment = 256;
+
+	int region = -1;
+	GLintptr offset = 0;
+
+	vector<GLsync> fences;
+
+	vector<char> scratch;
+	bool overflowReported = false;
+};
+
+#endif
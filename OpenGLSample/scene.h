@@ -0,0 +1,949 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "glcontext.h"
+#include "plane.h"
+#include "cylinder.h"
+#include "sphere.h"
+#include "cube.h"
+#include "texture2d.h"
+#include "material.h"
+#include "texturestreaming.h"
+#include "threadpool.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Scene files
+*
+* Text (.scene), one statement per line, # starts a comment, names with spaces go in double quotes:
+*   texture   <name> <path> [alpha] [clampu] [clampv] [nomips] [noflip]
+*   material  <name> <diffuse> <specular> <shininess> [overlay <diffuse> <specular>]
+*   plane     <name> <x y z> <length> <width>
+*   cylinder  <name> <x y z> <radius> <height> <sides> <subdivisions> <top 0|1> <bottom 0|1> [flat] [topradius <r>] [axis x|y|z]
+*             (topradius 0 makes a cone, without it the top radius is the base radius)
+*   sphere    <name> <x y z> <radiusLong> <radiusLat> <sides> <semi 0|1>
+*   cube      <name> <x y z> <length> <width> <height>
+*   object    <name> <primitive> <material> [rotate <ax ay az degrees>] [translate <x y z>] [scale <s> | scale <x y z>] ...
+*             transforms apply in order, like the glm calls that build a model matrix
+*   dirlight  <dx dy dz> <ambient rgb> <diffuse rgb> <specular rgb>
+*   pointlight <x y z> <r g b> <constant linear quadratic> [<cube scale>]
+*   spotlight <cutoff degrees> <outer cutoff degrees> <constant linear quadratic>
+*   lightmesh <primitive>
+*
+* Binary (.sceneb) holds the same description with the transforms already multiplied out, written by SaveBinary.
+* LoadSceneDescription picks the format from the first bytes.
+*/
+
+//"SCNB" then a version
+const uint32_t SCENE_BINARY_MAGIC = 0x424E4353;
+const uint32_t SCENE_BINARY_VERSION = 2;
+
+enum ScenePrimitiveType {
+	SCENE_PLANE = 0,
+	SCENE_CYLINDER = 1,
+	SCENE_SPHERE = 2,
+	SCENE_CUBE = 3
+};
+
+struct SceneTextureDesc {
+	string Name;
+	string Path;
+	bool HasAlpha = false;
+	bool RepeatU = true;
+	bool RepeatV = true;
+	bool GenMipMaps = true;
+	bool FlipVertical = true;
+};
+
+//Indices into the texture list, -1 for no overlay
+struct SceneMaterialDesc {
+	string Name;
+	int Diffuse = -1;
+	int Specular = -1;
+	int OverlayDiffuse = -1;
+	int OverlaySpecular = -1;
+	float Shininess = 32.0f;
+};
+
+struct ScenePrimitiveDesc {
+	string Name;
+	ScenePrimitiveType Type = SCENE_CYLINDER;
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::vec3 Size = glm::vec3(1.0f); //plane (length, width), cylinder (radius, height, top radius or CYLINDER_SAME_RADIUS), sphere (radiusLong, radiusLat), cube (length, width, height)
+	int Sides = 8;
+	int SubDivisions = 1;
+	bool DrawTop = true;
+	bool DrawBottom = true;
+	bool SemiCircle = false;
+	bool Smooth = true; //Cylinder normals
+	int UpAxis = 2; //Cylinder axis, 1 = X, 2 = Y, 3 = Z
+};
+
+//One draw: a primitive with a material and a model matrix
+struct SceneObjectDesc {
+	string Name;
+	int Primitive = -1;
+	int Material = -1;
+	glm::mat4 Model = glm::mat4(1.0f);
+};
+
+struct SceneDirLightDesc {
+	bool Enabled = false;
+	glm::vec3 Direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec3 Ambient = glm::vec3(0.0f);
+	glm::vec3 Diffuse = glm::vec3(0.0f);
+	glm::vec3 Specular = glm::vec3(0.0f);
+};
+
+//Color is what the light cube shows
+struct ScenePointLightDesc {
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::vec3 Color = glm::vec3(1.0f);
+	glm::vec3 Attenuation = glm::vec3(1.0f, 0.0f, 0.0f); //Constant, linear, quadratic
+	float CubeScale = 1.0f;
+};
+
+struct SceneSpotLightDesc {
+	float CutOffDegrees = 15.5f;
+	float OuterCutOffDegrees = 20.0f;
+	glm::vec3 Attenuation = glm::vec3(1.0f, 0.09f, 0.032f);
+};
+
+struct SceneDescription {
+	vector<SceneTextureDesc> Textures;
+	vector<SceneMaterialDesc> Materials;
+	vector<ScenePrimitiveDesc> Primitives;
+	vector<SceneObjectDesc> Objects;
+	SceneDirLightDesc DirLight;
+	vector<ScenePointLightDesc> PointLights;
+	SceneSpotLightDesc SpotLight;
+	int LightMesh = -1; //Primitive drawn at every point light
+};
+
+/*
+* =====================
+* Text format
+* =====================
+*/
+
+//Splits a line into tokens, double quotes group words and # ends the line
+inline vector<string> TokenizeSceneLine(const string& line) {
+	vector<string> tokens;
+	size_t i = 0;
+	while (i < line.size()) {
+		if (isspace((unsigned char)line[i])) {
+			i++;
+		}
+		else if (line[i] == '#') {
+			break;
+		}
+		else if (line[i] == '"') {
+			size_t end = line.find('"', i + 1);
+			if (end == string::npos) {
+				end = line.size();
+			}
+			tokens.push_back(line.substr(i + 1, end - i - 1));
+			i = end + 1;
+		}
+		else {
+			size_t end = i;
+			while (end < line.size() && !isspace((unsigned char)line[end])) {
+				end++;
+			}
+			tokens.push_back(line.substr(i, end - i));
+			i = end;
+		}
+	}
+	return tokens;
+}
+
+//Reads statements token by token, the first problem is kept with its line number
+class SceneTextParser
+{
+public:
+	SceneDescription& Scene;
+	string Error;
+
+	SceneTextParser(SceneDescription& scene) : Scene(scene) {}
+
+	bool ParseLine(const string& line, int lineNumber) {
+		tokens = TokenizeSceneLine(line);
+		next = 0;
+		this->lineNumber = lineNumber;
+		if (tokens.empty()) {
+			return true;
+		}
+
+		string keyword = tokens[next++];
+		if (keyword == "texture") {
+			SceneTextureDesc texture;
+			texture.Name = Word();
+			texture.Path = Word();
+			while (Ok() && next < tokens.size()) {
+				string option = Word();
+				if (option == "alpha") texture.HasAlpha = true;
+				else if (option == "clampu") texture.RepeatU = false;
+				else if (option == "clampv") texture.RepeatV = false;
+				else if (option == "nomips") texture.GenMipMaps = false;
+				else if (option == "noflip") texture.FlipVertical = false;
+				else return Fail("unknown texture option " + option);
+			}
+			Scene.Textures.push_back(texture);
+		}
+		else if (keyword == "material") {
+			SceneMaterialDesc material;
+			material.Name = Word();
+			material.Diffuse = Find(Scene.Textures, Word(), "texture");
+			material.Specular = Find(Scene.Textures, Word(), "texture");
+			material.Shininess = Number();
+			if (Ok() && next < tokens.size()) {
+				if (Word() != "overlay") {
+					return Fail("expected overlay");
+				}
+				material.OverlayDiffuse = Find(Scene.Textures, Word(), "texture");
+				material.OverlaySpecular = Find(Scene.Textures, Word(), "texture");
+			}
+			Scene.Materials.push_back(material);
+		}
+		else if (keyword == "plane" || keyword == "cylinder" || keyword == "sphere" || keyword == "cube") {
+			ScenePrimitiveDesc primitive;
+			primitive.Name = Word();
+			primitive.Position = Vector();
+			if (keyword == "plane") {
+				primitive.Type = SCENE_PLANE;
+				primitive.Size = Pair();
+			}
+			else if (keyword == "cylinder") {
+				primitive.Type = SCENE_CYLINDER;
+				primitive.Size = Pair();
+				primitive.Size.z = CYLINDER_SAME_RADIUS;
+				primitive.Sides = (int)Number();
+				primitive.SubDivisions = (int)Number();
+				primitive.DrawTop = Number() != 0.0f;
+				primitive.DrawBottom = Number() != 0.0f;
+				while (Ok() && next < tokens.size()) {
+					string option = Word();
+					if (option == "flat") primitive.Smooth = false;
+					else if (option == "topradius") {
+						primitive.Size.z = Number();
+						if (primitive.Size.z < 0.0f) {
+							return Fail("negative top radius");
+						}
+					}
+					else if (option == "axis") {
+						string axis = Word();
+						if (axis == "x") primitive.UpAxis = 1;
+						else if (axis == "y") primitive.UpAxis = 2;
+						else if (axis == "z") primitive.UpAxis = 3;
+						else return Fail("unknown axis " + axis);
+					}
+					else return Fail("unknown cylinder option " + option);
+				}
+			}
+			else if (keyword == "sphere") {
+				primitive.Type = SCENE_SPHERE;
+				primitive.Size = Pair();
+				primitive.Sides = (int)Number();
+				primitive.SemiCircle = Number() != 0.0f;
+			}
+			else {
+				primitive.Type = SCENE_CUBE;
+				primitive.Size = Vector();
+			}
+			Scene.Primitives.push_back(primitive);
+		}
+		else if (keyword == "object") {
+			SceneObjectDesc object;
+			object.Name = Word();
+			object.Primitive = Find(Scene.Primitives, Word(), "primitive");
+			object.Material = Find(Scene.Materials, Word(), "material");
+			while (Ok() && next < tokens.size()) {
+				string transform = Word();
+				if (transform == "rotate") {
+					glm::vec3 axis = Vector();
+					object.Model = glm::rotate(object.Model, glm::radians(Number()), axis);
+				}
+				else if (transform == "translate") {
+					object.Model = glm::translate(object.Model, Vector());
+				}
+				else if (transform == "scale") {
+					float x = Number();
+					//One value scales uniformly
+					if (next + 1 < tokens.size() && IsNumber(tokens[next]) && IsNumber(tokens[next + 1])) {
+						float y = Number();
+						object.Model = glm::scale(object.Model, glm::vec3(x, y, Number()));
+					}
+					else {
+						object.Model = glm::scale(object.Model, glm::vec3(x));
+					}
+				}
+				else {
+					return Fail("unknown transform " + transform);
+				}
+			}
+			Scene.Objects.push_back(object);
+		}
+		else if (keyword == "dirlight") {
+			Scene.DirLight.Enabled = true;
+			Scene.DirLight.Direction = Vector();
+			Scene.DirLight.Ambient = Vector();
+			Scene.DirLight.Diffuse = Vector();
+			Scene.DirLight.Specular = Vector();
+		}
+		else if (keyword == "pointlight") {
+			ScenePointLightDesc light;
+			light.Position = Vector();
+			light.Color = Vector();
+			light.Attenuation = Vector();
+			if (Ok() && next < tokens.size()) {
+				light.CubeScale = Number();
+			}
+			Scene.PointLights.push_back(light);
+		}
+		else if (keyword == "spotlight") {
+			Scene.SpotLight.CutOffDegrees = Number();
+			Scene.SpotLight.OuterCutOffDegrees = Number();
+			Scene.SpotLight.Attenuation = Vector();
+		}
+		else if (keyword == "lightmesh") {
+			Scene.LightMesh = Find(Scene.Primitives, Word(), "primitive");
+		}
+		else {
+			return Fail("unknown statement " + keyword);
+		}
+
+		if (Ok() && next < tokens.size()) {
+			return Fail("unexpected " + tokens[next]);
+		}
+		return Ok();
+	}
+
+private:
+	vector<string> tokens;
+	size_t next = 0;
+	int lineNumber = 0;
+
+	bool Ok() const {
+		return Error.empty();
+	}
+
+	bool Fail(const string& message) {
+		if (Error.empty()) {
+			Error = "LINE " + to_string(lineNumber) + ": " + message;
+		}
+		return false;
+	}
+
+	static bool IsNumber(const string& token) {
+		char* end = NULL;
+		strtod(token.c_str(), &end);
+		return end != token.c_str() && *end == '\0';
+	}
+
+	string Word() {
+		if (next >= tokens.size()) {
+			Fail("missing value");
+			return string();
+		}
+		return tokens[next++];
+	}
+
+	float Number() {
+		string token = Word();
+		if (!Ok()) {
+			return 0.0f;
+		}
+		if (!IsNumber(token)) {
+			Fail("expected a number, got " + token);
+			return 0.0f;
+		}
+		return (float)atof(token.c_str());
+	}
+
+	//Two numbers in order, the third component zero
+	glm::vec3 Pair() {
+		float x = Number();
+		return glm::vec3(x, Number(), 0.0f);
+	}
+
+	glm::vec3 Vector() {
+		float x = Number();
+		float y = Number();
+		return glm::vec3(x, y, Number());
+	}
+
+	template <typename T>
+	int Find(const vector<T>& items, const string& name, const char* kind) {
+		if (!Ok()) {
+			return -1;
+		}
+		for (size_t i = 0; i < items.size(); i++) {
+			if (items[i].Name == name) {
+				return (int)i;
+			}
+		}
+		Fail(string("unknown ") + kind + " " + name);
+		return -1;
+	}
+};
+
+/*
+* =====================
+* Binary format
+* =====================
+*/
+
+class SceneBinaryWriter
+{
+public:
+	vector<char> Data;
+
+	template <typename T>
+	void Write(const T& value) {
+		const char* bytes = (const char*)&value;
+		Data.insert(Data.end(), bytes, bytes + sizeof(T));
+	}
+
+	void WriteString(const string& value) {
+		Write((uint32_t)value.size());
+		Data.insert(Data.end(), value.begin(), value.end());
+	}
+};
+
+class SceneBinaryReader
+{
+public:
+	SceneBinaryReader(const vector<char>& data) : data(data) {}
+
+	//False once anything read past the end
+	bool Ok = true;
+
+	template <typename T>
+	T Read() {
+		T value = T();
+		if (offset + sizeof(T) > data.size()) {
+			Ok = false;
+			return value;
+		}
+		memcpy(&value, &data[offset], sizeof(T));
+		offset += sizeof(T);
+		return value;
+	}
+
+	string ReadString() {
+		uint32_t length = Read<uint32_t>();
+		if (!Ok || offset + length > data.size()) {
+			Ok = false;
+			return string();
+		}
+		string value(&data[offset], length);
+		offset += length;
+		return value;
+	}
+
+	//Element counts are checked against the bytes left so a corrupt file can't ask for huge allocations
+	uint32_t ReadCount(size_t minimumElementSize) {
+		uint32_t count = Read<uint32_t>();
+		if (!Ok || (size_t)count * minimumElementSize > data.size() - offset) {
+			Ok = false;
+			return 0;
+		}
+		return count;
+	}
+
+private:
+	const vector<char>& data;
+	size_t offset = 0;
+};
+
+//Writes a description in the binary form
+inline bool SaveSceneBinary(const SceneDescription& scene, const string& path) {
+	SceneBinaryWriter writer;
+	writer.Write(SCENE_BINARY_MAGIC);
+	writer.Write(SCENE_BINARY_VERSION);
+
+	writer.Write((uint32_t)scene.Textures.size());
+	for (const SceneTextureDesc& texture : scene.Textures) {
+		writer.WriteString(texture.Name);
+		writer.WriteString(texture.Path);
+		uint8_t flags = (texture.HasAlpha ? 1 : 0) | (texture.RepeatU ? 2 : 0) | (texture.RepeatV ? 4 : 0) | (texture.GenMipMaps ? 8 : 0) | (texture.FlipVertical ? 16 : 0);
+		writer.Write(flags);
+	}
+
+	writer.Write((uint32_t)scene.Materials.size());
+	for (const SceneMaterialDesc& material : scene.Materials) {
+		writer.WriteString(material.Name);
+		writer.Write((int32_t)material.Diffuse);
+		writer.Write((int32_t)material.Specular);
+		writer.Write((int32_t)material.OverlayDiffuse);
+		writer.Write((int32_t)material.OverlaySpecular);
+		writer.Write(material.Shininess);
+	}
+
+	writer.Write((uint32_t)scene.Primitives.size());
+	for (const ScenePrimitiveDesc& primitive : scene.Primitives) {
+		writer.WriteString(primitive.Name);
+		writer.Write((uint8_t)primitive.Type);
+		writer.Write(primitive.Position);
+		writer.Write(primitive.Size);
+		writer.Write((int32_t)primitive.Sides);
+		writer.Write((int32_t)primitive.SubDivisions);
+		uint8_t flags = (primitive.DrawTop ? 1 : 0) | (primitive.DrawBottom ? 2 : 0) | (primitive.SemiCircle ? 4 : 0) | (primitive.Smooth ? 0 : 8) | ((primitive.UpAxis - 1) << 4);
+		writer.Write(flags);
+	}
+
+	writer.Write((uint32_t)scene.Objects.size());
+	for (const SceneObjectDesc& object : scene.Objects) {
+		writer.WriteString(object.Name);
+		writer.Write((int32_t)object.Primitive);
+		writer.Write((int32_t)object.Material);
+		writer.Write(object.Model);
+	}
+
+	writer.Write((uint8_t)scene.DirLight.Enabled);
+	writer.Write(scene.DirLight.Direction);
+	writer.Write(scene.DirLight.Ambient);
+	writer.Write(scene.DirLight.Diffuse);
+	writer.Write(scene.DirLight.Specular);
+
+	writer.Write((uint32_t)scene.PointLights.size());
+	for (const ScenePointLightDesc& light : scene.PointLights) {
+		writer.Write(light.Position);
+		writer.Write(light.Color);
+		writer.Write(light.Attenuation);
+		writer.Write(light.CubeScale);
+	}
+
+	writer.Write(scene.SpotLight.CutOffDegrees);
+	writer.Write(scene.SpotLight.OuterCutOffDegrees);
+	writer.Write(scene.SpotLight.Attenuation);
+	writer.Write((int32_t)scene.LightMesh);
+
+	ofstream file(path.c_str(), ios::binary);
+	file.write(writer.Data.data(), writer.Data.size());
+	if (!file) {
+		cout << "ERROR::SCENE::WRITE_FAILED " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+//Reads a binary description, indices are range checked so the rest of the loader can trust them
+inline bool ParseSceneBinary(const vector<char>& data, SceneDescription& scene, string& error) {
+	SceneBinaryReader reader(data);
+	if (reader.Read<uint32_t>() != SCENE_BINARY_MAGIC || reader.Read<uint32_t>() != SCENE_BINARY_VERSION) {
+		error = "not a scene binary of version " + to_string(SCENE_BINARY_VERSION);
+		return false;
+	}
+
+	uint32_t count = reader.ReadCount(9);
+	for (uint32_t i = 0; i < count && reader.Ok; i++) {
+		SceneTextureDesc texture;
+		texture.Name = reader.ReadString();
+		texture.Path = reader.ReadString();
+		uint8_t flags = reader.Read<uint8_t>();
+		texture.HasAlpha = (flags & 1) != 0;
+		texture.RepeatU = (flags & 2) != 0;
+		texture.RepeatV = (flags & 4) != 0;
+		texture.GenMipMaps = (flags & 8) != 0;
+		texture.FlipVertical = (flags & 16) != 0;
+		scene.Textures.push_back(texture);
+	}
+
+	count = reader.ReadCount(24);
+	for (uint32_t i = 0; i < count && reader.Ok; i++) {
+		SceneMaterialDesc material;
+		material.Name = reader.ReadString();
+		material.Diffuse = reader.Read<int32_t>();
+		material.Specular = reader.Read<int32_t>();
+		material.OverlayDiffuse = reader.Read<int32_t>();
+		material.OverlaySpecular = reader.Read<int32_t>();
+		material.Shininess = reader.Read<float>();
+		scene.Materials.push_back(material);
+	}
+
+	count = reader.ReadCount(37);
+	for (uint32_t i = 0; i < count && reader.Ok; i++) {
+		ScenePrimitiveDesc primitive;
+		primitive.Name = reader.ReadString();
+		primitive.Type = (ScenePrimitiveType)reader.Read<uint8_t>();
+		primitive.Position = reader.Read<glm::vec3>();
+		primitive.Size = reader.Read<glm::vec3>();
+		primitive.Sides = reader.Read<int32_t>();
+		primitive.SubDivisions = reader.Read<int32_t>();
+		uint8_t flags = reader.Read<uint8_t>();
+		primitive.DrawTop = (flags & 1) != 0;
+		primitive.DrawBottom = (flags & 2) != 0;
+		primitive.SemiCircle = (flags & 4) != 0;
+		primitive.Smooth = (flags & 8) == 0;
+		primitive.UpAxis = min(((flags >> 4) & 3) + 1, 3);
+		scene.Primitives.push_back(primitive);
+	}
+
+	count = reader.ReadCount(76);
+	for (uint32_t i = 0; i < count && reader.Ok; i++) {
+		SceneObjectDesc object;
+		object.Name = reader.ReadString();
+		object.Primitive = reader.Read<int32_t>();
+		object.Material = reader.Read<int32_t>();
+		object.Model = reader.Read<glm::mat4>();
+		scene.Objects.push_back(object);
+	}
+
+	scene.DirLight.Enabled = reader.Read<uint8_t>() != 0;
+	scene.DirLight.Direction = reader.Read<glm::vec3>();
+	scene.DirLight.Ambient = reader.Read<glm::vec3>();
+	scene.DirLight.Diffuse = reader.Read<glm::vec3>();
+	scene.DirLight.Specular = reader.Read<glm::vec3>();
+
+	count = reader.ReadCount(40);
+	for (uint32_t i = 0; i < count && reader.Ok; i++) {
+		ScenePointLightDesc light;
+		light.Position = reader.Read<glm::vec3>();
+		light.Color = reader.Read<glm::vec3>();
+		light.Attenuation = reader.Read<glm::vec3>();
+		light.CubeScale = reader.Read<float>();
+		scene.PointLights.push_back(light);
+	}
+
+	scene.SpotLight.CutOffDegrees = reader.Read<float>();
+	scene.SpotLight.OuterCutOffDegrees = reader.Read<float>();
+	scene.SpotLight.Attenuation = reader.Read<glm::vec3>();
+	scene.LightMesh = reader.Read<int32_t>();
+
+	if (!reader.Ok) {
+		error = "truncated";
+		return false;
+	}
+
+	//Indices
+	int textureCount = (int)scene.Textures.size();
+	for (const SceneMaterialDesc& material : scene.Materials) {
+		if (material.Diffuse < 0 || material.Diffuse >= textureCount || material.Specular < 0 || material.Specular >= textureCount
+			|| material.OverlayDiffuse >= textureCount || material.OverlaySpecular >= textureCount || (material.OverlayDiffuse < 0) != (material.OverlaySpecular < 0)) {
+			error = "bad texture index in material " + material.Name;
+			return false;
+		}
+	}
+	for (const ScenePrimitiveDesc& primitive : scene.Primitives) {
+		if (primitive.Type < SCENE_PLANE || primitive.Type > SCENE_CUBE) {
+			error = "bad primitive type in " + primitive.Name;
+			return false;
+		}
+	}
+	for (const SceneObjectDesc& object : scene.Objects) {
+		if (object.Primitive < 0 || object.Primitive >= (int)scene.Primitives.size() || object.Material < 0 || object.Material >= (int)scene.Materials.size()) {
+			error = "bad index in object " + object.Name;
+			return false;
+		}
+	}
+	if (scene.LightMesh >= (int)scene.Primitives.size()) {
+		error = "bad light mesh index";
+		return false;
+	}
+	return true;
+}
+
+//Loads a scene description, text or binary, from the asset archive when it has it
+inline bool LoadSceneDescription(const string& path, SceneDescription& scene) {
+	AssetData file;
+	if (!ReadAsset(path, file)) {
+		cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ " << path << endl;
+		return false;
+	}
+	vector<char> data(file.GetData(), file.GetData() + file.GetSize());
+
+	scene = SceneDescription();
+	string error;
+	bool parsed;
+	if (data.size() >= sizeof(uint32_t) && memcmp(&data[0], &SCENE_BINARY_MAGIC, sizeof(uint32_t)) == 0) {
+		parsed = ParseSceneBinary(data, scene, error);
+	}
+	else {
+		SceneTextParser parser(scene);
+		istringstream lines(string(data.begin(), data.end()));
+		string line;
+		int lineNumber = 0;
+		while (getline(lines, line) && parser.ParseLine(line, ++lineNumber)) {
+		}
+		error = parser.Error;
+		parsed = error.empty();
+	}
+
+	if (!parsed) {
+		cout << "ERROR::SCENE::PARSE " << path << " " << error << endl;
+	}
+	return parsed;
+}
+
+/*
+* =====================
+* Built scene
+* =====================
+*/
+
+//One primitive of a built scene, exactly one of the meshes is set
+struct ScenePrimitive {
+	string Name;
+	ScenePrimitiveType Type = SCENE_CYLINDER;
+	unique_ptr<Plane> PlaneMesh;
+	unique_ptr<Cylinder> CylinderMesh;
+	unique_ptr<Sphere> SphereMesh;
+	unique_ptr<Cube> CubeMesh;
+
+	//Cylinders and Spheres, the shapes with LODs, patches and a procedural path. Tapered or turned cylinders are drawn
+	//like the flat shapes, the analytic paths only know straight Y-up ones.
+	bool IsCurved() const {
+		return (Type == SCENE_CYLINDER && CylinderMesh->HasAnalyticSurface()) || Type == SCENE_SPHERE;
+	}
+
+	//CPU vertices as a triangle list in the primitive layout, empty once ReleaseVertices ran
+	const vector<float>& GetVertices() const {
+		switch (Type) {
+		case SCENE_PLANE: return PlaneMesh->Vertices;
+		case SCENE_SPHERE: return SphereMesh->Vertices;
+		case SCENE_CUBE: return CubeMesh->Vertices;
+		default: return CylinderMesh->Vertices;
+		}
+	}
+
+	//Vertices one full detail draw submits (indices for the indexed Cylinder)
+	int GetVertexCount() const {
+		switch (Type) {
+		case SCENE_PLANE: return PlaneMesh->VertexCount;
+		case SCENE_SPHERE: return SphereMesh->VertexCount;
+		case SCENE_CUBE: return CubeMesh->VertexCount;
+		default: return CylinderMesh->IndexCount;
+		}
+	}
+
+	//Bytes held in CPU arrays, the Cylinder keeps its indexed mesh next to the triangle list
+	size_t GetCPUBytes() const {
+		if (Type == SCENE_CYLINDER) {
+			return CylinderMesh->GetCPUBytes();
+		}
+		return GetVertices().capacity() * sizeof(float);
+	}
+
+	void ReleaseVertices() {
+		switch (Type) {
+		case SCENE_PLANE: PlaneMesh->ReleaseVertices(); break;
+		case SCENE_SPHERE: SphereMesh->ReleaseVertices(); break;
+		case SCENE_CUBE: CubeMesh->ReleaseVertices(); break;
+		default: CylinderMesh->ReleaseVertices(); break;
+		}
+	}
+
+	//Draws the full object
+	void Draw() {
+		switch (Type) {
+		case SCENE_PLANE: PlaneMesh->Draw(); break;
+		case SCENE_SPHERE: SphereMesh->Draw(); break;
+		case SCENE_CUBE: CubeMesh->Draw(); break;
+		default: CylinderMesh->Draw(); break;
+		}
+	}
+
+	void DeallocateVertexArrayBuffers() {
+		switch (Type) {
+		case SCENE_PLANE: PlaneMesh->DeallocateVertexArrayBuffers(); break;
+		case SCENE_SPHERE: SphereMesh->DeallocateVertexArrayBuffers(); break;
+		case SCENE_CUBE: CubeMesh->DeallocateVertexArrayBuffers(); break;
+		default: CylinderMesh->DeallocateVertexArrayBuffers(); break;
+		}
+	}
+};
+
+//Timings of the last Build
+struct SceneBuildStats {
+	double GenerateMs = 0.0; //Decoding and vertex generation, on every core
+	double UploadMs = 0.0;   //GL uploads on the calling thread
+	int Threads = 1;
+};
+
+//Everything a description turns into: textures, materials, meshes and the draw list
+class Scene
+{
+public:
+	vector<Texture2D> Textures;
+	MaterialTable Materials;
+	vector<ScenePrimitive> Primitives;
+	vector<SceneObjectDesc> Objects;
+
+	SceneDirLightDesc DirLight;
+	vector<ScenePointLightDesc> PointLights;
+	SceneSpotLightDesc SpotLight;
+	int LightMesh = -1;
+
+	SceneBuildStats Stats;
+
+	//Decodes every texture and generates every mesh (with LODs, and patches when asked) in parallel on the thread pool,
+	//then uploads on the calling thread. Without a context on the calling thread nothing is decoded or uploaded (headless).
+	//With a streamer, textures are loaded with only their small levels and handed to it.
+	void Build(const SceneDescription& description, bool generatePatches, TextureStreamer* streamer = NULL) {
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+		bool upload = HasCurrentGLContext();
+
+		//Materials point into Textures, so it must never reallocate
+		Textures.clear();
+		Textures.reserve(description.Textures.size());
+		for (const SceneTextureDesc& texture : description.Textures) {
+			Textures.push_back(Texture2D::CreateDeferred(texture.Path.c_str(), texture.HasAlpha, texture.RepeatU, texture.RepeatV, texture.GenMipMaps, texture.FlipVertical));
+		}
+
+		Primitives.clear();
+		Primitives.resize(description.Primitives.size());
+
+		//One parallel loop over textures then primitives, the big images and the dense meshes share the cores
+		int textureJobs = upload ? (int)Textures.size() : 0;
+		stbi_set_flip_vertically_on_load(false);
+		ThreadPool::Shared().ParallelFor(0, textureJobs + (int)Primitives.size(), [&](int job) {
+			if (job < textureJobs) {
+				Textures[job].DecodePixels(streamer != NULL ? STREAM_RESIDENT_SIZE : 0);
+			}
+			else {
+				BuildPrimitive(description.Primitives[job - textureJobs], Primitives[job - textureJobs], generatePatches);
+			}
+		});
+
+		chrono::high_resolution_clock::time_point generated = chrono::high_resolution_clock::now();
+
+		if (upload) {
+			for (Texture2D& texture : Textures) {
+				if (streamer != NULL) {
+					streamer->Add(texture);
+				}
+				else {
+					texture.UploadPixels();
+				}
+			}
+			for (ScenePrimitive& primitive : Primitives) {
+				UploadPrimitive(primitive);
+			}
+		}
+
+		Materials = MaterialTable();
+		for (const SceneMaterialDesc& material : description.Materials) {
+			Material sceneMaterial(Textures[material.Diffuse], Textures[material.Specular], material.Shininess);
+			if (material.OverlayDiffuse >= 0) {
+				sceneMaterial.WithOverlay(Textures[material.OverlayDiffuse], Textures[material.OverlaySpecular]);
+			}
+			Materials.Add(sceneMaterial);
+		}
+		Materials.Upload();
+
+		Objects = description.Objects;
+		DirLight = description.DirLight;
+		PointLights = description.PointLights;
+		SpotLight = description.SpotLight;
+		LightMesh = description.LightMesh;
+
+		chrono::high_resolution_clock::time_point uploaded = chrono::high_resolution_clock::now();
+		Stats.GenerateMs = chrono::duration<double, milli>(generated - start).count();
+		Stats.UploadMs = chrono::duration<double, milli>(uploaded - generated).count();
+		Stats.Threads = (int)ThreadPool::Shared().ThreadCount() + 1;
+	}
+
+	//Index of the first primitive/object with this name, -1 when there is none
+	int FindPrimitive(const string& name) const {
+		for (size_t i = 0; i < Primitives.size(); i++) {
+			if (Primitives[i].Name == name) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	//Total triangles of one pass over the draw list at full detail
+	long long GetTriangleCount() const {
+		long long triangles = 0;
+		for (const SceneObjectDesc& object : Objects) {
+			triangles += Primitives[object.Primitive].GetVertexCount() / 3;
+		}
+		return triangles;
+	}
+
+	//Bytes of vertex data still held in CPU arrays
+	size_t GetCPUVertexBytes() const {
+		size_t bytes = 0;
+		for (const ScenePrimitive& primitive : Primitives) {
+			bytes += primitive.GetCPUBytes();
+		}
+		return bytes;
+	}
+
+	//Drops the CPU vertices of every uploaded mesh, once the BVH, megabuffer and the like have been built from them
+	void ReleaseVertices() {
+		for (ScenePrimitive& primitive : Primitives) {
+			primitive.ReleaseVertices();
+		}
+	}
+
+	//De-allocates every mesh, texture and the material table
+	void Deallocate() {
+		for (ScenePrimitive& primitive : Primitives) {
+			primitive.DeallocateVertexArrayBuffers();
+		}
+		for (Texture2D& texture : Textures) {
+			GetResourceRegistry().ReleaseTexture(texture.Texture);
+			glDeleteTextures(1, &texture.Texture);
+			texture.Texture = 0;
+		}
+		Materials.Deallocate();
+	}
+
+private:
+	//Runs on a worker thread, no GL context there so the meshes keep their data for UploadPrimitive
+	static void BuildPrimitive(const ScenePrimitiveDesc& desc, ScenePrimitive& primitive, bool generatePatches) {
+		primitive.Name = desc.Name;
+		primitive.Type = desc.Type;
+		switch (desc.Type) {
+		case SCENE_PLANE:
+			primitive.PlaneMesh.reset(new Plane(desc.Position, desc.Size.x, desc.Size.y));
+			break;
+		case SCENE_SPHERE:
+			primitive.SphereMesh.reset(new Sphere(desc.Position, desc.Size.x, desc.Size.y, desc.Sides, desc.SemiCircle));
+			primitive.SphereMesh->GenerateLODs();
+			if (generatePatches) {
+				primitive.SphereMesh->GeneratePatches();
+			}
+			break;
+		case SCENE_CUBE:
+			primitive.CubeMesh.reset(new Cube(desc.Position, desc.Size.x, desc.Size.y, desc.Size.z));
+			break;
+		default:
+			primitive.CylinderMesh.reset(new Cylinder(desc.Size.x, desc.Size.z, desc.Size.y, desc.Sides, desc.SubDivisions,
+				desc.Smooth, desc.UpAxis, desc.Position, desc.DrawTop, desc.DrawBottom));
+			primitive.CylinderMesh->GenerateLODs();
+			if (generatePatches) {
+				primitive.CylinderMesh->GeneratePatches();
+			}
+			break;
+		}
+	}
+
+	static void UploadPrimitive(ScenePrimitive& primitive) {
+		switch (primitive.Type) {
+		case SCENE_PLANE: primitive.PlaneMesh->GenerateVertexArrayAndBuffer(); break;
+		case SCENE_SPHERE: primitive.SphereMesh->UploadBuffers(); break;
+		case SCENE_CUBE: primitive.CubeMesh->GenerateVertexArrayAndBuffer(); break;
+		default: primitive.CylinderMesh->UploadBuffers(); break;
+		}
+	}
+};
+
+#endif
@@ -2,10 +2,11 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "glcontext.h"
+#include "rendercounters.h"
+#include "assetarchive.h"
 
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 
 //GLM Libs
@@ -21,48 +22,16 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
+        ID = 0;
+        // headless (or no paths given), nothing to compile against
+        if (!HasCurrentGLContext() || vertexPath == NULL || fragmentPath == NULL)
+            return;
+        // 1. retrieve the vertex/fragment source code (a span into the asset archive when one is open)
+        AssetData vertexCode = readShaderFile(vertexPath);
+        AssetData fragmentCode = readShaderFile(fragmentPath);
         // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        unsigned int vertex = compileStage(GL_VERTEX_SHADER, vertexCode, "VERTEX");
+        unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode, "FRAGMENT");
         // shader Program
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
@@ -73,6 +42,36 @@ public:
         glDeleteShader(vertex);
         glDeleteShader(fragment);
     }
+    // constructor for a tessellated program: vertex, tessellation control, tessellation evaluation and fragment stages.
+    // needs GL 4.0, leaves ID at 0 when the context is older.
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* tessControlPath, const char* tessEvaluationPath, const char* fragmentPath)
+    {
+        ID = 0;
+        if (!HasCurrentGLContext())
+            return;
+        if (!GLAD_GL_VERSION_4_0)
+        {
+            std::cout << "ERROR::SHADER::TESSELLATION_NEEDS_GL_4_0" << std::endl;
+            return;
+        }
+        unsigned int vertex = compileStage(GL_VERTEX_SHADER, readShaderFile(vertexPath), "VERTEX");
+        unsigned int tessControl = compileStage(GL_TESS_CONTROL_SHADER, readShaderFile(tessControlPath), "TESS_CONTROL");
+        unsigned int tessEvaluation = compileStage(GL_TESS_EVALUATION_SHADER, readShaderFile(tessEvaluationPath), "TESS_EVALUATION");
+        unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, readShaderFile(fragmentPath), "FRAGMENT");
+        // shader Program
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, tessControl);
+        glAttachShader(ID, tessEvaluation);
+        glAttachShader(ID, fragment);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(vertex);
+        glDeleteShader(tessControl);
+        glDeleteShader(tessEvaluation);
+        glDeleteShader(fragment);
+    }
     // activate the shader
     // ------------------------------------------------------------------------
     void use()
@@ -83,34 +82,79 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
+        GetRenderCounters().UniformUploads++;
         glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
+        GetRenderCounters().UniformUploads++;
         glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
+        GetRenderCounters().UniformUploads++;
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, glm::mat4 &mat) const
     {
+        GetRenderCounters().UniformUploads++;
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3 &value) const
     {
+        GetRenderCounters().UniformUploads++;
         glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
+        GetRenderCounters().UniformUploads++;
         glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
     }
 
+    // ------------------------------------------------------------------------
+    void setVec2(const std::string& name, float x, float y) const
+    {
+        GetRenderCounters().UniformUploads++;
+        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    }
+    // connects a uniform block to a binding point, does nothing if the program has no such block
+    // ------------------------------------------------------------------------
+    void setBlockBinding(const std::string& name, unsigned int binding) const
+    {
+        if (ID == 0)
+            return;
+        unsigned int index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+
 private:
+    // reads a whole shader file, empty on failure
+    // ------------------------------------------------------------------------
+    AssetData readShaderFile(const char* path)
+    {
+        AssetData source;
+        if (!ReadAsset(path, source))
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return source;
+    }
+    // compiles one stage, errors are printed like the other stages. The source is passed with its length, it is not
+    // null terminated when it points into the archive
+    // ------------------------------------------------------------------------
+    unsigned int compileStage(GLenum stage, const AssetData& source, const std::string& type)
+    {
+        const char* shaderCode = source.GetSize() > 0 ? source.GetData() : "";
+        GLint length = (GLint)source.GetSize();
+        unsigned int shader = glCreateShader(stage);
+        glShaderSource(shader, 1, &shaderCode, &length);
+        glCompileShader(shader);
+        checkCompileErrors(shader, type);
+        return shader;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
@@ -0,0 +1,62 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 Color;
+
+//Glyph coverage in red, solid quads sample the atlas' filled cell (see hud.h)
+uniform sampler2D fontAtlas;
+
+//HudBlock in hud.h: the graph's frame history, CPU then GPU time of two frames to a vec4 with 1.0 at the top,
+//then the text grid, 6 lines of 32 cells packed two to a uint as character | color index << 8
+layout (std140) uniform HudData {
+    vec4 samples[80];
+    uvec4 text[24];
+};
+
+//Text color of each color index: text, CPU, GPU. CPU and GPU also color the graph.
+uniform vec3 colors[3];
+
+const int TEXT_COLUMNS = 32;
+const int TEXT_LINES = 6;
+
+//Atlas cell of a character and its size, cells cover ASCII 32 to 127 sixteen to a row
+const ivec2 CELL_SIZE = ivec2(6, 8);
+const int ATLAS_COLUMNS = 16;
+
+//Lines are a cell and one blank row apart
+const int LINE_HEIGHT = 9;
+
+void main()
+{
+    //Zero alpha quads are filled here, red picks the text grid or the graph
+    if (Color.a == 0.0)
+    {
+        if (Color.r > 0.5)
+        {
+            //Text, V runs bottom up so the first line is at the top
+            ivec2 pixel = ivec2(TexCoord.x * float(TEXT_COLUMNS * CELL_SIZE.x), (1.0 - TexCoord.y) * float(TEXT_LINES * LINE_HEIGHT));
+            pixel = min(pixel, ivec2(TEXT_COLUMNS * CELL_SIZE.x, TEXT_LINES * LINE_HEIGHT) - 1);
+            int cell = pixel.y / LINE_HEIGHT * TEXT_COLUMNS + pixel.x / CELL_SIZE.x;
+            uint cells = text[cell / 8][(cell % 8) / 2];
+            uint code = (cells >> uint((cell % 2) * 16)) & 0xFFFFu;
+            ivec2 inCell = ivec2(pixel.x % CELL_SIZE.x, pixel.y % LINE_HEIGHT);
+            if ((code & 0xFFu) == 0u || inCell.y >= CELL_SIZE.y)
+            {
+                discard;
+            }
+            int glyph = int(code & 0xFFu) - 32;
+            ivec2 atlas = ivec2(glyph % ATLAS_COLUMNS, glyph / ATLAS_COLUMNS) * CELL_SIZE + inCell;
+            FragColor = vec4(colors[code >> 8], texelFetch(fontAtlas, atlas, 0).r);
+            return;
+        }
+
+        //Graph, every frame is a CPU column then a GPU column
+        int columns = samples.length() * 4;
+        int column = min(int(TexCoord.x * float(columns)), columns - 1);
+        float height = samples[column / 4][column % 4];
+        FragColor = vec4(colors[1 + column % 2], TexCoord.y <= height ? 1.0 : 0.0);
+        return;
+    }
+    FragColor = vec4(Color.rgb, Color.a * texture(fontAtlas, TexCoord).r);
+}
\ No newline at end of file
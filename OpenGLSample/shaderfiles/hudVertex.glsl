@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;     //Window pixels, origin top left
+layout (location = 1) in vec2 aTexCoord; //Font atlas, normalized from 16 bit
+layout (location = 2) in vec4 aColor;    //Normalized from 8 bit
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform vec2 screenSize;
+
+void main()
+{
+    gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);
+    TexCoord = aTexCoord;
+    Color = aColor;
+}
\ No newline at end of file
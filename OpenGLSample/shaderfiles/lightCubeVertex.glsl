@@ -1,9 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+//Per frame and per draw data, streamed through the ring buffer (see uniformblocks.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat3 normalMatrix;
+};
 
 void main()
 {
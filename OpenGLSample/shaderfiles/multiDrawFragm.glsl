@@ -0,0 +1,190 @@
+#version 430 core
+out vec4 FragColor;
+
+//Same lighting as sampleMultiLightFragm.glsl. Textures are layers of two arrays picked by the draw's material,
+//so the whole static scene shares one set of bindings (see megabuffer.h).
+
+//Fragment Material, std430 mirror of MultiDrawMaterial
+struct MaterialData {
+    int diffuseLayer; //Layers in surfaceTextures
+    int specularLayer;
+    int overlayDiffuseLayer; //Layers in overlayTextures, -1 when there is no overlay
+    int overlaySpecularLayer;
+    float shininess;
+    int pad0, pad1, pad2; //std430 packs scalar-only structs tightly, keep the 32 byte stride of the C++ struct
+};
+
+layout (std430, binding = 1) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+};
+
+uniform sampler2DArray surfaceTextures;
+uniform sampler2DArray overlayTextures;
+
+//Light Structs, members ordered so every vec3 shares its 16 bytes with a scalar under std140 (see uniformblocks.h)
+struct DirLight{
+    vec3 direction;
+    bool useDirectionalLight;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight{
+    vec3 position;
+    float constant; //Attenuation variables
+
+    vec3 ambient; //Usually set to low intensity to prevent dominance.
+    float linear;
+    vec3 diffuse; //Usually set to color of the light
+    float quadratic;
+    vec3 specular; //Usually kept at 1.0 for full shining
+};
+
+struct SpotLight{
+    vec3 position; //Where the light is positioned
+    bool useSpotLight;
+
+    vec3 direction; //Which way the light is facing
+    float cutOff; //Inner cone cutoff
+
+    vec3 ambient; //Usually set to low intensity to prevent dominance.
+    float outerCutOff; //Outer cone cutoff, this is used to soften the edge of the light
+    vec3 diffuse; //Usually set to color of the light
+    float constant; //Attenuation variables
+    vec3 specular; //Usually kept at 1.0 for full shining
+    float linear;
+    float quadratic;
+};
+
+//Ins
+in vec3 FragPosition;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in int MaterialIndex;
+
+//Per frame data, streamed through the ring buffer
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+#define NR_POINT_LIGHTS 4
+layout (std140) uniform LightData {
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+//Prototypes
+vec3 CalculateDirectionalLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess);
+vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess);
+vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess);
+
+void main(){
+    MaterialData material = materials[MaterialIndex];
+
+    //Surface colors, sampled once and shared by every light
+    vec3 diffuseColor;
+    vec3 specularColor;
+    if (material.overlayDiffuseLayer >= 0) {
+        vec2 overlayTexCoord = vec2(TexCoords.x * 2.0, TexCoords.y); //for halfing the overlay to prevent overstrecthing
+        vec4 overlayDiffuseColor = texture(overlayTextures, vec3(overlayTexCoord, material.overlayDiffuseLayer));
+        vec4 overlaySpecularColor = texture(overlayTextures, vec3(overlayTexCoord, material.overlaySpecularLayer));
+        diffuseColor = mix(texture(surfaceTextures, vec3(overlayTexCoord, material.diffuseLayer)).rgb, overlayDiffuseColor.rgb, overlayDiffuseColor.a);
+        specularColor = mix(texture(surfaceTextures, vec3(overlayTexCoord, material.specularLayer)).rgb, overlaySpecularColor.rgb, overlaySpecularColor.a);
+    }
+    else {
+        diffuseColor = texture(surfaceTextures, vec3(TexCoords, material.diffuseLayer)).rgb;
+        specularColor = texture(surfaceTextures, vec3(TexCoords, material.specularLayer)).rgb;
+    }
+
+    //properties
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPosition);
+    vec3 result;
+
+    //Phase 1: Directional Light
+    if(dirLight.useDirectionalLight){
+        result = CalculateDirectionalLight(dirLight, norm, viewDir, diffuseColor, specularColor, material.shininess);
+    }
+
+    //Phase 2: Point Lights (loop through them all)
+    for(int i = 0; i < NR_POINT_LIGHTS; i++){
+        result += CalculatePointLight(pointLights[i], norm, FragPosition, viewDir, diffuseColor, specularColor, material.shininess);
+    }
+
+    //Phase 3: Spot Light (flashlight)
+    if(spotLight.useSpotLight){
+        result += CalculateSpotLight(spotLight, norm, FragPosition, viewDir, diffuseColor, specularColor, material.shininess);
+    }
+
+    FragColor = vec4(result, 1.0);
+}
+
+//Helper Functions
+
+//Calculate the directional light's impact on the fragment
+vec3 CalculateDirectionalLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
+{
+    vec3 lightDir = normalize(-light.direction);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+
+    return (ambient + diffuse + specular);
+}
+
+//Calculate a Point light's impact on the fragment
+vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    //Attenuation - Light intensity fall off for spot/area lights
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance)); //F-att = 1.0 / Kc + (Kl * d) + Kq * d^2
+
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+//Calculate the flashlight's impact on the fragment
+vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, float shininess)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    //Spotlight (soft edge calculations)
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+
+    return (ambient + diffuse + specular) * attenuation * intensity;
+}
@@ -0,0 +1,38 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+//layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec2 aTexCoords;
+layout (location = 4) in uint aDrawID; //Instanced, baseInstance of the indirect command picks the draw (see megabuffer.h)
+
+//Per frame data, streamed through the ring buffer (see uniformblocks.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+//Every draw of the static scene, written once at load
+struct DrawData {
+    mat4 model;
+    mat3 normalMatrix;
+    int materialIndex;
+};
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+out vec3 FragPosition;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out int MaterialIndex;
+
+void main()
+{
+    mat4 model = draws[aDrawID].model;
+    MaterialIndex = draws[aDrawID].materialIndex;
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    FragPosition = vec3(model * vec4(aPos, 1.0)); //Get the fragment's world position
+    Normal = draws[aDrawID].normalMatrix * aNormal; //Same as sampleMultiLightVertex.glsl
+    TexCoords = aTexCoords;
+}
@@ -0,0 +1,83 @@
+#version 330 core
+//No vertex attributes, everything comes from gl_VertexID/gl_InstanceID and the uniforms below
+
+//Surfaces, must match TessSurface in tessellation.h
+#define CYLINDER_SIDE 0
+#define CYLINDER_BOTTOM 1
+#define CYLINDER_TOP 2
+#define SPHERE_BODY 3
+#define SPHERE_CAP 4
+#define PI 3.1415926535897932384626433832795
+
+//Per frame and per draw data, streamed through the ring buffer (see uniformblocks.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+uniform vec3 shapeOrigin; //Position of the Cylinder/Sphere
+uniform vec3 shapeSize; //Cylinder: radius, height. Sphere: long radius, lat radius, last latitude angle.
+
+uniform int firstSurface; //Surface of instance 0, each further instance is the next surface
+uniform int gridColumns; //Cells around
+uniform int gridRows; //Cells up (or out from the center on caps)
+
+//Same outputs as sampleMultiLightVertex.glsl so the lit fragment shader is reused as is
+out vec3 FragPosition;
+out vec3 Normal;
+out vec2 TexCoords;
+
+//Corner of the cell each of its six vertices sits on
+const vec2 cellCorners[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+//Exact surface point, normal and texture coordinate, same as tessPrimitiveEval.glsl
+void EvaluateSurface(int surface, vec2 coord, out vec3 position, out vec3 normal, out vec2 uv)
+{
+    float theta = 2.0 * PI * coord.x;
+    vec2 ring = vec2(cos(theta), sin(theta));
+
+    if (surface == CYLINDER_SIDE) {
+        position = shapeOrigin + vec3(shapeSize.x * ring.x, shapeSize.y * coord.y, shapeSize.x * ring.y);
+        normal = vec3(ring.x, 0.0, ring.y);
+        uv = vec2(1.0 - coord.x, coord.y);
+    }
+    else if (surface == CYLINDER_BOTTOM || surface == CYLINDER_TOP) {
+        bool top = surface == CYLINDER_TOP;
+        position = shapeOrigin + vec3(shapeSize.x * coord.y * ring.x, top ? shapeSize.y : 0.0, shapeSize.x * coord.y * ring.y);
+        normal = vec3(0.0, top ? 1.0 : -1.0, 0.0);
+        uv = ring * coord.y;
+    }
+    else if (surface == SPHERE_BODY) {
+        float phi = shapeSize.z * coord.y;
+        vec3 unit = vec3(sin(phi) * ring.x, cos(phi), sin(phi) * ring.y);
+        position = shapeOrigin + unit * shapeSize.xyx;
+        normal = normalize(unit / shapeSize.xyx);
+        uv = vec2(1.0 - coord.x, phi / PI);
+    }
+    else {
+        float capRadius = shapeSize.x * sin(shapeSize.z) * coord.y;
+        position = shapeOrigin + vec3(capRadius * ring.x, shapeSize.y * cos(shapeSize.z), capRadius * ring.y);
+        normal = vec3(0.0, -1.0, 0.0);
+        uv = ring * coord.y;
+    }
+}
+
+void main()
+{
+    int cell = gl_VertexID / 6;
+    vec2 corner = cellCorners[gl_VertexID % 6];
+    vec2 coord = (vec2(cell % gridColumns, cell / gridColumns) + corner) / vec2(gridColumns, gridRows);
+
+    vec3 position;
+    vec3 normal;
+    EvaluateSurface(firstSurface + gl_InstanceID, coord, position, normal, TexCoords);
+
+    FragPosition = vec3(model * vec4(position, 1.0));
+    Normal = normalMatrix * normal;
+    gl_Position = projection * view * vec4(FragPosition, 1.0);
+}
@@ -1,21 +1,19 @@
 #version 330 core
 out vec4 FragColor;
 
-//Fragment Material
+//Fragment Material maps, the samplers are set once per program (see material.h)
 struct Material {
     sampler2D diffuse; //The Diffuse Map
     sampler2D specular; //The Specular Map
 
-    bool useOverlayTexture;
     sampler2D overlayDiffuse; //Optional Diffuse
     sampler2D overlaySpecular; //Optional Specular
-    float shininess;
 };
 
-//Light Structs
+//Light Structs, members ordered so every vec3 shares its 16 bytes with a scalar under std140 (see uniformblocks.h)
 struct DirLight{
-    bool useDirectionalLight;
     vec3 direction;
+    bool useDirectionalLight;
 
     vec3 ambient;
     vec3 diffuse;
@@ -24,34 +22,29 @@ struct DirLight{
 
 struct PointLight{
     vec3 position;
+    float constant; //Attenuation variables
 
     vec3 ambient; //Usually set to low intensity to prevent dominance.
-    vec3 diffuse; //Usually set to color of the light
-    vec3 specular; //Usually kept at 1.0 for full shining
-
-    //Attenuation variables
-    float constant;
     float linear;
+    vec3 diffuse; //Usually set to color of the light
     float quadratic;
+    vec3 specular; //Usually kept at 1.0 for full shining
 };
 
 struct SpotLight{
+    vec3 position; //Where the light is positioned
     bool useSpotLight;
 
-    vec3 position; //Where the light is positioned
     vec3 direction; //Which way the light is facing
-
     float cutOff; //Inner cone cutoff
-    float outerCutOff; //Outer cone cutoff, this is used to soften the edge of the light
-
-    //Attenuation variables
-    float constant;
-    float linear;
-    float quadratic;
 
     vec3 ambient; //Usually set to low intensity to prevent dominance.
+    float outerCutOff; //Outer cone cutoff, this is used to soften the edge of the light
     vec3 diffuse; //Usually set to color of the light
+    float constant; //Attenuation variables
     vec3 specular; //Usually kept at 1.0 for full shining
+    float linear;
+    float quadratic;
 };
 
 //Ins
@@ -60,14 +53,27 @@ in vec3 Normal;
 in vec2 TexCoords;
 
 //Uniforms
-uniform vec3 viewPos;
 uniform Material material;
-uniform DirLight dirLight;
 
-#define NR_POINT_LIGHTS 4
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+//Material parameters, a range of the material table bound per material
+layout (std140) uniform MaterialData {
+    bool useOverlayTexture;
+    float shininess;
+};
+
+//Per frame data, streamed through the ring buffer
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
 
-uniform SpotLight spotLight;
+#define NR_POINT_LIGHTS 4
+layout (std140) uniform LightData {
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    SpotLight spotLight;
+};
 
 //Prototypes
 vec3 CalculateDirectionalLight(DirLight light, vec3 normal, vec3 viewDir);
@@ -113,7 +119,7 @@ vec3 CalculateDirectionalLight(DirLight light, vec3 normal, vec3 viewDir)
 
     //Specular
     vec3 reflectDir = reflect(-lightDir, normal); //reflect the light in the opposite direction it hit the normal from.
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess); //Get the dot product of the view/reflect, and ensure its not negative. Then raise to the power of material's shininess.
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess); //Get the dot product of the view/reflect, and ensure its not negative. Then raise to the power of material's shininess.
 
     vec3 ambient; 
     vec3 diffuse;
@@ -122,7 +128,7 @@ vec3 CalculateDirectionalLight(DirLight light, vec3 normal, vec3 viewDir)
     // Check if the overlayDiffuse texture is used
     vec4 overlayDiffuseColor = vec4(1.0);
     vec4 overlaySpecularColor = vec4(1.0);
-    if (material.useOverlayTexture) {
+    if (useOverlayTexture) {
         overlayDiffuseColor = texture(material.overlayDiffuse, overlayTexCoord);
         overlaySpecularColor = texture(material.overlaySpecular, overlayTexCoord);
 
@@ -151,7 +157,7 @@ vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewD
 
     //Specular
     vec3 reflectDir = reflect(-lightDir, normal); //reflect the light in the opposite direction it hit the normal from.
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess); //Get the dot product of the view/reflect, and ensure its not negative. Then raise to the power of material's shininess.
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess); //Get the dot product of the view/reflect, and ensure its not negative. Then raise to the power of material's shininess.
 
     //Attenuation - Light intensity fall off for spot/area lights
     float distance = length(light.position - fragPos);
@@ -164,7 +170,7 @@ vec3 CalculatePointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewD
     // Check if the overlayDiffuse texture is used
     vec4 overlayDiffuseColor = vec4(1.0);
     vec4 overlaySpecularColor = vec4(1.0);
-    if (material.useOverlayTexture) {
+    if (useOverlayTexture) {
         overlayDiffuseColor = texture(material.overlayDiffuse, overlayTexCoord);
         overlaySpecularColor = texture(material.overlaySpecular, overlayTexCoord);
 
@@ -198,7 +204,7 @@ vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir
 
     //Specular
     vec3 reflectDir = reflect(-lightDir, normal); //reflect the light in the opposite direction it hit the normal from.
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess); //Get the dot product of the view/reflect, and ensure its not negative. Then raise to the power of material's shininess.
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess); //Get the dot product of the view/reflect, and ensure its not negative. Then raise to the power of material's shininess.
 
     //Attenuation - Light intensity fall off for spot/area lights
     float distance = length(light.position - fragPos);
@@ -217,7 +223,7 @@ vec3 CalculateSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir
     // Check if the overlayDiffuse texture is used
     vec4 overlayDiffuseColor = vec4(1.0);
     vec4 overlaySpecularColor = vec4(1.0);
-    if (material.useOverlayTexture) {
+    if (useOverlayTexture) {
         overlayDiffuseColor = texture(material.overlayDiffuse, overlayTexCoord);
         overlaySpecularColor = texture(material.overlaySpecular, overlayTexCoord);
 
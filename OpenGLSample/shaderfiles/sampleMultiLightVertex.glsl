@@ -4,9 +4,16 @@ layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec3 aNormal;
 layout (location = 3) in vec2 aTexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+//Per frame and per draw data, streamed through the ring buffer (see uniformblocks.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat3 normalMatrix;
+};
 
 out vec3 FragPosition;
 out vec3 Normal;
@@ -16,7 +23,6 @@ void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
     FragPosition = vec3(model * vec4(aPos, 1.0)); //Get the fragment's world position
-    //Normal = mat3(transpose(inverse(model))) * aNormal; //Generate the normal matrix using inverse/transpose for non-uniform scaling. This is costly though. Better to do before the shader on the CPU.
-    Normal = aNormal;
+    Normal = normalMatrix * aNormal; //Inverse transpose of the model, made on the CPU (see uniformblocks.h)
     TexCoords = aTexCoords;
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 400 core
+layout (vertices = 4) out;
+
+in vec3 PatchCoord[];
+out vec3 ControlCoord[];
+
+uniform vec2 viewportSize; //In pixels
+uniform float pixelsPerEdge; //Target on screen length of a generated edge
+uniform float maxTessLevel;
+
+//Pixel position of a clip space corner. Corners behind the camera are pushed just in front so the edge stays finite.
+vec2 ScreenPosition(vec4 clip)
+{
+    return (clip.xy / max(clip.w, 0.0001)) * 0.5 * viewportSize;
+}
+
+//Level for one edge. Neighbouring patches pass the same two corners so shared edges always match (no cracks).
+float EdgeLevel(vec4 a, vec4 b)
+{
+    float pixels = length(ScreenPosition(a) - ScreenPosition(b));
+    return clamp(pixels / pixelsPerEdge, 1.0, maxTessLevel);
+}
+
+void main()
+{
+    ControlCoord[gl_InvocationID] = PatchCoord[gl_InvocationID];
+    gl_out[gl_InvocationID].gl_Position = gl_in[gl_InvocationID].gl_Position;
+
+    if (gl_InvocationID == 0) {
+        //Corners: 0 (u0,v0), 1 (u1,v0), 2 (u1,v1), 3 (u0,v1)
+        gl_TessLevelOuter[0] = EdgeLevel(gl_in[0].gl_Position, gl_in[3].gl_Position); //u = 0
+        gl_TessLevelOuter[1] = EdgeLevel(gl_in[0].gl_Position, gl_in[1].gl_Position); //v = 0
+        gl_TessLevelOuter[2] = EdgeLevel(gl_in[1].gl_Position, gl_in[2].gl_Position); //u = 1
+        gl_TessLevelOuter[3] = EdgeLevel(gl_in[3].gl_Position, gl_in[2].gl_Position); //v = 1
+
+        gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+        gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+    }
+}
@@ -0,0 +1,52 @@
+#version 400 core
+layout (location = 0) in vec3 aPatchCoord; //u, v, surface
+
+//Surfaces, must match TessSurface in tessellation.h
+#define CYLINDER_SIDE 0
+#define CYLINDER_BOTTOM 1
+#define CYLINDER_TOP 2
+#define SPHERE_BODY 3
+#define SPHERE_CAP 4
+#define PI 3.1415926535897932384626433832795
+
+//Per frame and per draw data, streamed through the ring buffer (see uniformblocks.h)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+uniform vec3 shapeOrigin; //Position of the Cylinder/Sphere
+uniform vec3 shapeSize; //Cylinder: radius, height. Sphere: long radius, lat radius, last latitude angle.
+
+out vec3 PatchCoord;
+
+//Object space position on the surface, same as tessPrimitiveEval.glsl
+vec3 EvaluatePosition(vec3 coord)
+{
+    int surface = int(coord.z + 0.5);
+    float theta = 2.0 * PI * coord.x;
+
+    if (surface == CYLINDER_SIDE)
+        return shapeOrigin + vec3(shapeSize.x * cos(theta), shapeSize.y * coord.y, shapeSize.x * sin(theta));
+    if (surface == CYLINDER_BOTTOM || surface == CYLINDER_TOP)
+        return shapeOrigin + vec3(shapeSize.x * coord.y * cos(theta), (surface == CYLINDER_TOP) ? shapeSize.y : 0.0, shapeSize.x * coord.y * sin(theta));
+    if (surface == SPHERE_BODY) {
+        float phi = shapeSize.z * coord.y;
+        return shapeOrigin + vec3(shapeSize.x * sin(phi) * cos(theta), shapeSize.y * cos(phi), shapeSize.x * sin(phi) * sin(theta));
+    }
+    //Sphere cap, closes off the last latitude ring
+    float capRadius = shapeSize.x * sin(shapeSize.z) * coord.y;
+    return shapeOrigin + vec3(capRadius * cos(theta), shapeSize.y * cos(shapeSize.z), capRadius * sin(theta));
+}
+
+void main()
+{
+    PatchCoord = aPatchCoord;
+    //Corners go to the control shader in clip space to measure the edges on screen
+    gl_Position = projection * view * model * vec4(EvaluatePosition(aPatchCoord), 1.0);
+}
@@ -0,0 +1,931 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#include "stb_image.h"
+#include "texture2d.h"
+#include "threadpool.h"
+
+//SSE2 is always there on x64, fall back to plain floats everywhere else
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2
+#endif
+
+using namespace std;
+
+//Layout of the primitive vertex arrays (Plane, Cube, Pyramid, Cylinder, Sphere): pos(3), color(3), normal(3), uv(2)
+const int SW_PRIMITIVE_STRIDE = 11;
+const int SW_PRIMITIVE_NORMAL_OFFSET = 6;
+const int SW_PRIMITIVE_UV_OFFSET = 9;
+
+//Must match NR_POINT_LIGHTS in sampleMultiLightFragm.glsl
+const int SW_NR_POINT_LIGHTS = 4;
+
+//Screen tiles are TILE x TILE pixels, each one is rasterized by a single thread
+const int SW_TILE_SIZE = 32;
+
+//Triangles are clipped against a guard band this many times the viewport, anything inside is handled by the edge functions
+const float SW_GUARD_BAND = 8.0f;
+
+//Four floats, one per pixel of a 2x2 quad (lanes: top left, top right, bottom left, bottom right)
+struct Quad4
+{
+#ifdef SOFTWARE_RASTERIZER_SSE2
+	__m128 v;
+
+	Quad4() {}
+	Quad4(__m128 value) : v(value) {}
+	explicit Quad4(float s) : v(_mm_set1_ps(s)) {}
+	Quad4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+	static Quad4 Load(const float* p) { return Quad4(_mm_loadu_ps(p)); }
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+	friend Quad4 operator+(const Quad4& a, const Quad4& b) { return Quad4(_mm_add_ps(a.v, b.v)); }
+	friend Quad4 operator-(const Quad4& a, const Quad4& b) { return Quad4(_mm_sub_ps(a.v, b.v)); }
+	friend Quad4 operator*(const Quad4& a, const Quad4& b) { return Quad4(_mm_mul_ps(a.v, b.v)); }
+	friend Quad4 operator/(const Quad4& a, const Quad4& b) { return Quad4(_mm_div_ps(a.v, b.v)); }
+
+	friend Quad4 Min(const Quad4& a, const Quad4& b) { return Quad4(_mm_min_ps(a.v, b.v)); }
+	friend Quad4 Max(const Quad4& a, const Quad4& b) { return Quad4(_mm_max_ps(a.v, b.v)); }
+	friend Quad4 Sqrt(const Quad4& a) { return Quad4(_mm_sqrt_ps(a.v)); }
+
+	//Bit i is set when lane i >= 0
+	friend int NonNegativeMask(const Quad4& a) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, _mm_setzero_ps())); }
+	//Bit i is set when lane i > 0
+	friend int PositiveMask(const Quad4& a) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, _mm_setzero_ps())); }
+	//Bit i is set when lane i of a < lane i of b
+	friend int LessMask(const Quad4& a, const Quad4& b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+#else
+	float v[4];
+
+	Quad4() {}
+	explicit Quad4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+	Quad4(float a, float b, float c, float d) { v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+
+	static Quad4 Load(const float* p) { return Quad4(p[0], p[1], p[2], p[3]); }
+	void Store(float* p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+
+	friend Quad4 operator+(const Quad4& a, const Quad4& b) { return Quad4(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+	friend Quad4 operator-(const Quad4& a, const Quad4& b) { return Quad4(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+	friend Quad4 operator*(const Quad4& a, const Quad4& b) { return Quad4(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+	friend Quad4 operator/(const Quad4& a, const Quad4& b) { return Quad4(a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]); }
+
+	friend Quad4 Min(const Quad4& a, const Quad4& b) { return Quad4(min(a.v[0], b.v[0]), min(a.v[1], b.v[1]), min(a.v[2], b.v[2]), min(a.v[3], b.v[3])); }
+	friend Quad4 Max(const Quad4& a, const Quad4& b) { return Quad4(max(a.v[0], b.v[0]), max(a.v[1], b.v[1]), max(a.v[2], b.v[2]), max(a.v[3], b.v[3])); }
+	friend Quad4 Sqrt(const Quad4& a) { return Quad4(sqrt(a.v[0]), sqrt(a.v[1]), sqrt(a.v[2]), sqrt(a.v[3])); }
+
+	friend int NonNegativeMask(const Quad4& a) {
+		int mask = 0;
+		for (int i = 0; i < 4; i++) if (a.v[i] >= 0.0f) mask |= 1 << i;
+		return mask;
+	}
+	friend int PositiveMask(const Quad4& a) {
+		int mask = 0;
+		for (int i = 0; i < 4; i++) if (a.v[i] > 0.0f) mask |= 1 << i;
+		return mask;
+	}
+	friend int LessMask(const Quad4& a, const Quad4& b) {
+		int mask = 0;
+		for (int i = 0; i < 4; i++) if (a.v[i] < b.v[i]) mask |= 1 << i;
+		return mask;
+	}
+#endif
+
+	//SSE2 has no pow, each lane goes through powf
+	friend Quad4 Pow(const Quad4& a, float exponent) {
+		float lanes[4];
+		a.Store(lanes);
+		return Quad4(pow(lanes[0], exponent), pow(lanes[1], exponent), pow(lanes[2], exponent), pow(lanes[3], exponent));
+	}
+};
+
+//A vec3 per lane of a 2x2 quad, the lighting runs on these so every operation covers the four pixels at once
+struct Quad3
+{
+	Quad4 X, Y, Z;
+
+	Quad3() {}
+	Quad3(const Quad4& x, const Quad4& y, const Quad4& z) : X(x), Y(y), Z(z) {}
+	explicit Quad3(const glm::vec3& v) : X(v.x), Y(v.y), Z(v.z) {}
+
+	friend Quad3 operator+(const Quad3& a, const Quad3& b) { return Quad3(a.X + b.X, a.Y + b.Y, a.Z + b.Z); }
+	friend Quad3 operator-(const Quad3& a, const Quad3& b) { return Quad3(a.X - b.X, a.Y - b.Y, a.Z - b.Z); }
+	friend Quad3 operator*(const Quad3& a, const Quad3& b) { return Quad3(a.X * b.X, a.Y * b.Y, a.Z * b.Z); }
+	friend Quad3 operator*(const Quad3& a, const Quad4& s) { return Quad3(a.X * s, a.Y * s, a.Z * s); }
+
+	friend Quad4 Dot(const Quad3& a, const Quad3& b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+	friend Quad3 Normalize(const Quad3& a) { return a * (Quad4(1.0f) / Sqrt(Dot(a, a))); }
+};
+
+//CPU copy of a Texture2D with a box filtered mip chain, sampled like GL_LINEAR_MIPMAP_LINEAR
+class SoftwareTexture
+{
+public:
+
+	struct Level {
+		int Width;
+		int Height;
+		vector<unsigned char> Texels; //RGBA8
+	};
+
+	vector<Level> Levels;
+	bool RepeatU;
+	bool RepeatV;
+
+	//Loads the same file the Texture2D was created from
+	SoftwareTexture(const Texture2D& texture) {
+		RepeatU = texture.RepeatU;
+		RepeatV = texture.RepeatV;
+
+		int width = 0, height = 0, numChannels;
+		AssetData file;
+		stbi_set_flip_vertically_on_load(texture.FlipVertical);
+		unsigned char* data = ReadAsset(texture.Path, file) ? stbi_load_from_memory((const stbi_uc*)file.GetData(), (int)file.GetSize(), &width, &height, &numChannels, 4) : NULL;
+
+		if (!data) {
+			cout << "FAILURE::LOAD::SOFTWARE_TEXTURE::" << texture.Path << endl;
+			return;
+		}
+
+		Level base;
+		base.Width = width;
+		base.Height = height;
+		base.Texels.assign(data, data + (size_t)width * height * 4);
+
+		//Images loaded without alpha are stored as GL_RGB, so alpha reads back as 1
+		if (!texture.HasAlpha) {
+			for (size_t i = 3; i < base.Texels.size(); i += 4) {
+				base.Texels[i] = 255;
+			}
+		}
+
+		stbi_image_free(data);
+
+		Levels.push_back(base);
+		GenerateMipMaps();
+	}
+
+	//Trilinear sample, uvDx/uvDy are the uv derivatives across one pixel (taken from the quad)
+	glm::vec4 Sample(const glm::vec2& uv, const glm::vec2& uvDx, const glm::vec2& uvDy) const {
+		if (Levels.empty()) {
+			return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+
+		glm::vec2 size((float)Levels[0].Width, (float)Levels[0].Height);
+		float rho = max(glm::length(uvDx * size), glm::length(uvDy * size));
+		float lod = (rho > 1.0f) ? log2(rho) : 0.0f;
+
+		int lastLevel = (int)Levels.size() - 1;
+		if (lod >= (float)lastLevel) {
+			return Bilinear(Levels[lastLevel], uv);
+		}
+
+		int level = (int)lod;
+		float blend = lod - (float)level;
+		glm::vec4 texel = Bilinear(Levels[level], uv);
+		if (blend > 0.0f) {
+			texel = glm::mix(texel, Bilinear(Levels[level + 1], uv), blend);
+		}
+		return texel;
+	}
+
+private:
+
+	//2x2 box filter down to 1x1
+	void GenerateMipMaps() {
+		while (Levels.back().Width > 1 || Levels.back().Height > 1) {
+			const Level& src = Levels.back();
+
+			Level dst;
+			dst.Width = max(1, src.Width / 2);
+			dst.Height = max(1, src.Height / 2);
+			dst.Texels.resize((size_t)dst.Width * dst.Height * 4);
+
+			for (int y = 0; y < dst.Height; y++) {
+				int y0 = min(y * 2, src.Height - 1);
+				int y1 = min(y * 2 + 1, src.Height - 1);
+				for (int x = 0; x < dst.Width; x++) {
+					int x0 = min(x * 2, src.Width - 1);
+					int x1 = min(x * 2 + 1, src.Width - 1);
+					for (int c = 0; c < 4; c++) {
+						int sum = src.Texels[((size_t)y0 * src.Width + x0) * 4 + c]
+							+ src.Texels[((size_t)y0 * src.Width + x1) * 4 + c]
+							+ src.Texels[((size_t)y1 * src.Width + x0) * 4 + c]
+							+ src.Texels[((size_t)y1 * src.Width + x1) * 4 + c];
+						dst.Texels[((size_t)y * dst.Width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+
+			Levels.push_back(std::move(dst));
+		}
+	}
+
+	int WrapCoord(int i, int size, bool repeat) const {
+		if (repeat) {
+			i %= size;
+			return (i < 0) ? i + size : i;
+		}
+		return min(max(i, 0), size - 1);
+	}
+
+	glm::vec4 Fetch(const Level& level, int x, int y) const {
+		const unsigned char* texel = &level.Texels[((size_t)y * level.Width + x) * 4];
+		return glm::vec4(texel[0], texel[1], texel[2], texel[3]) * (1.0f / 255.0f);
+	}
+
+	glm::vec4 Bilinear(const Level& level, const glm::vec2& uv) const {
+		//Texel centers sit at half coordinates
+		float x = uv.x * level.Width - 0.5f;
+		float y = uv.y * level.Height - 0.5f;
+		float fx = floor(x);
+		float fy = floor(y);
+		float tx = x - fx;
+		float ty = y - fy;
+
+		int x0 = WrapCoord((int)fx, level.Width, RepeatU);
+		int x1 = WrapCoord((int)fx + 1, level.Width, RepeatU);
+		int y0 = WrapCoord((int)fy, level.Height, RepeatV);
+		int y1 = WrapCoord((int)fy + 1, level.Height, RepeatV);
+
+		glm::vec4 top = glm::mix(Fetch(level, x0, y0), Fetch(level, x1, y0), tx);
+		glm::vec4 btm = glm::mix(Fetch(level, x0, y1), Fetch(level, x1, y1), tx);
+		return glm::mix(top, btm, ty);
+	}
+};
+
+//Mirrors the Material struct in sampleMultiLightFragm.glsl. Unlit draws use a flat color like lightCubeFragm.glsl.
+struct SoftwareMaterial {
+	const SoftwareTexture* Diffuse = NULL;
+	const SoftwareTexture* Specular = NULL;
+
+	bool UseOverlayTexture = false;
+	const SoftwareTexture* OverlayDiffuse = NULL;
+	const SoftwareTexture* OverlaySpecular = NULL;
+	float Shininess = 32.0f;
+
+	bool Unlit = false;
+	glm::vec3 UnlitColor = glm::vec3(1.0f);
+};
+
+//Light structs, same fields as the shader uniforms
+struct SoftwareDirLight {
+	bool Enabled = false;
+	glm::vec3 Direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec3 Ambient = glm::vec3(0.0f);
+	glm::vec3 Diffuse = glm::vec3(0.0f);
+	glm::vec3 Specular = glm::vec3(0.0f);
+};
+
+struct SoftwarePointLight {
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::vec3 Ambient = glm::vec3(0.0f);
+	glm::vec3 Diffuse = glm::vec3(0.0f);
+	glm::vec3 Specular = glm::vec3(0.0f);
+	float Constant = 1.0f;
+	float Linear = 0.0f;
+	float Quadratic = 0.0f;
+};
+
+struct SoftwareSpotLight {
+	bool Enabled = false;
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::vec3 Direction = glm::vec3(0.0f, 0.0f, -1.0f);
+	float CutOff = 1.0f;
+	float OuterCutOff = 1.0f;
+	float Constant = 1.0f;
+	float Linear = 0.0f;
+	float Quadratic = 0.0f;
+	glm::vec3 Ambient = glm::vec3(0.0f);
+	glm::vec3 Diffuse = glm::vec3(0.0f);
+	glm::vec3 Specular = glm::vec3(0.0f);
+};
+
+//Counters and timings for the last frame
+struct SoftwareRasterizerStats {
+	size_t TrianglesSubmitted = 0;
+	size_t TrianglesSetUp = 0;   //After clipping and dropping degenerates
+	size_t BinEntries = 0;       //Triangle/tile pairs
+	size_t FragmentsShaded = 0;
+	double SetupMs = 0.0;        //Transform, clip, setup and binning (all Draw calls)
+	double RasterMs = 0.0;       //Tile rasterization, shading and resolve
+};
+
+//Tile based CPU renderer for the primitive vertex arrays, shaded with the sampleMultiLightFragm.glsl lighting model.
+//Draw() transforms, clips and bins triangles into screen tiles; EndFrame() rasterizes every tile in parallel.
+class SoftwareRasterizer
+{
+public:
+
+	SoftwareDirLight DirLight;
+	SoftwarePointLight PointLights[SW_NR_POINT_LIGHTS];
+	SoftwareSpotLight SpotLight;
+
+	SoftwareRasterizerStats Stats;
+
+	//Constructor: output size and the pool to run on (defaults to the shared pool)
+	SoftwareRasterizer(int width, int height, ThreadPool* pool = NULL) : width(width), height(height)
+	{
+		threadPool = (pool != NULL) ? pool : &ThreadPool::Shared();
+
+		tilesX = (width + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+		tilesY = (height + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+		tileBins.resize(tilesX * tilesY);
+
+		ColorBuffer.resize((size_t)width * height * 3);
+	}
+
+	//Final image, tightly packed RGB8 rows from the top of the screen down
+	vector<unsigned char> ColorBuffer;
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	//Returns the CPU copy of a texture, loading it the first time it is asked for
+	const SoftwareTexture* GetTexture(const Texture2D& texture) {
+		map<string, unique_ptr<SoftwareTexture>>::iterator found = textureCache.find(texture.Path);
+		if (found != textureCache.end()) {
+			return found->second.get();
+		}
+
+		SoftwareTexture* loaded = new SoftwareTexture(texture);
+		textureCache[texture.Path] = unique_ptr<SoftwareTexture>(loaded);
+		return loaded;
+	}
+
+	//Starts a frame, drops everything binned for the previous one
+	void BeginFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, const glm::vec3& clearColor) {
+		viewProjection = projection * view;
+		viewPosition = viewPos;
+		clear = clearColor;
+
+		triangles.clear();
+		materials.clear();
+		for (vector<uint32_t>& bin : tileBins) {
+			bin.clear();
+		}
+
+		Stats = SoftwareRasterizerStats();
+	}
+
+	//Queues a non-indexed triangle list in the primitive vertex layout. Lights and material are captured now.
+	void Draw(const vector<float>& vertices, const glm::mat4& model, const SoftwareMaterial& material) {
+		auto start = chrono::high_resolution_clock::now();
+
+		int materialIndex = (int)materials.size();
+		materials.push_back(material);
+
+		int triangleCount = (int)(vertices.size() / (SW_PRIMITIVE_STRIDE * 3));
+		Stats.TrianglesSubmitted += triangleCount;
+
+		glm::mat4 mvp = viewProjection * model;
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+		//Each chunk sets up and bins its own triangles, merged in order afterwards so the output is deterministic
+		const int trianglesPerChunk = 256;
+		int chunkCount = (triangleCount + trianglesPerChunk - 1) / trianglesPerChunk;
+		vector<SetupChunk> chunks(chunkCount);
+
+		threadPool->ParallelFor(0, chunkCount, [&](int chunk) {
+			int first = chunk * trianglesPerChunk;
+			int last = min(first + trianglesPerChunk, triangleCount);
+			for (int tri = first; tri < last; tri++) {
+				SetupTriangleVertices(&vertices[(size_t)tri * 3 * SW_PRIMITIVE_STRIDE], model, normalMatrix, mvp, materialIndex, chunks[chunk]);
+			}
+		});
+
+		for (SetupChunk& chunk : chunks) {
+			uint32_t base = (uint32_t)triangles.size();
+			triangles.insert(triangles.end(), chunk.Triangles.begin(), chunk.Triangles.end());
+			for (const pair<int, uint32_t>& entry : chunk.BinEntries) {
+				tileBins[entry.first].push_back(base + entry.second);
+			}
+			Stats.BinEntries += chunk.BinEntries.size();
+		}
+		Stats.TrianglesSetUp = triangles.size();
+
+		Stats.SetupMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Rasterizes and shades every tile, leaving the result in ColorBuffer
+	void EndFrame() {
+		auto start = chrono::high_resolution_clock::now();
+
+		vector<size_t> fragmentsPerTile(tileBins.size(), 0);
+		threadPool->ParallelFor(0, (int)tileBins.size(), [&](int tile) {
+			fragmentsPerTile[tile] = RasterizeTile(tile);
+		});
+
+		for (size_t fragments : fragmentsPerTile) {
+			Stats.FragmentsShaded += fragments;
+		}
+
+		Stats.RasterMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Writes ColorBuffer out as a binary PPM
+	bool WritePPM(const char* path) const {
+		FILE* file = fopen(path, "wb");
+		if (!file) {
+			cout << "ERROR::SOFTWARE_RASTERIZER::COULD_NOT_WRITE::" << path << endl;
+			return false;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		fwrite(ColorBuffer.data(), 1, ColorBuffer.size(), file);
+		fclose(file);
+		return true;
+	}
+
+private:
+
+	//World position(3), normal(3), uv(2)
+	static const int ATTR_COUNT = 8;
+
+	struct ClipVertex {
+		glm::vec4 Clip;
+		float Attr[ATTR_COUNT];
+	};
+
+	//Everything the tile loop needs. Edge functions are positive inside and give barycentrics once multiplied by InvArea.
+	//TopLeft has bit e set for the edges that own the pixels lying exactly on them.
+	struct SetupTriangle {
+		float EdgeA[3];
+		float EdgeB[3];
+		float EdgeC[3];
+		float InvArea;
+		int TopLeft;
+		float Depth[3];
+		float InvW[3];
+		float AttrOverW[3][ATTR_COUNT];
+		int MinX, MinY, MaxX, MaxY;
+		int Material;
+	};
+
+	struct SetupChunk {
+		vector<SetupTriangle> Triangles;
+		vector<pair<int, uint32_t>> BinEntries; //tile, index into Triangles
+	};
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+
+	ThreadPool* threadPool;
+
+	glm::mat4 viewProjection;
+	glm::vec3 viewPosition;
+	glm::vec3 clear;
+
+	vector<SetupTriangle> triangles;
+	vector<SoftwareMaterial> materials;
+	vector<vector<uint32_t>> tileBins;
+
+	map<string, unique_ptr<SoftwareTexture>> textureCache;
+
+	//Transforms one triangle, clips it and sets up/bins whatever is left
+	void SetupTriangleVertices(const float* vertices, const glm::mat4& model, const glm::mat3& normalMatrix, const glm::mat4& mvp, int materialIndex, SetupChunk& out) const {
+		ClipVertex polygon[16];
+		for (int i = 0; i < 3; i++) {
+			const float* vertex = vertices + i * SW_PRIMITIVE_STRIDE;
+			glm::vec4 position(vertex[0], vertex[1], vertex[2], 1.0f);
+			glm::vec4 world = model * position;
+
+			polygon[i].Clip = mvp * position;
+			polygon[i].Attr[0] = world.x;
+			polygon[i].Attr[1] = world.y;
+			polygon[i].Attr[2] = world.z;
+			//Normal through the normal matrix, same as the GL vertex shader
+			glm::vec3 normal = normalMatrix * glm::vec3(vertex[SW_PRIMITIVE_NORMAL_OFFSET], vertex[SW_PRIMITIVE_NORMAL_OFFSET + 1], vertex[SW_PRIMITIVE_NORMAL_OFFSET + 2]);
+			polygon[i].Attr[3] = normal.x;
+			polygon[i].Attr[4] = normal.y;
+			polygon[i].Attr[5] = normal.z;
+			polygon[i].Attr[6] = vertex[SW_PRIMITIVE_UV_OFFSET];
+			polygon[i].Attr[7] = vertex[SW_PRIMITIVE_UV_OFFSET + 1];
+		}
+
+		int count = ClipTriangle(polygon);
+
+		//Fan out whatever the clipper left
+		for (int i = 1; i + 1 < count; i++) {
+			SetupAndBin(polygon[0], polygon[i], polygon[i + 1], materialIndex, out);
+		}
+	}
+
+	//Sutherland-Hodgman against near/far and the guard band, in place. Returns the vertex count.
+	int ClipTriangle(ClipVertex* polygon) const {
+		const glm::vec4 planes[6] = {
+			glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),           //near:  z >= -w
+			glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),          //far:   z <= w
+			glm::vec4(1.0f, 0.0f, 0.0f, SW_GUARD_BAND),  //left
+			glm::vec4(-1.0f, 0.0f, 0.0f, SW_GUARD_BAND), //right
+			glm::vec4(0.0f, 1.0f, 0.0f, SW_GUARD_BAND),  //bottom
+			glm::vec4(0.0f, -1.0f, 0.0f, SW_GUARD_BAND)  //top
+		};
+
+		//Fast path, most triangles are fully inside
+		bool allInside = true;
+		for (int p = 0; p < 6 && allInside; p++) {
+			for (int i = 0; i < 3; i++) {
+				if (glm::dot(planes[p], polygon[i].Clip) < 0.0f) {
+					allInside = false;
+					break;
+				}
+			}
+		}
+		if (allInside) {
+			return 3;
+		}
+
+		ClipVertex scratch[16];
+		ClipVertex* in = polygon;
+		ClipVertex* out = scratch;
+		int count = 3;
+
+		for (int p = 0; p < 6 && count > 0; p++) {
+			int outCount = 0;
+			for (int i = 0; i < count; i++) {
+				const ClipVertex& a = in[i];
+				const ClipVertex& b = in[(i + 1) % count];
+				float da = glm::dot(planes[p], a.Clip);
+				float db = glm::dot(planes[p], b.Clip);
+
+				if (da >= 0.0f) {
+					out[outCount++] = a;
+				}
+				if ((da >= 0.0f) != (db >= 0.0f)) {
+					float t = da / (da - db);
+					ClipVertex& v = out[outCount++];
+					v.Clip = glm::mix(a.Clip, b.Clip, t);
+					for (int k = 0; k < ATTR_COUNT; k++) {
+						v.Attr[k] = a.Attr[k] + (b.Attr[k] - a.Attr[k]) * t;
+					}
+				}
+			}
+			swap(in, out);
+			count = outCount;
+		}
+
+		if (in != polygon) {
+			for (int i = 0; i < count; i++) {
+				polygon[i] = in[i];
+			}
+		}
+		return count;
+	}
+
+	//Projects to the screen, builds the edge functions and adds the triangle to every tile it touches
+	void SetupAndBin(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, int materialIndex, SetupChunk& out) const {
+		const ClipVertex* verts[3] = { &v0, &v1, &v2 };
+
+		SetupTriangle tri;
+		glm::vec2 screen[3];
+		for (int i = 0; i < 3; i++) {
+			float invW = 1.0f / verts[i]->Clip.w;
+			glm::vec3 ndc = glm::vec3(verts[i]->Clip) * invW;
+
+			//Row 0 is the top of the image
+			screen[i].x = (ndc.x * 0.5f + 0.5f) * width;
+			screen[i].y = (0.5f - ndc.y * 0.5f) * height;
+
+			tri.Depth[i] = ndc.z * 0.5f + 0.5f;
+			tri.InvW[i] = invW;
+			for (int k = 0; k < ATTR_COUNT; k++) {
+				tri.AttrOverW[i][k] = verts[i]->Attr[k] * invW;
+			}
+		}
+
+		float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+		if (fabs(area) < 1e-8f) {
+			return;
+		}
+
+		//Culling is off in the GL path, so both windings are kept. Each edge is built from its endpoints in a fixed order
+		//(top to bottom, then left to right) and only then flipped so inside is positive: flipping is exact, so two
+		//triangles sharing an edge get exactly opposite values there and never both cover a pixel.
+		tri.InvArea = fabs(1.0f / area);
+		tri.TopLeft = 0;
+		for (int i = 0; i < 3; i++) {
+			glm::vec2 a = screen[(i + 1) % 3];
+			glm::vec2 b = screen[(i + 2) % 3];
+			bool swapped = b.y < a.y || (b.y == a.y && b.x < a.x);
+			if (swapped) {
+				swap(a, b);
+			}
+			float sign = (swapped != (area < 0.0f)) ? -1.0f : 1.0f;
+			tri.EdgeA[i] = -(b.y - a.y) * sign;
+			tri.EdgeB[i] = (b.x - a.x) * sign;
+			tri.EdgeC[i] = ((b.y - a.y) * a.x - (b.x - a.x) * a.y) * sign;
+
+			//Top-left rule: a pixel center on the edge belongs to the triangle on its right (left edge) or below it
+			//(flat top edge, rows grow downwards). The other triangle's edge faces the opposite way, so exactly one owns it.
+			if (tri.EdgeA[i] > 0.0f || (tri.EdgeA[i] == 0.0f && tri.EdgeB[i] > 0.0f)) {
+				tri.TopLeft |= 1 << i;
+			}
+		}
+
+		float minX = min(screen[0].x, min(screen[1].x, screen[2].x));
+		float maxX = max(screen[0].x, max(screen[1].x, screen[2].x));
+		float minY = min(screen[0].y, min(screen[1].y, screen[2].y));
+		float maxY = max(screen[0].y, max(screen[1].y, screen[2].y));
+
+		tri.MinX = max(0, (int)floor(minX));
+		tri.MinY = max(0, (int)floor(minY));
+		tri.MaxX = min(width - 1, (int)ceil(maxX));
+		tri.MaxY = min(height - 1, (int)ceil(maxY));
+		tri.Material = materialIndex;
+
+		if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY) {
+			return;
+		}
+
+		uint32_t index = (uint32_t)out.Triangles.size();
+		bool binned = false;
+
+		for (int ty = tri.MinY / SW_TILE_SIZE; ty <= tri.MaxY / SW_TILE_SIZE; ty++) {
+			for (int tx = tri.MinX / SW_TILE_SIZE; tx <= tri.MaxX / SW_TILE_SIZE; tx++) {
+				if (!TriangleTouchesTile(tri, tx, ty)) {
+					continue;
+				}
+				out.BinEntries.push_back(make_pair(ty * tilesX + tx, index));
+				binned = true;
+			}
+		}
+
+		if (binned) {
+			out.Triangles.push_back(tri);
+		}
+	}
+
+	//Rejects the tile when all four corners are outside the same edge
+	bool TriangleTouchesTile(const SetupTriangle& tri, int tileX, int tileY) const {
+		float x0 = (float)(tileX * SW_TILE_SIZE);
+		float y0 = (float)(tileY * SW_TILE_SIZE);
+		float x1 = x0 + SW_TILE_SIZE;
+		float y1 = y0 + SW_TILE_SIZE;
+
+		for (int e = 0; e < 3; e++) {
+			//Corner furthest along the edge normal
+			float x = (tri.EdgeA[e] >= 0.0f) ? x1 : x0;
+			float y = (tri.EdgeB[e] >= 0.0f) ? y1 : y0;
+			if (tri.EdgeA[e] * x + tri.EdgeB[e] * y + tri.EdgeC[e] < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Rasterizes one tile into tile local, quad ordered buffers, then copies the result out. Returns fragments shaded.
+	size_t RasterizeTile(int tileIndex) {
+		int tileX0 = (tileIndex % tilesX) * SW_TILE_SIZE;
+		int tileY0 = (tileIndex / tilesX) * SW_TILE_SIZE;
+		int tileX1 = min(tileX0 + SW_TILE_SIZE, width);
+		int tileY1 = min(tileY0 + SW_TILE_SIZE, height);
+
+		//Quad ordered so the four depths of a 2x2 quad are one SIMD load
+		float depth[SW_TILE_SIZE * SW_TILE_SIZE];
+		float color[SW_TILE_SIZE * SW_TILE_SIZE * 3];
+		for (int i = 0; i < SW_TILE_SIZE * SW_TILE_SIZE; i++) {
+			depth[i] = 1.0f;
+			color[i * 3] = clear.r;
+			color[i * 3 + 1] = clear.g;
+			color[i * 3 + 2] = clear.b;
+		}
+
+		size_t fragments = 0;
+		const Quad4 laneX(0.5f, 1.5f, 0.5f, 1.5f);
+		const Quad4 laneY(0.5f, 0.5f, 1.5f, 1.5f);
+
+		for (uint32_t triIndex : tileBins[tileIndex]) {
+			const SetupTriangle& tri = triangles[triIndex];
+
+			//Quads start on even pixels, tiles are even sized so this stays inside the tile
+			int minX = max(tri.MinX, tileX0) & ~1;
+			int minY = max(tri.MinY, tileY0) & ~1;
+			int maxX = min(tri.MaxX, tileX1 - 1);
+			int maxY = min(tri.MaxY, tileY1 - 1);
+
+			Quad4 a0(tri.EdgeA[0]), a1(tri.EdgeA[1]), a2(tri.EdgeA[2]);
+			Quad4 b0(tri.EdgeB[0]), b1(tri.EdgeB[1]), b2(tri.EdgeB[2]);
+			Quad4 c0(tri.EdgeC[0]), c1(tri.EdgeC[1]), c2(tri.EdgeC[2]);
+			Quad4 z0(tri.Depth[0]), z1(tri.Depth[1]), z2(tri.Depth[2]);
+			Quad4 invArea(tri.InvArea);
+
+			for (int qy = minY; qy <= maxY; qy += 2) {
+				Quad4 py = Quad4((float)qy) + laneY;
+
+				//Lanes hanging off the bottom/right of the screen
+				int rowMask = (qy + 1 < tileY1) ? 0xF : 0x3;
+
+				for (int qx = minX; qx <= maxX; qx += 2) {
+					Quad4 px = Quad4((float)qx) + laneX;
+
+					Quad4 e0 = a0 * px + b0 * py + c0;
+					Quad4 e1 = a1 * px + b1 * py + c1;
+					Quad4 e2 = a2 * px + b2 * py + c2;
+
+					//On an edge counts as inside only for the edges that own it
+					int mask = ((tri.TopLeft & 1) ? NonNegativeMask(e0) : PositiveMask(e0))
+						& ((tri.TopLeft & 2) ? NonNegativeMask(e1) : PositiveMask(e1))
+						& ((tri.TopLeft & 4) ? NonNegativeMask(e2) : PositiveMask(e2)) & rowMask;
+					if (qx + 1 >= tileX1) {
+						mask &= 0x5;
+					}
+					if (!mask) {
+						continue;
+					}
+
+					int quadIndex = (((qy - tileY0) / 2) * (SW_TILE_SIZE / 2) + (qx - tileX0) / 2) * 4;
+					Quad4 w0 = e0 * invArea, w1 = e1 * invArea, w2 = e2 * invArea;
+					Quad4 z = w0 * z0 + w1 * z1 + w2 * z2;
+
+					//GL_LESS
+					mask &= LessMask(z, Quad4::Load(&depth[quadIndex]));
+					if (!mask) {
+						continue;
+					}
+
+					fragments += ShadeQuad(tri, w0, w1, w2, z, mask, &depth[quadIndex], &color[quadIndex * 3]);
+				}
+			}
+		}
+
+		//Resolve to the linear RGB8 framebuffer
+		for (int y = tileY0; y < tileY1; y++) {
+			for (int x = tileX0; x < tileX1; x++) {
+				int quadIndex = (((y - tileY0) / 2) * (SW_TILE_SIZE / 2) + (x - tileX0) / 2) * 4 + ((y - tileY0) & 1) * 2 + ((x - tileX0) & 1);
+				unsigned char* dst = &ColorBuffer[((size_t)y * width + x) * 3];
+				for (int c = 0; c < 3; c++) {
+					float value = min(max(color[quadIndex * 3 + c], 0.0f), 1.0f);
+					dst[c] = (unsigned char)(value * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		return fragments;
+	}
+
+	//Interpolates the attributes for the whole quad (the uv derivatives come from neighbouring lanes) and shades the covered lanes
+	int ShadeQuad(const SetupTriangle& tri, const Quad4& w0, const Quad4& w1, const Quad4& w2, const Quad4& z, int mask, float* depth, float* color) const {
+		Quad4 invW = w0 * Quad4(tri.InvW[0]) + w1 * Quad4(tri.InvW[1]) + w2 * Quad4(tri.InvW[2]);
+		Quad4 perspective = Quad4(1.0f) / invW;
+
+		Quad4 attr[ATTR_COUNT];
+		for (int k = 0; k < ATTR_COUNT; k++) {
+			attr[k] = (w0 * Quad4(tri.AttrOverW[0][k]) + w1 * Quad4(tri.AttrOverW[1][k]) + w2 * Quad4(tri.AttrOverW[2][k])) * perspective;
+		}
+
+		float u[4], v[4];
+		attr[6].Store(u);
+		attr[7].Store(v);
+		glm::vec2 uvDx(u[1] - u[0], v[1] - v[0]);
+		glm::vec2 uvDy(u[2] - u[0], v[2] - v[0]);
+
+		Quad3 result = ShadeFragments(materials[tri.Material], Quad3(attr[0], attr[1], attr[2]), Quad3(attr[3], attr[4], attr[5]), u, v, uvDx, uvDy, mask);
+
+		float depths[4], red[4], green[4], blue[4];
+		z.Store(depths);
+		result.X.Store(red);
+		result.Y.Store(green);
+		result.Z.Store(blue);
+
+		int shaded = 0;
+		for (int lane = 0; lane < 4; lane++) {
+			if (!(mask & (1 << lane))) {
+				continue;
+			}
+			depth[lane] = depths[lane];
+			color[lane * 3] = red[lane];
+			color[lane * 3 + 1] = green[lane];
+			color[lane * 3 + 2] = blue[lane];
+			shaded++;
+		}
+		return shaded;
+	}
+
+	//Unbound texture units read back as black in GL
+	glm::vec4 SampleOrBlack(const SoftwareTexture* texture, const glm::vec2& uv, const glm::vec2& uvDx, const glm::vec2& uvDy) const {
+		if (texture == NULL) {
+			return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+		return texture->Sample(uv, uvDx, uvDy);
+	}
+
+	//Diffuse and specular texels of one pixel, overlay blended in like the shader does
+	void SampleMaterial(const SoftwareMaterial& material, const glm::vec2& uv, const glm::vec2& uvDx, const glm::vec2& uvDy, glm::vec3& diffuseColor, glm::vec3& specularColor) const {
+		if (material.UseOverlayTexture) {
+			glm::vec2 overlayScale(2.0f, 1.0f);
+			glm::vec2 overlayUV = uv * overlayScale;
+			glm::vec2 overlayDx = uvDx * overlayScale;
+			glm::vec2 overlayDy = uvDy * overlayScale;
+
+			glm::vec4 overlayDiffuse = SampleOrBlack(material.OverlayDiffuse, overlayUV, overlayDx, overlayDy);
+			glm::vec4 overlaySpecular = SampleOrBlack(material.OverlaySpecular, overlayUV, overlayDx, overlayDy);
+
+			diffuseColor = glm::mix(glm::vec3(SampleOrBlack(material.Diffuse, overlayUV, overlayDx, overlayDy)), glm::vec3(overlayDiffuse), overlayDiffuse.a);
+			specularColor = glm::mix(glm::vec3(SampleOrBlack(material.Specular, overlayUV, overlayDx, overlayDy)), glm::vec3(overlaySpecular), overlaySpecular.a);
+		}
+		else {
+			diffuseColor = glm::vec3(SampleOrBlack(material.Diffuse, uv, uvDx, uvDy));
+			specularColor = glm::vec3(SampleOrBlack(material.Specular, uv, uvDx, uvDy));
+		}
+	}
+
+	//Ambient + diffuse + specular for one light on all four lanes, before attenuation
+	Quad3 Phong(const Quad3& lightDir, const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular,
+		const Quad3& normal, const Quad3& viewDir, const Quad3& diffuseColor, const Quad3& specularColor, float shininess) const {
+		Quad4 normalDotLight = Dot(normal, lightDir);
+		Quad4 diff = Max(normalDotLight, Quad4(0.0f));
+
+		//reflect(-lightDir, normal)
+		Quad3 reflectDir = normal * (normalDotLight * Quad4(2.0f)) - lightDir;
+		Quad4 spec = Pow(Max(Dot(viewDir, reflectDir), Quad4(0.0f)), shininess);
+
+		return diffuseColor * (Quad3(ambient) + Quad3(diffuse) * diff) + specularColor * (Quad3(specular) * spec);
+	}
+
+	//Distance attenuation of a point or spot light on all four lanes
+	Quad4 Attenuation(const Quad3& toLight, float constant, float linear, float quadratic) const {
+		Quad4 distanceSquared = Dot(toLight, toLight);
+		Quad4 distance = Sqrt(distanceSquared);
+		return Quad4(1.0f) / (Quad4(constant) + Quad4(linear) * distance + Quad4(quadratic) * distanceSquared);
+	}
+
+	//C++ port of main() in sampleMultiLightFragm.glsl for the four pixels of a quad. Textures are sampled per covered
+	//lane (SSE2 has no gather), the lighting runs on all four lanes at once and the caller keeps the covered ones.
+	Quad3 ShadeFragments(const SoftwareMaterial& material, const Quad3& fragPos, const Quad3& normal, const float* u, const float* v,
+		const glm::vec2& uvDx, const glm::vec2& uvDy, int mask) const {
+		if (material.Unlit) {
+			return Quad3(material.UnlitColor);
+		}
+
+		Quad3 norm = Normalize(normal);
+		Quad3 viewDir = Normalize(Quad3(viewPosition) - fragPos);
+
+		//Every light reads the same texels, so sample once
+		float diffuse[3][4] = {}, specular[3][4] = {};
+		for (int lane = 0; lane < 4; lane++) {
+			if (!(mask & (1 << lane))) {
+				continue;
+			}
+			glm::vec3 diffuseColor, specularColor;
+			SampleMaterial(material, glm::vec2(u[lane], v[lane]), uvDx, uvDy, diffuseColor, specularColor);
+			for (int c = 0; c < 3; c++) {
+				diffuse[c][lane] = diffuseColor[c];
+				specular[c][lane] = specularColor[c];
+			}
+		}
+		Quad3 diffuseColor(Quad4::Load(diffuse[0]), Quad4::Load(diffuse[1]), Quad4::Load(diffuse[2]));
+		Quad3 specularColor(Quad4::Load(specular[0]), Quad4::Load(specular[1]), Quad4::Load(specular[2]));
+
+		Quad3 result(glm::vec3(0.0f));
+
+		//Phase 1: Directional Light
+		if (DirLight.Enabled) {
+			Quad3 lightDir(glm::normalize(-DirLight.Direction));
+			result = Phong(lightDir, DirLight.Ambient, DirLight.Diffuse, DirLight.Specular, norm, viewDir, diffuseColor, specularColor, material.Shininess);
+		}
+
+		//Phase 2: Point Lights
+		for (int i = 0; i < SW_NR_POINT_LIGHTS; i++) {
+			const SoftwarePointLight& light = PointLights[i];
+			Quad3 toLight = Quad3(light.Position) - fragPos;
+			Quad3 lightDir = Normalize(toLight);
+			Quad4 attenuation = Attenuation(toLight, light.Constant, light.Linear, light.Quadratic);
+
+			result = result + Phong(lightDir, light.Ambient, light.Diffuse, light.Specular, norm, viewDir, diffuseColor, specularColor, material.Shininess) * attenuation;
+		}
+
+		//Phase 3: Spot Light
+		if (SpotLight.Enabled) {
+			Quad3 toLight = Quad3(SpotLight.Position) - fragPos;
+			Quad3 lightDir = Normalize(toLight);
+			Quad4 attenuation = Attenuation(toLight, SpotLight.Constant, SpotLight.Linear, SpotLight.Quadratic);
+
+			Quad4 theta = Dot(lightDir, Quad3(glm::normalize(-SpotLight.Direction)));
+			Quad4 epsilon(SpotLight.CutOff - SpotLight.OuterCutOff);
+			Quad4 intensity = Min(Max((theta - Quad4(SpotLight.OuterCutOff)) / epsilon, Quad4(0.0f)), Quad4(1.0f));
+
+			result = result + Phong(lightDir, SpotLight.Ambient, SpotLight.Diffuse, SpotLight.Specular, norm, viewDir, diffuseColor, specularColor, material.Shininess) * (attenuation * intensity);
+		}
+
+		return result;
+	}
+};
+
+#endif
@@ -3,6 +3,14 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "glcontext.h"
+#include "camera.h"
+#include "lod.h"
+#include "shader.h"
+#include "tessellation.h"
+#include "procedural.h"
+#include "primitivegen.h"
+#include "angletable.h"
 
 #include <vector>
 #include <random>
@@ -25,11 +33,22 @@ public:
 	int SubDivisions;
 	bool SemiCircle;
 
-	//Vector of vertices
+	//Vector of vertices, empty when the object was generated straight into its buffer or ReleaseVertices was called
 	vector<float> Vertices;
 
+	//Vertices of the full detail mesh, valid whether or not Vertices is kept
+	int VertexCount = 0;
+
 	//VAO and VBO
-	unsigned int VAO, VBO;
+	unsigned int VAO = 0, VBO = 0;
+
+	//Level of detail chain, empty until GenerateLODs is called. Level 0 shares the VAO/VBO above.
+	vector<LODLevel> LODs;
+
+	//Coarse patch mesh for the tessellated path, empty until GeneratePatches is called
+	unsigned int PatchVAO = 0, PatchVBO = 0;
+	int PatchVertexCount = 0;
+	vector<float> PendingPatches; //Kept until UploadBuffers when built without a GL context
 
 	//Constructor - Uniform Sphere.
 	Sphere(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), float radius = 1.0f, int sides = 8, bool semiCircle = false)
@@ -45,11 +64,17 @@ public:
 		SideCount = sides;
 		SubDivisions = sides;
 
-		//Calculate the vertices
-		CalculateVertices();
+		//Calculate the vertices, straight into the VBO when no CPU copy is wanted
+		VertexCount = CalculateVertexCount(SideCount, SubDivisions);
+		bool upload = HasCurrentGLContext();
+		if (!upload || PrimitiveRetainsVertices()) {
+			CalculateVertices(SideCount, SubDivisions, Vertices);
+		}
 
 		//Generate the VAO/VBO
-		GenerateVertexArrayAndBuffer();
+		if (upload) {
+			GenerateVertexArrayAndBuffer();
+		}
 	}
 
 	//Constructor - Allows for differing longitude and latitude radius
@@ -66,11 +91,17 @@ public:
 		SideCount = sides;
 		SubDivisions = sides;
 
-		//Calculate the vertices
-		CalculateVertices();
+		//Calculate the vertices, straight into the VBO when no CPU copy is wanted
+		VertexCount = CalculateVertexCount(SideCount, SubDivisions);
+		bool upload = HasCurrentGLContext();
+		if (!upload || PrimitiveRetainsVertices()) {
+			CalculateVertices(SideCount, SubDivisions, Vertices);
+		}
 
 		//Generate the VAO/VBO
-		GenerateVertexArrayAndBuffer();
+		if (upload) {
+			GenerateVertexArrayAndBuffer();
+		}
 	}
 
 	//Binds the VAO associated with this object
@@ -81,153 +112,314 @@ public:
 	//Draws the object
 	void Draw() {
 		BindVAO();
-		glDrawArrays(GL_TRIANGLES, 0, (Vertices.size() / numVertexAttributes));
+		glDrawArrays(GL_TRIANGLES, 0, VertexCount);
 	}
 
 	//De-allocates the resources associated with the VAO/VBO
 	void DeallocateVertexArrayBuffers() {
+		GetResourceRegistry().ReleaseBuffer(VBO);
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
-	}
 
-private:
+		for (size_t i = 1; i < LODs.size(); i++) {
+			GetResourceRegistry().ReleaseBuffer(LODs[i].VBO);
+			glDeleteVertexArrays(1, &LODs[i].VAO);
+			glDeleteBuffers(1, &LODs[i].VBO);
+		}
+		LODs.clear();
 
-	const int numVertexAttributes = 11;
+		if (PatchVAO != 0) {
+			GetResourceRegistry().ReleaseBuffer(PatchVBO);
+			glDeleteVertexArrays(1, &PatchVAO);
+			glDeleteBuffers(1, &PatchVBO);
+			PatchVAO = PatchVBO = 0;
+		}
+	}
 
-	//Calculates the vertices that make up the plane
-	void CalculateVertices() {
-		// Generate vertices for a Sphere
-		glm::vec3 vertColor = glm::vec3(1.0f);
-		float u = 1.0f / static_cast<float>(SideCount - 1);
-		float v = 1.0f / static_cast<float>(SubDivisions);
+	//Builds the coarse patch mesh the tessellation shaders refine. Columns go around, rows go up.
+	void GeneratePatches(int columns = TESS_DEFAULT_PATCH_COLUMNS, int rows = TESS_DEFAULT_PATCH_ROWS) {
+		vector<float> patches;
+		AddPatchGrid(patches, columns, rows, TESS_SPHERE_BODY);
+		if (SemiCircle) {
+			AddPatchGrid(patches, columns, 1, TESS_SPHERE_CAP);
+		}
+		PatchVertexCount = (int)(patches.size() / TESS_PATCH_ATTRIBUTES);
 
-		glm::vec3 normals;
+		if (HasCurrentGLContext()) {
+			UploadPatchVertices(patches, PatchVAO, PatchVBO);
+		}
+		else {
+			PendingPatches.swap(patches);
+		}
+	}
 
-		//Limit the sides generated based on if its a semi circle or not. Doing on latitude (N/S) because my application has a semicircle facing downward.
-		int latitudeLimit = (SemiCircle)?SideCount / 2:SideCount;
+	//Sets the uniforms the tessellation and procedural shaders evaluate the surface from
+	void SetShapeUniforms(Shader& shader) {
+		shader.setVec3("shapeOrigin", Position);
+		//Semi circles stop at the equator
+		shader.setVec3("shapeSize", RadiusLong, RadiusLat, SemiCircle ? (float)(M_PI * 0.5) : (float)M_PI);
+	}
 
-		//Latitude Loop (N/S)
-		for (int i = 0; i < latitudeLimit; i++) {
-			float phi1 = static_cast<float>(M_PI * i) / (SideCount - 1);
-			float phi2 = static_cast<float>(M_PI * (i + 1)) / (SideCount - 1);
+	//Draws the analytic surface through the tessellation program, which must be in use with model/view/projection set
+	void DrawPatches(Shader& shader) {
+		SetShapeUniforms(shader);
+		DrawPatchArray(PatchVAO, PatchVertexCount);
+	}
 
-			// Longitude Loop (E/W) where the actual faces are drawn.
-			for (int j = 0; j < SubDivisions; j++) {
-				float theta1 = static_cast<float>(2.0f * M_PI * j) / SubDivisions;
-				float theta2 = static_cast<float>(2.0f * M_PI * (j + 1)) / SubDivisions;
+	//Draws without any vertex buffer, positions/normals/UVs come from the vertex ID in proceduralPrimitiveVertex.glsl.
+	//Reads the current dimensions and counts every call, so changing them shows up on the next draw.
+	void DrawProcedural(Shader& shader) {
+		SetShapeUniforms(shader);
+		//Latitude rows like CalculateVertices, half of them on a semi circle
+		DrawProceduralSurfaces(shader, TESS_SPHERE_BODY, 1, SubDivisions, SemiCircle ? SideCount / 2 : SideCount);
+		if (SemiCircle) {
+			DrawProceduralSurfaces(shader, TESS_SPHERE_CAP, 1, SideCount, 1);
+		}
+	}
 
-				// Vertex 1
-				glm::vec3 vert1 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, phi1, theta1);
+	//Builds reduced versions of this object, each level halves the side and subdivision counts.
+	//Stops early once the side count can't drop any further. Levels are written straight into their buffers when there is
+	//a current GL context, otherwise only described until UploadBuffers.
+	void GenerateLODs(int levelCount = LOD_DEFAULT_LEVELS) {
+		LODs.clear();
+
+		LODLevel full;
+		full.VAO = VAO;
+		full.VBO = VBO;
+		full.VertexCount = VertexCount;
+		full.SideCount = SideCount;
+		full.SubDivisions = SubDivisions;
+		LODs.push_back(full);
+
+		for (int i = 1; i < levelCount; i++) {
+			int sides = max(LOD_MIN_SIDES, SideCount >> i);
+			int subdivisions = max(1, SubDivisions >> i);
+			if (sides >= LODs.back().SideCount) {
+				break;
+			}
 
-				// Vertex 2
-				glm::vec3 vert2 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, phi1, theta2);
+			LODLevel level;
+			level.VertexCount = CalculateVertexCount(sides, subdivisions);
+			level.SideCount = sides;
+			level.SubDivisions = subdivisions;
+			if (HasCurrentGLContext()) {
+				GenerateLODBuffer(level);
+			}
+			LODs.push_back(level);
+		}
+	}
 
-				// Vertex 3
-				glm::vec3 vert3 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, phi2, theta1);
+	//Picks the level to draw from how large the bounding sphere is on screen
+	int SelectLOD(Camera& camera, const glm::mat4& model, const glm::mat4& projection, float viewportHeight, int currentLevel) {
+		if (LODs.size() < 2) {
+			return 0;
+		}
 
-				// Vertex 4
-				glm::vec3 vert4 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, phi2, theta2);
+		glm::vec3 worldCenter;
+		float worldRadius;
+		TransformBoundingSphere(model, Position, max(RadiusLong, RadiusLat), worldCenter, worldRadius);
 
-				glm::vec3 edge1 = vert3 - vert1;
-				glm::vec3 edge2 = vert2 - vert1;
-				normals = glm::normalize(glm::cross(edge1, edge2));
+		float pixelRadius = camera.GetProjectedRadius(worldCenter, worldRadius, projection, viewportHeight);
+		return SelectLODLevel(pixelRadius, currentLevel, (int)LODs.size());
+	}
 
-				// Right triangle
-				AddVertex(vert1.x, vert1.y, vert1.z, vertColor, normals, 1.0f - (u * j), v * i);
-				AddVertex(vert2.x, vert2.y, vert2.z, vertColor, normals, 1.0f - (u * (j + 1)), v * i);
-				AddVertex(vert3.x, vert3.y, vert3.z, vertColor, normals, 1.0f - (u * j), v * (i + 1));
+	//Draws one level of the chain, falls back to the full object when there is no chain
+	void DrawLOD(int level) {
+		if (LODs.empty()) {
+			Draw();
+			GetLODCounters().TrianglesDrawn += VertexCount / 3;
+			GetLODCounters().TrianglesFullDetail += VertexCount / 3;
+			GetLODCounters().DrawsPerLevel[0]++;
+			return;
+		}
+
+		level = min(max(level, 0), (int)LODs.size() - 1);
+		glBindVertexArray(LODs[level].VAO);
+		glDrawArrays(GL_TRIANGLES, 0, LODs[level].VertexCount);
 
-				edge1 = vert2 - vert4;
-				edge2 = vert3 - vert4;
-				normals = glm::normalize(glm::cross(edge1, edge2));
+		GetLODCounters().TrianglesDrawn += LODs[level].VertexCount / 3;
+		GetLODCounters().TrianglesFullDetail += LODs[0].VertexCount / 3;
+		GetLODCounters().DrawsPerLevel[level]++;
+	}
 
-				// Left triangle
-				AddVertex(vert2.x, vert2.y, vert2.z, vertColor, normals, 1.0f - (u * (j + 1)), v * i);
-				AddVertex(vert4.x, vert4.y, vert4.z, vertColor, normals, 1.0f - (u * (j + 1)), v * (i + 1));
-				AddVertex(vert3.x, vert3.y, vert3.z, vertColor, normals, 1.0f - (u * j), v * (i + 1));
+	//Uploads whatever was built on a thread without a GL context: the object itself, its LOD levels and its patches.
+	//LOD levels nobody reads on the CPU are generated here, straight into their mapped buffers.
+	void UploadBuffers() {
+		if (VAO == 0) {
+			GenerateVertexArrayAndBuffer();
+			if (!LODs.empty()) {
+				LODs[0].VAO = VAO;
+				LODs[0].VBO = VBO;
 			}
 		}
+		for (size_t i = 1; i < LODs.size(); i++) {
+			if (LODs[i].VAO == 0) {
+				GenerateLODBuffer(LODs[i]);
+			}
+		}
+		if (PatchVAO == 0 && !PendingPatches.empty()) {
+			UploadPatchVertices(PendingPatches, PatchVAO, PatchVBO);
+			vector<float>().swap(PendingPatches);
+		}
+	}
 
-		// If this is a semi-circle, we need to cap it. Full sphere doesnt require a cap.
-		if (SemiCircle) {
-			normals = glm::vec3(0.0f, -1.0f, 0.0);
-
-			for (int i = 0; i <= SideCount; ++i) {
+	//Writes the full detail vertices (VertexCount of them) at destination, a caller owned array or mapped buffer
+	void WriteVertices(float* destination) {
+		CalculateVertices(SideCount, SubDivisions, destination);
+	}
 
-				float curTheta = (float)(2.0f * M_PI * i) / SideCount;
-				float nxtTheta = (float)(2.0f * M_PI * (i + 1)) / SideCount;
+	//Frees the CPU copy of the vertices once the buffer holds them. Drawing keeps working, CPU consumers
+	//(BVH, software renderer, megabuffer) must have taken what they need first.
+	void ReleaseVertices() {
+		if (VAO != 0) {
+			vector<float>().swap(Vertices);
+		}
+	}
 
-				float curX = Position.x + RadiusLong * cos(curTheta);
-				float curZ = Position.z + RadiusLong * sin(curTheta);
+	//Generates the VAO and VBO for the object. Needs a current GL context, the constructor skips it when there is none (headless).
+	void GenerateVertexArrayAndBuffer() {
 
-				float nxtX = Position.x + RadiusLong * cos(nxtTheta);
-				float nxtZ = Position.z + RadiusLong * sin(nxtTheta);
+		//Copy the CPU vertices when there are some, otherwise generate them in the mapped buffer (no CPU copy at all)
+		if (!Vertices.empty()) {
+			UploadPrimitiveVertices(Vertices, VAO, VBO);
+		}
+		else {
+			GeneratePrimitiveVertexBuffer(VertexCount, VAO, VBO, [this](float* vertices) {
+				WriteVertices(vertices);
+			});
+		}
 
-				float textureCurThetaU = 1.0f * cos(curTheta);
-				float textureCurThetaV = 1.0f * sin(curTheta);
+		//Level 0 of the chain is this object
+		if (!LODs.empty()) {
+			LODs[0].VAO = VAO;
+			LODs[0].VBO = VBO;
+		}
+	}
 
-				float textureNxtThetaU = 1.0f * cos(nxtTheta);
-				float textureNxtThetaV = 1.0f * sin(nxtTheta);
+private:
 
-				// Triangle connecting the center, current, and next vertices
-				AddVertex(Position.x, Position.y, Position.z, vertColor, normals, 0.0f, 0.0f); //Center
-				AddVertex(curX, Position.y, curZ, vertColor, normals, textureCurThetaU, textureCurThetaV);
-				AddVertex(nxtX, Position.y, nxtZ, vertColor, normals, textureNxtThetaU, textureNxtThetaV);
+	const int numVertexAttributes = 11;
 
-			}
-		}
+	//Generates a reduced level straight into its own buffer
+	void GenerateLODBuffer(LODLevel& level) {
+		GeneratePrimitiveVertexBuffer(level.VertexCount, level.VAO, level.VBO, [this, &level](float* vertices) {
+			CalculateVertices(level.SideCount, level.SubDivisions, vertices);
+		});
 	}
 
-	//Helper function to calculate the vertices for the sphere.
-	glm::vec3 CalculateSphereVertex(const glm::vec3& position, float radiusLong, float radiusLat, float phi, float theta) {
-		float x = position.x + radiusLong * sin(phi) * cos(theta);
-		float y = position.y + radiusLat * cos(phi);
-		float z = position.z + radiusLong * sin(phi) * sin(theta);
-		return glm::vec3(x, y, z);
+	//Number of vertices CalculateVertices writes: two triangles per latitude/longitude cell, plus the cap of a semi circle
+	int CalculateVertexCount(int sides, int subdivisions) const {
+		int latitudeLimit = (SemiCircle) ? sides / 2 : sides;
+		return latitudeLimit * subdivisions * 6 + (SemiCircle ? (sides + 1) * 3 : 0);
 	}
 
-	//Helper function to add the vertices
-	void AddVertex(float x, float y, float z, const glm::vec3& color, const glm::vec3& normals, float u, float v) {
-		Vertices.push_back(x);
-		Vertices.push_back(y);
-		Vertices.push_back(z);
-		Vertices.push_back(color.r);
-		Vertices.push_back(color.g);
-		Vertices.push_back(color.b);
-		Vertices.push_back(normals.x);
-		Vertices.push_back(normals.y);
-		Vertices.push_back(normals.z);
-		Vertices.push_back(u);
-		Vertices.push_back(v);
+	//Sizes vertices and calculates them into it
+	void CalculateVertices(int sides, int subdivisions, vector<float>& vertices) {
+		vertices.resize((size_t)CalculateVertexCount(sides, subdivisions) * numVertexAttributes);
+		CalculateVertices(sides, subdivisions, vertices.data());
 	}
 
-	//Generates the VAO and VBO for the object
-	void GenerateVertexArrayAndBuffer() {
+	//Calculates the vertices for the given side/subdivision counts (also used for the reduced LOD levels).
+	//Writes CalculateVertexCount vertices at vertices, a CPU array or a mapped buffer. Every latitude row (and cap
+	//triangle) writes its own range, so large meshes are generated in parallel.
+	void CalculateVertices(int sides, int subdivisions, float* vertices) {
+		// Generate vertices for a Sphere
+		glm::vec3 vertColor = glm::vec3(1.0f);
+		float u = 1.0f / static_cast<float>(sides - 1);
+		float v = 1.0f / static_cast<float>(subdivisions);
 
-		//Gen the vertex array
-		glGenVertexArrays(1, &VAO);
-		glBindVertexArray(VAO);
+		//Limit the sides generated based on if its a semi circle or not. Doing on latitude (N/S) because my application has a semicircle facing downward.
+		int latitudeLimit = (SemiCircle)?sides / 2:sides;
+
+		//Layout: latitude rows, then the cap
+		int rowVertices = subdivisions * 6;
+		int capTriangles = SemiCircle ? sides + 1 : 0;
+		float* rowStart = vertices;
+		float* capStart = rowStart + (size_t)latitudeLimit * rowVertices * numVertexAttributes;
+
+		//Latitude angles step over half a circle, longitude and cap angles around a full one
+		const AngleRing& latitude = GetAngleRing(sides - 1, true);
+		const AngleRing& longitude = GetAngleRing(subdivisions);
+		const AngleRing& cap = GetAngleRing(sides);
+
+		ParallelForPrimitive(max(latitudeLimit, capTriangles), rowVertices, [&](int i) {
 
-		//Gen and bind the buffer
-		glGenBuffers(1, &VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), &Vertices[0], GL_STATIC_DRAW);
-
-		//Configure the Buffer Attributes
-
-		//Position (x, y, z)
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		// color attribute (r, g, b)
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-		// normals attribute (x, y, z)
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		// texture attribute (U, V)
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, numVertexAttributes * sizeof(float), (void*)(9 * sizeof(float)));
-		glEnableVertexAttribArray(3);
+			//Latitude row (N/S)
+			if (i < latitudeLimit) {
+				float* out = rowStart + (size_t)i * rowVertices * numVertexAttributes;
 
+				float sinPhi1 = latitude.Sin[i], cosPhi1 = latitude.Cos[i];
+				float sinPhi2 = latitude.Sin[i + 1], cosPhi2 = latitude.Cos[i + 1];
+
+				// Longitude Loop (E/W) where the actual faces are drawn.
+				for (int j = 0; j < subdivisions; j++) {
+					float sinTheta1 = longitude.Sin[j], cosTheta1 = longitude.Cos[j];
+					float sinTheta2 = longitude.Sin[j + 1], cosTheta2 = longitude.Cos[j + 1];
+
+					// Vertex 1
+					glm::vec3 vert1 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, sinPhi1, cosPhi1, sinTheta1, cosTheta1);
+
+					// Vertex 2
+					glm::vec3 vert2 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, sinPhi1, cosPhi1, sinTheta2, cosTheta2);
+
+					// Vertex 3
+					glm::vec3 vert3 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, sinPhi2, cosPhi2, sinTheta1, cosTheta1);
+
+					// Vertex 4
+					glm::vec3 vert4 = CalculateSphereVertex(Position, RadiusLong, RadiusLat, sinPhi2, cosPhi2, sinTheta2, cosTheta2);
+
+					//Outward facing, the lit shaders turn normals with the normal matrix
+					glm::vec3 edge1 = vert3 - vert1;
+					glm::vec3 edge2 = vert2 - vert1;
+					glm::vec3 normals = glm::normalize(glm::cross(edge2, edge1));
+
+					// Right triangle
+					out = WritePrimitiveVertex(out, vert1.x, vert1.y, vert1.z, vertColor, normals, 1.0f - (u * j), v * i);
+					out = WritePrimitiveVertex(out, vert2.x, vert2.y, vert2.z, vertColor, normals, 1.0f - (u * (j + 1)), v * i);
+					out = WritePrimitiveVertex(out, vert3.x, vert3.y, vert3.z, vertColor, normals, 1.0f - (u * j), v * (i + 1));
+
+					edge1 = vert2 - vert4;
+					edge2 = vert3 - vert4;
+					normals = glm::normalize(glm::cross(edge2, edge1));
+
+					// Left triangle
+					out = WritePrimitiveVertex(out, vert2.x, vert2.y, vert2.z, vertColor, normals, 1.0f - (u * (j + 1)), v * i);
+					out = WritePrimitiveVertex(out, vert4.x, vert4.y, vert4.z, vertColor, normals, 1.0f - (u * (j + 1)), v * (i + 1));
+					out = WritePrimitiveVertex(out, vert3.x, vert3.y, vert3.z, vertColor, normals, 1.0f - (u * j), v * (i + 1));
+				}
+			}
+
+			// If this is a semi-circle, we need to cap it. Full sphere doesnt require a cap.
+			if (i < capTriangles) {
+				glm::vec3 normals = glm::vec3(0.0f, -1.0f, 0.0);
+
+				float curX = Position.x + RadiusLong * cap.Cos[i];
+				float curZ = Position.z + RadiusLong * cap.Sin[i];
+
+				float nxtX = Position.x + RadiusLong * cap.Cos[i + 1];
+				float nxtZ = Position.z + RadiusLong * cap.Sin[i + 1];
+
+				float textureCurThetaU = cap.Cos[i];
+				float textureCurThetaV = cap.Sin[i];
+
+				float textureNxtThetaU = cap.Cos[i + 1];
+				float textureNxtThetaV = cap.Sin[i + 1];
+
+				// Triangle connecting the center, current, and next vertices
+				float* out = capStart + (size_t)i * 3 * numVertexAttributes;
+				out = WritePrimitiveVertex(out, Position.x, Position.y, Position.z, vertColor, normals, 0.0f, 0.0f); //Center
+				out = WritePrimitiveVertex(out, curX, Position.y, curZ, vertColor, normals, textureCurThetaU, textureCurThetaV);
+				out = WritePrimitiveVertex(out, nxtX, Position.y, nxtZ, vertColor, normals, textureNxtThetaU, textureNxtThetaV);
+			}
+		});
+	}
+
+	//Helper function to calculate the vertices for the sphere, from the ring values of its latitude (phi) and longitude (theta)
+	glm::vec3 CalculateSphereVertex(const glm::vec3& position, float radiusLong, float radiusLat, float sinPhi, float cosPhi, float sinTheta, float cosTheta) {
+		float x = position.x + radiusLong * sinPhi * cosTheta;
+		float y = position.y + radiusLat * cosPhi;
+		float z = position.z + radiusLong * sinPhi * sinTheta;
+		return glm::vec3(x, y, z);
 	}
 
 	//Generates a random color for the object's vertices
@@ -0,0 +1,87 @@
+#ifndef TESSELLATION_H
+#define TESSELLATION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "glcontext.h"
+#include "resourceregistry.h"
+
+#include <vector>
+
+using namespace std;
+
+//Every patch is a quad in parameter space, corners (u0,v0) (u1,v0) (u1,v1) (u0,v1)
+const int TESS_PATCH_VERTICES = 4;
+
+//Floats per patch vertex: u, v and the surface the shaders should evaluate
+const int TESS_PATCH_ATTRIBUTES = 3;
+
+//Default patch grid, coarse on purpose. Detail comes from the tessellator.
+const int TESS_DEFAULT_PATCH_COLUMNS = 8;
+const int TESS_DEFAULT_PATCH_ROWS = 2;
+
+//Target on screen length of a tessellated edge, in pixels
+const float TESS_DEFAULT_PIXELS_PER_EDGE = 8.0f;
+
+//Surfaces understood by tessPrimitiveVertex.glsl/tessPrimitiveEval.glsl, must match the defines there
+enum TessSurface {
+	TESS_CYLINDER_SIDE = 0,
+	TESS_CYLINDER_BOTTOM = 1,
+	TESS_CYLINDER_TOP = 2,
+	TESS_SPHERE_BODY = 3,
+	TESS_SPHERE_CAP = 4
+};
+
+//Tessellation shaders are core in GL 4.0, the scene asks for more but may have been given 3.3
+inline bool IsTessellationSupported() {
+	return HasCurrentGLContext() && GLAD_GL_VERSION_4_0;
+}
+
+//Highest tessellation level the driver allows (64 on everything current)
+inline float GetMaxTessellationLevel() {
+	int maxLevel = 64;
+	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+	return (float)maxLevel;
+}
+
+//Appends one quad patch covering [u0,u1] x [v0,v1] of a surface
+inline void AddPatch(vector<float>& patches, float u0, float v0, float u1, float v1, TessSurface surface) {
+	const float corners[TESS_PATCH_VERTICES][2] = { { u0, v0 }, { u1, v0 }, { u1, v1 }, { u0, v1 } };
+	for (int i = 0; i < TESS_PATCH_VERTICES; i++) {
+		patches.push_back(corners[i][0]);
+		patches.push_back(corners[i][1]);
+		patches.push_back((float)surface);
+	}
+}
+
+//Appends a grid of patches over the whole [0,1] x [0,1] parameter range of a surface
+inline void AddPatchGrid(vector<float>& patches, int columns, int rows, TessSurface surface) {
+	for (int row = 0; row < rows; row++) {
+		for (int column = 0; column < columns; column++) {
+			AddPatch(patches, (float)column / columns, (float)row / rows, (float)(column + 1) / columns, (float)(row + 1) / rows, surface);
+		}
+	}
+}
+
+//Uploads patch vertices, only attribute 0 is used (u, v, surface)
+inline void UploadPatchVertices(const vector<float>& patches, unsigned int& vao, unsigned int& vbo) {
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, patches.size() * sizeof(float), &patches[0], GL_STATIC_DRAW);
+	GetResourceRegistry().TrackBuffer(vbo, RESOURCE_VERTEX_BUFFER, patches.size() * sizeof(float), "tessellation patches");
+
+	glVertexAttribPointer(0, TESS_PATCH_ATTRIBUTES, GL_FLOAT, GL_FALSE, TESS_PATCH_ATTRIBUTES * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+}
+
+//Draws uploaded patches, the tessellation shader program must already be in use
+inline void DrawPatchArray(unsigned int vao, int vertexCount) {
+	glBindVertexArray(vao);
+	glPatchParameteri(GL_PATCH_VERTICES, TESS_PATCH_VERTICES);
+	glDrawArrays(GL_PATCHES, 0, vertexCount);
+}
+
+#endif
@@ -3,11 +3,15 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "glcontext.h"
+#include "resourceregistry.h"
+#include "mipchain.h"
 
 #include <vector>
 #include <random>
 #include "stb_image.h"
 #include <iostream>
+#include <cstring>
 
 using namespace std;
 
@@ -16,7 +20,15 @@ class Texture2D
 public:
 
 	//The texture
-	unsigned int Texture;
+	unsigned int Texture = 0;
+
+	//Load settings, kept so CPU-side consumers (software renderer) can load the same image
+	string Path;
+	bool HasAlpha;
+	bool RepeatU;
+	bool RepeatV;
+	bool FlipVertical;
+	bool GenMipMaps;
 
 	//Default Constructor: Path to file, is there an Alpha channel. Will default repeat on U and V, generates MipMaps and Flips Vertical Load
 	Texture2D(const char* path, bool hasAlpha) {
@@ -28,29 +40,127 @@ public:
 		GenerateTexture(path, hasAlpha, repeatTextureU, repeatTextureV, genMipMaps, flipVerticalOnLoad);
 	}
 
+	//Settings only, nothing loaded. DecodePixels (any thread) then UploadPixels (context thread) finish it,
+	//so many textures can be decoded in parallel while GL calls stay on one thread.
+	static Texture2D CreateDeferred(const char* path, bool hasAlpha, bool repeatTextureU, bool repeatTextureV, bool genMipMaps, bool flipVerticalOnLoad) {
+		Texture2D texture;
+		texture.Path = path;
+		texture.HasAlpha = hasAlpha;
+		texture.RepeatU = repeatTextureU;
+		texture.RepeatV = repeatTextureV;
+		texture.GenMipMaps = genMipMaps;
+		texture.FlipVertical = flipVerticalOnLoad;
+		return texture;
+	}
+
+	//Decodes the image into Pixels through LoadMipChain, safe on worker threads. Pixels hold mip level PixelsLevel:
+	//the quality preset's dropped levels are skipped, and with maxSize (for streaming) a mipmapped image is taken further
+	//down until its longer side fits. With CPU mips the levels below come along in MipPixels.
+	void DecodePixels(int maxSize = 0) {
+		MipChainRequest request;
+		request.Path = Path;
+		request.Channels = HasAlpha ? 4 : 3;
+		request.FlipVertical = FlipVertical;
+		request.WrapU = RepeatU;
+		request.WrapV = RepeatV;
+		request.FirstLevel = GenMipMaps ? GetTextureQuality().DropLevels : 0;
+		request.MaxSize = GenMipMaps ? maxSize : 0;
+		request.LevelCount = GenMipMaps && GetTextureQuality().CPUMips ? 0 : 1;
+
+		MipChain chain;
+		Pixels.clear();
+		MipPixels.clear();
+		if (!LoadMipChain(request, chain)) {
+			cout << "FAILURE::LOAD::TEXTURE::" << Path << endl;
+			return;
+		}
+		width = chain.Width;
+		height = chain.Height;
+		DroppedLevels = min(request.FirstLevel, chain.FirstLevel);
+		PixelsLevel = chain.FirstLevel;
+		Pixels = move(chain.Levels[0]);
+		MipPixels.assign(make_move_iterator(chain.Levels.begin() + 1), make_move_iterator(chain.Levels.end()));
+	}
+
+	//Creates the texture from Pixels and frees them. Needs a current GL context.
+	//Pixels shrunk further than the dropped levels (for streaming) go to TextureStreamer::Add instead.
+	void UploadPixels() {
+		if (Pixels.empty() || PixelsLevel != DroppedLevels || !HasCurrentGLContext()) {
+			return;
+		}
+		CreateTexture(&Pixels[0]);
+		vector<unsigned char>().swap(Pixels);
+		vector<vector<unsigned char>>().swap(MipPixels);
+	}
+
+	//Decoded image waiting for UploadPixels, the mip level it is and the CPU made levels below it (empty when the GL makes them)
+	vector<unsigned char> Pixels;
+	int PixelsLevel = 0;
+	vector<vector<unsigned char>> MipPixels;
+
+	//Top levels the quality preset left out, the texture's level 0 is this level of the image
+	int DroppedLevels = 0;
+
+	//Size of the image's level 0, known once decoded
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
 private:
 
-	int width, height, numChannels;
-	unsigned char* data;
+	int width = 0, height = 0, numChannels = 0;
+	unsigned char* data = NULL;
+
+	Texture2D() : HasAlpha(false), RepeatU(true), RepeatV(true), FlipVertical(true), GenMipMaps(true) {}
 
 	//Generate the Texture and store in Texture
 	void GenerateTexture(const char* path, bool hasAlpha, bool repeatU, bool repeatV, bool genMipMaps, bool flip) {
 
+		Path = path;
+		HasAlpha = hasAlpha;
+		RepeatU = repeatU;
+		RepeatV = repeatV;
+		FlipVertical = flip;
+		GenMipMaps = genMipMaps;
+
+		//Headless, nothing to upload to
+		if (!HasCurrentGLContext()) {
+			return;
+		}
+
 		//Flip y-axis during load so images arent flipped upside down
 		stbi_set_flip_vertically_on_load(flip);
 
+		AssetData file;
+		data = ReadAsset(path, file) ? stbi_load_from_memory((const stbi_uc*)file.GetData(), (int)file.GetSize(), &width, &height, &numChannels, 0) : NULL;
+
+		//Generate texture/mipmaps if data is available
+		if (data) {
+			CreateTexture(data);
+		}
+		else {
+			cout << "FAILURE::LOAD::TEXTURE" << endl;
+		}
+
+		//free image memory
+		stbi_image_free(data);
+
+	}
+
+	//Generates the texture object from decoded pixels (RGB, or RGBA when HasAlpha)
+	void CreateTexture(const unsigned char* pixels) {
+
 		//Generate and bind the texture
 		glGenTextures(1, &Texture);
 		glBindTexture(GL_TEXTURE_2D, Texture);
 
 		//Set repeat/wrap settings
-		if (repeatU) {
+		if (RepeatU) {
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		}
 		else {
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		}
-		if (repeatV) {
+		if (RepeatV) {
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		}
 		else {
@@ -58,35 +168,49 @@ private:
 		}
 
 		//Mip map settings
-		if (genMipMaps) {
+		if (GenMipMaps) {
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
 
-		data = stbi_load(path, &width, &height, &numChannels, 0);
-
-		//Generate texture/mipmaps if data is available
-		if (data) {
+		//Dropped levels make the texture smaller, its level 0 is the image's level PixelsLevel
+		int levelWidth = max(1, width >> PixelsLevel);
+		int levelHeight = max(1, height >> PixelsLevel);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1); //Halved RGB rows are rarely a multiple of 4 bytes
 
-			//If the type has support for alpha channel, set this to true
-			if (!hasAlpha) {
-				//           target         miplvl storeFormat  self explanatory   legacy, always 0  format/datatype of source  actual image data
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			}
-			else {
-				//           target         miplvl storeFormat  self explanatory   legacy, always 0  format/datatype of source  actual image data
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-			}
+		//If the type has support for alpha channel, set this to true
+		if (!HasAlpha) {
+			//           target         miplvl storeFormat  self explanatory   legacy, always 0  format/datatype of source  actual image data
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, levelWidth, levelHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		}
+		else {
+			//           target         miplvl storeFormat  self explanatory   legacy, always 0  format/datatype of source  actual image data
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		}
 
+		if (MipPixels.empty()) {
 			glGenerateMipmap(GL_TEXTURE_2D); //Gens all required mipmaps for currently bound texture
 		}
 		else {
-			cout << "FAILURE::LOAD::TEXTURE" << endl;
+			//Levels made by GenerateMipChain
+			GLenum format = HasAlpha ? GL_RGBA : GL_RGB;
+			for (size_t i = 0; i < MipPixels.size(); i++) {
+				int level = (int)i + 1;
+				glTexImage2D(GL_TEXTURE_2D, level, format, max(1, levelWidth >> level), max(1, levelHeight >> level), 0, format, GL_UNSIGNED_BYTE, &MipPixels[i][0]);
+			}
 		}
-
-		//free image memory
-		stbi_image_free(data);
-
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		//Evictable, a smaller level can always be rebuilt from the one above it and the image brings evicted ones back
+		GetResourceRegistry().TrackTexture(Texture, levelWidth, levelHeight, 1, 4, true, Path, true, HasAlpha ? 4 : 3);
+		MipChainRequest source;
+		source.Path = Path;
+		source.Channels = HasAlpha ? 4 : 3;
+		source.FlipVertical = FlipVertical;
+		source.WrapU = RepeatU;
+		source.WrapV = RepeatV;
+		source.FirstLevel = PixelsLevel;
+		GetResourceRegistry().SetTextureSource(Texture, source, width, height);
 	}
 
 };
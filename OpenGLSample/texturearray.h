@@ -0,0 +1,240 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <glad/glad.h>
+#include "glcontext.h"
+#include "texture2d.h"
+#include "threadpool.h"
+#include "stb_image.h"
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+//Where a texture ended up: which array, which layer in it
+struct TextureLayer {
+	int Array = -1;
+	int Layer = -1;
+};
+
+//One GL_TEXTURE_2D_ARRAY, every layer RGBA8 and the same size
+struct TextureArray {
+	unsigned int Texture = 0;
+	int Width = 0;
+	int Height = 0;
+	int Layers = 0;
+	bool RepeatU = true;
+	bool RepeatV = true;
+};
+
+//Collects textures and packs them into as few 2D texture arrays as possible, so switching between
+//materials is a change of layer index instead of a texture bind.
+//Wrap mode lives on the texture object, so repeating and clamped textures go to separate arrays.
+//Within one wrap mode the most common size wins and the rest are resampled to it, images are expanded to RGBA8.
+class TextureArrayBuilder
+{
+public:
+	vector<TextureArray> Arrays;
+
+	//Queues a texture (loaded again from its file) and returns a handle for GetLayer. The same texture twice gets one layer.
+	int Add(const Texture2D& texture) {
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (entries[i].Path == texture.Path && entries[i].RepeatU == texture.RepeatU && entries[i].RepeatV == texture.RepeatV) {
+				return (int)i;
+			}
+		}
+
+		Entry entry;
+		entry.Path = texture.Path;
+		entry.RepeatU = texture.RepeatU;
+		entry.RepeatV = texture.RepeatV;
+		entry.FlipVertical = texture.FlipVertical;
+		entries.push_back(entry);
+		return (int)entries.size() - 1;
+	}
+
+	//Decodes and resamples every image on the thread pool, then uploads the arrays (uploads stay on this thread)
+	void Build() {
+		//Whatever Texture2D loaded last left the global flip flag set, LoadEntry flips by itself
+		stbi_set_flip_vertically_on_load(false);
+		ThreadPool::Shared().ParallelFor(0, (int)entries.size(), [this](int i) {
+			LoadEntry(entries[i]);
+		});
+
+		//One array per wrap mode, sized by the most common image size in it
+		map<pair<bool, bool>, vector<int>> groups;
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (!entries[i].Texels.empty()) {
+				groups[make_pair(entries[i].RepeatU, entries[i].RepeatV)].push_back((int)i);
+			}
+		}
+
+		for (map<pair<bool, bool>, vector<int>>::iterator group = groups.begin(); group != groups.end(); ++group) {
+			map<pair<int, int>, int> sizeCounts;
+			for (int i : group->second) {
+				sizeCounts[make_pair(entries[i].Width, entries[i].Height)]++;
+			}
+			pair<int, int> layerSize = sizeCounts.begin()->first;
+			int bestCount = 0;
+			for (map<pair<int, int>, int>::iterator size = sizeCounts.begin(); size != sizeCounts.end(); ++size) {
+				//Ties go to the larger size, detail is not thrown away when there is no clear winner
+				if (size->second > bestCount || (size->second == bestCount && size->first.first * size->first.second > layerSize.first * layerSize.second)) {
+					layerSize = size->first;
+					bestCount = size->second;
+				}
+			}
+
+			TextureArray textureArray;
+			textureArray.Width = layerSize.first;
+			textureArray.Height = layerSize.second;
+			textureArray.Layers = (int)group->second.size();
+			textureArray.RepeatU = group->first.first;
+			textureArray.RepeatV = group->first.second;
+
+			int arrayIndex = (int)Arrays.size();
+			ThreadPool::Shared().ParallelFor(0, (int)group->second.size(), [&](int layer) {
+				Entry& entry = entries[group->second[layer]];
+				entry.Location.Array = arrayIndex;
+				entry.Location.Layer = layer;
+				if (entry.Width != textureArray.Width || entry.Height != textureArray.Height) {
+					entry.Texels = Resample(entry.Texels, entry.Width, entry.Height, textureArray.Width, textureArray.Height);
+					entry.Width = textureArray.Width;
+					entry.Height = textureArray.Height;
+				}
+			});
+			Upload(textureArray, group->second);
+			Arrays.push_back(textureArray);
+
+			cout << "TEXTUREARRAY::" << textureArray.Width << "x" << textureArray.Height << "::" << textureArray.Layers << " LAYERS::"
+				<< (textureArray.RepeatU ? "REPEAT" : "CLAMP") << endl;
+		}
+
+		//CPU copies are not needed once uploaded
+		for (Entry& entry : entries) {
+			vector<unsigned char>().swap(entry.Texels);
+		}
+	}
+
+	//Array and layer of a texture added before Build
+	TextureLayer GetLayer(int handle) const {
+		return entries[handle].Location;
+	}
+
+	//Texture object of the array a texture was put in, 0 if it failed to load
+	unsigned int GetArrayTexture(int handle) const {
+		int array = entries[handle].Location.Array;
+		return array >= 0 ? Arrays[array].Texture : 0;
+	}
+
+	//De-allocates every array texture
+	void Deallocate() {
+		for (TextureArray& textureArray : Arrays) {
+			GetResourceRegistry().ReleaseTexture(textureArray.Texture);
+			glDeleteTextures(1, &textureArray.Texture);
+			textureArray.Texture = 0;
+		}
+	}
+
+private:
+	struct Entry {
+		string Path;
+		bool RepeatU;
+		bool RepeatV;
+		bool FlipVertical;
+
+		int Width = 0;
+		int Height = 0;
+		vector<unsigned char> Texels; //RGBA8, emptied after Build
+
+		TextureLayer Location;
+	};
+
+	vector<Entry> entries;
+
+	//Runs on worker threads, DecodeImageFile flips the rows itself instead of through stb's global flag
+	static void LoadEntry(Entry& entry) {
+		entry.Texels = DecodeImageFile(entry.Path, 4, entry.FlipVertical, entry.Width, entry.Height);
+		if (entry.Texels.empty()) {
+			cout << "FAILURE::LOAD::TEXTURE_ARRAY::" << entry.Path << endl;
+		}
+	}
+
+	//Separable tent filter. The filter widens when shrinking so every source texel is covered, narrow when enlarging (bilinear).
+	//Horizontal: lines are rows. Vertical: lines are columns.
+	static vector<unsigned char> ResampleAxis(const vector<unsigned char>& source, int sourceLength, int destinationLength, int lineCount, bool horizontal) {
+		size_t texelStride = horizontal ? 4 : (size_t)lineCount * 4;
+		size_t lineStride = horizontal ? (size_t)sourceLength * 4 : 4;
+
+		vector<unsigned char> destination((size_t)destinationLength * lineCount * 4);
+
+		float scale = (float)sourceLength / destinationLength;
+		float radius = max(scale, 1.0f);
+
+		for (int d = 0; d < destinationLength; d++) {
+			float center = (d + 0.5f) * scale - 0.5f;
+			int first = max(0, (int)floor(center - radius));
+			int last = min(sourceLength - 1, (int)ceil(center + radius));
+
+			vector<float> weights;
+			float weightSum = 0.0f;
+			for (int s = first; s <= last; s++) {
+				float weight = max(0.0f, 1.0f - fabs(s - center) / radius);
+				weights.push_back(weight);
+				weightSum += weight;
+			}
+
+			for (int line = 0; line < lineCount; line++) {
+				float sum[4] = {};
+				for (int s = first; s <= last; s++) {
+					const unsigned char* texel = &source[line * lineStride + s * texelStride];
+					float weight = weights[s - first];
+					for (int c = 0; c < 4; c++) {
+						sum[c] += texel[c] * weight;
+					}
+				}
+				size_t outIndex = horizontal ? ((size_t)line * destinationLength + d) * 4 : ((size_t)d * lineCount + line) * 4;
+				for (int c = 0; c < 4; c++) {
+					destination[outIndex + c] = (unsigned char)min(255.0f, sum[c] / weightSum + 0.5f);
+				}
+			}
+		}
+		return destination;
+	}
+
+	//Resizes an RGBA8 image, horizontal pass then vertical pass
+	static vector<unsigned char> Resample(const vector<unsigned char>& texels, int width, int height, int newWidth, int newHeight) {
+		vector<unsigned char> rows = ResampleAxis(texels, width, newWidth, height, true);
+		return ResampleAxis(rows, height, newHeight, newWidth, false);
+	}
+
+	//Allocates every layer and mip of one array, fills the layers and builds the mips
+	void Upload(TextureArray& textureArray, const vector<int>& layers) {
+		if (!HasCurrentGLContext()) {
+			return;
+		}
+
+		glGenTextures(1, &textureArray.Texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.Texture);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, textureArray.RepeatU ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, textureArray.RepeatV ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, textureArray.Width, textureArray.Height, textureArray.Layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		for (int layer = 0; layer < (int)layers.size(); layer++) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, textureArray.Width, textureArray.Height, 1, GL_RGBA, GL_UNSIGNED_BYTE, &entries[layers[layer]].Texels[0]);
+		}
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		GetResourceRegistry().TrackTexture(textureArray.Texture, textureArray.Width, textureArray.Height, textureArray.Layers, 4, true, "material array");
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+};
+
+#endif
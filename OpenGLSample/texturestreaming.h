@@ -0,0 +1,286 @@
+#ifndef TEXTURESTREAMING_H
+#define TEXTURESTREAMING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "glcontext.h"
+#include "texture2d.h"
+#include "material.h"
+#include "boundingsphere.h"
+#include "threadpool.h"
+#include "resourceregistry.h"
+#include "mipchain.h"
+
+#include <vector>
+#include <future>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+/*
+* Mip streaming. A streamed texture gets immutable storage for its whole chain up front but only its small levels are
+* filled: the image is shrunk to STREAM_RESIDENT_SIZE on the decoding thread, uploaded as that level and the rest of
+* the chain generated below it, GL_TEXTURE_BASE_LEVEL clamped to it so the empty levels above are never sampled. Every
+* frame the visible objects ask for the level their materials can show on screen (from the projected size of their
+* bounding sphere), the missing larger levels are decoded on the thread pool and uploaded a few per frame, and the base
+* level is lowered once they are in. The storage is already there, so streamed in levels stay.
+*
+* Storage level 0 is the image's level MinLevel, the levels the quality preset drops are never allocated.
+*/
+
+//Longer side of the largest level loaded up front
+const int STREAM_RESIDENT_SIZE = 128;
+
+//Decodes in flight at once
+const int STREAM_MAX_PENDING = 4;
+
+//Upload bytes per frame. A finished decode that does not fit waits, the first of a frame always goes.
+const size_t STREAM_UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+class TextureStreamer
+{
+public:
+	//Levels finer than the estimate. The sphere only bounds the object, its UVs may repeat or stretch across it.
+	int LevelBias = 1;
+
+	//Levels uploaded since the start
+	int LevelsIn = 0;
+
+	//Takes over a texture decoded with DecodePixels(STREAM_RESIDENT_SIZE): creates it with the levels from PixelsLevel
+	//down and frees Pixels. Textures without mips or small enough to be whole go through UploadPixels.
+	//Levels the quality preset drops are never streamed in.
+	void Add(Texture2D& texture) {
+		if (texture.Pixels.empty() || !HasCurrentGLContext()) {
+			return;
+		}
+		if (!texture.GenMipMaps || texture.PixelsLevel == texture.DroppedLevels) {
+			texture.UploadPixels();
+			return;
+		}
+
+		Streamed streamed;
+		streamed.Source = &texture;
+		streamed.Width = texture.GetWidth();
+		streamed.Height = texture.GetHeight();
+		streamed.Format = texture.HasAlpha ? GL_RGBA : GL_RGB;
+		streamed.LevelCount = (int)floor(log2((double)max(streamed.Width, streamed.Height))) + 1;
+		streamed.MinLevel = texture.DroppedLevels;
+		streamed.FloorLevel = texture.PixelsLevel;
+		streamed.ResidentLevel = texture.PixelsLevel;
+		streamed.WantedLevel = texture.PixelsLevel;
+
+		glGenTextures(1, &texture.Texture);
+		glBindTexture(GL_TEXTURE_2D, texture.Texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.RepeatU ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.RepeatV ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		AllocateStorage(streamed);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, StorageLevel(streamed, streamed.ResidentLevel));
+
+		//Shrunk RGB rows are rarely a multiple of 4 bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		UploadLevel(streamed, streamed.ResidentLevel, &texture.Pixels[0]);
+		if (texture.MipPixels.empty()) {
+			glGenerateMipmap(GL_TEXTURE_2D); //From the base level down
+		}
+		for (size_t i = 0; i < texture.MipPixels.size(); i++) {
+			UploadLevel(streamed, streamed.ResidentLevel + 1 + (int)i, &texture.MipPixels[i][0]);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		streamed.Texture = texture.Texture;
+		streamed.Bytes = TextureBytesWithMips(LevelWidth(streamed, streamed.ResidentLevel), LevelHeight(streamed, streamed.ResidentLevel), 1, 4, true);
+		slots[streamed.Texture] = (int)textures.size();
+		textures.push_back(streamed);
+
+		//The registry gets the whole storage, not evictable there
+		GetResourceRegistry().TrackTexture(streamed.Texture, LevelWidth(streamed, streamed.MinLevel), LevelHeight(streamed, streamed.MinLevel), 1, 4, true, texture.Path + " (streamed)");
+		vector<unsigned char>().swap(texture.Pixels);
+		vector<vector<unsigned char>>().swap(texture.MipPixels);
+	}
+
+	//Asks for enough detail to cover screenTexels across the longer side of the texture. Unknown textures are ignored.
+	void Request(const Texture2D* texture, float screenTexels) {
+		if (texture == NULL) {
+			return;
+		}
+		unordered_map<GLuint, int>::iterator slot = slots.find(texture->Texture);
+		if (slot == slots.end()) {
+			return;
+		}
+		Streamed& streamed = textures[slot->second];
+		int level = screenTexels <= 0.0f ? streamed.FloorLevel : (int)floor(log2(max(streamed.Width, streamed.Height) / screenTexels)) - LevelBias;
+		streamed.WantedLevel = min(streamed.WantedLevel, max(streamed.MinLevel, min(level, streamed.FloorLevel)));
+	}
+
+	//Every texture of a material, sized by the sphere's projected diameter under a perspective or orthographic projection
+	void Request(const Material& material, const BoundingSphere& bounds, const glm::vec3& eye, const glm::mat4& projection, int viewportHeight) {
+		if (bounds.Radius < 0.0f) {
+			return;
+		}
+		float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+		if (projection[2][3] != 0.0f) {
+			pixelsPerUnit /= max(glm::length(bounds.Center - eye) - bounds.Radius, 0.01f); //Perspective, shrinks with distance
+		}
+		float screenTexels = 2.0f * bounds.Radius * pixelsPerUnit;
+		Request(material.Diffuse, screenTexels);
+		Request(material.Specular, screenTexels);
+		Request(material.OverlayDiffuse, screenTexels);
+		Request(material.OverlaySpecular, screenTexels);
+	}
+
+	//Once per frame before drawing: uploads finished decodes, starts decodes by last frame's requests, then clears the
+	//requests for this frame's.
+	void Update() {
+		size_t uploaded = 0;
+		for (size_t i = 0; i < pending.size();) {
+			if (pending[i].Levels.wait_for(chrono::seconds(0)) != future_status::ready || (uploaded > 0 && uploaded >= STREAM_UPLOAD_BYTES_PER_FRAME)) {
+				i++;
+				continue;
+			}
+			uploaded += Upload(textures[pending[i].Slot], pending[i].FirstLevel, pending[i].Levels.get());
+			pending.erase(pending.begin() + i);
+		}
+
+		for (int i = 0; i < (int)textures.size(); i++) {
+			Streamed& streamed = textures[i];
+			if (streamed.WantedLevel < streamed.ResidentLevel && !streamed.Pending && (int)pending.size() < STREAM_MAX_PENDING) {
+				StartDecode(i);
+			}
+			streamed.WantedLevel = streamed.FloorLevel;
+		}
+	}
+
+	//Bytes of every streamed texture's filled levels
+	size_t GetResidentBytes() const {
+		size_t bytes = 0;
+		for (const Streamed& streamed : textures) {
+			bytes += streamed.Bytes;
+		}
+		return bytes;
+	}
+
+	void Report() const {
+		size_t fullBytes = 0;
+		for (const Streamed& streamed : textures) {
+			fullBytes += TextureBytesWithMips(LevelWidth(streamed, streamed.MinLevel), LevelHeight(streamed, streamed.MinLevel), 1, 4, true);
+		}
+		cout << "STREAMING::" << textures.size() << " TEXTURES::" << LevelsIn << " LEVELS IN::RESIDENT "
+			<< GetResidentBytes() / 1024 << "KB OF " << fullBytes / 1024 << "KB" << endl;
+	}
+
+	//Waits for decodes still running, their results are dropped. The textures themselves belong to their Texture2D.
+	void Finish() {
+		for (Decode& decode : pending) {
+			decode.Levels.wait();
+		}
+		pending.clear();
+	}
+
+private:
+	struct Streamed {
+		const Texture2D* Source = NULL;
+		GLuint Texture = 0;
+		int Width = 0, Height = 0; //Of level 0
+		GLenum Format = GL_RGBA;
+		int LevelCount = 1;
+		int MinLevel = 0;		//Finest ever streamed in and storage level 0, below it the quality preset's dropped levels
+		int FloorLevel = 0;		//Loaded up front
+		int ResidentLevel = 0;	//The base level
+		int WantedLevel = 0;	//Finest asked for this frame
+		bool Pending = false;
+		size_t Bytes = 0;		//Of the filled levels
+	};
+
+	//Levels FirstLevel up to the resident level, finest first
+	struct Decode {
+		int Slot;
+		int FirstLevel;
+		future<vector<vector<unsigned char>>> Levels;
+	};
+
+	vector<Streamed> textures;
+	unordered_map<GLuint, int> slots;
+	vector<Decode> pending;
+
+	static int LevelWidth(const Streamed& streamed, int level) { return max(1, streamed.Width >> level); }
+	static int LevelHeight(const Streamed& streamed, int level) { return max(1, streamed.Height >> level); }
+	static GLint StorageLevel(const Streamed& streamed, int level) { return level - streamed.MinLevel; }
+
+	//Every level from MinLevel down, into the bound texture. Contexts before 4.2 have no glTexStorage2D and define the
+	//same levels empty instead, the base level keeps them out of sampling all the same.
+	static void AllocateStorage(const Streamed& streamed) {
+		int levels = streamed.LevelCount - streamed.MinLevel;
+		if (GLAD_GL_VERSION_4_2) {
+			glTexStorage2D(GL_TEXTURE_2D, levels, streamed.Format == GL_RGBA ? GL_RGBA8 : GL_RGB8, LevelWidth(streamed, streamed.MinLevel), LevelHeight(streamed, streamed.MinLevel));
+			return;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		for (int level = streamed.MinLevel; level < streamed.LevelCount; level++) {
+			glTexImage2D(GL_TEXTURE_2D, StorageLevel(streamed, level), streamed.Format, LevelWidth(streamed, level), LevelHeight(streamed, level), 0, streamed.Format, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+
+	//Fills an image level of the bound texture
+	static void UploadLevel(const Streamed& streamed, int level, const unsigned char* pixels) {
+		glTexSubImage2D(GL_TEXTURE_2D, StorageLevel(streamed, level), 0, 0, LevelWidth(streamed, level), LevelHeight(streamed, level), streamed.Format, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	//From the mip cache with CPU mips, otherwise the file is decoded whole and halved down (stb can not decode smaller)
+	void StartDecode(int slot) {
+		Streamed& streamed = textures[slot];
+		streamed.Pending = true;
+
+		MipChainRequest request;
+		request.Path = streamed.Source->Path;
+		request.Channels = streamed.Format == GL_RGBA ? 4 : 3;
+		request.FlipVertical = streamed.Source->FlipVertical;
+		request.WrapU = streamed.Source->RepeatU;
+		request.WrapV = streamed.Source->RepeatV;
+		request.FirstLevel = streamed.WantedLevel;
+		request.LevelCount = streamed.ResidentLevel - streamed.WantedLevel;
+
+		Decode decode;
+		decode.Slot = slot;
+		decode.FirstLevel = request.FirstLevel;
+		decode.Levels = ThreadPool::Shared().Enqueue([request]() {
+			MipChain chain;
+			if (!LoadMipChain(request, chain) || chain.FirstLevel != request.FirstLevel) {
+				return vector<vector<unsigned char>>();
+			}
+			return move(chain.Levels);
+		});
+		pending.push_back(move(decode));
+	}
+
+	//Fills the levels in and moves the base level up to the first, returns the bytes uploaded
+	size_t Upload(Streamed& streamed, int firstLevel, const vector<vector<unsigned char>>& levels) {
+		streamed.Pending = false;
+		if (levels.empty() || firstLevel + (int)levels.size() != streamed.ResidentLevel) {
+			cout << "FAILURE::STREAMING::TEXTURE::" << streamed.Source->Path << endl;
+			return 0;
+		}
+
+		size_t bytes = 0;
+		glBindTexture(GL_TEXTURE_2D, streamed.Texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (size_t i = 0; i < levels.size(); i++) {
+			UploadLevel(streamed, firstLevel + (int)i, &levels[i][0]);
+			bytes += levels[i].size();
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, StorageLevel(streamed, firstLevel));
+
+		LevelsIn += (int)levels.size();
+		streamed.ResidentLevel = firstLevel;
+		streamed.Bytes = TextureBytesWithMips(LevelWidth(streamed, firstLevel), LevelHeight(streamed, firstLevel), 1, 4, true);
+		return bytes;
+	}
+};
+
+#endif
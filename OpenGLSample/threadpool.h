@@ -0,0 +1,184 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//Fixed size pool of worker threads. Work is pushed as tasks, or split up with ParallelFor.
+class ThreadPool
+{
+public:
+
+	//Constructor: number of worker threads, 0 uses one per hardware thread (minus the calling thread)
+	ThreadPool(unsigned int threadCount = 0)
+	{
+		if (threadCount == 0) {
+			unsigned int hardwareThreads = thread::hardware_concurrency();
+			threadCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+		}
+
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			lock_guard<mutex> lock(queueMutex);
+			stopping = true;
+		}
+		queueCondition.notify_all();
+
+		for (thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	//Pool shared by the whole application, created on first use
+	static ThreadPool& Shared() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	//Number of worker threads (the thread calling ParallelFor also does work)
+	unsigned int ThreadCount() const {
+		return (unsigned int)workers.size();
+	}
+
+	//Queues a task and returns a future for its result
+	template <typename F>
+	auto Enqueue(F&& task) -> future<decltype(task())>
+	{
+		typedef decltype(task()) ResultType;
+		shared_ptr<packaged_task<ResultType()>> packaged = make_shared<packaged_task<ResultType()>>(std::forward<F>(task));
+		future<ResultType> result = packaged->get_future();
+
+		{
+			lock_guard<mutex> lock(queueMutex);
+			tasks.push([packaged]() { (*packaged)(); });
+		}
+		queueCondition.notify_one();
+
+		return result;
+	}
+
+	//Runs body(i) for every i in [begin, end), handing out chunks of grainSize indices at a time.
+	//The calling thread works too and only returns once every index is done, so this is safe to call from inside a task.
+	void ParallelFor(int begin, int end, const function<void(int)>& body, int grainSize = 1)
+	{
+		if (end <= begin) {
+			return;
+		}
+		if (grainSize < 1) {
+			grainSize = 1;
+		}
+
+		int chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+		//Not worth waking anyone up
+		if (chunkCount == 1 || workers.empty()) {
+			for (int i = begin; i < end; i++) {
+				body(i);
+			}
+			return;
+		}
+
+		//Shared so late helpers that find no work left never touch a dead stack frame
+		shared_ptr<ParallelForState> state = make_shared<ParallelForState>();
+		state->begin = begin;
+		state->end = end;
+		state->grainSize = grainSize;
+		state->chunkCount = chunkCount;
+		state->body = &body;
+
+		int helperCount = min((int)workers.size(), chunkCount - 1);
+		{
+			lock_guard<mutex> lock(queueMutex);
+			for (int i = 0; i < helperCount; i++) {
+				tasks.push([state]() { RunChunks(*state); });
+			}
+		}
+		queueCondition.notify_all();
+
+		RunChunks(*state);
+
+		//Wait for chunks other threads picked up
+		unique_lock<mutex> lock(state->doneMutex);
+		state->doneCondition.wait(lock, [&state]() { return state->chunksDone.load() == state->chunkCount; });
+	}
+
+private:
+
+	struct ParallelForState {
+		int begin;
+		int end;
+		int grainSize;
+		int chunkCount;
+		const function<void(int)>* body;
+
+		atomic<int> nextChunk{ 0 };
+		atomic<int> chunksDone{ 0 };
+		mutex doneMutex;
+		condition_variable doneCondition;
+	};
+
+	vector<thread> workers;
+	queue<function<void()>> tasks;
+
+	mutex queueMutex;
+	condition_variable queueCondition;
+	bool stopping = false;
+
+	//Pulls chunks off the shared counter until there are none left
+	static void RunChunks(ParallelForState& state) {
+		int chunk;
+		while ((chunk = state.nextChunk.fetch_add(1)) < state.chunkCount) {
+			int chunkBegin = state.begin + chunk * state.grainSize;
+			int chunkEnd = min(chunkBegin + state.grainSize, state.end);
+
+			for (int i = chunkBegin; i < chunkEnd; i++) {
+				(*state.body)(i);
+			}
+
+			if (state.chunksDone.fetch_add(1) + 1 == state.chunkCount) {
+				lock_guard<mutex> lock(state.doneMutex);
+				state.doneCondition.notify_all();
+			}
+		}
+	}
+
+	//Worker threads sit here waiting for tasks
+	void WorkerLoop() {
+		while (true) {
+			function<void()> task;
+			{
+				unique_lock<mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+				if (stopping && tasks.empty()) {
+					return;
+				}
+
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+};
+
+#endif
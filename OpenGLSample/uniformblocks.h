@@ -0,0 +1,105 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+
+//Binding points of the std140 blocks shared by every scene shader
+const unsigned int FRAME_BLOCK_BINDING = 0;
+const unsigned int OBJECT_BLOCK_BINDING = 1;
+const unsigned int LIGHT_BLOCK_BINDING = 2;
+const unsigned int MATERIAL_BLOCK_BINDING = 3;
+
+const int NR_POINT_LIGHTS = 4;
+
+//The structs below mirror the std140 blocks in the shaders member for member.
+//vec3s are paired with a float (or padding) so each pair fills one 16 byte slot like std140 lays them out.
+
+//FrameData: camera, written once per frame
+struct FrameBlock {
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::vec3 ViewPos;
+	float pad0;
+};
+
+//Normal matrix of a model matrix: the inverse transpose of its upper 3x3, so normals stay perpendicular to the surface
+//under non-uniform scale. Columns are padded to four floats, the way std140 and std430 lay out a mat3.
+inline glm::mat3x4 NormalMatrix(const glm::mat4& model) {
+	return glm::mat3x4(glm::transpose(glm::inverse(glm::mat3(model))));
+}
+
+//ObjectData: per draw transform and its normal matrix
+struct ObjectBlock {
+	glm::mat4 Model;
+	glm::mat3x4 NormalMatrix;
+};
+
+struct DirLightBlock {
+	glm::vec3 Direction;
+	int UseDirectionalLight;
+	glm::vec3 Ambient;
+	float pad0;
+	glm::vec3 Diffuse;
+	float pad1;
+	glm::vec3 Specular;
+	float pad2;
+};
+
+struct PointLightBlock {
+	glm::vec3 Position;
+	float Constant;
+	glm::vec3 Ambient;
+	float Linear;
+	glm::vec3 Diffuse;
+	float Quadratic;
+	glm::vec3 Specular;
+	float pad0;
+};
+
+struct SpotLightBlock {
+	glm::vec3 Position;
+	int UseSpotLight;
+	glm::vec3 Direction;
+	float CutOff;
+	glm::vec3 Ambient;
+	float OuterCutOff;
+	glm::vec3 Diffuse;
+	float Constant;
+	glm::vec3 Specular;
+	float Linear;
+	float Quadratic;
+	float pad0[3];
+};
+
+//LightData: every light in the scene, written once per frame
+struct LightBlock {
+	DirLightBlock DirLight;
+	PointLightBlock PointLights[NR_POINT_LIGHTS];
+	SpotLightBlock SpotLight;
+};
+
+//MaterialData: per material parameters, baked once into the material table (see material.h)
+struct MaterialBlock {
+	int UseOverlayTexture;
+	float Shininess;
+	float pad0[2];
+};
+
+static_assert(sizeof(FrameBlock) == 144, "FrameBlock must match the std140 FrameData block");
+static_assert(sizeof(DirLightBlock) == 64, "DirLightBlock must match the std140 DirLight struct");
+static_assert(sizeof(PointLightBlock) == 64, "PointLightBlock must match the std140 PointLight struct");
+static_assert(sizeof(SpotLightBlock) == 96, "SpotLightBlock must match the std140 SpotLight struct");
+static_assert(sizeof(LightBlock) == 416, "LightBlock must match the std140 LightData block");
+static_assert(sizeof(MaterialBlock) == 16, "MaterialBlock must match the std140 MaterialData block");
+
+//Points a program's blocks at the shared binding points, blocks the program doesn't use are skipped
+inline void BindSceneUniformBlocks(Shader& shader) {
+	shader.setBlockBinding("FrameData", FRAME_BLOCK_BINDING);
+	shader.setBlockBinding("ObjectData", OBJECT_BLOCK_BINDING);
+	shader.setBlockBinding("LightData", LIGHT_BLOCK_BINDING);
+	shader.setBlockBinding("MaterialData", MATERIAL_BLOCK_BINDING);
+}
+
+#endif